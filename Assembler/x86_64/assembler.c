@@ -0,0 +1,709 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "assembler.h"
+
+// Code buffer
+int CodeBuffer__init(CODE_BUFFER* buffer, uint64_t capacity) {
+	memset(buffer, 0, sizeof(CODE_BUFFER));
+	if(capacity == 0) {
+		capacity = 64;
+	}
+	buffer->data = malloc(capacity);
+	if(buffer->data == NULL) {
+		printf("[ERROR] Could not allocate code buffer.\n");
+		return -1;
+	}
+	buffer->capacity = capacity;
+	return 0;
+}
+
+void CodeBuffer__free(CODE_BUFFER* buffer) {
+	for(int i = 0;i < buffer->label_count;i++) {
+		free(buffer->labels[i].name);
+	}
+	for(int i = 0;i < buffer->relocation_count;i++) {
+		free(buffer->relocations[i].symbol);
+	}
+	free(buffer->labels);
+	free(buffer->relocations);
+	free(buffer->debug);
+	free(buffer->data);
+	memset(buffer, 0, sizeof(CODE_BUFFER));
+}
+
+static int CodeBuffer__grow(CODE_BUFFER* buffer, uint64_t length) {
+	if(buffer->size + length <= buffer->capacity) {
+		return 0;
+	}
+	uint64_t capacity = buffer->capacity ? buffer->capacity : 64;
+	while(capacity < buffer->size + length) {
+		capacity = capacity * 2;
+	}
+	uint8_t* data = realloc(buffer->data, capacity);
+	if(data == NULL) {
+		printf("[ERROR] Could not grow code buffer.\n");
+		return -1;
+	}
+	buffer->data = data;
+	buffer->capacity = capacity;
+	return 0;
+}
+
+int CodeBuffer__emit(CODE_BUFFER* buffer, const void* bytes, uint64_t length) {
+	if(CodeBuffer__grow(buffer, length) != 0) {
+		return -1;
+	}
+	memcpy(buffer->data + buffer->size, bytes, length);
+	buffer->size = buffer->size + length;
+	return 0;
+}
+
+int CodeBuffer__byte(CODE_BUFFER* buffer, uint8_t value) {
+	return CodeBuffer__emit(buffer, &value, 1);
+}
+
+int CodeBuffer__u32(CODE_BUFFER* buffer, uint32_t value) {
+	// Little endian
+	uint8_t bytes[4] = { value, value >> 8, value >> 16, value >> 24 };
+	return CodeBuffer__emit(buffer, bytes, 4);
+}
+
+int CodeBuffer__u64(CODE_BUFFER* buffer, uint64_t value) {
+	if(CodeBuffer__u32(buffer, (uint32_t)value) != 0) {
+		return -1;
+	}
+	return CodeBuffer__u32(buffer, (uint32_t)(value >> 32));
+}
+
+int CodeBuffer__zero(CODE_BUFFER* buffer, uint64_t length) {
+	if(CodeBuffer__grow(buffer, length) != 0) {
+		return -1;
+	}
+	memset(buffer->data + buffer->size, 0, length);
+	buffer->size = buffer->size + length;
+	return 0;
+}
+
+int CodeBuffer__align(CODE_BUFFER* buffer, uint64_t alignment, uint8_t fill) {
+	while(alignment > 1 && buffer->size % alignment != 0) {
+		if(CodeBuffer__byte(buffer, fill) != 0) {
+			return -1;
+		}
+	}
+	return 0;
+}
+
+int CodeBuffer__label(CODE_BUFFER* buffer, const char* name, bool global) {
+	return CodeBuffer__label_at(buffer, buffer->size, name, global);
+}
+
+int CodeBuffer__label_at(CODE_BUFFER* buffer, uint64_t offset, const char* name, bool global) {
+	if(buffer->label_count >= buffer->max_labels) {
+		int max_labels = buffer->max_labels ? buffer->max_labels * 2 : 16;
+		CODE_LABEL* labels = realloc(buffer->labels, max_labels * sizeof(CODE_LABEL));
+		if(labels == NULL) {
+			printf("[ERROR] Could not grow label table.\n");
+			return -1;
+		}
+		buffer->labels = labels;
+		buffer->max_labels = max_labels;
+	}
+	CODE_LABEL* label = &buffer->labels[buffer->label_count];
+	label->name = strdup(name);
+	label->offset = offset;
+	label->size = 0;
+	label->global = global;
+	label->exported = false;
+	return buffer->label_count++;
+}
+
+int CodeBuffer__relocation(CODE_BUFFER* buffer, const char* symbol, int type, int64_t addend) {
+	if(CodeBuffer__relocation_at(buffer, buffer->size, symbol, type, addend) != 0) {
+		return -1;
+	}
+
+	// Placeholder for the field
+	return CodeBuffer__zero(buffer, type == RELOCATION_ABS64 ? 8 : 4);
+}
+
+int CodeBuffer__relocation_at(CODE_BUFFER* buffer, uint64_t offset, const char* symbol, int type, int64_t addend) {
+	if(buffer->relocation_count >= buffer->max_relocations) {
+		int max_relocations = buffer->max_relocations ? buffer->max_relocations * 2 : 16;
+		CODE_RELOCATION* relocations = realloc(buffer->relocations, max_relocations * sizeof(CODE_RELOCATION));
+		if(relocations == NULL) {
+			printf("[ERROR] Could not grow relocation table.\n");
+			return -1;
+		}
+		buffer->relocations = relocations;
+		buffer->max_relocations = max_relocations;
+	}
+	CODE_RELOCATION* relocation = &buffer->relocations[buffer->relocation_count];
+	relocation->symbol = strdup(symbol);
+	relocation->offset = offset;
+	relocation->type = type;
+	relocation->addend = addend;
+	buffer->relocation_count++;
+	return 0;
+}
+
+int CodeBuffer__debug(CODE_BUFFER* buffer, int kind, int value, int column) {
+	return CodeBuffer__debug_at(buffer, buffer->size, kind, value, column);
+}
+
+int CodeBuffer__debug_at(CODE_BUFFER* buffer, uint64_t offset, int kind, int value, int column) {
+	if(buffer->debug_count >= buffer->max_debug) {
+		int max_debug = buffer->max_debug ? buffer->max_debug * 2 : 16;
+		CODE_DEBUG* debug = realloc(buffer->debug, max_debug * sizeof(CODE_DEBUG));
+		if(debug == NULL) {
+			printf("[ERROR] Could not grow debug table.\n");
+			return -1;
+		}
+		buffer->debug = debug;
+		buffer->max_debug = max_debug;
+	}
+	CODE_DEBUG* row = &buffer->debug[buffer->debug_count++];
+	row->offset = offset;
+	row->kind = kind;
+	row->value = value;
+	row->column = column;
+	return 0;
+}
+
+int CodeBuffer__find_label(CODE_BUFFER* buffer, const char* name) {
+	for(int i = 0;i < buffer->label_count;i++) {
+		if(strcmp(buffer->labels[i].name, name) == 0) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+int CodeBuffer__patch_rel32(CODE_BUFFER* buffer, uint64_t field, uint64_t target) {
+	// Relative to the end of the 4 byte field
+	int64_t value = (int64_t)target - (int64_t)(field + 4);
+	if(value < INT32_MIN || value > INT32_MAX) {
+		printf("[ERROR] Local jump out of range.\n");
+		return -1;
+	}
+	int32_t value32 = (int32_t)value;
+	memcpy(buffer->data + field, &value32, 4);
+	return 0;
+}
+
+// Instruction encoding
+static int Assembler__rex(CODE_BUFFER* buffer, bool w, int reg, int base, bool force) {
+	uint8_t rex = 0x40;
+	if(w) {
+		rex |= 0x08;
+	}
+	if(reg >= REGISTER_R8 && reg <= REGISTER_R15) {
+		rex |= 0x04;
+	}
+	if(base >= REGISTER_R8 && base <= REGISTER_R15) {
+		rex |= 0x01;
+	}
+	if(rex != 0x40 || force) {
+		return CodeBuffer__byte(buffer, rex);
+	}
+	return 0;
+}
+
+static int Assembler__modrm_register(CODE_BUFFER* buffer, int reg, int rm) {
+	return CodeBuffer__byte(buffer, 0xC0 | ((reg & 7) << 3) | (rm & 7));
+}
+
+// Writes ModRM (+ SIB + displacement) for a memory operand.
+// "trailing" is the number of immediate bytes following the operand (needed for RIP relative addends).
+// An 8 bit displacement is multiplied by "scale" (EVEX disp8*N compression, 1 otherwise).
+static int Assembler__modrm_memory_scaled(CODE_BUFFER* buffer, int reg, MEMORY_OPERAND memory, int trailing, int32_t scale) {
+	if(memory.base == REGISTER_RIP) {
+		if(CodeBuffer__byte(buffer, ((reg & 7) << 3) | 0x05) != 0) {
+			return -1;
+		}
+		return CodeBuffer__relocation(buffer, memory.symbol, RELOCATION_REL32, (int64_t)memory.displacement - 4 - trailing);
+	}
+
+	int mod = 2;
+	if(memory.displacement == 0 && (memory.base & 7) != REGISTER_RBP) {
+		mod = 0;
+	}
+	else if(memory.displacement % scale == 0 && memory.displacement / scale >= -128 && memory.displacement / scale <= 127) {
+		mod = 1;
+	}
+	if(CodeBuffer__byte(buffer, (mod << 6) | ((reg & 7) << 3) | (memory.base & 7)) != 0) {
+		return -1;
+	}
+	if((memory.base & 7) == REGISTER_RSP) {
+		// rsp/r12 need a SIB byte
+		if(CodeBuffer__byte(buffer, 0x24) != 0) {
+			return -1;
+		}
+	}
+	if(mod == 1) {
+		return CodeBuffer__byte(buffer, (uint8_t)(memory.displacement / scale));
+	}
+	else if(mod == 2) {
+		return CodeBuffer__u32(buffer, (uint32_t)memory.displacement);
+	}
+	return 0;
+}
+
+static int Assembler__modrm_memory(CODE_BUFFER* buffer, int reg, MEMORY_OPERAND memory, int trailing) {
+	return Assembler__modrm_memory_scaled(buffer, reg, memory, trailing, 1);
+}
+
+static int Assembler__memory_base(MEMORY_OPERAND memory) {
+	return memory.base == REGISTER_RIP ? REGISTER_RAX : memory.base;
+}
+
+MEMORY_OPERAND Assembler__memory(int base, int32_t displacement) {
+	MEMORY_OPERAND memory = { base, displacement, NULL };
+	return memory;
+}
+
+MEMORY_OPERAND Assembler__symbol(const char* symbol, int32_t addend) {
+	MEMORY_OPERAND memory = { REGISTER_RIP, addend, (char*)symbol };
+	return memory;
+}
+
+int Assembler__push(CODE_BUFFER* buffer, int reg) {
+	if(Assembler__rex(buffer, false, REGISTER_RAX, reg, false) != 0) {
+		return -1;
+	}
+	return CodeBuffer__byte(buffer, 0x50 + (reg & 7));
+}
+
+int Assembler__pop(CODE_BUFFER* buffer, int reg) {
+	if(Assembler__rex(buffer, false, REGISTER_RAX, reg, false) != 0) {
+		return -1;
+	}
+	return CodeBuffer__byte(buffer, 0x58 + (reg & 7));
+}
+
+int Assembler__ret(CODE_BUFFER* buffer) {
+	return CodeBuffer__byte(buffer, 0xC3);
+}
+
+int Assembler__syscall(CODE_BUFFER* buffer) {
+	uint8_t bytes[2] = { 0x0F, 0x05 };
+	return CodeBuffer__emit(buffer, bytes, 2);
+}
+
+int Assembler__rep_stosb(CODE_BUFFER* buffer) {
+	uint8_t bytes[2] = { 0xF3, 0xAA };
+	return CodeBuffer__emit(buffer, bytes, 2);
+}
+
+int Assembler__rep_movsb(CODE_BUFFER* buffer) {
+	uint8_t bytes[2] = { 0xF3, 0xA4 };
+	return CodeBuffer__emit(buffer, bytes, 2);
+}
+
+int Assembler__mov_reg_reg(CODE_BUFFER* buffer, int destination, int source) {
+	if(Assembler__rex(buffer, true, source, destination, false) != 0 || CodeBuffer__byte(buffer, 0x89) != 0) {
+		return -1;
+	}
+	return Assembler__modrm_register(buffer, source, destination);
+}
+
+int Assembler__mov_reg_imm32(CODE_BUFFER* buffer, int reg, uint32_t value) {
+	// Zero extends into the full register
+	if(Assembler__rex(buffer, false, REGISTER_RAX, reg, false) != 0 || CodeBuffer__byte(buffer, 0xB8 + (reg & 7)) != 0) {
+		return -1;
+	}
+	return CodeBuffer__u32(buffer, value);
+}
+
+int Assembler__mov_reg_imm64(CODE_BUFFER* buffer, int reg, uint64_t value) {
+	if(value <= 0xFFFFFFFFull) {
+		return Assembler__mov_reg_imm32(buffer, reg, (uint32_t)value);
+	}
+	if((int64_t)value >= INT32_MIN && (int64_t)value <= INT32_MAX) {
+		// mov r/m64, imm32 (sign extended)
+		if(Assembler__rex(buffer, true, REGISTER_RAX, reg, false) != 0 || CodeBuffer__byte(buffer, 0xC7) != 0 ||
+		   Assembler__modrm_register(buffer, 0, reg) != 0) {
+			return -1;
+		}
+		return CodeBuffer__u32(buffer, (uint32_t)value);
+	}
+	if(Assembler__rex(buffer, true, REGISTER_RAX, reg, false) != 0 || CodeBuffer__byte(buffer, 0xB8 + (reg & 7)) != 0) {
+		return -1;
+	}
+	return CodeBuffer__u64(buffer, value);
+}
+
+int Assembler__mov_reg_symbol(CODE_BUFFER* buffer, int reg, const char* symbol) {
+	// movabs reg, symbol
+	if(Assembler__rex(buffer, true, REGISTER_RAX, reg, false) != 0 || CodeBuffer__byte(buffer, 0xB8 + (reg & 7)) != 0) {
+		return -1;
+	}
+	return CodeBuffer__relocation(buffer, symbol, RELOCATION_ABS64, 0);
+}
+
+int Assembler__lea_reg_mem(CODE_BUFFER* buffer, int reg, MEMORY_OPERAND memory) {
+	if(Assembler__rex(buffer, true, reg, Assembler__memory_base(memory), false) != 0 || CodeBuffer__byte(buffer, 0x8D) != 0) {
+		return -1;
+	}
+	return Assembler__modrm_memory(buffer, reg, memory, 0);
+}
+
+int Assembler__mov_reg_mem(CODE_BUFFER* buffer, int reg, MEMORY_OPERAND memory, int size) {
+	int base = Assembler__memory_base(memory);
+	switch(size) {
+		case 1:
+		case 2: {
+			// movzx r32, r/m8 / r/m16
+			uint8_t opcode[2] = { 0x0F, size == 1 ? 0xB6 : 0xB7 };
+			if(Assembler__rex(buffer, false, reg, base, false) != 0 || CodeBuffer__emit(buffer, opcode, 2) != 0) {
+				return -1;
+			}
+		} break;
+		case 4: {
+			if(Assembler__rex(buffer, false, reg, base, false) != 0 || CodeBuffer__byte(buffer, 0x8B) != 0) {
+				return -1;
+			}
+		} break;
+		case 8: {
+			if(Assembler__rex(buffer, true, reg, base, false) != 0 || CodeBuffer__byte(buffer, 0x8B) != 0) {
+				return -1;
+			}
+		} break;
+		default: {
+			printf("[ERROR] Invalid operand size %d.\n", size);
+			return -1;
+		} break;
+	}
+	return Assembler__modrm_memory(buffer, reg, memory, 0);
+}
+
+int Assembler__mov_mem_reg(CODE_BUFFER* buffer, MEMORY_OPERAND memory, int reg, int size) {
+	int base = Assembler__memory_base(memory);
+	switch(size) {
+		case 1: {
+			// Force REX so that 4-7 select spl/bpl/sil/dil
+			if(Assembler__rex(buffer, false, reg, base, reg >= REGISTER_RSP) != 0 || CodeBuffer__byte(buffer, 0x88) != 0) {
+				return -1;
+			}
+		} break;
+		case 2: {
+			if(CodeBuffer__byte(buffer, 0x66) != 0 || Assembler__rex(buffer, false, reg, base, false) != 0 || CodeBuffer__byte(buffer, 0x89) != 0) {
+				return -1;
+			}
+		} break;
+		case 4:
+		case 8: {
+			if(Assembler__rex(buffer, size == 8, reg, base, false) != 0 || CodeBuffer__byte(buffer, 0x89) != 0) {
+				return -1;
+			}
+		} break;
+		default: {
+			printf("[ERROR] Invalid operand size %d.\n", size);
+			return -1;
+		} break;
+	}
+	return Assembler__modrm_memory(buffer, reg, memory, 0);
+}
+
+int Assembler__mov_mem_imm(CODE_BUFFER* buffer, MEMORY_OPERAND memory, int32_t value, int size) {
+	int base = Assembler__memory_base(memory);
+	int trailing = size > 4 ? 4 : size;
+	if(size == 2 && CodeBuffer__byte(buffer, 0x66) != 0) {
+		return -1;
+	}
+	if(Assembler__rex(buffer, size == 8, REGISTER_RAX, base, false) != 0 || CodeBuffer__byte(buffer, size == 1 ? 0xC6 : 0xC7) != 0) {
+		return -1;
+	}
+	if(Assembler__modrm_memory(buffer, 0, memory, trailing) != 0) {
+		return -1;
+	}
+	switch(size) {
+		case 1: return CodeBuffer__byte(buffer, (uint8_t)value);
+		case 2: return CodeBuffer__emit(buffer, (uint8_t[2]){ (uint8_t)value, (uint8_t)(value >> 8) }, 2);
+		case 4:
+		case 8: return CodeBuffer__u32(buffer, (uint32_t)value);
+	}
+	printf("[ERROR] Invalid operand size %d.\n", size);
+	return -1;
+}
+
+int Assembler__alu_reg_reg(CODE_BUFFER* buffer, int operation, int destination, int source) {
+	if(Assembler__rex(buffer, true, source, destination, false) != 0 || CodeBuffer__byte(buffer, (uint8_t)operation) != 0) {
+		return -1;
+	}
+	return Assembler__modrm_register(buffer, source, destination);
+}
+
+int Assembler__alu_reg_imm32(CODE_BUFFER* buffer, int operation, int reg, int32_t value) {
+	// The "/digit" extension is the operation's opcode divided by 8
+	bool short_form = value >= -128 && value <= 127;
+	if(Assembler__rex(buffer, true, REGISTER_RAX, reg, false) != 0 || CodeBuffer__byte(buffer, short_form ? 0x83 : 0x81) != 0 ||
+	   Assembler__modrm_register(buffer, operation >> 3, reg) != 0) {
+		return -1;
+	}
+	if(short_form) {
+		return CodeBuffer__byte(buffer, (uint8_t)value);
+	}
+	return CodeBuffer__u32(buffer, (uint32_t)value);
+}
+
+int Assembler__alu_mem_reg(CODE_BUFFER* buffer, int operation, MEMORY_OPERAND memory, int reg, bool lock) {
+	// 64 bit "operation [memory], reg", lock makes the read-modify-write atomic
+	if(lock && CodeBuffer__byte(buffer, 0xF0) != 0) {
+		return -1;
+	}
+	if(Assembler__rex(buffer, true, reg, Assembler__memory_base(memory), false) != 0 || CodeBuffer__byte(buffer, (uint8_t)operation) != 0) {
+		return -1;
+	}
+	return Assembler__modrm_memory(buffer, reg, memory, 0);
+}
+
+int Assembler__alu_mem_imm32(CODE_BUFFER* buffer, int operation, MEMORY_OPERAND memory, int32_t value, bool lock) {
+	// 64 bit "operation qword [memory], value"
+	bool short_form = value >= -128 && value <= 127;
+	if(lock && CodeBuffer__byte(buffer, 0xF0) != 0) {
+		return -1;
+	}
+	if(Assembler__rex(buffer, true, REGISTER_RAX, Assembler__memory_base(memory), false) != 0 || CodeBuffer__byte(buffer, short_form ? 0x83 : 0x81) != 0 ||
+	   Assembler__modrm_memory(buffer, operation >> 3, memory, short_form ? 1 : 4) != 0) {
+		return -1;
+	}
+	if(short_form) {
+		return CodeBuffer__byte(buffer, (uint8_t)value);
+	}
+	return CodeBuffer__u32(buffer, (uint32_t)value);
+}
+
+int Assembler__shl_reg_imm8(CODE_BUFFER* buffer, int reg, uint8_t count) {
+	return Assembler__shift_reg_imm8(buffer, SHIFT_SHL, reg, count);
+}
+
+int Assembler__shift_reg_imm8(CODE_BUFFER* buffer, int operation, int reg, uint8_t count) {
+	// 64 bit, shifts by one have their own opcode
+	if(Assembler__rex(buffer, true, REGISTER_RAX, reg, false) != 0 || CodeBuffer__byte(buffer, count == 1 ? 0xD1 : 0xC1) != 0 ||
+	   Assembler__modrm_register(buffer, operation, reg) != 0) {
+		return -1;
+	}
+	if(count == 1) {
+		return 0;
+	}
+	return CodeBuffer__byte(buffer, count);
+}
+
+int Assembler__lea_reg_index(CODE_BUFFER* buffer, int reg, int base, int index, int scale) {
+	// "lea reg, [base + index * scale]" (scale 1, 2, 4 or 8, rsp can not be an index)
+	static const uint8_t factors[9] = { 0, 0, 1, 0, 2, 0, 0, 0, 3 };
+	if(index == REGISTER_RSP || scale < 1 || scale > 8 || (scale != 1 && factors[scale] == 0)) {
+		printf("[ERROR] Invalid index operand.\n");
+		return -1;
+	}
+	uint8_t rex = 0x48 | (reg >= REGISTER_R8 ? 0x04 : 0) | (index >= REGISTER_R8 ? 0x02 : 0) | (base >= REGISTER_R8 ? 0x01 : 0);
+	// rbp/r13 as base only exist with a displacement
+	bool displacement = (base & 7) == REGISTER_RBP;
+	uint8_t bytes[5] = { rex, 0x8D, (uint8_t)((displacement ? 0x44 : 0x04) | ((reg & 7) << 3)), (uint8_t)((factors[scale] << 6) | ((index & 7) << 3) | (base & 7)), 0 };
+	return CodeBuffer__emit(buffer, bytes, displacement ? 5 : 4);
+}
+
+int Assembler__imul_reg_reg(CODE_BUFFER* buffer, int destination, int source) {
+	// 64 bit, low half of the product
+	uint8_t opcode[2] = { 0x0F, 0xAF };
+	if(Assembler__rex(buffer, true, destination, source, false) != 0 || CodeBuffer__emit(buffer, opcode, 2) != 0) {
+		return -1;
+	}
+	return Assembler__modrm_register(buffer, destination, source);
+}
+
+int Assembler__imul_reg_imm32(CODE_BUFFER* buffer, int destination, int source, int32_t value) {
+	// "destination = source * value", 64 bit
+	bool short_form = value >= -128 && value <= 127;
+	if(Assembler__rex(buffer, true, destination, source, false) != 0 || CodeBuffer__byte(buffer, short_form ? 0x6B : 0x69) != 0 ||
+	   Assembler__modrm_register(buffer, destination, source) != 0) {
+		return -1;
+	}
+	if(short_form) {
+		return CodeBuffer__byte(buffer, (uint8_t)value);
+	}
+	return CodeBuffer__u32(buffer, (uint32_t)value);
+}
+
+int Assembler__mul_reg(CODE_BUFFER* buffer, int reg, bool is_signed) {
+	// rdx:rax = rax * reg (mul or one operand imul)
+	if(Assembler__rex(buffer, true, REGISTER_RAX, reg, false) != 0 || CodeBuffer__byte(buffer, 0xF7) != 0) {
+		return -1;
+	}
+	return Assembler__modrm_register(buffer, is_signed ? 5 : 4, reg);
+}
+
+int Assembler__div_reg(CODE_BUFFER* buffer, int reg, int size, bool is_signed) {
+	// edx:eax / reg (size 4) or rdx:rax / reg (size 8), quotient in rax, remainder in rdx
+	if(Assembler__rex(buffer, size == 8, REGISTER_RAX, reg, false) != 0 || CodeBuffer__byte(buffer, 0xF7) != 0) {
+		return -1;
+	}
+	return Assembler__modrm_register(buffer, is_signed ? 7 : 6, reg);
+}
+
+int Assembler__cdq(CODE_BUFFER* buffer, int size) {
+	// Sign of eax into edx (cdq) or of rax into rdx (cqo)
+	if(size == 8 && Assembler__rex(buffer, true, REGISTER_RAX, REGISTER_RAX, false) != 0) {
+		return -1;
+	}
+	return CodeBuffer__byte(buffer, 0x99);
+}
+
+int Assembler__neg_reg(CODE_BUFFER* buffer, int reg) {
+	if(Assembler__rex(buffer, true, REGISTER_RAX, reg, false) != 0 || CodeBuffer__byte(buffer, 0xF7) != 0) {
+		return -1;
+	}
+	return Assembler__modrm_register(buffer, 3, reg);
+}
+
+int Assembler__extend_reg(CODE_BUFFER* buffer, int reg, int size, bool is_signed) {
+	// Sign or zero extends the low size bytes of reg into all 64 bit
+	switch(size) {
+		case 1:
+		case 2: {
+			// movsx/movzx r64, r/m8 / r/m16 (REX.W also selects spl/bpl/sil/dil)
+			uint8_t opcode[2] = { 0x0F, (uint8_t)((is_signed ? 0xBE : 0xB6) + (size == 2)) };
+			if(Assembler__rex(buffer, true, reg, reg, false) != 0 || CodeBuffer__emit(buffer, opcode, 2) != 0) {
+				return -1;
+			}
+		} break;
+		case 4: {
+			// movsxd r64, r/m32 or "mov r32, r32" (zero extends)
+			if(Assembler__rex(buffer, is_signed, reg, reg, false) != 0 || CodeBuffer__byte(buffer, is_signed ? 0x63 : 0x89) != 0) {
+				return -1;
+			}
+		} break;
+		case 8: {
+			return 0;
+		}
+		default: {
+			printf("[ERROR] Invalid operand size %d.\n", size);
+			return -1;
+		} break;
+	}
+	return Assembler__modrm_register(buffer, reg, reg);
+}
+
+static int Assembler__vector_prefix(CODE_BUFFER* buffer, int reg, MEMORY_OPERAND memory, int size) {
+	// movdqu (16 byte, SSE2), vmovdqu (32 byte, VEX.256) or vmovdqu64 (64 byte, EVEX.512), all F3 0F
+	int base = Assembler__memory_base(memory);
+	uint8_t r = reg >= REGISTER_R8 ? 0x00 : 0x80;     // Inverted in VEX and EVEX
+	uint8_t b = base >= REGISTER_R8 ? 0x00 : 0x20;
+	switch(size) {
+		case 16: {
+			if(CodeBuffer__byte(buffer, 0xF3) != 0 || Assembler__rex(buffer, false, reg, base, false) != 0) {
+				return -1;
+			}
+			return CodeBuffer__byte(buffer, 0x0F);
+		}
+		case 32: {
+			if(b != 0) {
+				// Two byte VEX: R, vvvv = 1111, L = 1, pp = F3
+				uint8_t bytes[2] = { 0xC5, (uint8_t)(r | 0x7E) };
+				return CodeBuffer__emit(buffer, bytes, 2);
+			}
+			// Three byte VEX for r8-r15 as base: map 0F, W = 0
+			uint8_t bytes[3] = { 0xC4, (uint8_t)(r | 0x40 | b | 0x01), 0x7E };
+			return CodeBuffer__emit(buffer, bytes, 3);
+		}
+		case 64: {
+			// EVEX: R X B R' map 0F, W = 1 vvvv = 1111 pp = F3, L'L = 512 V' = 1 no mask
+			uint8_t bytes[4] = { 0x62, (uint8_t)(r | 0x40 | b | 0x10 | 0x01), 0xFE, 0x48 };
+			return CodeBuffer__emit(buffer, bytes, 4);
+		}
+	}
+	printf("[ERROR] Invalid vector size %d.\n", size);
+	return -1;
+}
+
+int Assembler__movdqu_reg_mem(CODE_BUFFER* buffer, int reg, MEMORY_OPERAND memory, int size) {
+	// Unaligned load into xmm/ymm/zmm "reg"
+	if(Assembler__vector_prefix(buffer, reg, memory, size) != 0 || CodeBuffer__byte(buffer, 0x6F) != 0) {
+		return -1;
+	}
+	return Assembler__modrm_memory_scaled(buffer, reg, memory, 0, size == 64 ? 64 : 1);
+}
+
+int Assembler__movdqu_mem_reg(CODE_BUFFER* buffer, MEMORY_OPERAND memory, int reg, int size) {
+	// Unaligned store of xmm/ymm/zmm "reg"
+	if(Assembler__vector_prefix(buffer, reg, memory, size) != 0 || CodeBuffer__byte(buffer, 0x7F) != 0) {
+		return -1;
+	}
+	return Assembler__modrm_memory_scaled(buffer, reg, memory, 0, size == 64 ? 64 : 1);
+}
+
+int Assembler__vzeroupper(CODE_BUFFER* buffer) {
+	// Avoids the penalty of SSE code after ymm/zmm code
+	uint8_t bytes[3] = { 0xC5, 0xF8, 0x77 };
+	return CodeBuffer__emit(buffer, bytes, 3);
+}
+
+int Assembler__rdtsc(CODE_BUFFER* buffer) {
+	// Time stamp counter in edx:eax
+	uint8_t bytes[2] = { 0x0F, 0x31 };
+	return CodeBuffer__emit(buffer, bytes, 2);
+}
+
+int Assembler__xor_reg32(CODE_BUFFER* buffer, int reg) {
+	if(Assembler__rex(buffer, false, reg, reg, false) != 0 || CodeBuffer__byte(buffer, ALU_XOR) != 0) {
+		return -1;
+	}
+	return Assembler__modrm_register(buffer, reg, reg);
+}
+
+int Assembler__call_symbol(CODE_BUFFER* buffer, const char* symbol) {
+	if(CodeBuffer__byte(buffer, 0xE8) != 0) {
+		return -1;
+	}
+	return CodeBuffer__relocation(buffer, symbol, RELOCATION_REL32, -4);
+}
+
+int Assembler__call_plt(CODE_BUFFER* buffer, const char* symbol) {
+	// call symbol@PLT
+	if(CodeBuffer__byte(buffer, 0xE8) != 0) {
+		return -1;
+	}
+	return CodeBuffer__relocation(buffer, symbol, RELOCATION_PLT32, -4);
+}
+
+int Assembler__mov_reg_got(CODE_BUFFER* buffer, int reg, const char* symbol) {
+	// mov reg, [rip + symbol@GOTPCREL] (address of the symbol)
+	if(Assembler__rex(buffer, true, reg, REGISTER_RAX, false) != 0 || CodeBuffer__byte(buffer, 0x8B) != 0 ||
+	   CodeBuffer__byte(buffer, ((reg & 7) << 3) | 0x05) != 0) {
+		return -1;
+	}
+	return CodeBuffer__relocation(buffer, symbol, RELOCATION_GOTPCREL, -4);
+}
+
+int Assembler__jmp_symbol(CODE_BUFFER* buffer, const char* symbol) {
+	if(CodeBuffer__byte(buffer, 0xE9) != 0) {
+		return -1;
+	}
+	return CodeBuffer__relocation(buffer, symbol, RELOCATION_REL32, -4);
+}
+
+int Assembler__jmp_plt(CODE_BUFFER* buffer, const char* symbol) {
+	// jmp symbol@PLT (tail calls)
+	if(CodeBuffer__byte(buffer, 0xE9) != 0) {
+		return -1;
+	}
+	return CodeBuffer__relocation(buffer, symbol, RELOCATION_PLT32, -4);
+}
+
+int Assembler__jmp_mem(CODE_BUFFER* buffer, MEMORY_OPERAND memory) {
+	// jmp qword [memory] (FF /4)
+	if(Assembler__rex(buffer, false, REGISTER_RAX, Assembler__memory_base(memory), false) != 0 || CodeBuffer__byte(buffer, 0xFF) != 0) {
+		return -1;
+	}
+	return Assembler__modrm_memory(buffer, 4, memory, 0);
+}
+
+int Assembler__jmp_local(CODE_BUFFER* buffer, uint64_t* field) {
+	// Target is patched later with CodeBuffer__patch_rel32
+	if(CodeBuffer__byte(buffer, 0xE9) != 0) {
+		return -1;
+	}
+	*field = buffer->size;
+	return CodeBuffer__zero(buffer, 4);
+}
@@ -0,0 +1,172 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// Registers (numbers match the x86_64 encoding)
+enum REGISTER {
+	REGISTER_RAX,
+	REGISTER_RCX,
+	REGISTER_RDX,
+	REGISTER_RBX,
+	REGISTER_RSP,
+	REGISTER_RBP,
+	REGISTER_RSI,
+	REGISTER_RDI,
+	REGISTER_R8,
+	REGISTER_R9,
+	REGISTER_R10,
+	REGISTER_R11,
+	REGISTER_R12,
+	REGISTER_R13,
+	REGISTER_R14,
+	REGISTER_R15,
+	REGISTER_RIP,                      // Only valid as memory operand base (uses the symbol of the operand)
+};
+
+// Relocation types (same meaning as the ELF x86_64 relocations)
+enum RELOCATION_TYPE {
+	RELOCATION_ABS64,                  // S + A, 8 byte
+	RELOCATION_ABS32,                  // S + A, 4 byte, must fit zero extended
+	RELOCATION_REL32,                  // S + A - P, 4 byte signed
+	RELOCATION_PLT32,                  // L + A - P, PLT entry L if the symbol is in another shared object, else S
+	RELOCATION_GOTPCREL,               // G + A - P, G = GOT entry holding the symbol address
+};
+
+// Integer ALU operations (opcode of the "r/m, reg" form)
+enum ALU_OPERATION {
+	ALU_ADD = 0x01,
+	ALU_OR  = 0x09,
+	ALU_AND = 0x21,
+	ALU_SUB = 0x29,
+	ALU_XOR = 0x31,
+	ALU_CMP = 0x39,
+};
+
+// Shifts (the "/digit" of the opcode)
+enum SHIFT_OPERATION {
+	SHIFT_SHL = 4,
+	SHIFT_SHR = 5,
+	SHIFT_SAR = 7,
+};
+
+typedef struct _CODE_LABEL_ {
+	char* name;                        // Name of the label (owned by the buffer)
+	uint64_t offset;                   // Offset inside the buffer
+	uint64_t size;                     // Size of the labeled object, 0 = unknown
+	bool global;                       // Visible to other buffers/files
+	bool exported;                     // Visible outside of a shared object (global labels are hidden otherwise)
+} CODE_LABEL;
+
+typedef struct _CODE_RELOCATION_ {
+	char* symbol;                      // Referenced label (owned by the buffer)
+	uint64_t offset;                   // Offset of the field inside the buffer
+	int type;                          // See RELOCATION_TYPE enum
+	int64_t addend;                    // Constant added to the symbol address
+} CODE_RELOCATION;
+
+// Debug rows (-g): what the code from the offset of a row on belongs to
+enum CODE_DEBUG_KIND {
+	CODE_DEBUG_LINE,                   // Source position: value = line, column
+	CODE_DEBUG_FRAME,                  // Frame state for unwinding: value = CODE_FRAME
+};
+
+enum CODE_FRAME {
+	CODE_FRAME_ENTRY,                  // CFA = rsp + 8 (function entry, frameless code, after "pop rbp")
+	CODE_FRAME_PUSHED,                 // CFA = rsp + 16, rbp saved at CFA - 16 (after "push rbp")
+	CODE_FRAME_BASE,                   // CFA = rbp + 16, rbp saved at CFA - 16 (after "mov rbp, rsp")
+	CODE_FRAME_OUTERMOST,              // No caller (_start)
+};
+
+typedef struct _CODE_DEBUG_ {
+	uint64_t offset;                   // Offset inside the buffer
+	int kind;                          // See CODE_DEBUG_KIND enum
+	int value;
+	int column;
+} CODE_DEBUG;
+
+typedef struct _CODE_BUFFER_ {
+	uint8_t* data;                     // Encoded bytes
+	uint64_t size;                     // Used bytes
+	uint64_t capacity;                 // Allocated bytes
+	CODE_LABEL* labels;
+	int label_count;
+	int max_labels;
+	CODE_RELOCATION* relocations;
+	int relocation_count;
+	int max_relocations;
+	CODE_DEBUG* debug;
+	int debug_count;
+	int max_debug;
+} CODE_BUFFER;
+
+typedef struct _MEMORY_OPERAND_ {
+	int base;                          // Base register, REGISTER_RIP for symbol relative addressing
+	int32_t displacement;              // Displacement (addend for REGISTER_RIP)
+	char* symbol;                      // Symbol for REGISTER_RIP
+} MEMORY_OPERAND;
+
+// Code buffer
+int CodeBuffer__init(CODE_BUFFER* buffer, uint64_t capacity);
+void CodeBuffer__free(CODE_BUFFER* buffer);
+int CodeBuffer__emit(CODE_BUFFER* buffer, const void* bytes, uint64_t length);
+int CodeBuffer__byte(CODE_BUFFER* buffer, uint8_t value);
+int CodeBuffer__u32(CODE_BUFFER* buffer, uint32_t value);
+int CodeBuffer__u64(CODE_BUFFER* buffer, uint64_t value);
+int CodeBuffer__zero(CODE_BUFFER* buffer, uint64_t length);
+int CodeBuffer__align(CODE_BUFFER* buffer, uint64_t alignment, uint8_t fill);
+int CodeBuffer__label(CODE_BUFFER* buffer, const char* name, bool global);
+int CodeBuffer__label_at(CODE_BUFFER* buffer, uint64_t offset, const char* name, bool global);
+int CodeBuffer__relocation(CODE_BUFFER* buffer, const char* symbol, int type, int64_t addend);
+int CodeBuffer__relocation_at(CODE_BUFFER* buffer, uint64_t offset, const char* symbol, int type, int64_t addend);
+int CodeBuffer__debug(CODE_BUFFER* buffer, int kind, int value, int column);
+int CodeBuffer__debug_at(CODE_BUFFER* buffer, uint64_t offset, int kind, int value, int column);
+int CodeBuffer__find_label(CODE_BUFFER* buffer, const char* name);
+int CodeBuffer__patch_rel32(CODE_BUFFER* buffer, uint64_t field, uint64_t target);
+
+// Instruction encoding
+int Assembler__push(CODE_BUFFER* buffer, int reg);
+int Assembler__pop(CODE_BUFFER* buffer, int reg);
+int Assembler__ret(CODE_BUFFER* buffer);
+int Assembler__syscall(CODE_BUFFER* buffer);
+int Assembler__rep_stosb(CODE_BUFFER* buffer);
+int Assembler__rep_movsb(CODE_BUFFER* buffer);
+int Assembler__mov_reg_reg(CODE_BUFFER* buffer, int destination, int source);
+int Assembler__mov_reg_imm32(CODE_BUFFER* buffer, int reg, uint32_t value);
+int Assembler__mov_reg_imm64(CODE_BUFFER* buffer, int reg, uint64_t value);
+int Assembler__mov_reg_symbol(CODE_BUFFER* buffer, int reg, const char* symbol);
+int Assembler__lea_reg_mem(CODE_BUFFER* buffer, int reg, MEMORY_OPERAND memory);
+int Assembler__mov_reg_mem(CODE_BUFFER* buffer, int reg, MEMORY_OPERAND memory, int size);
+int Assembler__mov_mem_reg(CODE_BUFFER* buffer, MEMORY_OPERAND memory, int reg, int size);
+int Assembler__mov_mem_imm(CODE_BUFFER* buffer, MEMORY_OPERAND memory, int32_t value, int size);
+int Assembler__alu_reg_reg(CODE_BUFFER* buffer, int operation, int destination, int source);
+int Assembler__alu_reg_imm32(CODE_BUFFER* buffer, int operation, int reg, int32_t value);
+int Assembler__alu_mem_reg(CODE_BUFFER* buffer, int operation, MEMORY_OPERAND memory, int reg, bool lock);
+int Assembler__alu_mem_imm32(CODE_BUFFER* buffer, int operation, MEMORY_OPERAND memory, int32_t value, bool lock);
+int Assembler__shl_reg_imm8(CODE_BUFFER* buffer, int reg, uint8_t count);
+int Assembler__shift_reg_imm8(CODE_BUFFER* buffer, int operation, int reg, uint8_t count);
+int Assembler__lea_reg_index(CODE_BUFFER* buffer, int reg, int base, int index, int scale);
+int Assembler__imul_reg_reg(CODE_BUFFER* buffer, int destination, int source);
+int Assembler__imul_reg_imm32(CODE_BUFFER* buffer, int destination, int source, int32_t value);
+int Assembler__mul_reg(CODE_BUFFER* buffer, int reg, bool is_signed);
+int Assembler__div_reg(CODE_BUFFER* buffer, int reg, int size, bool is_signed);
+int Assembler__cdq(CODE_BUFFER* buffer, int size);
+int Assembler__neg_reg(CODE_BUFFER* buffer, int reg);
+int Assembler__extend_reg(CODE_BUFFER* buffer, int reg, int size, bool is_signed);
+int Assembler__movdqu_reg_mem(CODE_BUFFER* buffer, int reg, MEMORY_OPERAND memory, int size);
+int Assembler__movdqu_mem_reg(CODE_BUFFER* buffer, MEMORY_OPERAND memory, int reg, int size);
+int Assembler__vzeroupper(CODE_BUFFER* buffer);
+int Assembler__rdtsc(CODE_BUFFER* buffer);
+int Assembler__xor_reg32(CODE_BUFFER* buffer, int reg);
+int Assembler__call_symbol(CODE_BUFFER* buffer, const char* symbol);
+int Assembler__call_plt(CODE_BUFFER* buffer, const char* symbol);
+int Assembler__mov_reg_got(CODE_BUFFER* buffer, int reg, const char* symbol);
+int Assembler__jmp_symbol(CODE_BUFFER* buffer, const char* symbol);
+int Assembler__jmp_plt(CODE_BUFFER* buffer, const char* symbol);
+int Assembler__jmp_mem(CODE_BUFFER* buffer, MEMORY_OPERAND memory);
+int Assembler__jmp_local(CODE_BUFFER* buffer, uint64_t* field);
+
+// Memory operand helpers
+MEMORY_OPERAND Assembler__memory(int base, int32_t displacement);
+MEMORY_OPERAND Assembler__symbol(const char* symbol, int32_t addend);
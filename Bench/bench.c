@@ -0,0 +1,259 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <sys/stat.h>
+
+// Compiler throughput benchmark (make bench)
+//   Generates synthetic ChaosLang programs, compiles every one of them
+//   BENCH_RUNS times with -ftime-report=json (see TimeReport/time_report.h)
+//   and reports the fastest run of every phase as ms, MB/s of source and
+//   tokens/s. The sources only depend on the kind and the scale, the cache
+//   is off and translation runs on one thread, so the numbers of two
+//   commits can be compared. Every case is also written as one JSON line
+//   into <directory>/results.json.
+//     bench <compiler> <directory> [-n <runs>] [-s <scale>]
+//     bench --generate <kind> <scale> <file>
+
+#define BENCH_DEFAULT_RUNS 5
+#define BENCH_MAX_PHASES 16
+
+typedef struct _BENCH_CASE_ {
+	const char* kind;
+	void (*generate)(FILE* file, int scale);
+} BENCH_CASE;
+
+typedef struct _BENCH_PHASE_ {
+	char name[32];
+	double ms;                         // Fastest run
+} BENCH_PHASE;
+
+static void Bench__globals(FILE* file, int scale) {
+	// Globals with literals, every fourth one is a constant expression of earlier ones
+	int count = 2000 * scale;
+	for(int i = 0;i < count;i++) {
+		if(i % 4 == 3) {
+			fprintf(file, "int g%d = g%d + g%d * 3;\n", i, i - 1, i - 2);
+		}
+		else {
+			fprintf(file, "int g%d = %d;\n", i, i * 7 % 1000);
+		}
+	}
+	fprintf(file, "int main() {\n\treturn g%d;\n}\n", count - 1);
+}
+
+static void Bench__function(FILE* file, int i, bool comments) {
+	// int fN(int a, int b): locals and a call of the previous function
+	if(comments) {
+		fprintf(file, "// Function %d\n/* Takes two arguments,\n   declares locals and calls f%d.\n   Returns its result. */\n", i, i - 1);
+	}
+	fprintf(file, "int f%d(int a, int b) {\n", i);
+	for(int j = 0;j < 4;j++) {
+		if(comments) {
+			fprintf(file, "\t// Local %d of f%d\n\t/* set to a literal */\n", j, i);
+		}
+		fprintf(file, "\tint x%d = %d;\n", j, i + j);
+	}
+	if(i == 0) {
+		fprintf(file, "\treturn b;\n}\n");
+		return;
+	}
+	fprintf(file, "\tint r = f%d(b, x3);\n", i - 1);
+	if(comments) {
+		fprintf(file, "\t// Result of the call\n");
+	}
+	fprintf(file, "\treturn r;\n}\n");
+}
+
+static void Bench__functions(FILE* file, int scale) {
+	int count = 400 * scale;
+	for(int i = 0;i < count;i++) {
+		Bench__function(file, i, false);
+	}
+	fprintf(file, "int main() {\n\tint r = f%d(1, 2);\n\treturn r;\n}\n", count - 1);
+}
+
+static void Bench__comments(FILE* file, int scale) {
+	int count = 400 * scale;
+	for(int i = 0;i < count;i++) {
+		Bench__function(file, i, true);
+	}
+	fprintf(file, "// Entry\nint main() {\n\tint r = f%d(1, 2);\n\treturn r;\n}\n", count - 1);
+}
+
+static void Bench__nesting(FILE* file, int scale) {
+	// Constexpr functions with deeply nested if and while blocks, called by global initializers
+	int count = 50 * scale, depth = 24;
+	for(int i = 0;i < count;i++) {
+		fprintf(file, "constexpr int n%d(int v) {\n\tint r = 0;\n", i);
+		for(int d = 0;d < depth;d++) {
+			fprintf(file, "%*sif v > %d {\n%*swhile r < %d {\n%*sr = r + 1;\n%*s}\n", d + 1, "", d, d + 2, "", d + 1, d + 3, "", d + 2, "");
+		}
+		for(int d = depth - 1;d >= 0;d--) {
+			fprintf(file, "%*s}\n", d + 1, "");
+		}
+		fprintf(file, "\treturn r;\n}\nint k%d = n%d(%d);\n", i, i, i % depth);
+	}
+	fprintf(file, "int main() {\n\treturn k%d;\n}\n", count - 1);
+}
+
+static const BENCH_CASE cases[] = {
+	{ "globals", Bench__globals },
+	{ "functions", Bench__functions },
+	{ "comments", Bench__comments },
+	{ "nesting", Bench__nesting },
+};
+
+static const BENCH_CASE* Bench__case(const char* kind) {
+	for(size_t i = 0;i < sizeof(cases) / sizeof(cases[0]);i++) {
+		if(strcmp(cases[i].kind, kind) == 0) {
+			return &cases[i];
+		}
+	}
+	return NULL;
+}
+
+static int Bench__generate(const BENCH_CASE* benchmark, int scale, const char* path) {
+	FILE* file = fopen(path, "w");
+	if(file == NULL) {
+		printf("[ERROR] Could not create \"%s\".\n", path);
+		return -1;
+	}
+	benchmark->generate(file, scale);
+	fclose(file);
+	return 0;
+}
+
+static int Bench__parse(const char* line, BENCH_PHASE* phases, int* phase_count, long long* tokens, bool first) {
+	// Phases of one -ftime-report=json line, keeps the fastest run
+	const char* end = strstr(line, "\"total\":");
+	const char* cursor = line;
+	int index = 0;
+	while((cursor = strstr(cursor, "{\"name\":\"")) != NULL && (end == NULL || cursor < end)) {
+		char name[32];
+		double ms;
+		if(sscanf(cursor, "{\"name\":\"%31[^\"]\",\"wall_ms\":%lf", name, &ms) != 2) {
+			return -1;
+		}
+		if(first && index < BENCH_MAX_PHASES) {
+			strcpy(phases[index].name, name);
+			phases[index].ms = ms;
+			*phase_count = index + 1;
+		}
+		else if(index < *phase_count && strcmp(phases[index].name, name) == 0 && ms < phases[index].ms) {
+			phases[index].ms = ms;
+		}
+		index++;
+		cursor++;
+	}
+	const char* counts = strstr(line, "\"tokens\":");
+	if(counts == NULL || sscanf(counts, "\"tokens\":%lld", tokens) != 1) {
+		return -1;
+	}
+	return 0;
+}
+
+static int Bench__run(const char* compiler, const char* directory, const BENCH_CASE* benchmark, int runs, int scale, FILE* results) {
+	char source[512], output[512], command[2048];
+	snprintf(source, sizeof(source), "%s/%s.soft", directory, benchmark->kind);
+	snprintf(output, sizeof(output), "%s/%s.out", directory, benchmark->kind);
+	if(Bench__generate(benchmark, scale, source) != 0) {
+		return -1;
+	}
+	struct stat info;
+	if(stat(source, &info) != 0) {
+		return -1;
+	}
+	long long bytes = info.st_size;
+	// Limits: every token is at least one byte, every function at least 8 tokens
+	snprintf(command, sizeof(command), "\"%s\" \"%s\" %lld %lld 100 %lld 1 -o \"%s\" --no-cache -ftime-report=json",
+		compiler, source, bytes / 8 + 16, bytes + 16, bytes + 16, output);
+
+	BENCH_PHASE phases[BENCH_MAX_PHASES];
+	int phase_count = 0;
+	long long tokens = 0;
+	for(int run = 0;run < runs;run++) {
+		FILE* pipe = popen(command, "r");
+		if(pipe == NULL) {
+			printf("[ERROR] Could not run \"%s\".\n", compiler);
+			return -1;
+		}
+		char line[8192];
+		bool found = false;
+		while(fgets(line, sizeof(line), pipe) != NULL) {
+			if(line[0] == '{' && Bench__parse(line, phases, &phase_count, &tokens, run == 0) == 0) {
+				found = true;
+			}
+			else if(strncmp(line, "[ERROR]", 7) == 0) {
+				printf("%s", line);
+			}
+		}
+		pclose(pipe);
+		if(!found) {
+			printf("[ERROR] No time report from \"%s\" for %s.\n", compiler, source);
+			return -1;
+		}
+	}
+
+	printf("%s: %lld bytes, %lld tokens, best of %d runs\n", benchmark->kind, bytes, tokens, runs);
+	printf("  %-12s %10s %10s %14s\n", "phase", "ms", "MB/s", "tokens/s");
+	fprintf(results, "{\"case\":\"%s\",\"scale\":%d,\"bytes\":%lld,\"tokens\":%lld,\"runs\":%d,\"phases\":{", benchmark->kind, scale, bytes, tokens, runs);
+	double total = 0;
+	for(int i = 0;i <= phase_count;i++) {
+		const char* name = i < phase_count ? phases[i].name : "total";
+		double ms = i < phase_count ? phases[i].ms : total;
+		total = total + (i < phase_count ? ms : 0);
+		double seconds = ms > 0 ? ms / 1e3 : 1e-9;
+		printf("  %-12s %10.3f %10.2f %14.0f\n", name, ms, bytes / seconds / 1e6, tokens / seconds);
+		fprintf(results, "%s\"%s\":{\"ms\":%.3f,\"mb_s\":%.2f,\"tokens_s\":%.0f}", i > 0 ? "," : "", name, ms, bytes / seconds / 1e6, tokens / seconds);
+	}
+	fprintf(results, "}}\n");
+	return 0;
+}
+
+int main(int argc, char* argv[]) {
+	if(argc == 5 && strcmp(argv[1], "--generate") == 0) {
+		const BENCH_CASE* benchmark = Bench__case(argv[2]);
+		if(benchmark == NULL) {
+			printf("[ERROR] Unknown kind \"%s\" (globals, functions, comments, nesting).\n", argv[2]);
+			return 1;
+		}
+		return Bench__generate(benchmark, atoi(argv[3]) > 0 ? atoi(argv[3]) : 1, argv[4]) != 0;
+	}
+	if(argc < 3) {
+		printf("[ERROR] Not enough arguments.\n<compiler> <directory> [-n <runs>] [-s <scale>]\n--generate <kind> <scale> <file>\n");
+		return 1;
+	}
+	int runs = BENCH_DEFAULT_RUNS, scale = 1;
+	for(int i = 3;i < argc;i++) {
+		if(strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+			runs = atoi(argv[++i]);
+		}
+		else if(strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+			scale = atoi(argv[++i]);
+		}
+		else {
+			printf("[ERROR] Argument \"%s\" is invalid.\n", argv[i]);
+			return 1;
+		}
+	}
+	runs = runs > 0 ? runs : 1;
+	scale = scale > 0 ? scale : 1;
+
+	char path[512];
+	snprintf(path, sizeof(path), "%s/results.json", argv[2]);
+	FILE* results = fopen(path, "w");
+	if(results == NULL) {
+		printf("[ERROR] Could not create \"%s\".\n", path);
+		return 1;
+	}
+	int ret = 0;
+	for(size_t i = 0;i < sizeof(cases) / sizeof(cases[0]) && ret == 0;i++) {
+		ret = Bench__run(argv[1], argv[2], &cases[i], runs, scale, results);
+	}
+	fclose(results);
+	if(ret == 0) {
+		printf("[INFO] Results written to \"%s\".\n", path);
+	}
+	return ret != 0;
+}
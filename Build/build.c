@@ -0,0 +1,703 @@
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <spawn.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#include "build.h"
+
+extern char** environ;
+
+static uint64_t Build__hash(uint64_t hash, const void* data, size_t length) {
+	// FNV-1a
+	const uint8_t* bytes = data;
+	for(size_t i = 0;i < length;i++) {
+		hash ^= bytes[i];
+		hash *= 0x100000001b3ull;
+	}
+	return hash;
+}
+
+static uint64_t Build__hash_string(uint64_t hash, const char* str) {
+	return Build__hash(hash, str, strlen(str) + 1);
+}
+
+static int Build__hash_file(const char* path, uint64_t* hash) {
+	FILE* file = fopen(path, "rb");
+	if(file == NULL) {
+		return -1;
+	}
+	char buffer[65536];
+	size_t n;
+	while((n = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+		*hash = Build__hash(*hash, buffer, n);
+	}
+	fclose(file);
+	return 0;
+}
+
+static uint64_t Build__compiler_stamp(const char* compiler) {
+	// Path and contents of the compiler binary, a rebuilt compiler rebuilds everything
+	uint64_t hash = Build__hash_string(0xcbf29ce484222325ull, compiler);
+	if(strchr(compiler, '/') != NULL) {
+		Build__hash_file(compiler, &hash);
+		return hash;
+	}
+	// Found through PATH like posix_spawnp does
+	const char* path = getenv("PATH");
+	while(path != NULL && *path != '\0') {
+		const char* end = strchr(path, ':');
+		size_t length = end != NULL ? (size_t)(end - path) : strlen(path);
+		char candidate[4096];
+		snprintf(candidate, sizeof(candidate), "%.*s/%s", (int)length, length > 0 ? path : ".", compiler);
+		if(access(candidate, X_OK) == 0 && Build__hash_file(candidate, &hash) == 0) {
+			break;
+		}
+		path = end != NULL ? end + 1 : NULL;
+	}
+	return hash;
+}
+
+static int Build__mkdir(const char* path) {
+	// mkdir -p
+	char buffer[4096];
+	snprintf(buffer, sizeof(buffer), "%s", path);
+	for(char* p = buffer + 1;*p;p++) {
+		if(*p == '/') {
+			*p = '\0';
+			if(mkdir(buffer, 0755) != 0 && errno != EEXIST) {
+				return -1;
+			}
+			*p = '/';
+		}
+	}
+	if(mkdir(buffer, 0755) != 0 && errno != EEXIST) {
+		return -1;
+	}
+	return 0;
+}
+
+static int Build__add_job(BUILD_PROJECT* project, BUILD_JOB_TYPE type, int target, char* input, char* output) {
+	BUILD_JOB* jobs = realloc(project->jobs, (project->job_count + 1) * sizeof(BUILD_JOB));
+	if(jobs == NULL) {
+		return -1;
+	}
+	project->jobs = jobs;
+	BUILD_JOB job = {0};
+	job.type = type;
+	job.target = target;
+	job.input = input;
+	job.output = output;
+	project->jobs[project->job_count] = job;
+	return project->job_count++;
+}
+
+static int Build__add_input(BUILD_JOB* job, int input) {
+	int* inputs = realloc(job->inputs, (job->input_count + 1) * sizeof(int));
+	if(inputs == NULL) {
+		return -1;
+	}
+	job->inputs = inputs;
+	job->inputs[job->input_count++] = input;
+	return 0;
+}
+
+int Build__graph(BUILD_PROJECT* project) {
+	// Compile jobs
+	for(int i = 0;i < project->target_count;i++) {
+		BUILD_TARGET* target = &project->targets[i];
+		char directory[4096];
+		snprintf(directory, sizeof(directory), "%s/%s.dir", project->build_directory, target->name);
+		if(Build__mkdir(directory) != 0) {
+			printf("[ERROR] Could not create \"%s\".\n", directory);
+			return -1;
+		}
+		int first = project->job_count;
+		for(int j = 0;j < target->source_count;j++) {
+			char* input = malloc(strlen(project->directory) + strlen(target->sources[j]) + 2);
+			char* output = malloc(strlen(directory) + strlen(target->sources[j]) + 4);
+			if(input == NULL || output == NULL) {
+				free(input);
+				free(output);
+				return -1;
+			}
+			sprintf(input, "%s/%s", project->directory, target->sources[j]);
+			// One object per source, directories flattened
+			sprintf(output, "%s/%s.o", directory, target->sources[j]);
+			for(char* p = output + strlen(directory) + 1;*p;p++) {
+				if(*p == '/') {
+					*p = '_';
+				}
+			}
+			if(Build__add_job(project, BUILD_JOB_COMPILE, i, input, output) < 0) {
+				return -1;
+			}
+		}
+
+		// Link job
+		char* output = malloc(strlen(project->build_directory) + strlen(target->name) + 16);
+		if(output == NULL) {
+			return -1;
+		}
+		if(target->type == BUILD_TARGET_STATIC_LIBRARY) {
+			sprintf(output, "%s/lib%s.rlib", project->build_directory, target->name);
+		}
+		else if(target->type == BUILD_TARGET_DYNAMIC_LIBRARY) {
+			sprintf(output, "%s/lib%s.so", project->build_directory, target->name);
+		}
+		else {
+			sprintf(output, "%s/%s", project->build_directory, target->name);
+		}
+		target->output = output;
+		target->link_job = Build__add_job(project, BUILD_JOB_LINK, i, NULL, strdup(output));
+		if(target->link_job < 0) {
+			return -1;
+		}
+		for(int j = first;j < target->link_job;j++) {
+			if(Build__add_input(&project->jobs[target->link_job], j) != 0) {
+				return -1;
+			}
+		}
+	}
+
+	// Libraries
+	for(int i = 0;i < project->target_count;i++) {
+		BUILD_TARGET* target = &project->targets[i];
+		for(int j = 0;j < target->library_count;j++) {
+			int library = -1;
+			for(int k = 0;k < project->target_count;k++) {
+				if(strcmp(project->targets[k].name, target->libraries[j]) == 0) {
+					library = k;
+					break;
+				}
+			}
+			if(library < 0 || project->targets[library].type == BUILD_TARGET_EXECUTABLE) {
+				printf("[ERROR] \"%s\" is not a library target (linked by \"%s\", at %s:%d).\n", target->libraries[j], target->name, project->file, target->line);
+				return -1;
+			}
+			if(Build__add_input(&project->jobs[target->link_job], project->targets[library].link_job) != 0) {
+				return -1;
+			}
+		}
+	}
+
+	// Reverse edges
+	for(int i = 0;i < project->job_count;i++) {
+		BUILD_JOB* job = &project->jobs[i];
+		job->pending = job->input_count;
+		for(int j = 0;j < job->input_count;j++) {
+			BUILD_JOB* input = &project->jobs[job->inputs[j]];
+			int* dependents = realloc(input->dependents, (input->dependent_count + 1) * sizeof(int));
+			if(dependents == NULL) {
+				return -1;
+			}
+			input->dependents = dependents;
+			input->dependents[input->dependent_count++] = i;
+		}
+	}
+
+	// Reject libraries that link each other in a cycle
+	int* pending = malloc((project->job_count + 1) * sizeof(int));
+	int* ready = malloc((project->job_count + 1) * sizeof(int));
+	if(pending == NULL || ready == NULL) {
+		free(pending);
+		free(ready);
+		return -1;
+	}
+	int count = 0;
+	for(int i = 0;i < project->job_count;i++) {
+		pending[i] = project->jobs[i].pending;
+		if(pending[i] == 0) {
+			ready[count++] = i;
+		}
+	}
+	for(int i = 0;i < count;i++) {
+		BUILD_JOB* job = &project->jobs[ready[i]];
+		for(int j = 0;j < job->dependent_count;j++) {
+			if(--pending[job->dependents[j]] == 0) {
+				ready[count++] = job->dependents[j];
+			}
+		}
+	}
+	free(pending);
+	free(ready);
+	if(count != project->job_count) {
+		printf("[ERROR] Targets in \"%s\" link each other in a cycle.\n", project->file);
+		return -1;
+	}
+	return 0;
+}
+
+static int Build__state_path(BUILD_PROJECT* project, char* path, size_t size) {
+	return snprintf(path, size, "%s/%s", project->build_directory, BUILD_STATE_FILE);
+}
+
+static void Build__load_state(BUILD_PROJECT* project) {
+	char path[4096];
+	Build__state_path(project, path, sizeof(path));
+	FILE* file = fopen(path, "r");
+	if(file == NULL) {
+		return;
+	}
+	char line[4608];
+	while(fgets(line, sizeof(line), file) != NULL) {
+		unsigned long long stamp, content;
+		long long mtime, size;
+		int offset = 0;
+		if(sscanf(line, "%llx %lld %lld %llx %n", &stamp, &mtime, &size, &content, &offset) != 4 || offset == 0) {
+			continue;
+		}
+		line[strcspn(line, "\n")] = '\0';
+		BUILD_STAMP* stamps = realloc(project->stamps, (project->stamp_count + 1) * sizeof(BUILD_STAMP));
+		if(stamps == NULL) {
+			break;
+		}
+		project->stamps = stamps;
+		BUILD_STAMP entry = { strdup(line + offset), stamp, mtime, size, content };
+		project->stamps[project->stamp_count++] = entry;
+	}
+	fclose(file);
+}
+
+static void Build__save_state(BUILD_PROJECT* project) {
+	char path[4096], temp_path[4200];
+	Build__state_path(project, path, sizeof(path));
+	snprintf(temp_path, sizeof(temp_path), "%s.tmp", path);
+	FILE* file = fopen(temp_path, "w");
+	if(file == NULL) {
+		return;
+	}
+	for(int i = 0;i < project->job_count;i++) {
+		BUILD_JOB* job = &project->jobs[i];
+		if(job->state != BUILD_JOB_UP_TO_DATE && job->state != BUILD_JOB_BUILT) {
+			continue;
+		}
+		// Compile jobs remember the source, so unchanged sources are not hashed again
+		fprintf(file, "%016llx %lld %lld %016llx %s\n", (unsigned long long)job->stamp, job->mtime, job->size, (unsigned long long)job->content, job->output);
+	}
+	if(fclose(file) == 0) {
+		rename(temp_path, path);
+	}
+}
+
+static BUILD_STAMP* Build__find_stamp(BUILD_PROJECT* project, const char* output) {
+	for(int i = 0;i < project->stamp_count;i++) {
+		if(strcmp(project->stamps[i].output, output) == 0) {
+			return &project->stamps[i];
+		}
+	}
+	return NULL;
+}
+
+static int Build__command(char* const argv[], const char* log) {
+	// Runs a command with its output in log, returns its exit status
+	posix_spawn_file_actions_t actions;
+	posix_spawn_file_actions_init(&actions);
+	posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, log, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	posix_spawn_file_actions_adddup2(&actions, STDOUT_FILENO, STDERR_FILENO);
+	pid_t pid;
+	int ret = posix_spawnp(&pid, argv[0], &actions, NULL, argv, environ);
+	posix_spawn_file_actions_destroy(&actions);
+	if(ret != 0) {
+		printf("[ERROR] Could not run \"%s\".\n", argv[0]);
+		return -1;
+	}
+	int status = 0;
+	while(waitpid(pid, &status, 0) < 0) {
+		if(errno != EINTR) {
+			return -1;
+		}
+	}
+	return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+static void Build__print_log(const char* log) {
+	FILE* file = fopen(log, "r");
+	if(file == NULL) {
+		return;
+	}
+	char line[1024];
+	while(fgets(line, sizeof(line), file) != NULL) {
+		if(strncmp(line, "[ERROR]", 7) == 0 || strncmp(line, "[FATAL ERROR]", 13) == 0) {
+			printf("%s", line);
+		}
+	}
+	fclose(file);
+}
+
+static BUILD_JOB_STATE Build__compile(BUILD_PROJECT* project, BUILD_JOB* job) {
+	struct stat status;
+	if(stat(job->input, &status) != 0) {
+		printf("[ERROR] Source \"%s\" of \"%s\" does not exist.\n", job->input, project->targets[job->target].name);
+		return BUILD_JOB_FAILED;
+	}
+
+	// Hash the source only when stat says it changed
+	job->mtime = (long long)status.st_mtim.tv_sec * 1000000000ll + status.st_mtim.tv_nsec;
+	job->size = status.st_size;
+	BUILD_STAMP* previous = Build__find_stamp(project, job->output);
+	if(previous != NULL && previous->mtime == job->mtime && previous->size == job->size) {
+		job->content = previous->content;
+	}
+	else {
+		uint64_t hash = 0xcbf29ce484222325ull;
+		if(Build__hash_file(job->input, &hash) != 0) {
+			printf("[ERROR] Could not read \"%s\".\n", job->input);
+			return BUILD_JOB_FAILED;
+		}
+		job->content = hash;
+	}
+	// Objects of dynamic libraries are position independent
+	bool pic = project->targets[job->target].type == BUILD_TARGET_DYNAMIC_LIBRARY;
+	job->stamp = Build__hash(job->content, &project->compiler_stamp, sizeof(uint64_t));
+	job->stamp = Build__hash_string(job->stamp, job->input);
+	job->stamp = Build__hash(job->stamp, &pic, sizeof(pic));
+	if(previous != NULL && previous->stamp == job->stamp && access(job->output, F_OK) == 0) {
+		return BUILD_JOB_UP_TO_DATE;
+	}
+
+	printf("[BUILD] Compiling %s\n", job->input);
+	char log[4200];
+	snprintf(log, sizeof(log), "%s.log", job->output);
+	char* argv[] = { project->compiler, job->input, "1000", "1000", "100", "100000", "1", "-c", "-o", job->output, pic ? "-fPIC" : NULL, NULL };
+	if(Build__command(argv, log) != 0) {
+		// An object of an earlier compile must not be linked
+		unlink(job->output);
+		printf("[ERROR] Compiling \"%s\" failed (see \"%s\").\n", job->input, log);
+		Build__print_log(log);
+		return BUILD_JOB_FAILED;
+	}
+	return BUILD_JOB_BUILT;
+}
+
+static BUILD_JOB_STATE Build__link(BUILD_PROJECT* project, BUILD_JOB* job) {
+	BUILD_TARGET* target = &project->targets[job->target];
+
+	// Stamp of a link is made from the compiler and the stamps of its inputs
+	uint64_t hash = project->compiler_stamp;
+	hash = Build__hash(hash, &target->type, sizeof(target->type));
+	hash = Build__hash_string(hash, job->output);
+	for(int i = 0;i < job->input_count;i++) {
+		hash = Build__hash(hash, &project->jobs[job->inputs[i]].stamp, sizeof(uint64_t));
+	}
+	job->stamp = hash;
+	BUILD_STAMP* previous = Build__find_stamp(project, job->output);
+	if(previous != NULL && previous->stamp == job->stamp && access(job->output, F_OK) == 0) {
+		return BUILD_JOB_UP_TO_DATE;
+	}
+
+	printf("[BUILD] Linking %s\n", job->output);
+
+	// <compiler> --link|--shared|--archive <output> <objects> [<static libraries>]
+	char** argv = malloc((project->job_count + 5) * sizeof(char*));
+	if(argv == NULL) {
+		return BUILD_JOB_FAILED;
+	}
+	int argc = 0;
+	argv[argc++] = project->compiler;
+	argv[argc++] = target->type == BUILD_TARGET_STATIC_LIBRARY ? "--archive" : target->type == BUILD_TARGET_DYNAMIC_LIBRARY ? "--shared" : "--link";
+	argv[argc++] = job->output;
+	for(int i = 0;i < job->input_count;i++) {
+		if(project->jobs[job->inputs[i]].type == BUILD_JOB_COMPILE) {
+			argv[argc++] = project->jobs[job->inputs[i]].output;
+		}
+	}
+	if(target->type != BUILD_TARGET_STATIC_LIBRARY) {
+		// Static libraries and the libraries they link (each one once)
+		int* libraries = malloc((project->job_count + 1) * sizeof(int));
+		if(libraries == NULL) {
+			free(argv);
+			return BUILD_JOB_FAILED;
+		}
+		int library_count = 0;
+		for(int i = 0;i < job->input_count;i++) {
+			if(project->jobs[job->inputs[i]].type == BUILD_JOB_LINK) {
+				libraries[library_count++] = job->inputs[i];
+			}
+		}
+		for(int i = 0;i < library_count;i++) {
+			BUILD_JOB* library = &project->jobs[libraries[i]];
+			if(project->targets[library->target].type == BUILD_TARGET_DYNAMIC_LIBRARY) {
+				printf("[ERROR] \"%s\" links the dynamic library \"%s\", which is not supported yet.\n", target->name, project->targets[library->target].name);
+				free(libraries);
+				free(argv);
+				return BUILD_JOB_FAILED;
+			}
+			argv[argc++] = library->output;
+			for(int j = 0;j < library->input_count;j++) {
+				bool known = project->jobs[library->inputs[j]].type != BUILD_JOB_LINK;
+				for(int k = 0;k < library_count && !known;k++) {
+					known = libraries[k] == library->inputs[j];
+				}
+				if(!known) {
+					libraries[library_count++] = library->inputs[j];
+				}
+			}
+		}
+		free(libraries);
+	}
+	argv[argc] = NULL;
+
+	char log[4200];
+	snprintf(log, sizeof(log), "%s.log", job->output);
+	int status = Build__command(argv, log);
+	free(argv);
+	if(status != 0) {
+		unlink(job->output);
+		printf("[ERROR] Linking \"%s\" failed (see \"%s\").\n", target->name, log);
+		Build__print_log(log);
+		return BUILD_JOB_FAILED;
+	}
+	return BUILD_JOB_BUILT;
+}
+
+// Job pool
+
+static void Build__push(BUILD_PROJECT* project, int worker, int job) {
+	BUILD_DEQUE* deque = &project->deques[worker];
+	pthread_mutex_lock(&deque->lock);
+	deque->jobs[deque->bottom % deque->capacity] = job;
+	deque->bottom++;
+	pthread_mutex_unlock(&deque->lock);
+
+	pthread_mutex_lock(&project->lock);
+	if(project->sleeping > 0) {
+		pthread_cond_signal(&project->wake);
+	}
+	pthread_mutex_unlock(&project->lock);
+}
+
+static int Build__pop(BUILD_PROJECT* project, int worker) {
+	// Own jobs newest first, then the oldest job of another worker
+	int job = -1;
+	BUILD_DEQUE* deque = &project->deques[worker];
+	pthread_mutex_lock(&deque->lock);
+	if(deque->bottom > deque->top) {
+		deque->bottom--;
+		job = deque->jobs[deque->bottom % deque->capacity];
+	}
+	pthread_mutex_unlock(&deque->lock);
+	for(int i = 1;job < 0 && i < project->threads;i++) {
+		BUILD_DEQUE* victim = &project->deques[(worker + i) % project->threads];
+		pthread_mutex_lock(&victim->lock);
+		if(victim->bottom > victim->top) {
+			job = victim->jobs[victim->top % victim->capacity];
+			victim->top++;
+		}
+		pthread_mutex_unlock(&victim->lock);
+	}
+	return job;
+}
+
+static void Build__execute(BUILD_PROJECT* project, int worker, int index) {
+	BUILD_JOB* job = &project->jobs[index];
+	bool inputs_failed = false;
+	for(int i = 0;i < job->input_count;i++) {
+		if(project->jobs[job->inputs[i]].state == BUILD_JOB_FAILED) {
+			inputs_failed = true;
+		}
+	}
+	BUILD_JOB_STATE state;
+	if(inputs_failed) {
+		state = BUILD_JOB_FAILED;
+	}
+	else if(job->type == BUILD_JOB_COMPILE) {
+		state = Build__compile(project, job);
+	}
+	else {
+		state = Build__link(project, job);
+	}
+	__atomic_store_n(&job->state, state, __ATOMIC_RELEASE);
+	if(state == BUILD_JOB_FAILED) {
+		__atomic_fetch_add(&project->failed, 1, __ATOMIC_RELAXED);
+	}
+
+	// Jobs whose last input finished are ready
+	for(int i = 0;i < job->dependent_count;i++) {
+		if(__atomic_sub_fetch(&project->jobs[job->dependents[i]].pending, 1, __ATOMIC_ACQ_REL) == 0) {
+			Build__push(project, worker, job->dependents[i]);
+		}
+	}
+	pthread_mutex_lock(&project->lock);
+	project->remaining--;
+	if(project->remaining == 0) {
+		pthread_cond_broadcast(&project->wake);
+	}
+	pthread_mutex_unlock(&project->lock);
+}
+
+typedef struct _BUILD_WORKER_ {
+	BUILD_PROJECT* project;
+	int index;
+} BUILD_WORKER;
+
+static void* Build__worker(void* argument) {
+	BUILD_WORKER* worker = argument;
+	BUILD_PROJECT* project = worker->project;
+	while(true) {
+		int job = Build__pop(project, worker->index);
+		if(job >= 0) {
+			Build__execute(project, worker->index, job);
+			continue;
+		}
+		pthread_mutex_lock(&project->lock);
+		if(project->remaining == 0) {
+			pthread_mutex_unlock(&project->lock);
+			break;
+		}
+		// Pushes signal under the lock, look again before sleeping
+		job = Build__pop(project, worker->index);
+		if(job < 0) {
+			project->sleeping++;
+			pthread_cond_wait(&project->wake, &project->lock);
+			project->sleeping--;
+		}
+		pthread_mutex_unlock(&project->lock);
+		if(job >= 0) {
+			Build__execute(project, worker->index, job);
+		}
+	}
+	return NULL;
+}
+
+int Build__run(BUILD_PROJECT* project) {
+	Build__load_state(project);
+	project->compiler_stamp = Build__compiler_stamp(project->compiler);
+	if(project->job_count == 0) {
+		return 0;
+	}
+	if(project->threads < 1) {
+		project->threads = 1;
+	}
+	project->deques = calloc(project->threads, sizeof(BUILD_DEQUE));
+	BUILD_WORKER* workers = malloc(project->threads * sizeof(BUILD_WORKER));
+	pthread_t* threads = malloc(project->threads * sizeof(pthread_t));
+	if(project->deques == NULL || workers == NULL || threads == NULL) {
+		free(workers);
+		free(threads);
+		return -1;
+	}
+	for(int i = 0;i < project->threads;i++) {
+		project->deques[i].capacity = project->job_count;
+		project->deques[i].jobs = malloc(project->job_count * sizeof(int));
+		if(project->deques[i].jobs == NULL) {
+			free(workers);
+			free(threads);
+			return -1;
+		}
+		pthread_mutex_init(&project->deques[i].lock, NULL);
+	}
+	pthread_mutex_init(&project->lock, NULL);
+	pthread_cond_init(&project->wake, NULL);
+	project->remaining = project->job_count;
+
+	// Spread the jobs without inputs over the workers
+	int next = 0;
+	for(int i = 0;i < project->job_count;i++) {
+		if(project->jobs[i].pending == 0) {
+			BUILD_DEQUE* deque = &project->deques[next];
+			deque->jobs[deque->bottom++ % deque->capacity] = i;
+			next = (next + 1) % project->threads;
+		}
+	}
+
+	int started = 0;
+	for(;started < project->threads;started++) {
+		workers[started].project = project;
+		workers[started].index = started;
+		if(started > 0 && pthread_create(&threads[started], NULL, Build__worker, &workers[started]) != 0) {
+			break;
+		}
+	}
+	// The calling thread is worker 0
+	Build__worker(&workers[0]);
+	for(int i = 1;i < started;i++) {
+		pthread_join(threads[i], NULL);
+	}
+	free(workers);
+	free(threads);
+
+	Build__save_state(project);
+	int built = 0, up_to_date = 0;
+	for(int i = 0;i < project->job_count;i++) {
+		if(project->jobs[i].state == BUILD_JOB_BUILT) {
+			built++;
+		}
+		else if(project->jobs[i].state == BUILD_JOB_UP_TO_DATE) {
+			up_to_date++;
+		}
+	}
+	printf("[INFO] %d jobs built, %d up to date, %d failed.\n", built, up_to_date, project->failed);
+	return project->failed == 0 ? 0 : -1;
+}
+
+void Build__free(BUILD_PROJECT* project) {
+	for(int i = 0;i < project->target_count;i++) {
+		BUILD_TARGET* target = &project->targets[i];
+		free(target->name);
+		free(target->output);
+		for(int j = 0;j < target->source_count;j++) {
+			free(target->sources[j]);
+		}
+		free(target->sources);
+		for(int j = 0;j < target->library_count;j++) {
+			free(target->libraries[j]);
+		}
+		free(target->libraries);
+	}
+	free(project->targets);
+	for(int i = 0;i < project->job_count;i++) {
+		free(project->jobs[i].input);
+		free(project->jobs[i].output);
+		free(project->jobs[i].inputs);
+		free(project->jobs[i].dependents);
+	}
+	free(project->jobs);
+	for(int i = 0;i < project->stamp_count;i++) {
+		free(project->stamps[i].output);
+	}
+	free(project->stamps);
+	if(project->deques != NULL) {
+		for(int i = 0;i < project->threads;i++) {
+			free(project->deques[i].jobs);
+		}
+		free(project->deques);
+	}
+	free(project->file);
+	free(project->directory);
+}
+
+int Build__main(int argc, char* argv[]) {
+	// --build <project file> [-j <threads>] [-B <build directory>] [--compiler <path>]
+	BUILD_PROJECT project = {0};
+	project.build_directory = BUILD_DIRECTORY;
+	project.compiler = BUILD_COMPILER;
+	project.threads = sysconf(_SC_NPROCESSORS_ONLN);
+	for(int i = 3;i < argc;i++) {
+		if(strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+			project.threads = atoi(argv[++i]);
+		}
+		else if(strcmp(argv[i], "-B") == 0 && i + 1 < argc) {
+			project.build_directory = argv[++i];
+		}
+		else if(strcmp(argv[i], "--compiler") == 0 && i + 1 < argc) {
+			project.compiler = argv[++i];
+		}
+		else {
+			printf("[ERROR] Argument \"%s\" is invalid.\n", argv[i]);
+			return -1;
+		}
+	}
+	int ret = Build__parse(&project, argv[2]);
+	if(ret == 0) {
+		ret = Build__graph(&project);
+	}
+	if(ret == 0) {
+		ret = Build__run(&project);
+	}
+	Build__free(&project);
+	return ret;
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <pthread.h>
+
+// Build engine for .soft project files
+//   ADD_EXECUTABLE(<sources>, <output>)
+//   ADD_STATIC_LIBRARY(<sources>, <output>)
+//   ADD_DYNAMIC_LIBRARY(<sources>, <output>)
+//   TARGET_LINK_LIBRARIES(<target>, <libraries>)
+//     <sources>   "file" or {"file", "file", ...}
+//     <output>    "name" or {"name", linux="<suffix>", windows="<suffix>"}
+//     <libraries> "name" or {"name", "name", ...}
+//
+//   Every source becomes a compile job and every target a link job that
+//   depends on the compile jobs of its sources and the link jobs of its
+//   libraries. Jobs whose stamp (hash of the inputs and the command) did not
+//   change and whose output exists are skipped. Ready jobs run on a pool of
+//   workers with one deque each; idle workers steal from the others.
+
+#define BUILD_DIRECTORY  "./build"
+#define BUILD_COMPILER   "./build/ChaosLangCompiler/token_compiler" // make token-compiler
+#define BUILD_STATE_FILE ".soft.state"
+
+typedef enum _BUILD_TARGET_TYPE_ {
+	BUILD_TARGET_EXECUTABLE,
+	BUILD_TARGET_STATIC_LIBRARY,
+	BUILD_TARGET_DYNAMIC_LIBRARY
+} BUILD_TARGET_TYPE;
+
+typedef enum _BUILD_JOB_TYPE_ {
+	BUILD_JOB_COMPILE,
+	BUILD_JOB_LINK
+} BUILD_JOB_TYPE;
+
+typedef enum _BUILD_JOB_STATE_ {
+	BUILD_JOB_WAITING,
+	BUILD_JOB_UP_TO_DATE,
+	BUILD_JOB_BUILT,
+	BUILD_JOB_FAILED
+} BUILD_JOB_STATE;
+
+typedef struct _BUILD_TARGET_ {
+	BUILD_TARGET_TYPE type;
+	char* name;
+	char* output;                      // Path of the linked file
+	char** sources;
+	int source_count;
+	char** libraries;                  // Names of other targets
+	int library_count;
+	int link_job;
+	int line;                          // Declaration in the project file
+} BUILD_TARGET;
+
+typedef struct _BUILD_JOB_ {
+	BUILD_JOB_TYPE type;
+	int target;
+	char* input;                       // Source file (compile jobs)
+	char* output;
+	int* inputs;                       // Jobs this job waits for
+	int input_count;
+	int* dependents;                   // Jobs waiting for this job
+	int dependent_count;
+	int pending;                       // Unfinished inputs
+	BUILD_JOB_STATE state;
+	uint64_t stamp;
+	uint64_t content;                  // Source content hash (compile jobs)
+	long long mtime, size;             // Source status the content hash belongs to
+} BUILD_JOB;
+
+typedef struct _BUILD_STAMP_ {
+	char* output;
+	uint64_t stamp;
+	long long mtime;                   // Source modification time (compile jobs)
+	long long size;
+	uint64_t content;                  // Source content hash (compile jobs)
+} BUILD_STAMP;
+
+typedef struct _BUILD_DEQUE_ {
+	int* jobs;                         // Ring buffer, owner works at the bottom, thieves take from the top
+	int capacity;
+	int top, bottom;
+	pthread_mutex_t lock;
+} BUILD_DEQUE;
+
+typedef struct _BUILD_PROJECT_ {
+	char* file;                        // Project file
+	char* directory;                   // Sources are relative to it
+	char* build_directory;
+	char* compiler;
+	uint64_t compiler_stamp;           // Hash of the compiler path and binary, part of every stamp
+	int threads;
+
+	BUILD_TARGET* targets;
+	int target_count;
+	BUILD_JOB* jobs;
+	int job_count;
+
+	// Stamps of the last build (read from and written to <build directory>/.soft.state)
+	BUILD_STAMP* stamps;
+	int stamp_count;
+
+	// Job pool
+	BUILD_DEQUE* deques;
+	int remaining;                     // Jobs not finished yet
+	int sleeping;
+	int failed;
+	pthread_mutex_t lock;
+	pthread_cond_t wake;
+} BUILD_PROJECT;
+
+int Build__parse(BUILD_PROJECT* project, const char* file);
+int Build__graph(BUILD_PROJECT* project);
+int Build__run(BUILD_PROJECT* project);
+void Build__free(BUILD_PROJECT* project);
+int Build__main(int argc, char* argv[]);
@@ -0,0 +1,292 @@
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "build.h"
+
+// Project file reader (see build.h for the syntax)
+
+typedef struct _PROJECT_READER_ {
+	const char* file;
+	char* text;
+	size_t position;
+	int line, column;
+	char token[512];                   // Current token (strings without quotes)
+	bool string;                       // Current token was a string
+} PROJECT_READER;
+
+static int Project__next(PROJECT_READER* reader) {
+	// Returns 0 with the next token, 1 at the end of the file, -1 on errors
+	char* text = reader->text;
+	while(text[reader->position] != '\0') {
+		char c = text[reader->position];
+		if(c == '\n') {
+			reader->line++;
+			reader->column = 1;
+			reader->position++;
+		}
+		else if(isspace((unsigned char)c)) {
+			reader->column++;
+			reader->position++;
+		}
+		else if(c == '/' && text[reader->position + 1] == '/') {
+			// Comment
+			while(text[reader->position] != '\0' && text[reader->position] != '\n') {
+				reader->position++;
+			}
+		}
+		else {
+			break;
+		}
+	}
+	if(text[reader->position] == '\0') {
+		reader->token[0] = '\0';
+		return 1;
+	}
+
+	size_t length = 0;
+	reader->string = false;
+	char c = text[reader->position];
+	if(c == '"') {
+		reader->string = true;
+		reader->position++;
+		reader->column++;
+		while(text[reader->position] != '"') {
+			if(text[reader->position] == '\0' || text[reader->position] == '\n' || length + 1 >= sizeof(reader->token)) {
+				printf("[ERROR] Unterminated string, at %s:%d:%d.\n", reader->file, reader->line, reader->column);
+				return -1;
+			}
+			reader->token[length++] = text[reader->position++];
+			reader->column++;
+		}
+		reader->position++;
+		reader->column++;
+	}
+	else if(isalnum((unsigned char)c) || c == '_') {
+		while((isalnum((unsigned char)text[reader->position]) || text[reader->position] == '_') && length + 1 < sizeof(reader->token)) {
+			reader->token[length++] = text[reader->position++];
+			reader->column++;
+		}
+	}
+	else if(strchr("(){},=", c) != NULL) {
+		reader->token[length++] = c;
+		reader->position++;
+		reader->column++;
+	}
+	else {
+		printf("[ERROR] Unsupported character '%c', at %s:%d:%d.\n", c, reader->file, reader->line, reader->column);
+		return -1;
+	}
+	reader->token[length] = '\0';
+	return 0;
+}
+
+static int Project__expect(PROJECT_READER* reader, const char* token) {
+	if(Project__next(reader) != 0 || reader->string || strcmp(reader->token, token) != 0) {
+		printf("[ERROR] Expected '%s', at %s:%d:%d.\n", token, reader->file, reader->line, reader->column);
+		return -1;
+	}
+	return 0;
+}
+
+static int Project__add(char*** list, int* count, const char* str) {
+	char** grown = realloc(*list, (*count + 1) * sizeof(char*));
+	if(grown == NULL) {
+		return -1;
+	}
+	*list = grown;
+	(*list)[*count] = strdup(str);
+	(*count)++;
+	return 0;
+}
+
+static int Project__strings(PROJECT_READER* reader, char*** list, int* count) {
+	// "a" or {"a", "b", ...}
+	if(Project__next(reader) != 0) {
+		printf("[ERROR] Expected a string or '{', at %s:%d:%d.\n", reader->file, reader->line, reader->column);
+		return -1;
+	}
+	if(reader->string) {
+		return Project__add(list, count, reader->token);
+	}
+	if(strcmp(reader->token, "{") != 0) {
+		printf("[ERROR] Expected a string or '{', at %s:%d:%d.\n", reader->file, reader->line, reader->column);
+		return -1;
+	}
+	while(true) {
+		if(Project__next(reader) != 0 || !reader->string) {
+			printf("[ERROR] Expected a string, at %s:%d:%d.\n", reader->file, reader->line, reader->column);
+			return -1;
+		}
+		if(Project__add(list, count, reader->token) != 0) {
+			return -1;
+		}
+		if(Project__next(reader) != 0) {
+			printf("[ERROR] Expected ',' or '}', at %s:%d:%d.\n", reader->file, reader->line, reader->column);
+			return -1;
+		}
+		if(strcmp(reader->token, "}") == 0) {
+			return 0;
+		}
+		if(strcmp(reader->token, ",") != 0) {
+			printf("[ERROR] Expected ',' or '}', at %s:%d:%d.\n", reader->file, reader->line, reader->column);
+			return -1;
+		}
+	}
+}
+
+static char* Project__output(PROJECT_READER* reader) {
+	// "name" or {"name", linux="<suffix>", windows="<suffix>"}
+	if(Project__next(reader) != 0) {
+		printf("[ERROR] Expected an output name, at %s:%d:%d.\n", reader->file, reader->line, reader->column);
+		return NULL;
+	}
+	if(reader->string) {
+		return strdup(reader->token);
+	}
+	if(strcmp(reader->token, "{") != 0 || Project__next(reader) != 0 || !reader->string) {
+		printf("[ERROR] Expected an output name, at %s:%d:%d.\n", reader->file, reader->line, reader->column);
+		return NULL;
+	}
+	char name[512];
+	char suffix[512] = "";
+	snprintf(name, sizeof(name), "%s", reader->token);
+	while(true) {
+		if(Project__next(reader) != 0) {
+			printf("[ERROR] Expected ',' or '}', at %s:%d:%d.\n", reader->file, reader->line, reader->column);
+			return NULL;
+		}
+		if(strcmp(reader->token, "}") == 0) {
+			break;
+		}
+		char platform[512];
+		if(strcmp(reader->token, ",") != 0 || Project__next(reader) != 0 || reader->string) {
+			printf("[ERROR] Expected a platform, at %s:%d:%d.\n", reader->file, reader->line, reader->column);
+			return NULL;
+		}
+		snprintf(platform, sizeof(platform), "%s", reader->token);
+		if(Project__expect(reader, "=") != 0) {
+			return NULL;
+		}
+		if(Project__next(reader) != 0 || !reader->string) {
+			printf("[ERROR] Expected a suffix, at %s:%d:%d.\n", reader->file, reader->line, reader->column);
+			return NULL;
+		}
+		if(strcmp(platform, "linux") == 0) {
+			snprintf(suffix, sizeof(suffix), "%s", reader->token);
+		}
+	}
+	char* output = malloc(strlen(name) + strlen(suffix) + 1);
+	if(output != NULL) {
+		sprintf(output, "%s%s", name, suffix);
+	}
+	return output;
+}
+
+static BUILD_TARGET* Project__find(BUILD_PROJECT* project, const char* name) {
+	for(int i = 0;i < project->target_count;i++) {
+		if(strcmp(project->targets[i].name, name) == 0) {
+			return &project->targets[i];
+		}
+	}
+	return NULL;
+}
+
+int Build__parse(BUILD_PROJECT* project, const char* file) {
+	FILE* fptr = fopen(file, "r");
+	if(fptr == NULL) {
+		printf("[ERROR] Could not open project file \"%s\".\n", file);
+		return -1;
+	}
+	fseek(fptr, 0, SEEK_END);
+	long length = ftell(fptr);
+	fseek(fptr, 0, SEEK_SET);
+	PROJECT_READER reader = {0};
+	reader.file = file;
+	reader.text = malloc(length + 1);
+	reader.line = 1;
+	reader.column = 1;
+	if(reader.text == NULL || fread(reader.text, 1, length, fptr) != (size_t)length) {
+		printf("[ERROR] Could not read project file \"%s\".\n", file);
+		fclose(fptr);
+		free(reader.text);
+		return -1;
+	}
+	fclose(fptr);
+	reader.text[length] = '\0';
+
+	// Sources are relative to the project file
+	project->file = strdup(file);
+	const char* slash = strrchr(file, '/');
+	project->directory = slash != NULL ? strndup(file, slash - file) : strdup(".");
+
+	int ret = 0;
+	while(ret == 0) {
+		int next = Project__next(&reader);
+		if(next != 0) {
+			ret = next < 0 ? -1 : 0;
+			break;
+		}
+		int line = reader.line;
+		char command[512];
+		snprintf(command, sizeof(command), "%s", reader.token);
+		if(reader.string || Project__expect(&reader, "(") != 0) {
+			printf("[ERROR] Expected a command, at %s:%d.\n", file, line);
+			ret = -1;
+			break;
+		}
+
+		if(strcmp(command, "ADD_EXECUTABLE") == 0 || strcmp(command, "ADD_STATIC_LIBRARY") == 0 || strcmp(command, "ADD_DYNAMIC_LIBRARY") == 0) {
+			BUILD_TARGET target = {0};
+			target.line = line;
+			target.link_job = -1;
+			if(strcmp(command, "ADD_EXECUTABLE") == 0) {
+				target.type = BUILD_TARGET_EXECUTABLE;
+			}
+			else if(strcmp(command, "ADD_STATIC_LIBRARY") == 0) {
+				target.type = BUILD_TARGET_STATIC_LIBRARY;
+			}
+			else {
+				target.type = BUILD_TARGET_DYNAMIC_LIBRARY;
+			}
+			if(Project__strings(&reader, &target.sources, &target.source_count) != 0 || Project__expect(&reader, ",") != 0 ||
+				(target.name = Project__output(&reader)) == NULL || Project__expect(&reader, ")") != 0) {
+				ret = -1;
+			}
+			else if(Project__find(project, target.name) != NULL) {
+				printf("[ERROR] Target \"%s\" is defined twice, at %s:%d.\n", target.name, file, line);
+				ret = -1;
+			}
+			BUILD_TARGET* targets = realloc(project->targets, (project->target_count + 1) * sizeof(BUILD_TARGET));
+			if(targets == NULL) {
+				ret = -1;
+				break;
+			}
+			project->targets = targets;
+			project->targets[project->target_count++] = target;
+		}
+		else if(strcmp(command, "TARGET_LINK_LIBRARIES") == 0) {
+			if(Project__next(&reader) != 0 || !reader.string) {
+				printf("[ERROR] Expected a target name, at %s:%d.\n", file, line);
+				ret = -1;
+				break;
+			}
+			BUILD_TARGET* target = Project__find(project, reader.token);
+			if(target == NULL) {
+				printf("[ERROR] Unknown target \"%s\", at %s:%d.\n", reader.token, file, line);
+				ret = -1;
+				break;
+			}
+			if(Project__expect(&reader, ",") != 0 || Project__strings(&reader, &target->libraries, &target->library_count) != 0 ||
+				Project__expect(&reader, ")") != 0) {
+				ret = -1;
+			}
+		}
+		else {
+			printf("[ERROR] Unknown command \"%s\", at %s:%d.\n", command, file, line);
+			ret = -1;
+		}
+	}
+	free(reader.text);
+	return ret;
+}
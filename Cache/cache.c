@@ -0,0 +1,585 @@
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "cache.h"
+
+#define C compiler
+
+// Cache file layout (little endian):
+//   u32 magic, u32 version, u64 key, u64 size, <size bytes>
+//   u32 label count,      per label:      u64 offset, u64 size, u8 flags (1 = global, 2 = exported), u32 length, <name>
+//   u32 relocation count, per relocation: u64 offset, u32 type, i64 addend, u32 length, <symbol>
+
+uint64_t Cache__hash(uint64_t hash, const void* data, size_t length) {
+	// FNV-1a
+	const uint8_t* bytes = data;
+	for(size_t i = 0;i < length;i++) {
+		hash ^= bytes[i];
+		hash *= 0x100000001b3ull;
+	}
+	return hash;
+}
+
+uint64_t Cache__hash_string(uint64_t hash, const char* str) {
+	// Including the terminator keeps "ab" "c" and "a" "bc" apart
+	return Cache__hash(hash, str, strlen(str) + 1);
+}
+
+static uint64_t Cache__flags(COMPILER* compiler) {
+	// Everything outside of the function that changes its translation
+	uint64_t hash = 0xcbf29ce484222325ull;
+	uint32_t version = CACHE_VERSION;
+	hash = Cache__hash(hash, &version, sizeof(version));
+	hash = Cache__hash(hash, &C->bflagsArgs[2], sizeof(bool));
+	hash = Cache__hash(hash, &C->format, sizeof(C->format));
+	hash = Cache__hash(hash, &C->pic, sizeof(C->pic));
+	hash = Cache__hash(hash, &C->whole_program, sizeof(C->whole_program));
+	hash = Cache__hash(hash, &C->debug, sizeof(C->debug));
+	hash = Cache__hash(hash, &C->target.level, sizeof(C->target.level));
+	// Constexpr functions compute initializers inside of any function
+	for(int i = 0;i < C->evaluator.function_count;i++) {
+		CONSTEXPR_FUNCTION* function = &C->evaluator.functions[i];
+		hash = Cache__hash_string(hash, function->name);
+		for(int j = 0;j < function->arg_count;j++) {
+			hash = Cache__hash_string(hash, function->args[j]);
+		}
+		for(int j = function->token_start;j <= function->token_end;j++) {
+			hash = Cache__hash_string(hash, C->tokens[j].str);
+		}
+	}
+	return hash;
+}
+
+static CACHE_SYMBOL* Cache__lookup(FUNCTION_CACHE* cache, const char* name) {
+	uint64_t mask = (uint64_t)cache->symbol_capacity - 1;
+	uint64_t slot = Cache__hash_string(0xcbf29ce484222325ull, name) & mask;
+	while(cache->symbols[slot].name != NULL) {
+		if(strcmp(cache->symbols[slot].name, name) == 0) {
+			return &cache->symbols[slot];
+		}
+		slot = (slot + 1) & mask;
+	}
+	return &cache->symbols[slot];
+}
+
+static int Cache__mkdir(const char* path) {
+	// mkdir -p
+	char buffer[512];
+	snprintf(buffer, sizeof(buffer), "%s", path);
+	for(char* p = buffer + 1;*p;p++) {
+		if(*p == '/') {
+			*p = '\0';
+			if(mkdir(buffer, 0755) != 0 && errno != EEXIST) {
+				return -1;
+			}
+			*p = '/';
+		}
+	}
+	if(mkdir(buffer, 0755) != 0 && errno != EEXIST) {
+		return -1;
+	}
+	return 0;
+}
+
+int Cache__prepare(COMPILER* compiler) {
+	FUNCTION_CACHE* cache = &C->cache;
+	if(!cache->enabled) {
+		return 0;
+	}
+
+	// One directory per source file
+	char directory[512];
+	snprintf(directory, sizeof(directory), "./build/ChaosLangCompiler/cache/%016llx",
+		(unsigned long long)Cache__hash_string(0xcbf29ce484222325ull, C->fName));
+	if(Cache__mkdir(directory) != 0) {
+		printf("[WARNING] Could not create cache directory \"%s\", compiling without cache.\n", directory);
+		cache->enabled = false;
+		return 0;
+	}
+	free(cache->directory);
+	cache->directory = strdup(directory);
+
+	// Signatures of functions and declarations of globals
+	int capacity = 16;
+	while(capacity < (C->current_function + C->pcc_entries) * 2) {
+		capacity = capacity * 2;
+	}
+	free(cache->symbols);
+	cache->symbols = calloc(capacity, sizeof(CACHE_SYMBOL));
+	free(cache->keys);
+	cache->keys = malloc((C->current_function + 1) * sizeof(uint64_t));
+	if(cache->symbols == NULL || cache->keys == NULL) {
+		printf("[ERROR] Could not allocate cache tables.\n");
+		return -1;
+	}
+	cache->symbol_capacity = capacity;
+	for(int i = 0;i < C->current_function;i++) {
+		uint64_t hash = Cache__hash_string(0xcbf29ce484222325ull, C->functions[i].name);
+		hash = Cache__hash(hash, &C->functions[i].arg_count, sizeof(int));
+		for(int j = 0;j < C->functions[i].arg_count;j++) {
+			// Callers keep arrays that escape on the heap (see Optimizer/Escape/escape.h)
+			hash = Cache__hash(hash, &C->functions[i].args[j].type, sizeof(int));
+			hash = Cache__hash(hash, &C->functions[i].args[j].escapes, sizeof(bool));
+		}
+		CACHE_SYMBOL* symbol = Cache__lookup(cache, C->functions[i].name);
+		symbol->name = C->functions[i].name;
+		symbol->hash = hash;
+	}
+	for(int i = 0;i < C->pcc_entries;i++) {
+		if(C->pre_compiled_code[i].type != CODE_OBJECT_TYPE_INT || !C->pre_compiled_code[i].CODE_OBJECT_DATA._int->global) {
+			continue;
+		}
+		PCC__INT* global = C->pre_compiled_code[i].CODE_OBJECT_DATA._int;
+		uint64_t hash = Cache__hash_string(0xcbf29ce484222325ull, global->identifier);
+		hash = Cache__hash(hash, &global->type, sizeof(int));
+		hash = Cache__hash(hash, &global->value, sizeof(long long));
+		hash = Cache__hash(hash, &global->exported, sizeof(bool));
+		CACHE_SYMBOL* symbol = Cache__lookup(cache, global->identifier);
+		symbol->name = global->identifier;
+		symbol->hash = hash;
+	}
+
+	// Function keys: flags + tokens + everything referenced
+	uint64_t flags = Cache__flags(C);
+	cache->flags = flags;
+	for(int i = 0;i < C->current_function;i++) {
+		uint64_t hash = flags;
+		for(int j = C->functions[i].token_start;j <= C->functions[i].token_end && j < C->current_token_index;j++) {
+			char* str = C->tokens[j].str;
+			hash = Cache__hash_string(hash, str);
+			if(C->debug) {
+				// Line rows of -g move with the tokens
+				hash = Cache__hash(hash, &C->tokens[j].line, sizeof(int));
+				hash = Cache__hash(hash, &C->tokens[j].column, sizeof(int));
+			}
+			if((isalpha(str[0]) || str[0] == '_') && strcmp(str, C->functions[i].name) != 0) {
+				CACHE_SYMBOL* symbol = Cache__lookup(cache, str);
+				if(symbol->name != NULL) {
+					hash = Cache__hash(hash, &symbol->hash, sizeof(uint64_t));
+				}
+			}
+		}
+		cache->keys[i] = hash;
+	}
+	return 0;
+}
+
+// Entries kept in memory by a long running compiler (see Server/server.h)
+typedef struct _CACHE_BLOB_ {
+	char* path;                        // Cache file or source file path
+	uint8_t* data;
+	size_t size;
+	long long mtime;                   // Source files only
+	uint64_t used;                     // Tick of the last get or put, least recently used goes first
+} CACHE_BLOB;
+
+typedef struct _CACHE_MEMORY_ {
+	CACHE_BLOB* blobs;
+	size_t count;
+	size_t capacity;
+	size_t bytes;                      // Sum of the sizes, kept below Cache__memory_limit
+	uint64_t tick;
+	pthread_mutex_t lock;
+} CACHE_MEMORY;
+
+static bool Cache__memory_enabled = false;
+static size_t Cache__memory_limit = CACHE_MEMORY_LIMIT;
+static CACHE_MEMORY Cache__entries = { NULL, 0, 0, 0, 0, PTHREAD_MUTEX_INITIALIZER };
+static CACHE_MEMORY Cache__sources = { NULL, 0, 0, 0, 0, PTHREAD_MUTEX_INITIALIZER };
+
+void Cache__keep_in_memory(bool enabled, size_t limit) {
+	Cache__memory_enabled = enabled;
+	Cache__memory_limit = limit != 0 ? limit : CACHE_MEMORY_LIMIT;
+}
+
+static CACHE_BLOB* Cache__memory_slot(CACHE_MEMORY* memory, const char* path) {
+	// Caller holds memory->lock, memory->capacity is a power of 2
+	size_t mask = memory->capacity - 1;
+	size_t slot = Cache__hash_string(0xcbf29ce484222325ull, path) & mask;
+	while(memory->blobs[slot].path != NULL && strcmp(memory->blobs[slot].path, path) != 0) {
+		slot = (slot + 1) & mask;
+	}
+	return &memory->blobs[slot];
+}
+
+static void Cache__memory_remove(CACHE_MEMORY* memory, CACHE_BLOB* blob) {
+	// Caller holds memory->lock, the rest of the probe run moves up into the hole
+	size_t mask = memory->capacity - 1;
+	size_t slot = blob - memory->blobs;
+	memory->bytes -= blob->size;
+	memory->count--;
+	free(blob->path);
+	free(blob->data);
+	memset(blob, 0, sizeof(*blob));
+	for(size_t next = (slot + 1) & mask;memory->blobs[next].path != NULL;next = (next + 1) & mask) {
+		CACHE_BLOB moved = memory->blobs[next];
+		memset(&memory->blobs[next], 0, sizeof(CACHE_BLOB));
+		*Cache__memory_slot(memory, moved.path) = moved;
+	}
+}
+
+static int Cache__memory_get(CACHE_MEMORY* memory, const char* path, long long mtime, uint8_t** data, size_t* size) {
+	// Copies the entry, returns 0 if it was found
+	int ret = 1;
+	pthread_mutex_lock(&memory->lock);
+	if(memory->capacity != 0) {
+		CACHE_BLOB* blob = Cache__memory_slot(memory, path);
+		if(blob->path != NULL && blob->mtime == mtime) {
+			*data = malloc(blob->size > 0 ? blob->size : 1);
+			if(*data != NULL) {
+				memcpy(*data, blob->data, blob->size);
+				*size = blob->size;
+				blob->used = ++memory->tick;
+				ret = 0;
+			}
+		}
+	}
+	pthread_mutex_unlock(&memory->lock);
+	return ret;
+}
+
+static void Cache__memory_put(CACHE_MEMORY* memory, const char* path, long long mtime, const uint8_t* data, size_t size) {
+	if(size > Cache__memory_limit) {
+		return;
+	}
+	uint8_t* copy = malloc(size > 0 ? size : 1);
+	if(copy == NULL) {
+		return;
+	}
+	memcpy(copy, data, size);
+	pthread_mutex_lock(&memory->lock);
+	if((memory->count + 1) * 2 > memory->capacity) {
+		// Grow and rehash
+		size_t capacity = memory->capacity ? memory->capacity * 2 : 256;
+		CACHE_BLOB* blobs = calloc(capacity, sizeof(CACHE_BLOB));
+		if(blobs == NULL) {
+			pthread_mutex_unlock(&memory->lock);
+			free(copy);
+			return;
+		}
+		CACHE_MEMORY grown = {0};
+		grown.blobs = blobs;
+		grown.count = memory->count;
+		grown.capacity = capacity;
+		for(size_t i = 0;i < memory->capacity;i++) {
+			if(memory->blobs[i].path != NULL) {
+				*Cache__memory_slot(&grown, memory->blobs[i].path) = memory->blobs[i];
+			}
+		}
+		free(memory->blobs);
+		memory->blobs = blobs;
+		memory->capacity = capacity;
+	}
+	CACHE_BLOB* blob = Cache__memory_slot(memory, path);
+	if(blob->path == NULL) {
+		blob->path = strdup(path);
+		memory->count++;
+	}
+	memory->bytes = memory->bytes - blob->size + size;
+	free(blob->data);
+	blob->data = copy;
+	blob->size = size;
+	blob->mtime = mtime;
+	blob->used = ++memory->tick;
+
+	// Over the limit: drop the least recently used entries, never the new one
+	while(memory->bytes > Cache__memory_limit && memory->count > 1) {
+		CACHE_BLOB* oldest = NULL;
+		for(size_t i = 0;i < memory->capacity;i++) {
+			if(memory->blobs[i].path != NULL && memory->blobs[i].used != memory->tick && (oldest == NULL || memory->blobs[i].used < oldest->used)) {
+				oldest = &memory->blobs[i];
+			}
+		}
+		Cache__memory_remove(memory, oldest);
+	}
+	pthread_mutex_unlock(&memory->lock);
+}
+
+FILE* Cache__open_source(const char* path) {
+	if(!Cache__memory_enabled) {
+		return fopen(path, "r");
+	}
+	struct stat status;
+	if(stat(path, &status) != 0) {
+		return NULL;
+	}
+	// Contents are reused while the modification time and size stay the same
+	long long mtime = (long long)status.st_mtim.tv_sec * 1000000000ll + status.st_mtim.tv_nsec;
+	uint8_t* data = NULL;
+	size_t size = 0;
+	if(Cache__memory_get(&Cache__sources, path, mtime, &data, &size) != 0 || size != (size_t)status.st_size) {
+		free(data);
+		FILE* file = fopen(path, "r");
+		if(file == NULL) {
+			return NULL;
+		}
+		size = status.st_size;
+		data = malloc(size > 0 ? size : 1);
+		if(data == NULL || fread(data, 1, size, file) != size) {
+			free(data);
+			rewind(file);
+			return file;
+		}
+		fclose(file);
+		Cache__memory_put(&Cache__sources, path, mtime, data, size);
+	}
+	if(size == 0) {
+		free(data);
+		return fopen(path, "r");
+	}
+	// The stream gets its own copy of the contents
+	FILE* file = NULL;
+	int fd = memfd_create("chaoslang-source", 0);
+	if(fd >= 0 && write(fd, data, size) == (ssize_t)size && lseek(fd, 0, SEEK_SET) == 0) {
+		file = fdopen(fd, "r");
+	}
+	if(file == NULL) {
+		if(fd >= 0) {
+			close(fd);
+		}
+		file = fopen(path, "r");
+	}
+	free(data);
+	return file;
+}
+
+static void Cache__path(COMPILER* compiler, int function, char* path, size_t size) {
+	// Builds with other options keep their own entries next to these
+	snprintf(path, size, "%s/%s.%016llx.fnc", C->cache.directory, C->functions[function].name, (unsigned long long)C->cache.flags);
+}
+
+// Bounds checked reader over the loaded file
+typedef struct _CACHE_READER_ {
+	uint8_t* data;
+	size_t size;
+	size_t offset;
+	bool failed;
+} CACHE_READER;
+
+static void Cache__read(CACHE_READER* reader, void* out, size_t length) {
+	if(reader->failed || reader->offset + length > reader->size) {
+		reader->failed = true;
+		memset(out, 0, length);
+		return;
+	}
+	memcpy(out, reader->data + reader->offset, length);
+	reader->offset = reader->offset + length;
+}
+
+static char* Cache__read_string(CACHE_READER* reader) {
+	uint32_t length = 0;
+	Cache__read(reader, &length, sizeof(length));
+	if(reader->failed || reader->offset + length > reader->size) {
+		reader->failed = true;
+		return NULL;
+	}
+	char* str = malloc(length + 1);
+	if(str == NULL) {
+		reader->failed = true;
+		return NULL;
+	}
+	memcpy(str, reader->data + reader->offset, length);
+	str[length] = '\0';
+	reader->offset = reader->offset + length;
+	return str;
+}
+
+int Cache__load(COMPILER* compiler, int function, CODE_BUFFER* buffer) {
+	// Returns 0 on a hit, 1 on a miss
+	if(!C->cache.enabled) {
+		return 1;
+	}
+	char path[640];
+	Cache__path(C, function, path, sizeof(path));
+	CACHE_READER reader = { NULL, 0, 0, false };
+	if(!Cache__memory_enabled || Cache__memory_get(&Cache__entries, path, 0, &reader.data, &reader.size) != 0) {
+		FILE* file = fopen(path, "rb");
+		if(file == NULL) {
+			__atomic_fetch_add(&C->cache.misses, 1, __ATOMIC_RELAXED);
+			return 1;
+		}
+		fseek(file, 0, SEEK_END);
+		long length = ftell(file);
+		fseek(file, 0, SEEK_SET);
+		reader.size = length > 0 ? length : 0;
+		reader.data = malloc(length > 0 ? length : 1);
+		if(reader.data == NULL || fread(reader.data, 1, reader.size, file) != reader.size) {
+			reader.failed = true;
+		}
+		fclose(file);
+		if(Cache__memory_enabled && !reader.failed) {
+			Cache__memory_put(&Cache__entries, path, 0, reader.data, reader.size);
+		}
+	}
+
+	uint32_t magic = 0, version = 0;
+	uint64_t key = 0, size = 0;
+	Cache__read(&reader, &magic, sizeof(magic));
+	Cache__read(&reader, &version, sizeof(version));
+	Cache__read(&reader, &key, sizeof(key));
+	Cache__read(&reader, &size, sizeof(size));
+	if(reader.failed || magic != CACHE_MAGIC || version != CACHE_VERSION || key != C->cache.keys[function] || reader.offset + size > reader.size) {
+		free(reader.data);
+		__atomic_fetch_add(&C->cache.misses, 1, __ATOMIC_RELAXED);
+		return 1;
+	}
+	CodeBuffer__emit(buffer, reader.data + reader.offset, size);
+	reader.offset = reader.offset + size;
+
+	uint32_t count = 0;
+	Cache__read(&reader, &count, sizeof(count));
+	for(uint32_t i = 0;i < count && !reader.failed;i++) {
+		uint64_t offset = 0, label_size = 0;
+		uint8_t flags = 0;
+		Cache__read(&reader, &offset, sizeof(offset));
+		Cache__read(&reader, &label_size, sizeof(label_size));
+		Cache__read(&reader, &flags, sizeof(flags));
+		char* name = Cache__read_string(&reader);
+		if(name != NULL) {
+			int index = CodeBuffer__label_at(buffer, offset, name, (flags & 1) != 0);
+			if(index >= 0) {
+				buffer->labels[index].size = label_size;
+				buffer->labels[index].exported = (flags & 2) != 0;
+			}
+			free(name);
+		}
+	}
+	Cache__read(&reader, &count, sizeof(count));
+	for(uint32_t i = 0;i < count && !reader.failed;i++) {
+		uint64_t offset = 0;
+		uint32_t type = 0;
+		int64_t addend = 0;
+		Cache__read(&reader, &offset, sizeof(offset));
+		Cache__read(&reader, &type, sizeof(type));
+		Cache__read(&reader, &addend, sizeof(addend));
+		char* symbol = Cache__read_string(&reader);
+		if(symbol != NULL) {
+			CodeBuffer__relocation_at(buffer, offset, symbol, type, addend);
+			free(symbol);
+		}
+	}
+	Cache__read(&reader, &count, sizeof(count));
+	for(uint32_t i = 0;i < count && !reader.failed;i++) {
+		uint64_t offset = 0;
+		int32_t row[3] = { 0, 0, 0 };
+		Cache__read(&reader, &offset, sizeof(offset));
+		Cache__read(&reader, row, sizeof(row));
+		if(!reader.failed) {
+			CodeBuffer__debug_at(buffer, offset, row[0], row[1], row[2]);
+		}
+	}
+	free(reader.data);
+
+	if(reader.failed) {
+		// Damaged entry, translate again
+		CodeBuffer__free(buffer);
+		CodeBuffer__init(buffer, 256);
+		__atomic_fetch_add(&C->cache.misses, 1, __ATOMIC_RELAXED);
+		return 1;
+	}
+	__atomic_fetch_add(&C->cache.hits, 1, __ATOMIC_RELAXED);
+	return 0;
+}
+
+static void Cache__write_string(FILE* file, const char* str) {
+	uint32_t length = strlen(str);
+	fwrite(&length, sizeof(length), 1, file);
+	fwrite(str, 1, length, file);
+}
+
+int Cache__store(COMPILER* compiler, int function, CODE_BUFFER* buffer) {
+	if(!C->cache.enabled) {
+		return 0;
+	}
+	// Serialize, then write to a temporary file and rename, so readers never see half an entry
+	char* data = NULL;
+	size_t size = 0;
+	FILE* file = open_memstream(&data, &size);
+	if(file == NULL) {
+		return -1;
+	}
+	uint32_t magic = CACHE_MAGIC, version = CACHE_VERSION;
+	fwrite(&magic, sizeof(magic), 1, file);
+	fwrite(&version, sizeof(version), 1, file);
+	fwrite(&C->cache.keys[function], sizeof(uint64_t), 1, file);
+	fwrite(&buffer->size, sizeof(uint64_t), 1, file);
+	fwrite(buffer->data, 1, buffer->size, file);
+
+	uint32_t count = buffer->label_count;
+	fwrite(&count, sizeof(count), 1, file);
+	for(int i = 0;i < buffer->label_count;i++) {
+		uint8_t flags = (buffer->labels[i].global ? 1 : 0) | (buffer->labels[i].exported ? 2 : 0);
+		fwrite(&buffer->labels[i].offset, sizeof(uint64_t), 1, file);
+		fwrite(&buffer->labels[i].size, sizeof(uint64_t), 1, file);
+		fwrite(&flags, sizeof(flags), 1, file);
+		Cache__write_string(file, buffer->labels[i].name);
+	}
+	count = buffer->relocation_count;
+	fwrite(&count, sizeof(count), 1, file);
+	for(int i = 0;i < buffer->relocation_count;i++) {
+		uint32_t type = buffer->relocations[i].type;
+		fwrite(&buffer->relocations[i].offset, sizeof(uint64_t), 1, file);
+		fwrite(&type, sizeof(type), 1, file);
+		fwrite(&buffer->relocations[i].addend, sizeof(int64_t), 1, file);
+		Cache__write_string(file, buffer->relocations[i].symbol);
+	}
+	count = buffer->debug_count;
+	fwrite(&count, sizeof(count), 1, file);
+	for(int i = 0;i < buffer->debug_count;i++) {
+		int32_t row[3] = { buffer->debug[i].kind, buffer->debug[i].value, buffer->debug[i].column };
+		fwrite(&buffer->debug[i].offset, sizeof(uint64_t), 1, file);
+		fwrite(row, sizeof(row), 1, file);
+	}
+	if(fclose(file) != 0) {
+		free(data);
+		return -1;
+	}
+
+	char path[640], temp_path[660];
+	Cache__path(C, function, path, sizeof(path));
+	if(Cache__memory_enabled) {
+		Cache__memory_put(&Cache__entries, path, 0, (uint8_t*)data, size);
+	}
+	// Unique per writer, compilers sharing the directory must not write into each other's file
+	snprintf(temp_path, sizeof(temp_path), "%s.XXXXXX", path);
+	int fd = mkstemp(temp_path);
+	file = fd >= 0 ? fdopen(fd, "wb") : NULL;
+	if(file == NULL) {
+		if(fd >= 0) {
+			close(fd);
+			remove(temp_path);
+		}
+		free(data);
+		return -1;
+	}
+	bool failed = fwrite(data, 1, size, file) != size;
+	free(data);
+	if(fclose(file) != 0 || failed) {
+		remove(temp_path);
+		return -1;
+	}
+	// mkstemp creates 0600
+	chmod(temp_path, 0644);
+	if(rename(temp_path, path) != 0) {
+		remove(temp_path);
+		return -1;
+	}
+	return 0;
+}
+
+void Cache__free(COMPILER* compiler) {
+	free(C->cache.directory);
+	free(C->cache.symbols);
+	free(C->cache.keys);
+	C->cache.directory = NULL;
+	C->cache.symbols = NULL;
+	C->cache.keys = NULL;
+	C->cache.symbol_capacity = 0;
+}
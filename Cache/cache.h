@@ -0,0 +1,32 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "./../structures.h"
+
+// Incremental compilation
+//   Every function gets a key made from its tokens, the signatures of the
+//   functions and the declarations of the globals it references and the flags
+//   that change code generation. The translated CODE_BUFFER of a function is
+//   stored under that key and reused by later compiles of the same file.
+//   Entry names carry the hash of the flags as well, so builds of one file
+//   with different options (-fPIC, -g, -march) keep separate entries.
+
+#define CACHE_MAGIC   0x43464C43 // "CLFC"
+#define CACHE_VERSION 5
+
+uint64_t Cache__hash(uint64_t hash, const void* data, size_t length);
+uint64_t Cache__hash_string(uint64_t hash, const char* str);
+int Cache__prepare(COMPILER* compiler);
+int Cache__load(COMPILER* compiler, int function, CODE_BUFFER* buffer);
+int Cache__store(COMPILER* compiler, int function, CODE_BUFFER* buffer);
+void Cache__free(COMPILER* compiler);
+
+// Long running compilers (--server) keep cache entries and source files in memory,
+// each up to limit bytes (0 = CACHE_MEMORY_LIMIT), the least recently used go first
+#define CACHE_MEMORY_LIMIT (256ull << 20)
+
+void Cache__keep_in_memory(bool enabled, size_t limit);
+FILE* Cache__open_source(const char* path);
@@ -0,0 +1,316 @@
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "archive.h"
+#include "./../ELF64/linker.h"
+
+#define ARCHIVE_HEADER_SIZE 60
+
+static uint64_t Archive__hash(const char* name) {
+	// FNV-1a
+	uint64_t hash = 0xcbf29ce484222325ull;
+	while(*name) {
+		hash ^= (uint8_t)*name++;
+		hash *= 0x100000001b3ull;
+	}
+	return hash;
+}
+
+static int Archive__field(char* field, size_t width, const char* value) {
+	// Left aligned and padded with spaces
+	size_t length = strlen(value);
+	if(length > width) {
+		return -1;
+	}
+	memset(field, ' ', width);
+	memcpy(field, value, length);
+	return 0;
+}
+
+static int Archive__header(FILE* file, const char* name, uint64_t size) {
+	// Deterministic: no time stamp, owner or group
+	char header[ARCHIVE_HEADER_SIZE];
+	char digits[24];
+	snprintf(digits, sizeof(digits), "%llu", (unsigned long long)size);
+	if(Archive__field(header, 16, name) != 0 || Archive__field(header + 16, 12, "0") != 0 ||
+		Archive__field(header + 28, 6, "0") != 0 || Archive__field(header + 34, 6, "0") != 0 ||
+		Archive__field(header + 40, 8, "644") != 0 || Archive__field(header + 48, 10, digits) != 0) {
+		printf("[ERROR] Archive member \"%s\" does not fit into its header.\n", name);
+		return -1;
+	}
+	header[58] = '`';
+	header[59] = '\n';
+	fwrite(header, 1, ARCHIVE_HEADER_SIZE, file);
+	return 0;
+}
+
+static void Archive__write_be32(FILE* file, uint32_t value) {
+	uint8_t bytes[4] = { value >> 24, value >> 16, value >> 8, value };
+	fwrite(bytes, 1, 4, file);
+}
+
+typedef struct _ARCHIVE_MEMBER_ {
+	const char* name;                  // File name without directories
+	uint8_t* data;
+	uint64_t size;
+	char** symbols;
+	int symbol_count;
+	uint64_t long_name;                // Offset in the long name member
+	uint64_t offset;                   // Offset of the member header
+} ARCHIVE_MEMBER;
+
+int Archive__write(const char* path, char** objects, int object_count) {
+	ARCHIVE_MEMBER* members = calloc(object_count + 1, sizeof(ARCHIVE_MEMBER));
+	if(members == NULL) {
+		return -1;
+	}
+	int ret = -1;
+	uint64_t symbol_count = 0, symbol_names = 0, long_names = 0;
+	for(int i = 0;i < object_count;i++) {
+		ARCHIVE_MEMBER* member = &members[i];
+		const char* slash = strrchr(objects[i], '/');
+		member->name = slash != NULL ? slash + 1 : objects[i];
+		FILE* file = fopen(objects[i], "rb");
+		if(file == NULL) {
+			printf("[ERROR] Could not open \"%s\".\n", objects[i]);
+			goto CLEANUP;
+		}
+		fseek(file, 0, SEEK_END);
+		member->size = ftell(file);
+		fseek(file, 0, SEEK_SET);
+		member->data = malloc(member->size > 0 ? member->size : 1);
+		if(member->data == NULL || fread(member->data, 1, member->size, file) != member->size) {
+			printf("[ERROR] Could not read \"%s\".\n", objects[i]);
+			fclose(file);
+			goto CLEANUP;
+		}
+		fclose(file);
+		if(Linker__object_globals(member->data, member->size, &member->symbols, &member->symbol_count) != 0) {
+			printf("[ERROR] \"%s\" can not be archived.\n", objects[i]);
+			goto CLEANUP;
+		}
+		symbol_count = symbol_count + member->symbol_count;
+		for(int j = 0;j < member->symbol_count;j++) {
+			symbol_names = symbol_names + strlen(member->symbols[j]) + 1;
+		}
+		if(strlen(member->name) > 15) {
+			member->long_name = long_names;
+			long_names = long_names + strlen(member->name) + 2;
+		}
+	}
+
+	// Layout
+	uint64_t index_size = 4 + 4 * symbol_count + symbol_names;
+	uint64_t offset = ARCHIVE_MAGIC_SIZE + ARCHIVE_HEADER_SIZE + index_size + (index_size & 1);
+	if(long_names > 0) {
+		offset = offset + ARCHIVE_HEADER_SIZE + long_names + (long_names & 1);
+	}
+	for(int i = 0;i < object_count;i++) {
+		members[i].offset = offset;
+		offset = offset + ARCHIVE_HEADER_SIZE + members[i].size + (members[i].size & 1);
+	}
+	if(offset > 0xFFFFFFFFull) {
+		printf("[ERROR] Archive \"%s\" is larger than 4 GiB.\n", path);
+		goto CLEANUP;
+	}
+
+	char temp_path[4200];
+	snprintf(temp_path, sizeof(temp_path), "%s.tmp", path);
+	FILE* file = fopen(temp_path, "wb");
+	if(file == NULL) {
+		printf("[ERROR] Could not create \"%s\".\n", path);
+		goto CLEANUP;
+	}
+	fwrite(ARCHIVE_MAGIC, 1, ARCHIVE_MAGIC_SIZE, file);
+	bool failed = false;
+
+	// Symbol index
+	failed = Archive__header(file, "/", index_size) != 0;
+	Archive__write_be32(file, symbol_count);
+	for(int i = 0;i < object_count;i++) {
+		for(int j = 0;j < members[i].symbol_count;j++) {
+			Archive__write_be32(file, members[i].offset);
+		}
+	}
+	for(int i = 0;i < object_count;i++) {
+		for(int j = 0;j < members[i].symbol_count;j++) {
+			fwrite(members[i].symbols[j], 1, strlen(members[i].symbols[j]) + 1, file);
+		}
+	}
+	if(index_size & 1) {
+		fputc('\n', file);
+	}
+
+	// Long names
+	if(long_names > 0) {
+		failed = failed || Archive__header(file, "//", long_names) != 0;
+		for(int i = 0;i < object_count;i++) {
+			if(strlen(members[i].name) > 15) {
+				fprintf(file, "%s/\n", members[i].name);
+			}
+		}
+		if(long_names & 1) {
+			fputc('\n', file);
+		}
+	}
+
+	// Members
+	for(int i = 0;i < object_count;i++) {
+		char name[32];
+		if(strlen(members[i].name) > 15) {
+			snprintf(name, sizeof(name), "/%llu", (unsigned long long)members[i].long_name);
+		}
+		else {
+			snprintf(name, sizeof(name), "%s/", members[i].name);
+		}
+		failed = failed || Archive__header(file, name, members[i].size) != 0;
+		fwrite(members[i].data, 1, members[i].size, file);
+		if(members[i].size & 1) {
+			fputc('\n', file);
+		}
+	}
+	failed = failed || ferror(file) != 0;
+	if(fclose(file) != 0 || failed || rename(temp_path, path) != 0) {
+		printf("[ERROR] Could not write \"%s\".\n", path);
+		remove(temp_path);
+		goto CLEANUP;
+	}
+	ret = 0;
+
+	CLEANUP:
+	for(int i = 0;i < object_count;i++) {
+		free(members[i].data);
+		for(int j = 0;j < members[i].symbol_count;j++) {
+			free(members[i].symbols[j]);
+		}
+		free(members[i].symbols);
+	}
+	free(members);
+	return ret;
+}
+
+static uint32_t Archive__read_be32(const uint8_t* bytes) {
+	return ((uint32_t)bytes[0] << 24) | ((uint32_t)bytes[1] << 16) | ((uint32_t)bytes[2] << 8) | bytes[3];
+}
+
+int Archive__member(ARCHIVE* archive, uint64_t offset, const uint8_t** data, uint64_t* size) {
+	if(offset + ARCHIVE_HEADER_SIZE > archive->size) {
+		return -1;
+	}
+	const char* header = (const char*)archive->data + offset;
+	if(header[58] != '`' || header[59] != '\n') {
+		return -1;
+	}
+	char field[11];
+	memcpy(field, header + 48, 10);
+	field[10] = '\0';
+	uint64_t length = strtoull(field, NULL, 10);
+	if(length > archive->size - offset - ARCHIVE_HEADER_SIZE) {
+		return -1;
+	}
+	*data = archive->data + offset + ARCHIVE_HEADER_SIZE;
+	*size = length;
+	return 0;
+}
+
+int Archive__open(ARCHIVE* archive, const char* path) {
+	memset(archive, 0, sizeof(ARCHIVE));
+	int fd = open(path, O_RDONLY);
+	if(fd < 0) {
+		printf("[ERROR] Could not open \"%s\".\n", path);
+		return -1;
+	}
+	struct stat status;
+	if(fstat(fd, &status) != 0 || status.st_size < ARCHIVE_MAGIC_SIZE) {
+		printf("[ERROR] \"%s\" is not an archive.\n", path);
+		close(fd);
+		return -1;
+	}
+	archive->size = status.st_size;
+	archive->data = mmap(NULL, archive->size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if(archive->data == MAP_FAILED) {
+		archive->data = NULL;
+		printf("[ERROR] Could not map \"%s\".\n", path);
+		return -1;
+	}
+	archive->path = strdup(path);
+	if(memcmp(archive->data, ARCHIVE_MAGIC, ARCHIVE_MAGIC_SIZE) != 0) {
+		printf("[ERROR] \"%s\" is not an archive.\n", path);
+		return -1;
+	}
+
+	// The symbol index is the first member
+	const uint8_t* index;
+	uint64_t index_size;
+	if(Archive__member(archive, ARCHIVE_MAGIC_SIZE, &index, &index_size) != 0 ||
+		memcmp(archive->data + ARCHIVE_MAGIC_SIZE, "/ ", 2) != 0 || index_size < 4) {
+		printf("[ERROR] \"%s\" has no symbol index.\n", path);
+		return -1;
+	}
+	uint32_t count = Archive__read_be32(index);
+	if((uint64_t)count * 4 + 4 > index_size) {
+		printf("[ERROR] \"%s\" has a damaged symbol index.\n", path);
+		return -1;
+	}
+	int capacity = 16;
+	while((uint64_t)capacity < (uint64_t)count * 2) {
+		capacity = capacity * 2;
+	}
+	archive->symbols = calloc(capacity, sizeof(ARCHIVE_SYMBOL));
+	if(archive->symbols == NULL) {
+		return -1;
+	}
+	archive->symbol_capacity = capacity;
+	const char* name = (const char*)index + 4 + (uint64_t)count * 4;
+	const char* end = (const char*)index + index_size;
+	for(uint32_t i = 0;i < count;i++) {
+		size_t length = strnlen(name, end - name);
+		if(name + length >= end) {
+			printf("[ERROR] \"%s\" has a damaged symbol index.\n", path);
+			return -1;
+		}
+		// First definition wins, like the order of the index
+		uint64_t mask = (uint64_t)capacity - 1;
+		uint64_t slot = Archive__hash(name) & mask;
+		while(archive->symbols[slot].name != NULL && strcmp(archive->symbols[slot].name, name) != 0) {
+			slot = (slot + 1) & mask;
+		}
+		if(archive->symbols[slot].name == NULL) {
+			archive->symbols[slot].name = name;
+			archive->symbols[slot].member = Archive__read_be32(index + 4 + (uint64_t)i * 4);
+		}
+		name = name + length + 1;
+	}
+	return 0;
+}
+
+int64_t Archive__find(ARCHIVE* archive, const char* symbol) {
+	// Offset of the member defining symbol, -1 if the archive does not define it
+	if(archive->symbol_capacity == 0) {
+		return -1;
+	}
+	uint64_t mask = (uint64_t)archive->symbol_capacity - 1;
+	uint64_t slot = Archive__hash(symbol) & mask;
+	while(archive->symbols[slot].name != NULL) {
+		if(strcmp(archive->symbols[slot].name, symbol) == 0) {
+			return archive->symbols[slot].member;
+		}
+		slot = (slot + 1) & mask;
+	}
+	return -1;
+}
+
+void Archive__close(ARCHIVE* archive) {
+	if(archive->data != NULL) {
+		munmap(archive->data, archive->size);
+	}
+	free(archive->path);
+	free(archive->symbols);
+	free(archive->loaded);
+	memset(archive, 0, sizeof(ARCHIVE));
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// Static libraries (GNU ar format)
+//   "!<arch>\n", the symbol index member "/" (big endian count, member
+//   offsets, names), the long name member "//" if needed, then the objects.
+//   Readers only map the file and parse the index; members are loaded when
+//   one of their symbols is needed.
+
+#define ARCHIVE_MAGIC      "!<arch>\n"
+#define ARCHIVE_MAGIC_SIZE 8
+
+typedef struct _ARCHIVE_SYMBOL_ {
+	const char* name;                  // Points into the mapped index
+	uint64_t member;                   // Offset of the member header
+} ARCHIVE_SYMBOL;
+
+typedef struct _ARCHIVE_ {
+	char* path;
+	uint8_t* data;                     // Mapped file
+	uint64_t size;
+	ARCHIVE_SYMBOL* symbols;           // Hash table of the index
+	int symbol_capacity;
+	uint64_t* loaded;                  // Members already loaded
+	int loaded_count;
+} ARCHIVE;
+
+int Archive__write(const char* path, char** objects, int object_count);
+int Archive__open(ARCHIVE* archive, const char* path);
+void Archive__close(ARCHIVE* archive);
+int64_t Archive__find(ARCHIVE* archive, const char* symbol);
+int Archive__member(ARCHIVE* archive, uint64_t offset, const uint8_t** data, uint64_t* size);
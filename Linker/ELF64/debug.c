@@ -0,0 +1,435 @@
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <elf.h>
+
+#include "linker.h"
+
+// Symbols and debug info of executables
+//   .symtab lists every label with its size, functions in .text and objects
+//   in the data sections (local labels first, like in objects). Locals of
+//   linked objects keep the name of their source, equal names may repeat.
+//   With -g (image->source) the debug rows of the translated functions (see
+//   CODE_DEBUG) become:
+//   - .eh_frame and .eh_frame_hdr at the end of .rodata: one CIE and one FDE
+//     per function, so unwinders (perf --call-graph=dwarf, gdb) walk through
+//     frameless functions and the ones with an rbp frame. They are loaded
+//     (PT_GNU_EH_FRAME) and refer to the functions through relocations, so
+//     they are built before the layout.
+//   - .debug_line (DWARF 4) with one sequence per function, mapping its code
+//     to line and column of the source file, and the compile unit in
+//     .debug_info/.debug_abbrev that points to it.
+//   Only functions whose code starts with a frame row get debug info, the
+//   runtime and linked objects have none.
+
+// DWARF call frame instructions and pointer encodings
+enum DEBUG_CFA {
+	DW_CFA_nop         = 0x00,
+	DW_CFA_advance_loc1 = 0x02,
+	DW_CFA_advance_loc2 = 0x03,
+	DW_CFA_advance_loc4 = 0x04,
+	DW_CFA_undefined   = 0x07,
+	DW_CFA_same_value  = 0x08,
+	DW_CFA_def_cfa     = 0x0c,
+	DW_CFA_advance_loc = 0x40,         // | delta (< 64)
+	DW_CFA_offset      = 0x80,         // | register, factored offset follows
+	DW_EH_PE_udata4    = 0x03,
+	DW_EH_PE_sdata4    = 0x0b,
+	DW_EH_PE_pcrel     = 0x10,
+	DW_EH_PE_datarel   = 0x30,
+};
+
+// DWARF registers of x86_64
+enum DEBUG_REGISTER {
+	DEBUG_REGISTER_RBP = 6,
+	DEBUG_REGISTER_RSP = 7,
+	DEBUG_REGISTER_RA  = 16,           // Return address
+};
+
+// DWARF line program (version 4) and compile unit
+enum DEBUG_LINE {
+	DW_LNS_copy        = 0x01,
+	DW_LNS_advance_pc  = 0x02,
+	DW_LNS_advance_line = 0x03,
+	DW_LNS_set_column  = 0x05,
+	DW_LNE_end_sequence = 0x01,
+	DW_LNE_set_address = 0x02,
+	DEBUG_LINE_BASE    = -5,
+	DEBUG_LINE_RANGE   = 14,
+	DEBUG_OPCODE_BASE  = 13,
+	DW_TAG_compile_unit = 0x11,
+	DW_AT_name         = 0x03,
+	DW_AT_stmt_list    = 0x10,
+	DW_AT_low_pc       = 0x11,
+	DW_AT_high_pc      = 0x12,
+	DW_AT_comp_dir     = 0x1b,
+	DW_AT_producer     = 0x25,
+	DW_FORM_addr       = 0x01,
+	DW_FORM_data8      = 0x07,
+	DW_FORM_string     = 0x08,
+	DW_FORM_sec_offset = 0x17,
+};
+
+#define DEBUG_PRODUCER "ChaosLangCompiler"
+
+static int Debug__uleb(CODE_BUFFER* buffer, uint64_t value) {
+	do {
+		uint8_t byte = value & 0x7F;
+		value = value >> 7;
+		if(CodeBuffer__byte(buffer, byte | (value != 0 ? 0x80 : 0)) != 0) {
+			return -1;
+		}
+	} while(value != 0);
+	return 0;
+}
+
+static int Debug__sleb(CODE_BUFFER* buffer, int64_t value) {
+	while(true) {
+		uint8_t byte = value & 0x7F;
+		value = value >> 7;
+		bool done = (value == 0 && !(byte & 0x40)) || (value == -1 && (byte & 0x40));
+		if(CodeBuffer__byte(buffer, byte | (done ? 0 : 0x80)) != 0) {
+			return -1;
+		}
+		if(done) {
+			return 0;
+		}
+	}
+}
+
+static int Debug__string(CODE_BUFFER* buffer, const char* str) {
+	return CodeBuffer__emit(buffer, str, strlen(str) + 1);
+}
+
+static void Debug__patch_u32(CODE_BUFFER* buffer, uint64_t offset, uint32_t value) {
+	memcpy(buffer->data + offset, &value, 4);
+}
+
+static int Debug__first_row(CODE_BUFFER* buffer, uint64_t offset) {
+	// First debug row at or after offset (rows are in code order, the buffers are spliced in order)
+	int low = 0, high = buffer->debug_count;
+	while(low < high) {
+		int middle = (low + high) / 2;
+		if(buffer->debug[middle].offset < offset) {
+			low = middle + 1;
+		}
+		else {
+			high = middle;
+		}
+	}
+	return low;
+}
+
+static __thread CODE_BUFFER* sort_text;
+
+static int Debug__compare_offset(const void* a, const void* b) {
+	uint64_t x = sort_text->labels[*(const int*)a].offset;
+	uint64_t y = sort_text->labels[*(const int*)b].offset;
+	return x < y ? -1 : x > y;
+}
+
+static int Debug__functions(OUTPUT_IMAGE* image, int** functions) {
+	// Labels of the functions with debug rows, by address
+	CODE_BUFFER* text = &image->sections[OUTPUT_SECTION_TEXT].buffer;
+	*functions = malloc((text->label_count + 1) * sizeof(int));
+	if(*functions == NULL) {
+		printf("[ERROR] Could not allocate the debug info.\n");
+		return -1;
+	}
+	int count = 0;
+	for(int i = 0;i < text->label_count;i++) {
+		CODE_LABEL* label = &text->labels[i];
+		int row = Debug__first_row(text, label->offset);
+		if(label->size > 0 && row < text->debug_count && text->debug[row].offset == label->offset && text->debug[row].kind == CODE_DEBUG_FRAME) {
+			(*functions)[count++] = i;
+		}
+	}
+	sort_text = text;
+	qsort(*functions, count, sizeof(int), Debug__compare_offset);
+	return count;
+}
+
+static int Debug__advance_loc(CODE_BUFFER* buffer, uint64_t delta) {
+	if(delta == 0) {
+		return 0;
+	}
+	if(delta < 0x40) {
+		return CodeBuffer__byte(buffer, DW_CFA_advance_loc | delta);
+	}
+	if(delta <= 0xFF) {
+		uint8_t bytes[2] = { DW_CFA_advance_loc1, delta };
+		return CodeBuffer__emit(buffer, bytes, 2);
+	}
+	if(delta <= 0xFFFF) {
+		uint8_t bytes[3] = { DW_CFA_advance_loc2, delta, delta >> 8 };
+		return CodeBuffer__emit(buffer, bytes, 3);
+	}
+	if(CodeBuffer__byte(buffer, DW_CFA_advance_loc4) != 0) {
+		return -1;
+	}
+	return CodeBuffer__u32(buffer, (uint32_t)delta);
+}
+
+static int Debug__frame(CODE_BUFFER* buffer, int frame) {
+	// Rules of a CODE_FRAME state: CFA and where rbp is (data alignment -8)
+	uint8_t bytes[6] = { DW_CFA_def_cfa, DEBUG_REGISTER_RSP, 8, DW_CFA_same_value, DEBUG_REGISTER_RBP, 0 };
+	int length = 5;
+	switch(frame) {
+		case CODE_FRAME_ENTRY: break;
+		case CODE_FRAME_PUSHED:
+		case CODE_FRAME_BASE: {
+			bytes[1] = frame == CODE_FRAME_BASE ? DEBUG_REGISTER_RBP : DEBUG_REGISTER_RSP;
+			bytes[2] = 16;
+			bytes[3] = DW_CFA_offset | DEBUG_REGISTER_RBP;
+			bytes[4] = 2;
+		} break;
+		case CODE_FRAME_OUTERMOST: {
+			bytes[0] = DW_CFA_undefined;
+			bytes[1] = DEBUG_REGISTER_RA;
+			length = 2;
+		} break;
+		default: {
+			printf("[ERROR] Unknown frame state %d.\n", frame);
+			return -1;
+		} break;
+	}
+	return CodeBuffer__emit(buffer, bytes, length);
+}
+
+static int Debug__pad(CODE_BUFFER* buffer, uint64_t start) {
+	// CIEs and FDEs end on 8 bytes, the length excludes its own field
+	while((buffer->size - start) % 8 != 0) {
+		if(CodeBuffer__byte(buffer, DW_CFA_nop) != 0) {
+			return -1;
+		}
+	}
+	Debug__patch_u32(buffer, start, (uint32_t)(buffer->size - start - 4));
+	return 0;
+}
+
+int Linker__unwind_tables(OUTPUT_IMAGE* image) {
+	CODE_BUFFER* text = &image->sections[OUTPUT_SECTION_TEXT].buffer;
+	CODE_BUFFER* rodata = &image->sections[OUTPUT_SECTION_RODATA].buffer;
+	int* functions = NULL;
+	int count = Debug__functions(image, &functions);
+	if(count < 0) {
+		return -1;
+	}
+	int ret = -1;
+
+	// .eh_frame_hdr: pointer to .eh_frame, then the FDEs by address for the binary search of unwinders
+	if(CodeBuffer__align(rodata, 8, 0) != 0) {
+		goto CLEANUP;
+	}
+	uint64_t header = rodata->size;
+	uint64_t table = header + 12;
+	uint64_t eh_frame = (table + count * 8 + 7) & ~7ull;
+	uint8_t encodings[4] = { 1, DW_EH_PE_pcrel | DW_EH_PE_sdata4, DW_EH_PE_udata4, DW_EH_PE_datarel | DW_EH_PE_sdata4 };
+	if(CodeBuffer__emit(rodata, encodings, 4) != 0 || CodeBuffer__u32(rodata, (uint32_t)(eh_frame - (header + 4))) != 0 ||
+	   CodeBuffer__u32(rodata, count) != 0 || CodeBuffer__zero(rodata, eh_frame - table) != 0) {
+		goto CLEANUP;
+	}
+
+	// CIE: return address at CFA - 8, CFA = rsp + 8 on entry, FDE addresses are pc relative
+	uint64_t cie = rodata->size;
+	uint8_t cie_start[8] = { 0, 0, 0, 0, 0, 0, 0, 0 };
+	if(CodeBuffer__emit(rodata, cie_start, 8) != 0 || CodeBuffer__byte(rodata, 1) != 0 || Debug__string(rodata, "zR") != 0 ||
+	   Debug__uleb(rodata, 1) != 0 || Debug__sleb(rodata, -8) != 0 || Debug__uleb(rodata, DEBUG_REGISTER_RA) != 0 ||
+	   Debug__uleb(rodata, 1) != 0 || CodeBuffer__byte(rodata, DW_EH_PE_pcrel | DW_EH_PE_sdata4) != 0 ||
+	   Debug__frame(rodata, CODE_FRAME_ENTRY) != 0 || CodeBuffer__byte(rodata, DW_CFA_offset | DEBUG_REGISTER_RA) != 0 ||
+	   Debug__uleb(rodata, 1) != 0 || Debug__pad(rodata, cie) != 0) {
+		goto CLEANUP;
+	}
+
+	// One FDE per function: the frame rows inside of it
+	for(int i = 0;i < count;i++) {
+		CODE_LABEL* label = &text->labels[functions[i]];
+		uint64_t fde = rodata->size;
+		uint64_t entry = table + i * 8;
+		if(CodeBuffer__relocation_at(rodata, entry, label->name, RELOCATION_REL32, entry - header) != 0) {
+			goto CLEANUP;
+		}
+		Debug__patch_u32(rodata, entry + 4, (uint32_t)(fde - header));
+		if(CodeBuffer__u32(rodata, 0) != 0 || CodeBuffer__u32(rodata, (uint32_t)(fde + 4 - cie)) != 0 ||
+		   CodeBuffer__relocation(rodata, label->name, RELOCATION_REL32, 0) != 0 || CodeBuffer__u32(rodata, (uint32_t)label->size) != 0 ||
+		   Debug__uleb(rodata, 0) != 0) {
+			goto CLEANUP;
+		}
+		uint64_t location = label->offset;
+		for(int row = Debug__first_row(text, label->offset);row < text->debug_count && text->debug[row].offset < label->offset + label->size;row++) {
+			CODE_DEBUG* debug = &text->debug[row];
+			if(debug->kind != CODE_DEBUG_FRAME || (debug->offset == label->offset && debug->value == CODE_FRAME_ENTRY)) {
+				continue;
+			}
+			if(Debug__advance_loc(rodata, debug->offset - location) != 0 || Debug__frame(rodata, debug->value) != 0) {
+				goto CLEANUP;
+			}
+			location = debug->offset;
+		}
+		if(Debug__pad(rodata, fde) != 0) {
+			goto CLEANUP;
+		}
+	}
+	if(CodeBuffer__u32(rodata, 0) != 0) {
+		// Terminator
+		goto CLEANUP;
+	}
+	image->eh_frame_hdr_offset = header;
+	image->eh_frame_hdr_size = table + count * 8 - header;
+	image->eh_frame_offset = eh_frame;
+	image->eh_frame_size = rodata->size - eh_frame;
+	ret = 0;
+
+	CLEANUP:
+	free(functions);
+	return ret;
+}
+
+static int Debug__line_rows(CODE_BUFFER* line, CODE_BUFFER* text, CODE_LABEL* label, uint64_t address) {
+	// One sequence: the line rows of the function, the last row at an offset wins
+	int first = Debug__first_row(text, label->offset);
+	uint64_t end = label->offset + label->size;
+	bool started = false;
+	uint64_t location = label->offset;
+	int current_line = 1, current_column = 0;
+	for(int row = first;row < text->debug_count && text->debug[row].offset < end;row++) {
+		CODE_DEBUG* debug = &text->debug[row];
+		if(debug->kind != CODE_DEBUG_LINE) {
+			continue;
+		}
+		int next = row + 1;
+		while(next < text->debug_count && text->debug[next].offset == debug->offset && text->debug[next].kind != CODE_DEBUG_LINE) {
+			next++;
+		}
+		if(next < text->debug_count && text->debug[next].offset == debug->offset) {
+			continue;
+		}
+		if(started && debug->value == current_line && debug->column == current_column) {
+			continue;
+		}
+		if(!started) {
+			uint8_t set_address[3] = { 0, 9, DW_LNE_set_address };
+			if(CodeBuffer__emit(line, set_address, 3) != 0 || CodeBuffer__u64(line, address) != 0) {
+				return -1;
+			}
+			started = true;
+		}
+		if(debug->offset != location && (CodeBuffer__byte(line, DW_LNS_advance_pc) != 0 || Debug__uleb(line, debug->offset - location) != 0)) {
+			return -1;
+		}
+		if(debug->column != current_column && (CodeBuffer__byte(line, DW_LNS_set_column) != 0 || Debug__uleb(line, debug->column) != 0)) {
+			return -1;
+		}
+		if(debug->value != current_line && (CodeBuffer__byte(line, DW_LNS_advance_line) != 0 || Debug__sleb(line, (int64_t)debug->value - current_line) != 0)) {
+			return -1;
+		}
+		if(CodeBuffer__byte(line, DW_LNS_copy) != 0) {
+			return -1;
+		}
+		location = debug->offset;
+		current_line = debug->value;
+		current_column = debug->column;
+	}
+	if(!started) {
+		return 0;
+	}
+	uint8_t end_sequence[3] = { 0, 1, DW_LNE_end_sequence };
+	if(end != location && (CodeBuffer__byte(line, DW_LNS_advance_pc) != 0 || Debug__uleb(line, end - location) != 0)) {
+		return -1;
+	}
+	return CodeBuffer__emit(line, end_sequence, 3);
+}
+
+int Linker__debug_info(OUTPUT_IMAGE* image, CODE_BUFFER* abbrev, CODE_BUFFER* info, CODE_BUFFER* line) {
+	OUTPUT_SECTION* text = &image->sections[OUTPUT_SECTION_TEXT];
+	int* functions = NULL;
+	int count = Debug__functions(image, &functions);
+	if(count < 0) {
+		return -1;
+	}
+	char directory[4096];
+	if(getcwd(directory, sizeof(directory)) == NULL) {
+		strcpy(directory, ".");
+	}
+	int ret = -1;
+
+	// Line program header: one file (relative to the directory of the compile unit)
+	static const uint8_t opcode_lengths[DEBUG_OPCODE_BASE - 1] = { 0, 1, 1, 1, 1, 0, 0, 0, 1, 0, 0, 1 };
+	// Minimum instruction length, operations per instruction, default is_stmt, line base, line range, opcode base
+	uint8_t parameters[6] = { 1, 1, 1, (uint8_t)DEBUG_LINE_BASE, DEBUG_LINE_RANGE, DEBUG_OPCODE_BASE };
+	uint16_t version = 4;
+	if(CodeBuffer__u32(line, 0) != 0 || CodeBuffer__emit(line, &version, 2) != 0 || CodeBuffer__u32(line, 0) != 0 ||
+	   CodeBuffer__emit(line, parameters, 6) != 0 || CodeBuffer__emit(line, opcode_lengths, sizeof(opcode_lengths)) != 0 ||
+	   CodeBuffer__byte(line, 0) != 0 || Debug__string(line, image->source) != 0 ||
+	   Debug__uleb(line, 0) != 0 || Debug__uleb(line, 0) != 0 || Debug__uleb(line, 0) != 0 || CodeBuffer__byte(line, 0) != 0) {
+		goto CLEANUP;
+	}
+	Debug__patch_u32(line, 6, (uint32_t)(line->size - 10));
+	for(int i = 0;i < count;i++) {
+		CODE_LABEL* label = &text->buffer.labels[functions[i]];
+		if(Debug__line_rows(line, &text->buffer, label, text->address + label->offset) != 0) {
+			goto CLEANUP;
+		}
+	}
+	Debug__patch_u32(line, 0, (uint32_t)(line->size - 4));
+
+	// Compile unit over .text
+	uint8_t abbreviations[] = {
+		1, DW_TAG_compile_unit, 0,
+		DW_AT_producer, DW_FORM_string, DW_AT_name, DW_FORM_string, DW_AT_comp_dir, DW_FORM_string,
+		DW_AT_stmt_list, DW_FORM_sec_offset, DW_AT_low_pc, DW_FORM_addr, DW_AT_high_pc, DW_FORM_data8,
+		0, 0, 0
+	};
+	uint8_t address_size = 8;
+	if(CodeBuffer__emit(abbrev, abbreviations, sizeof(abbreviations)) != 0 ||
+	   CodeBuffer__u32(info, 0) != 0 || CodeBuffer__emit(info, &version, 2) != 0 || CodeBuffer__u32(info, 0) != 0 || CodeBuffer__byte(info, address_size) != 0 ||
+	   Debug__uleb(info, 1) != 0 || Debug__string(info, DEBUG_PRODUCER) != 0 || Debug__string(info, image->source) != 0 || Debug__string(info, directory) != 0 ||
+	   CodeBuffer__u32(info, 0) != 0 || CodeBuffer__u64(info, text->address) != 0 || CodeBuffer__u64(info, text->buffer.size) != 0) {
+		goto CLEANUP;
+	}
+	Debug__patch_u32(info, 0, (uint32_t)(info->size - 4));
+	ret = 0;
+
+	CLEANUP:
+	free(functions);
+	return ret;
+}
+
+int Linker__symbol_table(OUTPUT_IMAGE* image, const uint16_t* indices, uint16_t cold_index, CODE_BUFFER* symtab, CODE_BUFFER* strtab, uint32_t* first_global) {
+	// Locals first, then globals (sh_info = first global), the addresses are final
+	Elf64_Sym null_symbol = {0};
+	if(CodeBuffer__emit(symtab, &null_symbol, sizeof(null_symbol)) != 0 || CodeBuffer__byte(strtab, 0) != 0) {
+		return -1;
+	}
+	for(int pass = 0;pass < 2;pass++) {
+		if(pass == 1) {
+			*first_global = symtab->size / sizeof(Elf64_Sym);
+		}
+		for(int i = 0;i < OUTPUT_SECTION_COUNT;i++) {
+			OUTPUT_SECTION* section = &image->sections[i];
+			for(int j = 0;j < section->buffer.label_count;j++) {
+				CODE_LABEL* label = &section->buffer.labels[j];
+				if(label->global != (pass == 1)) {
+					continue;
+				}
+				// Locals of linked objects under the name they had there, section symbols are left out
+				size_t length = label->global ? strlen(label->name) : Linker__source_length(label->name);
+				if(length == 0) {
+					continue;
+				}
+				bool cold = i == OUTPUT_SECTION_TEXT && image->cold_size > 0 && label->offset >= image->cold_offset;
+				uint8_t type = label->size == 0 ? STT_NOTYPE : i == OUTPUT_SECTION_TEXT ? STT_FUNC : STT_OBJECT;
+				Elf64_Sym symbol = {0};
+				symbol.st_name = strtab->size;
+				symbol.st_info = ELF64_ST_INFO(label->global ? STB_GLOBAL : STB_LOCAL, type);
+				symbol.st_shndx = cold ? cold_index : indices[i] != 0 ? indices[i] : SHN_ABS; // Empty sections have no header
+				symbol.st_value = section->address + label->offset;
+				symbol.st_size = label->size;
+				if(CodeBuffer__emit(strtab, label->name, length) != 0 || CodeBuffer__byte(strtab, 0) != 0 || CodeBuffer__emit(symtab, &symbol, sizeof(symbol)) != 0) {
+					return -1;
+				}
+			}
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,233 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "linker.h"
+#include "./../Archive/archive.h"
+
+// Linking objects and static libraries
+//   All objects are loaded. Archive members are only loaded when they define
+//   a symbol that is still undefined (found through the symbol index of the
+//   archive), until no new member is needed.
+
+typedef struct _LINK_SET_ {
+	// Set of symbol names (open addressing, names are not owned)
+	const char** names;
+	int count;
+	int capacity;
+} LINK_SET;
+
+static uint64_t Link__hash(const char* name) {
+	// FNV-1a
+	uint64_t hash = 0xcbf29ce484222325ull;
+	while(*name) {
+		hash ^= (uint8_t)*name++;
+		hash *= 0x100000001b3ull;
+	}
+	return hash;
+}
+
+static bool Link__contains(LINK_SET* set, const char* name) {
+	if(set->capacity == 0) {
+		return false;
+	}
+	uint64_t mask = (uint64_t)set->capacity - 1;
+	uint64_t slot = Link__hash(name) & mask;
+	while(set->names[slot] != NULL) {
+		if(strcmp(set->names[slot], name) == 0) {
+			return true;
+		}
+		slot = (slot + 1) & mask;
+	}
+	return false;
+}
+
+static int Link__insert(LINK_SET* set, const char* name) {
+	if((set->count + 1) * 2 > set->capacity) {
+		int capacity = set->capacity ? set->capacity * 2 : 256;
+		const char** names = calloc(capacity, sizeof(char*));
+		if(names == NULL) {
+			return -1;
+		}
+		for(int i = 0;i < set->capacity;i++) {
+			if(set->names[i] != NULL) {
+				uint64_t slot = Link__hash(set->names[i]) & (uint64_t)(capacity - 1);
+				while(names[slot] != NULL) {
+					slot = (slot + 1) & (uint64_t)(capacity - 1);
+				}
+				names[slot] = set->names[i];
+			}
+		}
+		free(set->names);
+		set->names = names;
+		set->capacity = capacity;
+	}
+	uint64_t mask = (uint64_t)set->capacity - 1;
+	uint64_t slot = Link__hash(name) & mask;
+	while(set->names[slot] != NULL) {
+		if(strcmp(set->names[slot], name) == 0) {
+			return 0;
+		}
+		slot = (slot + 1) & mask;
+	}
+	set->names[slot] = name;
+	set->count++;
+	return 0;
+}
+
+static uint8_t* Link__read(const char* path, uint64_t* size) {
+	FILE* file = fopen(path, "rb");
+	if(file == NULL) {
+		printf("[ERROR] Could not open \"%s\".\n", path);
+		return NULL;
+	}
+	fseek(file, 0, SEEK_END);
+	long length = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	uint8_t* data = malloc(length > 0 ? length : 1);
+	if(data == NULL || fread(data, 1, length, file) != (size_t)length) {
+		printf("[ERROR] Could not read \"%s\".\n", path);
+		free(data);
+		fclose(file);
+		return NULL;
+	}
+	fclose(file);
+	*size = length;
+	return data;
+}
+
+static bool Link__is_archive(const char* path) {
+	FILE* file = fopen(path, "rb");
+	if(file == NULL) {
+		return false;
+	}
+	char magic[ARCHIVE_MAGIC_SIZE];
+	bool archive = fread(magic, 1, ARCHIVE_MAGIC_SIZE, file) == ARCHIVE_MAGIC_SIZE && memcmp(magic, ARCHIVE_MAGIC, ARCHIVE_MAGIC_SIZE) == 0;
+	fclose(file);
+	return archive;
+}
+
+int Linker__link(const char* output, char** inputs, int input_count, uint8_t format) {
+	OUTPUT_IMAGE image;
+	if(Linker__init_image(&image) != 0) {
+		return -1;
+	}
+	ARCHIVE* archives = calloc(input_count + 1, sizeof(ARCHIVE));
+	int archive_count = 0;
+	LINK_SET defined = {0}, requested = {0};
+	int unit = 0;
+	int ret = -1;
+	if(archives == NULL) {
+		goto CLEANUP;
+	}
+
+	// Objects
+	for(int i = 0;i < input_count;i++) {
+		if(Link__is_archive(inputs[i])) {
+			if(Archive__open(&archives[archive_count++], inputs[i]) != 0) {
+				goto CLEANUP;
+			}
+			continue;
+		}
+		uint64_t size;
+		uint8_t* data = Link__read(inputs[i], &size);
+		if(data == NULL) {
+			goto CLEANUP;
+		}
+		int loaded = Linker__load_object(&image, data, size, inputs[i], unit++);
+		free(data);
+		if(loaded != 0) {
+			goto CLEANUP;
+		}
+	}
+
+	// Archive members, until nothing new is referenced
+	int labels_seen[OUTPUT_SECTION_COUNT] = {0};
+	int relocations_seen[OUTPUT_SECTION_COUNT] = {0};
+	const char** undefined = NULL;
+	int undefined_count = 0;
+	undefined = malloc(sizeof(char*));
+	if(undefined == NULL) {
+		goto CLEANUP;
+	}
+	if(format != OUTPUT_FORMAT_ELF64_SHARED) {
+		// Shared objects have no entry point
+		if(Link__insert(&requested, image.entry) != 0) {
+			goto UNDEFINED_CLEANUP;
+		}
+		undefined[undefined_count++] = image.entry;
+	}
+	bool loaded = true;
+	while(loaded) {
+		loaded = false;
+		for(int i = 0;i < OUTPUT_SECTION_COUNT;i++) {
+			CODE_BUFFER* buffer = &image.sections[i].buffer;
+			for(;labels_seen[i] < buffer->label_count;labels_seen[i]++) {
+				if(Link__insert(&defined, buffer->labels[labels_seen[i]].name) != 0) {
+					goto UNDEFINED_CLEANUP;
+				}
+			}
+			for(;relocations_seen[i] < buffer->relocation_count;relocations_seen[i]++) {
+				const char* symbol = buffer->relocations[relocations_seen[i]].symbol;
+				if(Link__contains(&requested, symbol)) {
+					continue;
+				}
+				const char** grown = realloc(undefined, (undefined_count + 1) * sizeof(char*));
+				if(grown == NULL || Link__insert(&requested, symbol) != 0) {
+					goto UNDEFINED_CLEANUP;
+				}
+				undefined = grown;
+				undefined[undefined_count++] = symbol;
+			}
+		}
+		for(int i = 0;i < undefined_count && !loaded;i++) {
+			if(Link__contains(&defined, undefined[i])) {
+				continue;
+			}
+			for(int j = 0;j < archive_count;j++) {
+				int64_t member = Archive__find(&archives[j], undefined[i]);
+				bool known = member < 0;
+				for(int k = 0;k < archives[j].loaded_count && !known;k++) {
+					known = archives[j].loaded[k] == (uint64_t)member;
+				}
+				if(known) {
+					continue;
+				}
+				uint64_t* members = realloc(archives[j].loaded, (archives[j].loaded_count + 1) * sizeof(uint64_t));
+				if(members == NULL) {
+					goto UNDEFINED_CLEANUP;
+				}
+				archives[j].loaded = members;
+				archives[j].loaded[archives[j].loaded_count++] = member;
+				const uint8_t* data;
+				uint64_t size;
+				if(Archive__member(&archives[j], member, &data, &size) != 0) {
+					printf("[ERROR] \"%s\" has a damaged member.\n", archives[j].path);
+					goto UNDEFINED_CLEANUP;
+				}
+				char name[4200];
+				snprintf(name, sizeof(name), "%s(%llu)", archives[j].path, (unsigned long long)member);
+				if(Linker__load_object(&image, data, size, name, unit++) != 0) {
+					goto UNDEFINED_CLEANUP;
+				}
+				// Relocation symbols point into the image, rescan before the next lookup
+				loaded = true;
+				break;
+			}
+		}
+	}
+
+	image.soname = (char*)output;
+	ret = Linker__write_file(&image, output, format);
+
+	UNDEFINED_CLEANUP:
+	free(undefined);
+	CLEANUP:
+	for(int i = 0;i < archive_count;i++) {
+		Archive__close(&archives[i]);
+	}
+	free(archives);
+	free(defined.names);
+	free(requested.names);
+	Linker__free_image(&image);
+	return ret;
+}
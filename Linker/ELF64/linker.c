@@ -0,0 +1,590 @@
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <elf.h>
+
+#include "linker.h"
+
+// Native output writer
+//   Lays out the sections of an OUTPUT_IMAGE, resolves the relocations of all
+//   spliced code buffers and writes the final file with a single write call.
+//   - ELF64: one PT_LOAD per non-empty section (.text RX, .rodata R, .data RW, .bss RW)
+//   - Raw:   .text, .rodata and .data packed after each other (.bss follows in memory only),
+//            bin64 only, bin16/bin32 are rejected until there is 16/32-bit code
+//   Cold code (image->cold) is appended to .text last, after the runtime and
+//   objects linked into it. Executables describe it with a .text.cold section
+//   header inside the .text segment, other formats keep it in .text.
+//   ELF64 executables also carry .symtab, with -g the line table and the
+//   unwind tables (see debug.c).
+
+static const char* section_names[OUTPUT_SECTION_COUNT] = { ".text", ".rodata", ".data", ".bss" };
+
+// Sections of executables that are only in the file (see debug.c), the debug info needs -g
+enum FILE_SECTION_ID {
+	FILE_SECTION_SYMTAB,
+	FILE_SECTION_STRTAB,
+	FILE_SECTION_DEBUG_ABBREV,
+	FILE_SECTION_DEBUG_INFO,
+	FILE_SECTION_DEBUG_LINE,
+	FILE_SECTION_COUNT
+};
+static const char* file_section_names[FILE_SECTION_COUNT] = { ".symtab", ".strtab", ".debug_abbrev", ".debug_info", ".debug_line" };
+static const uint64_t file_section_alignments[FILE_SECTION_COUNT] = { 8, 1, 1, 1, 1 };
+
+static uint64_t Linker__align(uint64_t value, uint64_t alignment) {
+	if(alignment <= 1) {
+		return value;
+	}
+	return (value + alignment - 1) & ~(alignment - 1);
+}
+
+static uint64_t Linker__hash(const char* name) {
+	// FNV-1a
+	uint64_t hash = 0xcbf29ce484222325ull;
+	while(*name) {
+		hash ^= (uint8_t)*name++;
+		hash *= 0x100000001b3ull;
+	}
+	return hash;
+}
+
+static bool Linker__is_raw(uint8_t format) {
+	return format == OUTPUT_FORMAT_RAW64;
+}
+
+int Linker__init_image(OUTPUT_IMAGE* image) {
+	memset(image, 0, sizeof(OUTPUT_IMAGE));
+	uint64_t alignments[OUTPUT_SECTION_COUNT] = { 16, 16, 8, 16 };
+	for(int i = 0;i < OUTPUT_SECTION_COUNT;i++) {
+		if(CodeBuffer__init(&image->sections[i].buffer, 4096) != 0) {
+			return -1;
+		}
+		image->sections[i].alignment = alignments[i];
+	}
+	if(CodeBuffer__init(&image->cold, 256) != 0) {
+		return -1;
+	}
+	image->base_address = 0x400000;
+	image->page_size = 4096;
+	image->entry = "_start";
+	return 0;
+}
+
+void Linker__free_image(OUTPUT_IMAGE* image) {
+	for(int i = 0;i < OUTPUT_SECTION_COUNT;i++) {
+		CodeBuffer__free(&image->sections[i].buffer);
+	}
+	CodeBuffer__free(&image->cold);
+	free(image->symbols);
+	image->symbols = NULL;
+	image->symbol_capacity = 0;
+}
+
+int Linker__splice(OUTPUT_IMAGE* image, int section, CODE_BUFFER* buffer) {
+	return Linker__splice_buffer(&image->sections[section].buffer, buffer);
+}
+
+int Linker__splice_buffer(CODE_BUFFER* target, CODE_BUFFER* buffer) {
+	// Appends the code with its labels, relocations and debug rows
+	uint64_t base = target->size;
+
+	if(CodeBuffer__emit(target, buffer->data, buffer->size) != 0) {
+		return -1;
+	}
+	for(int i = 0;i < buffer->label_count;i++) {
+		CODE_LABEL* label = &buffer->labels[i];
+		int index = CodeBuffer__label_at(target, base + label->offset, label->name, label->global);
+		if(index < 0) {
+			return -1;
+		}
+		target->labels[index].size = label->size;
+		target->labels[index].exported = label->exported;
+	}
+	for(int i = 0;i < buffer->relocation_count;i++) {
+		CODE_RELOCATION* relocation = &buffer->relocations[i];
+		if(CodeBuffer__relocation_at(target, base + relocation->offset, relocation->symbol, relocation->type, relocation->addend) != 0) {
+			return -1;
+		}
+	}
+	for(int i = 0;i < buffer->debug_count;i++) {
+		CODE_DEBUG* row = &buffer->debug[i];
+		if(CodeBuffer__debug_at(target, base + row->offset, row->kind, row->value, row->column) != 0) {
+			return -1;
+		}
+	}
+	return 0;
+}
+
+int Linker__layout(OUTPUT_IMAGE* image, uint8_t format) {
+	if(Linker__is_raw(format)) {
+		// Flat binary: everything follows the code directly
+		uint64_t offset = 0;
+		for(int i = 0;i < OUTPUT_SECTION_COUNT;i++) {
+			offset = Linker__align(offset, image->sections[i].alignment);
+			image->sections[i].file_offset = offset;
+			image->sections[i].address = image->base_address + offset;
+			offset = offset + image->sections[i].buffer.size;
+		}
+		return 0;
+	}
+
+	// ELF: headers in the first page(s), every section starts on its own page
+	uint64_t offset = image->header_size > 0 ? image->header_size : image->page_size;
+	for(int i = 0;i < OUTPUT_SECTION_BSS;i++) {
+		offset = Linker__align(offset, image->page_size);
+		image->sections[i].file_offset = offset;
+		image->sections[i].address = image->base_address + offset;
+		offset = offset + image->sections[i].buffer.size;
+	}
+	offset = Linker__align(offset, image->page_size);
+	image->sections[OUTPUT_SECTION_BSS].file_offset = offset;
+	image->sections[OUTPUT_SECTION_BSS].address = image->base_address + offset;
+	return 0;
+}
+
+static int Linker__insert(OUTPUT_IMAGE* image, char* name, int section, uint64_t offset) {
+	uint64_t mask = (uint64_t)image->symbol_capacity - 1;
+	uint64_t slot = Linker__hash(name) & mask;
+	while(image->symbols[slot].name != NULL) {
+		if(strcmp(image->symbols[slot].name, name) == 0) {
+			printf("[ERROR] Symbol \"%s\" is defined multiple times.\n", name);
+			return -1;
+		}
+		slot = (slot + 1) & mask;
+	}
+	image->symbols[slot].name = name;
+	image->symbols[slot].section = section;
+	image->symbols[slot].offset = offset;
+	return 0;
+}
+
+OUTPUT_SYMBOL* Linker__lookup(OUTPUT_IMAGE* image, const char* name) {
+	if(image->symbol_capacity == 0) {
+		return NULL;
+	}
+	uint64_t mask = (uint64_t)image->symbol_capacity - 1;
+	uint64_t slot = Linker__hash(name) & mask;
+	while(image->symbols[slot].name != NULL) {
+		if(strcmp(image->symbols[slot].name, name) == 0) {
+			return &image->symbols[slot];
+		}
+		slot = (slot + 1) & mask;
+	}
+	return NULL;
+}
+
+uint64_t Linker__symbol_address(OUTPUT_IMAGE* image, OUTPUT_SYMBOL* symbol) {
+	return image->sections[symbol->section].address + symbol->offset;
+}
+
+int Linker__symbols(OUTPUT_IMAGE* image) {
+	// Build the symbol table
+	int count = 0;
+	for(int i = 0;i < OUTPUT_SECTION_COUNT;i++) {
+		count = count + image->sections[i].buffer.label_count;
+	}
+	int capacity = 16;
+	while(capacity < count * 2) {
+		capacity = capacity * 2;
+	}
+	free(image->symbols);
+	image->symbols = calloc(capacity, sizeof(OUTPUT_SYMBOL));
+	if(image->symbols == NULL) {
+		printf("[ERROR] Could not allocate symbol table.\n");
+		return -1;
+	}
+	image->symbol_capacity = capacity;
+	for(int i = 0;i < OUTPUT_SECTION_COUNT;i++) {
+		CODE_BUFFER* buffer = &image->sections[i].buffer;
+		for(int j = 0;j < buffer->label_count;j++) {
+			if(Linker__insert(image, buffer->labels[j].name, i, buffer->labels[j].offset) != 0) {
+				return -1;
+			}
+		}
+	}
+	return 0;
+}
+
+int Linker__resolve(OUTPUT_IMAGE* image) {
+	if(Linker__symbols(image) != 0) {
+		return -1;
+	}
+
+	// Apply relocations
+	for(int i = 0;i < OUTPUT_SECTION_COUNT;i++) {
+		CODE_BUFFER* buffer = &image->sections[i].buffer;
+		for(int j = 0;j < buffer->relocation_count;j++) {
+			CODE_RELOCATION* relocation = &buffer->relocations[j];
+			OUTPUT_SYMBOL* symbol = Linker__lookup(image, relocation->symbol);
+			if(symbol == NULL && image->shared && relocation->type == RELOCATION_ABS64) {
+				// Filled in by the dynamic loader (see Linker__write_shared)
+				continue;
+			}
+			if(symbol == NULL) {
+				printf("[ERROR] Undefined symbol \"%s\".\n", relocation->symbol);
+				return -1;
+			}
+			uint64_t S = Linker__symbol_address(image, symbol);
+			uint64_t P = image->sections[i].address + relocation->offset;
+			uint8_t* field = buffer->data + relocation->offset;
+			switch(relocation->type) {
+				case RELOCATION_ABS64: {
+					uint64_t value = S + relocation->addend;
+					memcpy(field, &value, 8);
+				} break;
+				case RELOCATION_ABS32: {
+					uint64_t value = S + relocation->addend;
+					if(value > 0xFFFFFFFFull) {
+						printf("[ERROR] Relocation to \"%s\" does not fit into 32 bit.\n", relocation->symbol);
+						return -1;
+					}
+					uint32_t value32 = (uint32_t)value;
+					memcpy(field, &value32, 4);
+				} break;
+				case RELOCATION_REL32:
+				case RELOCATION_PLT32: {
+					// PLT32 only remains for symbols of this image (see Linker__indirect)
+					int64_t value = (int64_t)(S + relocation->addend - P);
+					if(value < INT32_MIN || value > INT32_MAX) {
+						printf("[ERROR] Relative relocation to \"%s\" out of range.\n", relocation->symbol);
+						return -1;
+					}
+					int32_t value32 = (int32_t)value;
+					memcpy(field, &value32, 4);
+				} break;
+				default: {
+					printf("[ERROR] Unknown relocation type %d.\n", relocation->type);
+					return -1;
+				} break;
+			}
+		}
+	}
+	return 0;
+}
+
+static int Linker__write_all(int fd, uint8_t* data, uint64_t size) {
+	while(size > 0) {
+		ssize_t written = write(fd, data, size);
+		if(written <= 0) {
+			printf("[ERROR] Could not write output file.\n");
+			return -1;
+		}
+		data = data + written;
+		size = size - written;
+	}
+	return 0;
+}
+
+static int Linker__write_raw(OUTPUT_IMAGE* image, int fd) {
+	OUTPUT_SECTION* data = &image->sections[OUTPUT_SECTION_DATA];
+	uint64_t size = data->file_offset + data->buffer.size;
+	uint8_t* file = calloc(size ? size : 1, 1);
+	if(file == NULL) {
+		printf("[ERROR] Could not allocate output buffer.\n");
+		return -1;
+	}
+	for(int i = 0;i < OUTPUT_SECTION_BSS;i++) {
+		memcpy(file + image->sections[i].file_offset, image->sections[i].buffer.data, image->sections[i].buffer.size);
+	}
+	int ret = Linker__write_all(fd, file, size);
+	free(file);
+	return ret;
+}
+
+static uint32_t Linker__section_name(CODE_BUFFER* shstrtab, const char* name) {
+	uint32_t offset = shstrtab->size;
+	CodeBuffer__emit(shstrtab, name, strlen(name) + 1);
+	return offset;
+}
+
+static int Linker__write_elf64(OUTPUT_IMAGE* image, int fd) {
+	OUTPUT_SYMBOL* entry = Linker__lookup(image, image->entry);
+	if(entry == NULL) {
+		printf("[ERROR] Entry point \"%s\" is not defined.\n", image->entry);
+		return -1;
+	}
+
+	// Section headers: one per non-empty section, the parts of .text and
+	// .rodata (.text.cold, .eh_frame_hdr, .eh_frame), the sections that are
+	// only in the file (symbols and debug info) and the name table
+	int segment_count = 0;
+	uint16_t indices[OUTPUT_SECTION_COUNT] = { 0 };
+	for(int i = 0;i < OUTPUT_SECTION_COUNT;i++) {
+		if(image->sections[i].buffer.size != 0) {
+			indices[i] = ++segment_count;
+		}
+	}
+	bool cold = image->cold_size > 0;
+	bool unwind = image->eh_frame_size > 0;
+	uint16_t cold_index = segment_count + 1;
+	int file_count = image->source != NULL ? FILE_SECTION_COUNT : FILE_SECTION_DEBUG_ABBREV;
+	int file_first = segment_count + 1 + cold + unwind * 2;
+	int section_count = file_first + file_count + 1;
+
+	CODE_BUFFER files[FILE_SECTION_COUNT], shstrtab;
+	uint32_t first_global = 0;
+	uint8_t* file = NULL;
+	int ret = -1;
+	memset(files, 0, sizeof(files));
+	memset(&shstrtab, 0, sizeof(shstrtab));
+	for(int i = 0;i < FILE_SECTION_COUNT;i++) {
+		if(CodeBuffer__init(&files[i], 256) != 0) {
+			goto CLEANUP;
+		}
+	}
+	if(CodeBuffer__init(&shstrtab, 256) != 0 ||
+	   Linker__symbol_table(image, indices, cold_index, &files[FILE_SECTION_SYMTAB], &files[FILE_SECTION_STRTAB], &first_global) != 0) {
+		goto CLEANUP;
+	}
+	if(image->source != NULL && Linker__debug_info(image, &files[FILE_SECTION_DEBUG_ABBREV], &files[FILE_SECTION_DEBUG_INFO], &files[FILE_SECTION_DEBUG_LINE]) != 0) {
+		goto CLEANUP;
+	}
+	CodeBuffer__byte(&shstrtab, 0);
+
+	// File layout: headers, sections, symbols and debug info, name table, section headers
+	OUTPUT_SECTION* data = &image->sections[OUTPUT_SECTION_DATA];
+	uint64_t file_offsets[FILE_SECTION_COUNT];
+	uint64_t offset = data->file_offset + data->buffer.size;
+	for(int i = 0;i < file_count;i++) {
+		offset = Linker__align(offset, file_section_alignments[i]);
+		file_offsets[i] = offset;
+		offset = offset + files[i].size;
+	}
+	uint64_t shstrtab_offset = offset;
+	uint32_t name_offsets[OUTPUT_SECTION_COUNT];
+	for(int i = 0;i < OUTPUT_SECTION_COUNT;i++) {
+		name_offsets[i] = Linker__section_name(&shstrtab, section_names[i]);
+	}
+	uint32_t cold_name = Linker__section_name(&shstrtab, ".text.cold");
+	uint32_t eh_frame_hdr_name = Linker__section_name(&shstrtab, ".eh_frame_hdr");
+	uint32_t eh_frame_name = Linker__section_name(&shstrtab, ".eh_frame");
+	uint32_t file_names[FILE_SECTION_COUNT];
+	for(int i = 0;i < file_count;i++) {
+		file_names[i] = Linker__section_name(&shstrtab, file_section_names[i]);
+	}
+	uint32_t shstrtab_name = Linker__section_name(&shstrtab, ".shstrtab");
+	uint64_t section_header_offset = Linker__align(shstrtab_offset + shstrtab.size, 8);
+	uint64_t size = section_header_offset + section_count * sizeof(Elf64_Shdr);
+
+	file = calloc(size, 1);
+	if(file == NULL) {
+		printf("[ERROR] Could not allocate output buffer.\n");
+		goto CLEANUP;
+	}
+
+	Elf64_Ehdr* header = (Elf64_Ehdr*)file;
+	memcpy(header->e_ident, ELFMAG, SELFMAG);
+	header->e_ident[EI_CLASS] = ELFCLASS64;
+	header->e_ident[EI_DATA] = ELFDATA2LSB;
+	header->e_ident[EI_VERSION] = EV_CURRENT;
+	header->e_ident[EI_OSABI] = ELFOSABI_SYSV;
+	header->e_type = ET_EXEC;
+	header->e_machine = EM_X86_64;
+	header->e_version = EV_CURRENT;
+	header->e_entry = Linker__symbol_address(image, entry);
+	header->e_phoff = sizeof(Elf64_Ehdr);
+	header->e_shoff = section_header_offset;
+	header->e_ehsize = sizeof(Elf64_Ehdr);
+	header->e_phentsize = sizeof(Elf64_Phdr);
+	header->e_phnum = segment_count + unwind;
+	header->e_shentsize = sizeof(Elf64_Shdr);
+	header->e_shnum = section_count;
+	header->e_shstrndx = section_count - 1;
+
+	Elf64_Phdr* program_headers = (Elf64_Phdr*)(file + sizeof(Elf64_Ehdr));
+	Elf64_Shdr* section_headers = (Elf64_Shdr*)(file + section_header_offset);
+	uint32_t segment_flags[OUTPUT_SECTION_COUNT] = { PF_R | PF_X, PF_R, PF_R | PF_W, PF_R | PF_W };
+	uint64_t section_flags[OUTPUT_SECTION_COUNT] = { SHF_ALLOC | SHF_EXECINSTR, SHF_ALLOC, SHF_ALLOC | SHF_WRITE, SHF_ALLOC | SHF_WRITE };
+	int segment = 0;
+	for(int i = 0;i < OUTPUT_SECTION_COUNT;i++) {
+		OUTPUT_SECTION* section = &image->sections[i];
+		if(section->buffer.size == 0) {
+			continue;
+		}
+		bool bss = i == OUTPUT_SECTION_BSS;
+		if(!bss) {
+			memcpy(file + section->file_offset, section->buffer.data, section->buffer.size);
+		}
+
+		Elf64_Phdr* program_header = &program_headers[segment];
+		program_header->p_type = PT_LOAD;
+		program_header->p_flags = segment_flags[i];
+		program_header->p_offset = section->file_offset;
+		program_header->p_vaddr = section->address;
+		program_header->p_paddr = section->address;
+		program_header->p_filesz = bss ? 0 : section->buffer.size;
+		program_header->p_memsz = section->buffer.size;
+		program_header->p_align = image->page_size;
+
+		Elf64_Shdr* section_header = &section_headers[indices[i]];
+		section_header->sh_name = name_offsets[i];
+		section_header->sh_type = bss ? SHT_NOBITS : SHT_PROGBITS;
+		section_header->sh_flags = section_flags[i];
+		section_header->sh_addr = section->address;
+		section_header->sh_offset = section->file_offset;
+		section_header->sh_size = section->buffer.size;
+		section_header->sh_addralign = section->alignment;
+		segment++;
+	}
+	if(cold) {
+		// Part of the .text segment, after the header of .text
+		OUTPUT_SECTION* text = &image->sections[OUTPUT_SECTION_TEXT];
+		Elf64_Shdr* cold_header = &section_headers[cold_index];
+		section_headers[indices[OUTPUT_SECTION_TEXT]].sh_size = image->cold_offset;
+		cold_header->sh_name = cold_name;
+		cold_header->sh_type = SHT_PROGBITS;
+		cold_header->sh_flags = SHF_ALLOC | SHF_EXECINSTR;
+		cold_header->sh_addr = text->address + image->cold_offset;
+		cold_header->sh_offset = text->file_offset + image->cold_offset;
+		cold_header->sh_size = image->cold_size;
+		cold_header->sh_addralign = LINKER_COLD_ALIGNMENT;
+	}
+	if(unwind) {
+		// End of the .rodata segment (see debug.c), found by unwinders through PT_GNU_EH_FRAME
+		OUTPUT_SECTION* rodata = &image->sections[OUTPUT_SECTION_RODATA];
+		Elf64_Shdr* hdr_header = &section_headers[cold_index + cold];
+		Elf64_Shdr* eh_frame_header = hdr_header + 1;
+		section_headers[indices[OUTPUT_SECTION_RODATA]].sh_size = image->eh_frame_hdr_offset;
+		hdr_header->sh_name = eh_frame_hdr_name;
+		hdr_header->sh_type = SHT_PROGBITS;
+		hdr_header->sh_flags = SHF_ALLOC;
+		hdr_header->sh_addr = rodata->address + image->eh_frame_hdr_offset;
+		hdr_header->sh_offset = rodata->file_offset + image->eh_frame_hdr_offset;
+		hdr_header->sh_size = image->eh_frame_hdr_size;
+		hdr_header->sh_addralign = 4;
+		eh_frame_header->sh_name = eh_frame_name;
+		eh_frame_header->sh_type = SHT_X86_64_UNWIND;
+		eh_frame_header->sh_flags = SHF_ALLOC;
+		eh_frame_header->sh_addr = rodata->address + image->eh_frame_offset;
+		eh_frame_header->sh_offset = rodata->file_offset + image->eh_frame_offset;
+		eh_frame_header->sh_size = image->eh_frame_size;
+		eh_frame_header->sh_addralign = 8;
+
+		Elf64_Phdr* program_header = &program_headers[segment];
+		program_header->p_type = PT_GNU_EH_FRAME;
+		program_header->p_flags = PF_R;
+		program_header->p_offset = hdr_header->sh_offset;
+		program_header->p_vaddr = hdr_header->sh_addr;
+		program_header->p_paddr = hdr_header->sh_addr;
+		program_header->p_filesz = image->eh_frame_hdr_size;
+		program_header->p_memsz = image->eh_frame_hdr_size;
+		program_header->p_align = 4;
+	}
+	for(int i = 0;i < file_count;i++) {
+		Elf64_Shdr* section_header = &section_headers[file_first + i];
+		memcpy(file + file_offsets[i], files[i].data, files[i].size);
+		section_header->sh_name = file_names[i];
+		section_header->sh_type = i == FILE_SECTION_SYMTAB ? SHT_SYMTAB : i == FILE_SECTION_STRTAB ? SHT_STRTAB : SHT_PROGBITS;
+		section_header->sh_offset = file_offsets[i];
+		section_header->sh_size = files[i].size;
+		section_header->sh_addralign = file_section_alignments[i];
+	}
+	section_headers[file_first + FILE_SECTION_SYMTAB].sh_link = file_first + FILE_SECTION_STRTAB;
+	section_headers[file_first + FILE_SECTION_SYMTAB].sh_info = first_global;
+	section_headers[file_first + FILE_SECTION_SYMTAB].sh_entsize = sizeof(Elf64_Sym);
+
+	memcpy(file + shstrtab_offset, shstrtab.data, shstrtab.size);
+	Elf64_Shdr* shstrtab_header = &section_headers[section_count - 1];
+	shstrtab_header->sh_name = shstrtab_name;
+	shstrtab_header->sh_type = SHT_STRTAB;
+	shstrtab_header->sh_offset = shstrtab_offset;
+	shstrtab_header->sh_size = shstrtab.size;
+	shstrtab_header->sh_addralign = 1;
+
+	ret = Linker__write_all(fd, file, size);
+
+	CLEANUP:
+	free(file);
+	for(int i = 0;i < FILE_SECTION_COUNT;i++) {
+		CodeBuffer__free(&files[i]);
+	}
+	CodeBuffer__free(&shstrtab);
+	return ret;
+}
+
+static int Linker__splice_cold(OUTPUT_IMAGE* image) {
+	CODE_BUFFER* text = &image->sections[OUTPUT_SECTION_TEXT].buffer;
+	if(image->cold.size == 0) {
+		return 0;
+	}
+	if(CodeBuffer__align(text, LINKER_COLD_ALIGNMENT, 0xCC) != 0) {
+		return -1;
+	}
+	image->cold_offset = text->size;
+	image->cold_size = image->cold.size;
+	int ret = Linker__splice_buffer(text, &image->cold);
+	CodeBuffer__free(&image->cold);
+	return ret != 0 ? ret : CodeBuffer__init(&image->cold, 256);
+}
+
+int Linker__write(OUTPUT_IMAGE* image, int fd, uint8_t format) {
+	if(Linker__splice_cold(image) != 0) {
+		return -1;
+	}
+	if(format == OUTPUT_FORMAT_ELF64_OBJECT) {
+		// Relocations stay unresolved
+		return Linker__write_object(image, fd);
+	}
+	if(format == OUTPUT_FORMAT_ELF64_SHARED) {
+		return Linker__write_shared(image, fd);
+	}
+	if(format == OUTPUT_FORMAT_RAW16 || format == OUTPUT_FORMAT_RAW32) {
+		// The translator only emits 64-bit code
+		printf("[ERROR] Format %d needs 16/32-bit code, which is not supported yet (use bin64).\n", format);
+		return -1;
+	}
+	if(!Linker__is_raw(format) && format != OUTPUT_FORMAT_ELF64_RAW && format != OUTPUT_FORMAT_ELF64_LINUX) {
+		printf("[ERROR] Format %d is not supported by the native writer.\n", format);
+		return -1;
+	}
+	if(image->source != NULL && !Linker__is_raw(format) && Linker__unwind_tables(image) != 0) {
+		return -1;
+	}
+	if(Linker__indirect(image, false) != 0 || Linker__layout(image, format) != 0) {
+		return -1;
+	}
+	if(Linker__resolve(image) != 0) {
+		return -1;
+	}
+	if(Linker__is_raw(format)) {
+		return Linker__write_raw(image, fd);
+	}
+	return Linker__write_elf64(image, fd);
+}
+
+int Linker__write_file(OUTPUT_IMAGE* image, const char* path, uint8_t format) {
+	// Written next to the output and renamed into place, a failed write leaves no partial file
+	char temp_path[4200];
+	snprintf(temp_path, sizeof(temp_path), "%s.tmp", path);
+	int fd = open(temp_path, O_WRONLY | O_CREAT | O_TRUNC, 0755);
+	if(fd < 0) {
+		printf("[ERROR] Could not create output file \"%s\".\n", path);
+		return -1;
+	}
+	int ret = Linker__write(image, fd, format);
+	if(close(fd) != 0 && ret == 0) {
+		printf("[ERROR] Could not write output file \"%s\".\n", path);
+		ret = -1;
+	}
+	if(ret == 0 && rename(temp_path, path) != 0) {
+		printf("[ERROR] Could not create output file \"%s\".\n", path);
+		ret = -1;
+	}
+	if(ret != 0) {
+		unlink(temp_path);
+	}
+	return ret;
+}
+
+int Linker__format(const char* name) {
+	// Format names as used by "-f"
+	if(strcmp(name, "bin16") == 0)          { return OUTPUT_FORMAT_RAW16; }
+	else if(strcmp(name, "bin32") == 0)     { return OUTPUT_FORMAT_RAW32; }
+	else if(strcmp(name, "bin64") == 0)     { return OUTPUT_FORMAT_RAW64; }
+	else if(strcmp(name, "elf_raw") == 0)   { return OUTPUT_FORMAT_ELF64_RAW; }
+	else if(strcmp(name, "elf_linux") == 0) { return OUTPUT_FORMAT_ELF64_LINUX; }
+	else if(strcmp(name, "elf_object") == 0) { return OUTPUT_FORMAT_ELF64_OBJECT; }
+	else if(strcmp(name, "elf_shared") == 0) { return OUTPUT_FORMAT_ELF64_SHARED; }
+	return -1;
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "./../../Assembler/x86_64/assembler.h"
+
+// Alignment of .text.cold, hot code does not share its last cache line with cold code
+#define LINKER_COLD_ALIGNMENT 64
+
+// Output sections (in memory order)
+enum OUTPUT_SECTION_ID {
+	OUTPUT_SECTION_TEXT,
+	OUTPUT_SECTION_RODATA,
+	OUTPUT_SECTION_DATA,
+	OUTPUT_SECTION_BSS,
+	OUTPUT_SECTION_COUNT
+};
+
+// Output formats (same numbers as "Format" in compiler.test.c)
+enum OUTPUT_FORMAT {
+	OUTPUT_FORMAT_RAW16       = 0,
+	OUTPUT_FORMAT_RAW32       = 1,
+	OUTPUT_FORMAT_RAW64       = 2,
+	OUTPUT_FORMAT_ELF64_RAW   = 6,
+	OUTPUT_FORMAT_ELF64_LINUX = 7,
+	OUTPUT_FORMAT_ELF64_OBJECT = 8,    // Relocatable object (ET_REL) for --link and --archive
+	OUTPUT_FORMAT_ELF64_SHARED = 9,    // Shared object (ET_DYN), position independent code only
+};
+
+typedef struct _OUTPUT_SECTION_ {
+	CODE_BUFFER buffer;                // Content (.bss only uses the size)
+	uint64_t alignment;                // Alignment of the section start
+	uint64_t address;                  // Virtual address, set by Linker__layout
+	uint64_t file_offset;              // Offset in the output file, set by Linker__layout
+} OUTPUT_SECTION;
+
+typedef struct _OUTPUT_SYMBOL_ {
+	char* name;                        // Points into the label of the section buffer
+	int section;                       // See OUTPUT_SECTION_ID enum
+	uint64_t offset;                   // Offset inside the section
+} OUTPUT_SYMBOL;
+
+typedef struct _OUTPUT_IMAGE_ {
+	OUTPUT_SECTION sections[OUTPUT_SECTION_COUNT];
+	uint64_t base_address;             // Load address of the image (Default: 0x400000, raw images usually use 0)
+	uint64_t page_size;                // Default: 4096
+	char* entry;                       // Entry symbol (Default: "_start")
+	uint64_t header_size;              // Bytes in front of the first section (Default: 0 = one page)
+	char* soname;                      // DT_SONAME of shared objects (Default: NULL = none)
+	bool shared;                       // Absolute relocations against undefined symbols are left to the dynamic loader
+	const uint8_t* ir;                 // Source of the unit for link-time optimization (objects only, not owned)
+	uint64_t ir_size;
+	CODE_BUFFER cold;                  // Code that did not run in the profile (-fprofile-use), goes to the end of .text
+	uint64_t cold_offset;              // .text.cold inside .text, set by Linker__write (size 0 = none)
+	uint64_t cold_size;
+	const char* source;                // Source file of the debug info (-g), NULL = none (see debug.c)
+	uint64_t eh_frame_hdr_offset;      // .eh_frame_hdr and .eh_frame inside .rodata, set by Linker__write (size 0 = none)
+	uint64_t eh_frame_hdr_size;
+	uint64_t eh_frame_offset;
+	uint64_t eh_frame_size;
+
+	// Symbol table (hash table, built by Linker__resolve)
+	OUTPUT_SYMBOL* symbols;
+	int symbol_capacity;
+} OUTPUT_IMAGE;
+
+int Linker__init_image(OUTPUT_IMAGE* image);
+void Linker__free_image(OUTPUT_IMAGE* image);
+int Linker__splice(OUTPUT_IMAGE* image, int section, CODE_BUFFER* buffer);
+int Linker__splice_buffer(CODE_BUFFER* target, CODE_BUFFER* buffer);
+int Linker__layout(OUTPUT_IMAGE* image, uint8_t format);
+int Linker__symbols(OUTPUT_IMAGE* image);
+int Linker__resolve(OUTPUT_IMAGE* image);
+OUTPUT_SYMBOL* Linker__lookup(OUTPUT_IMAGE* image, const char* name);
+uint64_t Linker__symbol_address(OUTPUT_IMAGE* image, OUTPUT_SYMBOL* symbol);
+int Linker__write(OUTPUT_IMAGE* image, int fd, uint8_t format);
+int Linker__write_file(OUTPUT_IMAGE* image, const char* path, uint8_t format);
+int Linker__format(const char* name);
+
+// Relocatable objects (object.c)
+int Linker__write_object(OUTPUT_IMAGE* image, int fd);
+int Linker__load_object(OUTPUT_IMAGE* image, const uint8_t* data, uint64_t size, const char* name, int unit);
+int Linker__object_globals(const uint8_t* data, uint64_t size, char*** names, int* count);
+int Linker__object_ir(const uint8_t* data, uint64_t size, const uint8_t** ir, uint64_t* ir_size);
+size_t Linker__source_length(const char* name);
+
+// Symbols and debug info of executables (debug.c)
+int Linker__unwind_tables(OUTPUT_IMAGE* image);
+int Linker__debug_info(OUTPUT_IMAGE* image, CODE_BUFFER* abbrev, CODE_BUFFER* info, CODE_BUFFER* line);
+int Linker__symbol_table(OUTPUT_IMAGE* image, const uint16_t* indices, uint16_t cold_index, CODE_BUFFER* symtab, CODE_BUFFER* strtab, uint32_t* first_global);
+
+// Shared objects (shared.c)
+int Linker__indirect(OUTPUT_IMAGE* image, bool shared);
+int Linker__write_shared(OUTPUT_IMAGE* image, int fd);
+
+// Linking objects and static libraries (link.c)
+int Linker__link(const char* output, char** inputs, int input_count, uint8_t format);
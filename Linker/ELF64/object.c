@@ -0,0 +1,520 @@
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <elf.h>
+
+#include "linker.h"
+
+// Relocatable ELF64 objects (ET_REL)
+//   Writer: the sections of an OUTPUT_IMAGE with their labels as symbols and
+//   their relocations as .rela sections. Local labels stay local. Objects
+//   compiled with -flto also carry the source of the unit in .chaos.ir (not
+//   loaded, only read by link-time optimization).
+//   Reader: loads .text*, .rodata*, .data* and .bss* of an object (also
+//   objects from other compilers) into an OUTPUT_IMAGE. Local symbols are
+//   renamed to "<name>.<index>@<unit>" so equal local names do not collide,
+//   neither between objects nor inside one (ld -r output). The .symtab of
+//   executables gets the names back (Linker__source_length).
+
+static const char* object_section_names[OUTPUT_SECTION_COUNT] = { ".text", ".rodata", ".data", ".bss" };
+static const char* object_rela_names[OUTPUT_SECTION_BSS] = { ".rela.text", ".rela.rodata", ".rela.data" };
+
+// Section indices of written objects
+#define OBJECT_SECTION_FIRST  1
+#define OBJECT_RELA_FIRST     (OBJECT_SECTION_FIRST + OUTPUT_SECTION_COUNT)
+#define OBJECT_SYMTAB         (OBJECT_RELA_FIRST + OUTPUT_SECTION_BSS)
+#define OBJECT_STRTAB         (OBJECT_SYMTAB + 1)
+#define OBJECT_SHSTRTAB       (OBJECT_STRTAB + 1)
+#define OBJECT_IR             (OBJECT_SHSTRTAB + 1)
+#define OBJECT_SECTION_COUNT  (OBJECT_IR + 1)
+#define OBJECT_IR_NAME        ".chaos.ir"
+
+typedef struct _OBJECT_NAMES_ {
+	// Symbol name -> symbol index (open addressing)
+	const char** names;
+	int* indices;
+	int capacity;
+} OBJECT_NAMES;
+
+static uint64_t Object__hash(const char* name) {
+	// FNV-1a
+	uint64_t hash = 0xcbf29ce484222325ull;
+	while(*name) {
+		hash ^= (uint8_t)*name++;
+		hash *= 0x100000001b3ull;
+	}
+	return hash;
+}
+
+static int* Object__slot(OBJECT_NAMES* names, const char* name, bool insert) {
+	uint64_t mask = (uint64_t)names->capacity - 1;
+	uint64_t slot = Object__hash(name) & mask;
+	while(names->names[slot] != NULL) {
+		if(strcmp(names->names[slot], name) == 0) {
+			return &names->indices[slot];
+		}
+		slot = (slot + 1) & mask;
+	}
+	if(!insert) {
+		return NULL;
+	}
+	names->names[slot] = name;
+	names->indices[slot] = -1;
+	return &names->indices[slot];
+}
+
+static int Object__add_symbol(CODE_BUFFER* symtab, CODE_BUFFER* strtab, OBJECT_NAMES* names, const char* name,
+	uint8_t info, uint8_t visibility, uint16_t section, uint64_t value, uint64_t size) {
+	int* index = Object__slot(names, name, true);
+	*index = symtab->size / sizeof(Elf64_Sym);
+	Elf64_Sym symbol = {0};
+	symbol.st_name = strtab->size;
+	symbol.st_info = info;
+	symbol.st_other = visibility;
+	symbol.st_shndx = section;
+	symbol.st_value = value;
+	symbol.st_size = size;
+	if(CodeBuffer__emit(strtab, name, strlen(name) + 1) != 0) {
+		return -1;
+	}
+	return CodeBuffer__emit(symtab, &symbol, sizeof(symbol));
+}
+
+int Linker__write_object(OUTPUT_IMAGE* image, int fd) {
+	// Symbol tables
+	int count = 1;
+	for(int i = 0;i < OUTPUT_SECTION_COUNT;i++) {
+		count = count + image->sections[i].buffer.label_count + image->sections[i].buffer.relocation_count;
+	}
+	OBJECT_NAMES names = { NULL, NULL, 16 };
+	while(names.capacity < count * 2) {
+		names.capacity = names.capacity * 2;
+	}
+	names.names = calloc(names.capacity, sizeof(char*));
+	names.indices = calloc(names.capacity, sizeof(int));
+	CODE_BUFFER symtab, strtab, shstrtab, file;
+	CodeBuffer__init(&symtab, (count + 1) * sizeof(Elf64_Sym));
+	CodeBuffer__init(&strtab, 4096);
+	CodeBuffer__init(&shstrtab, 256);
+	CodeBuffer__init(&file, 4096);
+	int ret = -1;
+	if(names.names == NULL || names.indices == NULL || symtab.data == NULL || strtab.data == NULL || shstrtab.data == NULL || file.data == NULL) {
+		printf("[ERROR] Could not allocate object file.\n");
+		goto CLEANUP;
+	}
+	int first_global = 1;
+	Elf64_Sym null_symbol = {0};
+	CodeBuffer__emit(&symtab, &null_symbol, sizeof(null_symbol));
+	CodeBuffer__byte(&strtab, 0);
+
+	// Locals first, then globals, then undefined symbols
+	for(int pass = 0;pass < 2;pass++) {
+		for(int i = 0;i < OUTPUT_SECTION_COUNT;i++) {
+			CODE_BUFFER* buffer = &image->sections[i].buffer;
+			for(int j = 0;j < buffer->label_count;j++) {
+				CODE_LABEL* label = &buffer->labels[j];
+				if(label->global != (pass == 1)) {
+					continue;
+				}
+				uint8_t type = i == OUTPUT_SECTION_TEXT ? STT_FUNC : STT_OBJECT;
+				uint8_t bind = label->global ? STB_GLOBAL : STB_LOCAL;
+				// Globals are only visible outside of a shared object when they are exported
+				uint8_t visibility = label->global && !label->exported ? STV_HIDDEN : STV_DEFAULT;
+				if(Object__add_symbol(&symtab, &strtab, &names, label->name, ELF64_ST_INFO(bind, type), visibility, OBJECT_SECTION_FIRST + i, label->offset, label->size) != 0) {
+					goto CLEANUP;
+				}
+			}
+		}
+		if(pass == 0) {
+			// sh_info of .symtab: index of the first global
+			first_global = symtab.size / sizeof(Elf64_Sym);
+		}
+	}
+	for(int i = 0;i < OUTPUT_SECTION_COUNT;i++) {
+		CODE_BUFFER* buffer = &image->sections[i].buffer;
+		for(int j = 0;j < buffer->relocation_count;j++) {
+			if(Object__slot(&names, buffer->relocations[j].symbol, false) == NULL) {
+				if(Object__add_symbol(&symtab, &strtab, &names, buffer->relocations[j].symbol, ELF64_ST_INFO(STB_GLOBAL, STT_NOTYPE), STV_DEFAULT, SHN_UNDEF, 0, 0) != 0) {
+					goto CLEANUP;
+				}
+			}
+		}
+	}
+
+	// Section contents
+	Elf64_Shdr headers[OBJECT_SECTION_COUNT];
+	memset(headers, 0, sizeof(headers));
+	CodeBuffer__byte(&shstrtab, 0);
+	CodeBuffer__zero(&file, sizeof(Elf64_Ehdr));
+	uint64_t section_flags[OUTPUT_SECTION_COUNT] = { SHF_ALLOC | SHF_EXECINSTR, SHF_ALLOC, SHF_ALLOC | SHF_WRITE, SHF_ALLOC | SHF_WRITE };
+	for(int i = 0;i < OUTPUT_SECTION_COUNT;i++) {
+		OUTPUT_SECTION* section = &image->sections[i];
+		Elf64_Shdr* header = &headers[OBJECT_SECTION_FIRST + i];
+		header->sh_name = shstrtab.size;
+		CodeBuffer__emit(&shstrtab, object_section_names[i], strlen(object_section_names[i]) + 1);
+		header->sh_type = i == OUTPUT_SECTION_BSS ? SHT_NOBITS : SHT_PROGBITS;
+		header->sh_flags = section_flags[i];
+		header->sh_addralign = section->alignment;
+		header->sh_size = section->buffer.size;
+		CodeBuffer__align(&file, section->alignment, 0);
+		header->sh_offset = file.size;
+		if(i != OUTPUT_SECTION_BSS) {
+			CodeBuffer__emit(&file, section->buffer.data, section->buffer.size);
+		}
+	}
+	for(int i = 0;i < OUTPUT_SECTION_BSS;i++) {
+		CODE_BUFFER* buffer = &image->sections[i].buffer;
+		Elf64_Shdr* header = &headers[OBJECT_RELA_FIRST + i];
+		header->sh_name = shstrtab.size;
+		CodeBuffer__emit(&shstrtab, object_rela_names[i], strlen(object_rela_names[i]) + 1);
+		header->sh_type = SHT_RELA;
+		header->sh_flags = SHF_INFO_LINK;
+		header->sh_link = OBJECT_SYMTAB;
+		header->sh_info = OBJECT_SECTION_FIRST + i;
+		header->sh_addralign = 8;
+		header->sh_entsize = sizeof(Elf64_Rela);
+		CodeBuffer__align(&file, 8, 0);
+		header->sh_offset = file.size;
+		for(int j = 0;j < buffer->relocation_count;j++) {
+			CODE_RELOCATION* relocation = &buffer->relocations[j];
+			uint32_t types[] = { R_X86_64_64, R_X86_64_32, R_X86_64_PC32, R_X86_64_PLT32, R_X86_64_GOTPCREL };
+			uint32_t type = types[relocation->type];
+			Elf64_Rela rela;
+			rela.r_offset = relocation->offset;
+			rela.r_info = ELF64_R_INFO((uint64_t)*Object__slot(&names, relocation->symbol, false), type);
+			rela.r_addend = relocation->addend;
+			CodeBuffer__emit(&file, &rela, sizeof(rela));
+		}
+		header->sh_size = file.size - header->sh_offset;
+	}
+	const char* table_names[4] = { ".symtab", ".strtab", ".shstrtab", OBJECT_IR_NAME };
+	for(int i = 0;i < 4;i++) {
+		headers[OBJECT_SYMTAB + i].sh_name = shstrtab.size;
+		CodeBuffer__emit(&shstrtab, table_names[i], strlen(table_names[i]) + 1);
+	}
+	CodeBuffer__align(&file, 8, 0);
+	headers[OBJECT_SYMTAB].sh_type = SHT_SYMTAB;
+	headers[OBJECT_SYMTAB].sh_offset = file.size;
+	headers[OBJECT_SYMTAB].sh_size = symtab.size;
+	headers[OBJECT_SYMTAB].sh_link = OBJECT_STRTAB;
+	headers[OBJECT_SYMTAB].sh_info = first_global;
+	headers[OBJECT_SYMTAB].sh_addralign = 8;
+	headers[OBJECT_SYMTAB].sh_entsize = sizeof(Elf64_Sym);
+	CodeBuffer__emit(&file, symtab.data, symtab.size);
+	headers[OBJECT_STRTAB].sh_type = SHT_STRTAB;
+	headers[OBJECT_STRTAB].sh_offset = file.size;
+	headers[OBJECT_STRTAB].sh_size = strtab.size;
+	headers[OBJECT_STRTAB].sh_addralign = 1;
+	CodeBuffer__emit(&file, strtab.data, strtab.size);
+	headers[OBJECT_SHSTRTAB].sh_type = SHT_STRTAB;
+	headers[OBJECT_SHSTRTAB].sh_offset = file.size;
+	headers[OBJECT_SHSTRTAB].sh_size = shstrtab.size;
+	headers[OBJECT_SHSTRTAB].sh_addralign = 1;
+	CodeBuffer__emit(&file, shstrtab.data, shstrtab.size);
+	int section_count = OBJECT_SECTION_COUNT - 1;
+	if(image->ir != NULL) {
+		headers[OBJECT_IR].sh_type = SHT_PROGBITS;
+		headers[OBJECT_IR].sh_offset = file.size;
+		headers[OBJECT_IR].sh_size = image->ir_size;
+		headers[OBJECT_IR].sh_addralign = 1;
+		CodeBuffer__emit(&file, image->ir, image->ir_size);
+		section_count = OBJECT_SECTION_COUNT;
+	}
+	CodeBuffer__align(&file, 8, 0);
+	uint64_t section_header_offset = file.size;
+	if(CodeBuffer__emit(&file, headers, section_count * sizeof(Elf64_Shdr)) != 0) {
+		goto CLEANUP;
+	}
+
+	Elf64_Ehdr* header = (Elf64_Ehdr*)file.data;
+	memcpy(header->e_ident, ELFMAG, SELFMAG);
+	header->e_ident[EI_CLASS] = ELFCLASS64;
+	header->e_ident[EI_DATA] = ELFDATA2LSB;
+	header->e_ident[EI_VERSION] = EV_CURRENT;
+	header->e_ident[EI_OSABI] = ELFOSABI_SYSV;
+	header->e_type = ET_REL;
+	header->e_machine = EM_X86_64;
+	header->e_version = EV_CURRENT;
+	header->e_shoff = section_header_offset;
+	header->e_ehsize = sizeof(Elf64_Ehdr);
+	header->e_shentsize = sizeof(Elf64_Shdr);
+	header->e_shnum = section_count;
+	header->e_shstrndx = OBJECT_SHSTRTAB;
+
+	ret = 0;
+	uint8_t* data = file.data;
+	uint64_t size = file.size;
+	while(size > 0) {
+		ssize_t written = write(fd, data, size);
+		if(written <= 0) {
+			printf("[ERROR] Could not write output file.\n");
+			ret = -1;
+			break;
+		}
+		data = data + written;
+		size = size - written;
+	}
+
+	CLEANUP:
+	free(names.names);
+	free(names.indices);
+	CodeBuffer__free(&symtab);
+	CodeBuffer__free(&strtab);
+	CodeBuffer__free(&shstrtab);
+	CodeBuffer__free(&file);
+	return ret;
+}
+
+typedef struct _OBJECT_FILE_ {
+	const uint8_t* data;
+	uint64_t size;
+	const Elf64_Shdr* sections;
+	int section_count;
+	const char* section_names;
+	const Elf64_Sym* symbols;
+	int symbol_count;
+	const char* symbol_names;
+	uint64_t symbol_names_size;
+} OBJECT_FILE;
+
+static int Object__parse(OBJECT_FILE* object, const uint8_t* data, uint64_t size, const char* name) {
+	memset(object, 0, sizeof(OBJECT_FILE));
+	object->data = data;
+	object->size = size;
+	const Elf64_Ehdr* header = (const Elf64_Ehdr*)data;
+	if(size < sizeof(Elf64_Ehdr) || memcmp(header->e_ident, ELFMAG, SELFMAG) != 0 || header->e_ident[EI_CLASS] != ELFCLASS64 ||
+		header->e_type != ET_REL || header->e_machine != EM_X86_64) {
+		printf("[ERROR] \"%s\" is not an x86_64 ELF object.\n", name);
+		return -1;
+	}
+	if(header->e_shoff > size || (uint64_t)header->e_shnum * sizeof(Elf64_Shdr) > size - header->e_shoff || header->e_shstrndx >= header->e_shnum) {
+		printf("[ERROR] \"%s\" has damaged section headers.\n", name);
+		return -1;
+	}
+	object->sections = (const Elf64_Shdr*)(data + header->e_shoff);
+	object->section_count = header->e_shnum;
+	for(int i = 0;i < object->section_count;i++) {
+		const Elf64_Shdr* section = &object->sections[i];
+		if(section->sh_type != SHT_NOBITS && (section->sh_offset > size || section->sh_size > size - section->sh_offset)) {
+			printf("[ERROR] \"%s\" has a damaged section.\n", name);
+			return -1;
+		}
+	}
+	object->section_names = (const char*)data + object->sections[header->e_shstrndx].sh_offset;
+	for(int i = 0;i < object->section_count;i++) {
+		const Elf64_Shdr* section = &object->sections[i];
+		if(section->sh_type == SHT_SYMTAB && section->sh_link < (uint32_t)object->section_count) {
+			object->symbols = (const Elf64_Sym*)(data + section->sh_offset);
+			object->symbol_count = section->sh_size / sizeof(Elf64_Sym);
+			object->symbol_names = (const char*)data + object->sections[section->sh_link].sh_offset;
+			object->symbol_names_size = object->sections[section->sh_link].sh_size;
+		}
+	}
+	return 0;
+}
+
+static const char* Object__symbol_name(OBJECT_FILE* object, const Elf64_Sym* symbol) {
+	if(symbol->st_name >= object->symbol_names_size) {
+		return "";
+	}
+	return object->symbol_names + symbol->st_name;
+}
+
+static int Object__output_section(OBJECT_FILE* object, int index) {
+	// Output section of an object section, -1 if it is not loaded
+	const Elf64_Shdr* section = &object->sections[index];
+	if(!(section->sh_flags & SHF_ALLOC) || (section->sh_type != SHT_PROGBITS && section->sh_type != SHT_NOBITS)) {
+		return -1;
+	}
+	const char* name = object->section_names + section->sh_name;
+	for(int i = 0;i < OUTPUT_SECTION_COUNT;i++) {
+		size_t length = strlen(object_section_names[i]);
+		if(strncmp(name, object_section_names[i], length) == 0 && (name[length] == '\0' || name[length] == '.')) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+static char* Object__local_name(OBJECT_FILE* object, int symbol_index, int unit) {
+	// Unique name of a symbol inside the image
+	const Elf64_Sym* symbol = &object->symbols[symbol_index];
+	char buffer[512];
+	if(ELF64_ST_TYPE(symbol->st_info) == STT_SECTION) {
+		snprintf(buffer, sizeof(buffer), ".section%d@%d", symbol->st_shndx, unit);
+	}
+	else if(ELF64_ST_BIND(symbol->st_info) == STB_LOCAL) {
+		snprintf(buffer, sizeof(buffer), "%s.%d@%d", Object__symbol_name(object, symbol), symbol_index, unit);
+	}
+	else {
+		snprintf(buffer, sizeof(buffer), "%s", Object__symbol_name(object, symbol));
+	}
+	return strdup(buffer);
+}
+
+size_t Linker__source_length(const char* name) {
+	// Length of a local name without the ".<index>@<unit>" of Object__local_name, 0 for sections
+	const char* unit = strrchr(name, '@');
+	if(unit == NULL) {
+		return strlen(name);
+	}
+	if(strncmp(name, ".section", 8) == 0) {
+		return 0;
+	}
+	const char* index = unit;
+	while(index > name && index[-1] >= '0' && index[-1] <= '9') {
+		index--;
+	}
+	if(index == unit || index == name || index[-1] != '.') {
+		return strlen(name);
+	}
+	return (size_t)(index - 1 - name);
+}
+
+int Linker__load_object(OUTPUT_IMAGE* image, const uint8_t* data, uint64_t size, const char* name, int unit) {
+	OBJECT_FILE object;
+	if(Object__parse(&object, data, size, name) != 0) {
+		return -1;
+	}
+	for(int i = 1;i < object.section_count;i++) {
+		int output = Object__output_section(&object, i);
+		if(output < 0) {
+			continue;
+		}
+		const Elf64_Shdr* section = &object.sections[i];
+		CODE_BUFFER buffer;
+		if(CodeBuffer__init(&buffer, section->sh_size + 16) != 0) {
+			return -1;
+		}
+		int ret = section->sh_type == SHT_NOBITS ? CodeBuffer__zero(&buffer, section->sh_size) : CodeBuffer__emit(&buffer, data + section->sh_offset, section->sh_size);
+
+		// Symbols defined in this section
+		for(int j = 1;j < object.symbol_count && ret == 0;j++) {
+			const Elf64_Sym* symbol = &object.symbols[j];
+			if(symbol->st_shndx != i || ELF64_ST_TYPE(symbol->st_info) == STT_FILE) {
+				continue;
+			}
+			char* label_name = Object__local_name(&object, j, unit);
+			int label = CodeBuffer__label_at(&buffer, symbol->st_value, label_name, ELF64_ST_BIND(symbol->st_info) != STB_LOCAL);
+			free(label_name);
+			if(label < 0) {
+				ret = -1;
+				break;
+			}
+			buffer.labels[label].size = symbol->st_size;
+			buffer.labels[label].exported = ELF64_ST_BIND(symbol->st_info) != STB_LOCAL && ELF64_ST_VISIBILITY(symbol->st_other) == STV_DEFAULT;
+		}
+
+		// Relocations of this section
+		for(int j = 1;j < object.section_count && ret == 0;j++) {
+			const Elf64_Shdr* rela = &object.sections[j];
+			if(rela->sh_type != SHT_RELA || rela->sh_info != (uint32_t)i) {
+				continue;
+			}
+			const Elf64_Rela* relocations = (const Elf64_Rela*)(data + rela->sh_offset);
+			for(uint64_t k = 0;k < rela->sh_size / sizeof(Elf64_Rela);k++) {
+				uint32_t symbol_index = ELF64_R_SYM(relocations[k].r_info);
+				uint32_t type = ELF64_R_TYPE(relocations[k].r_info);
+				int relocation_type;
+				if(type == R_X86_64_64) {
+					relocation_type = RELOCATION_ABS64;
+				}
+				else if(type == R_X86_64_32 || type == R_X86_64_32S) {
+					relocation_type = RELOCATION_ABS32;
+				}
+				else if(type == R_X86_64_PC32) {
+					relocation_type = RELOCATION_REL32;
+				}
+				else if(type == R_X86_64_PLT32) {
+					relocation_type = RELOCATION_PLT32;
+				}
+				else if(type == R_X86_64_GOTPCREL || type == R_X86_64_GOTPCRELX || type == R_X86_64_REX_GOTPCRELX) {
+					relocation_type = RELOCATION_GOTPCREL;
+				}
+				else {
+					printf("[ERROR] Relocation type %u in \"%s\" is not supported.\n", type, name);
+					ret = -1;
+					break;
+				}
+				if(symbol_index == 0 || symbol_index >= (uint32_t)object.symbol_count) {
+					printf("[ERROR] \"%s\" has a damaged relocation.\n", name);
+					ret = -1;
+					break;
+				}
+				char* symbol_name = Object__local_name(&object, symbol_index, unit);
+				ret = CodeBuffer__relocation_at(&buffer, relocations[k].r_offset, symbol_name, relocation_type, relocations[k].r_addend);
+				free(symbol_name);
+				if(ret != 0) {
+					break;
+				}
+			}
+		}
+
+		if(ret == 0) {
+			uint64_t alignment = section->sh_addralign > 1 ? section->sh_addralign : 1;
+			if(alignment > image->sections[output].alignment) {
+				image->sections[output].alignment = alignment;
+			}
+			ret = CodeBuffer__align(&image->sections[output].buffer, alignment, 0);
+		}
+		if(ret == 0) {
+			ret = Linker__splice(image, output, &buffer);
+		}
+		CodeBuffer__free(&buffer);
+		if(ret != 0) {
+			return -1;
+		}
+	}
+	for(int j = 1;j < object.symbol_count;j++) {
+		if(object.symbols[j].st_shndx == SHN_COMMON) {
+			printf("[ERROR] Common symbol \"%s\" in \"%s\" is not supported (compile with -fno-common).\n", Object__symbol_name(&object, &object.symbols[j]), name);
+			return -1;
+		}
+	}
+	return 0;
+}
+
+int Linker__object_globals(const uint8_t* data, uint64_t size, char*** names, int* count) {
+	// Names of all symbols an object defines for other objects
+	OBJECT_FILE object;
+	*names = NULL;
+	*count = 0;
+	if(Object__parse(&object, data, size, "archive member") != 0) {
+		return -1;
+	}
+	for(int i = 1;i < object.symbol_count;i++) {
+		const Elf64_Sym* symbol = &object.symbols[i];
+		if(ELF64_ST_BIND(symbol->st_info) == STB_LOCAL || symbol->st_shndx == SHN_UNDEF) {
+			continue;
+		}
+		char** grown = realloc(*names, (*count + 1) * sizeof(char*));
+		if(grown == NULL) {
+			return -1;
+		}
+		*names = grown;
+		(*names)[(*count)++] = strdup(Object__symbol_name(&object, symbol));
+	}
+	return 0;
+}
+
+int Linker__object_ir(const uint8_t* data, uint64_t size, const uint8_t** ir, uint64_t* ir_size) {
+	// Source carried by an object compiled with -flto, 1 if there is none
+	OBJECT_FILE object;
+	if(Object__parse(&object, data, size, "object") != 0) {
+		return -1;
+	}
+	for(int i = 1;i < object.section_count;i++) {
+		const Elf64_Shdr* section = &object.sections[i];
+		if(strcmp(object.section_names + section->sh_name, OBJECT_IR_NAME) != 0) {
+			continue;
+		}
+		if(section->sh_offset > size || section->sh_size > size - section->sh_offset) {
+			printf("[ERROR] Object has a damaged %s section.\n", OBJECT_IR_NAME);
+			return -1;
+		}
+		*ir = data + section->sh_offset;
+		*ir_size = section->sh_size;
+		return 0;
+	}
+	return 1;
+}
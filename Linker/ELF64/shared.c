@@ -0,0 +1,645 @@
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <elf.h>
+
+#include "linker.h"
+
+// Shared objects
+//   Symbols of the image are bound directly (RIP-relative, no interposition).
+//   Only symbols that stay undefined go through a GOT entry (data) or a PLT
+//   entry (calls). Global labels are hidden unless they are exported, so only
+//   exported labels end up in .dynsym and the GNU hash table. GOT entries are
+//   bound at load time (BIND_NOW): a PLT entry is a single indirect jump and
+//   there is no .got.plt or lazy binding.
+//   File: headers, .gnu.hash, .dynsym, .dynstr and .rela.dyn share the first
+//   read-only segment, followed by the usual section segments. .dynamic is
+//   appended to .data.
+
+typedef struct _SHARED_NAMES_ {
+	// Name -> value (open addressing, names are not owned)
+	const char** names;
+	int* values;
+	int count;
+	int capacity;
+} SHARED_NAMES;
+
+typedef struct _SHARED_SYMBOL_ {
+	const char* name;
+	OUTPUT_SYMBOL* symbol;             // NULL for undefined symbols, stale after Linker__resolve
+	uint64_t size;
+	uint32_t hash;                     // GNU hash of the name
+	uint32_t name_offset;              // Offset in .dynstr
+} SHARED_SYMBOL;
+
+static uint64_t Shared__align(uint64_t value, uint64_t alignment) {
+	return (value + alignment - 1) & ~(alignment - 1);
+}
+
+static uint64_t Shared__fnv(const char* name) {
+	// FNV-1a
+	uint64_t hash = 0xcbf29ce484222325ull;
+	while(*name) {
+		hash ^= (uint8_t)*name++;
+		hash *= 0x100000001b3ull;
+	}
+	return hash;
+}
+
+static uint32_t Shared__gnu_hash(const char* name) {
+	// Hash function of DT_GNU_HASH (djb2)
+	uint32_t hash = 5381;
+	while(*name) {
+		hash = hash * 33 + (uint8_t)*name++;
+	}
+	return hash;
+}
+
+static int* Shared__find(SHARED_NAMES* set, const char* name) {
+	if(set->capacity == 0) {
+		return NULL;
+	}
+	uint64_t mask = (uint64_t)set->capacity - 1;
+	uint64_t slot = Shared__fnv(name) & mask;
+	while(set->names[slot] != NULL) {
+		if(strcmp(set->names[slot], name) == 0) {
+			return &set->values[slot];
+		}
+		slot = (slot + 1) & mask;
+	}
+	return NULL;
+}
+
+static int Shared__add(SHARED_NAMES* set, const char* name, int value) {
+	if((set->count + 1) * 2 > set->capacity) {
+		int capacity = set->capacity ? set->capacity * 2 : 64;
+		const char** names = calloc(capacity, sizeof(char*));
+		int* values = calloc(capacity, sizeof(int));
+		if(names == NULL || values == NULL) {
+			free(names);
+			free(values);
+			return -1;
+		}
+		for(int i = 0;i < set->capacity;i++) {
+			if(set->names[i] != NULL) {
+				uint64_t slot = Shared__fnv(set->names[i]) & (uint64_t)(capacity - 1);
+				while(names[slot] != NULL) {
+					slot = (slot + 1) & (uint64_t)(capacity - 1);
+				}
+				names[slot] = set->names[i];
+				values[slot] = set->values[i];
+			}
+		}
+		free(set->names);
+		free(set->values);
+		set->names = names;
+		set->values = values;
+		set->capacity = capacity;
+	}
+	uint64_t mask = (uint64_t)set->capacity - 1;
+	uint64_t slot = Shared__fnv(name) & mask;
+	while(set->names[slot] != NULL) {
+		if(strcmp(set->names[slot], name) == 0) {
+			return 0;
+		}
+		slot = (slot + 1) & mask;
+	}
+	set->names[slot] = name;
+	set->values[slot] = value;
+	set->count++;
+	return 0;
+}
+
+static void Shared__free(SHARED_NAMES* set) {
+	free(set->names);
+	free(set->values);
+	memset(set, 0, sizeof(SHARED_NAMES));
+}
+
+static const char* Shared__got_entry(OUTPUT_IMAGE* image, SHARED_NAMES* entries, const char* symbol) {
+	// 8 byte slot in .data holding the address of symbol
+	char name[4200];
+	snprintf(name, sizeof(name), ".got.%s", symbol);
+	CODE_BUFFER* data = &image->sections[OUTPUT_SECTION_DATA].buffer;
+	int* index = Shared__find(entries, name);
+	if(index != NULL) {
+		return data->labels[*index].name;
+	}
+	if(CodeBuffer__align(data, 8, 0) != 0) {
+		return NULL;
+	}
+	int label = CodeBuffer__label(data, name, false);
+	if(label < 0 || CodeBuffer__relocation(data, symbol, RELOCATION_ABS64, 0) != 0 ||
+	   Shared__add(entries, data->labels[label].name, label) != 0) {
+		return NULL;
+	}
+	return data->labels[label].name;
+}
+
+static const char* Shared__plt_entry(OUTPUT_IMAGE* image, SHARED_NAMES* entries, const char* symbol, const char* got) {
+	// jmp [rip + GOT entry], padded to 8 bytes
+	char name[4200];
+	snprintf(name, sizeof(name), ".plt.%s", symbol);
+	CODE_BUFFER* text = &image->sections[OUTPUT_SECTION_TEXT].buffer;
+	int* index = Shared__find(entries, name);
+	if(index != NULL) {
+		return text->labels[*index].name;
+	}
+	uint8_t jump[2] = { 0xFF, 0x25 }, padding[2] = { 0xCC, 0xCC };
+	if(CodeBuffer__align(text, 8, 0xCC) != 0) {
+		return NULL;
+	}
+	int label = CodeBuffer__label(text, name, false);
+	if(label < 0 || CodeBuffer__emit(text, jump, 2) != 0 || CodeBuffer__relocation(text, got, RELOCATION_REL32, -4) != 0 ||
+	   CodeBuffer__emit(text, padding, 2) != 0 || Shared__add(entries, text->labels[label].name, label) != 0) {
+		return NULL;
+	}
+	text->labels[label].size = 8;
+	return text->labels[label].name;
+}
+
+int Linker__indirect(OUTPUT_IMAGE* image, bool shared) {
+	// Lower GOT and PLT relocations
+	//   PLT32 to a symbol of the image is a direct call. GOTPCREL to a symbol
+	//   of the image turns "mov reg, [rip + GOT]" into "lea reg, [rip + symbol]".
+	//   Everything else gets a GOT entry (and a PLT entry for calls in shared objects).
+	if(Linker__symbols(image) != 0) {
+		return -1;
+	}
+	SHARED_NAMES got = { 0 }, plt = { 0 };
+	int ret = -1;
+	for(int i = 0;i < OUTPUT_SECTION_BSS;i++) {
+		CODE_BUFFER* buffer = &image->sections[i].buffer;
+		// Entries appended below only use REL32/ABS64
+		int count = buffer->relocation_count;
+		for(int j = 0;j < count;j++) {
+			CODE_RELOCATION* relocation = &buffer->relocations[j];
+			if(relocation->type != RELOCATION_PLT32 && relocation->type != RELOCATION_GOTPCREL) {
+				continue;
+			}
+			const char* name = relocation->symbol;
+			bool defined = Linker__lookup(image, name) != NULL;
+			const char* target = NULL;
+			if(relocation->type == RELOCATION_PLT32) {
+				if(defined || !shared) {
+					// Undefined symbols of executables are reported by Linker__resolve
+					relocation->type = RELOCATION_REL32;
+					continue;
+				}
+				const char* entry = Shared__got_entry(image, &got, name);
+				target = entry != NULL ? Shared__plt_entry(image, &plt, name, entry) : NULL;
+			}
+			else {
+				uint8_t* field = buffer->data + relocation->offset;
+				if(defined && relocation->offset >= 2 && field[-2] == 0x8B && (field[-1] & 0xC7) == 0x05) {
+					field[-2] = 0x8D;
+					relocation->type = RELOCATION_REL32;
+					continue;
+				}
+				target = Shared__got_entry(image, &got, name);
+			}
+			if(target == NULL) {
+				printf("[ERROR] Could not create GOT/PLT entry for \"%s\".\n", name);
+				goto CLEANUP;
+			}
+			// The entries may have grown this buffer
+			relocation = &buffer->relocations[j];
+			char* symbol = strdup(target);
+			if(symbol == NULL) {
+				goto CLEANUP;
+			}
+			free(relocation->symbol);
+			relocation->symbol = symbol;
+			relocation->type = RELOCATION_REL32;
+		}
+	}
+	ret = 0;
+
+	CLEANUP:
+	Shared__free(&got);
+	Shared__free(&plt);
+	return ret;
+}
+
+static int Shared__compare(const void* a, const void* b) {
+	// Order of the GNU hash chains: bucket, then original order (stable output)
+	const uint32_t* x = a;
+	const uint32_t* y = b;
+	if(x[0] != y[0]) {
+		return x[0] < y[0] ? -1 : 1;
+	}
+	return x[1] < y[1] ? -1 : x[1] > y[1];
+}
+
+static Elf64_Shdr* Shared__section(Elf64_Shdr* headers, int* count, char* names, uint32_t* names_size, const char* name,
+	uint32_t type, uint64_t flags, uint64_t address, uint64_t size, uint64_t alignment) {
+	// The image is based at 0, so offsets equal addresses
+	Elf64_Shdr* header = &headers[(*count)++];
+	header->sh_name = *names_size;
+	strcpy(names + *names_size, name);
+	*names_size = *names_size + strlen(name) + 1;
+	header->sh_type = type;
+	header->sh_flags = flags;
+	header->sh_addr = flags & SHF_ALLOC ? address : 0;
+	header->sh_offset = address;
+	header->sh_size = size;
+	header->sh_addralign = alignment;
+	return header;
+}
+
+int Linker__write_shared(OUTPUT_IMAGE* image, int fd) {
+	static const char* section_names[OUTPUT_SECTION_COUNT] = { ".text", ".rodata", ".data", ".bss" };
+	image->base_address = 0;
+	image->shared = true;
+	if(Linker__indirect(image, true) != 0 || Linker__symbols(image) != 0) {
+		return -1;
+	}
+
+	SHARED_NAMES undefined_names = { 0 };
+	SHARED_SYMBOL* symbols = NULL;
+	uint32_t* order = NULL;
+	char* strings = NULL;
+	uint8_t* file = NULL;
+	int ret = -1;
+
+	// Undefined symbols (only reachable through absolute .data relocations now)
+	int symbol_count = 1, symbol_capacity = 64, relocation_count = 0;
+	symbols = calloc(symbol_capacity, sizeof(SHARED_SYMBOL));
+	if(symbols == NULL) {
+		goto CLEANUP;
+	}
+	for(int i = 0;i < OUTPUT_SECTION_BSS;i++) {
+		CODE_BUFFER* buffer = &image->sections[i].buffer;
+		for(int j = 0;j < buffer->relocation_count;j++) {
+			CODE_RELOCATION* relocation = &buffer->relocations[j];
+			bool defined = Linker__lookup(image, relocation->symbol) != NULL;
+			if(relocation->type == RELOCATION_ABS32) {
+				printf("[ERROR] 32 bit absolute address of \"%s\" in a shared object, compile with -fPIC.\n", relocation->symbol);
+				goto CLEANUP;
+			}
+			if(relocation->type == RELOCATION_ABS64 && i != OUTPUT_SECTION_DATA) {
+				printf("[ERROR] Absolute address of \"%s\" in %s of a shared object, compile with -fPIC.\n", relocation->symbol, section_names[i]);
+				goto CLEANUP;
+			}
+			if(relocation->type == RELOCATION_ABS64) {
+				relocation_count++;
+			}
+			if(defined) {
+				continue;
+			}
+			if(relocation->type != RELOCATION_ABS64) {
+				printf("[ERROR] Undefined symbol \"%s\" is not referenced through the GOT or PLT, compile with -fPIC.\n", relocation->symbol);
+				goto CLEANUP;
+			}
+			if(Shared__find(&undefined_names, relocation->symbol) != NULL) {
+				continue;
+			}
+			if(symbol_count >= symbol_capacity) {
+				symbol_capacity = symbol_capacity * 2;
+				SHARED_SYMBOL* grown = realloc(symbols, symbol_capacity * sizeof(SHARED_SYMBOL));
+				if(grown == NULL) {
+					goto CLEANUP;
+				}
+				symbols = grown;
+			}
+			if(Shared__add(&undefined_names, relocation->symbol, symbol_count) != 0) {
+				goto CLEANUP;
+			}
+			SHARED_SYMBOL symbol = { relocation->symbol, NULL, 0, 0, 0 };
+			symbols[symbol_count++] = symbol;
+		}
+	}
+
+	// Exported symbols (hashed, so they follow the undefined ones)
+	int first_hashed = symbol_count;
+	for(int i = 0;i < OUTPUT_SECTION_COUNT;i++) {
+		CODE_BUFFER* buffer = &image->sections[i].buffer;
+		for(int j = 0;j < buffer->label_count;j++) {
+			CODE_LABEL* label = &buffer->labels[j];
+			if(!label->global || !label->exported) {
+				continue;
+			}
+			if(symbol_count >= symbol_capacity) {
+				symbol_capacity = symbol_capacity * 2;
+				SHARED_SYMBOL* grown = realloc(symbols, symbol_capacity * sizeof(SHARED_SYMBOL));
+				if(grown == NULL) {
+					goto CLEANUP;
+				}
+				symbols = grown;
+			}
+			SHARED_SYMBOL symbol = { label->name, Linker__lookup(image, label->name), label->size, Shared__gnu_hash(label->name), 0 };
+			symbols[symbol_count++] = symbol;
+		}
+	}
+	int hashed_count = symbol_count - first_hashed;
+	uint32_t bucket_count = hashed_count / 4 + 1;
+	uint32_t bloom_count = 1;
+	while(bloom_count * 8 < (uint32_t)hashed_count) {
+		bloom_count = bloom_count * 2;
+	}
+	order = malloc((hashed_count + 1) * 2 * sizeof(uint32_t));
+	if(order == NULL) {
+		goto CLEANUP;
+	}
+	for(int i = 0;i < hashed_count;i++) {
+		order[i * 2] = symbols[first_hashed + i].hash % bucket_count;
+		order[i * 2 + 1] = first_hashed + i;
+	}
+	qsort(order, hashed_count, 2 * sizeof(uint32_t), Shared__compare);
+
+	// Dynamic string table
+	uint64_t strings_size = 1;
+	const char* soname = image->soname;
+	if(soname != NULL && strrchr(soname, '/') != NULL) {
+		soname = strrchr(soname, '/') + 1;
+	}
+	if(soname != NULL) {
+		strings_size = strings_size + strlen(soname) + 1;
+	}
+	for(int i = 1;i < symbol_count;i++) {
+		strings_size = strings_size + strlen(symbols[i].name) + 1;
+	}
+	strings = calloc(strings_size, 1);
+	if(strings == NULL) {
+		goto CLEANUP;
+	}
+	uint64_t string_offset = 1, soname_offset = 0;
+	if(soname != NULL) {
+		soname_offset = string_offset;
+		strcpy(strings + string_offset, soname);
+		string_offset = string_offset + strlen(soname) + 1;
+	}
+	for(int i = 1;i < symbol_count;i++) {
+		symbols[i].name_offset = string_offset;
+		strcpy(strings + string_offset, symbols[i].name);
+		string_offset = string_offset + strlen(symbols[i].name) + 1;
+	}
+
+	// .dynamic at the end of .data
+	int dynamic_count = (soname != NULL) + 5 + (relocation_count > 0 ? 4 : 0) + 3;
+	CODE_BUFFER* data = &image->sections[OUTPUT_SECTION_DATA].buffer;
+	if(CodeBuffer__align(data, 8, 0) != 0) {
+		goto CLEANUP;
+	}
+	uint64_t dynamic_offset = data->size;
+	if(CodeBuffer__label(data, "_DYNAMIC", false) < 0 || CodeBuffer__zero(data, dynamic_count * sizeof(Elf64_Dyn)) != 0) {
+		goto CLEANUP;
+	}
+
+	// Header segment
+	int segment_count = 1 + 2;
+	for(int i = 0;i < OUTPUT_SECTION_COUNT;i++) {
+		if(image->sections[i].buffer.size != 0) {
+			segment_count++;
+		}
+	}
+	uint64_t hash_offset = Shared__align(sizeof(Elf64_Ehdr) + segment_count * sizeof(Elf64_Phdr), 8);
+	uint64_t hash_size = (4 + bloom_count * 2 + bucket_count + hashed_count) * sizeof(uint32_t);
+	uint64_t dynsym_offset = Shared__align(hash_offset + hash_size, 8);
+	uint64_t dynstr_offset = dynsym_offset + symbol_count * sizeof(Elf64_Sym);
+	uint64_t rela_offset = Shared__align(dynstr_offset + strings_size, 8);
+	uint64_t rela_size = relocation_count * sizeof(Elf64_Rela);
+	image->header_size = rela_offset + rela_size;
+	if(Linker__layout(image, OUTPUT_FORMAT_ELF64_SHARED) != 0 || Linker__resolve(image) != 0) {
+		goto CLEANUP;
+	}
+
+	// Section headers (indices are needed by .dynsym)
+	Elf64_Shdr headers[16];
+	memset(headers, 0, sizeof(headers));
+	char names[256] = { 0 };
+	uint32_t names_size = 1;
+	int header_count = 1;
+	int section_index[OUTPUT_SECTION_COUNT] = { 0 };
+	OUTPUT_SECTION* sections = image->sections;
+	Elf64_Shdr* hash_header = Shared__section(headers, &header_count, names, &names_size, ".gnu.hash", SHT_GNU_HASH, SHF_ALLOC, hash_offset, hash_size, 8);
+	int dynsym_index = header_count;
+	Elf64_Shdr* dynsym_header = Shared__section(headers, &header_count, names, &names_size, ".dynsym", SHT_DYNSYM, SHF_ALLOC, dynsym_offset, symbol_count * sizeof(Elf64_Sym), 8);
+	int dynstr_index = header_count;
+	Shared__section(headers, &header_count, names, &names_size, ".dynstr", SHT_STRTAB, SHF_ALLOC, dynstr_offset, strings_size, 1);
+	hash_header->sh_link = dynsym_index;
+	dynsym_header->sh_link = dynstr_index;
+	dynsym_header->sh_info = 1;
+	dynsym_header->sh_entsize = sizeof(Elf64_Sym);
+	if(relocation_count > 0) {
+		Elf64_Shdr* rela_header = Shared__section(headers, &header_count, names, &names_size, ".rela.dyn", SHT_RELA, SHF_ALLOC, rela_offset, rela_size, 8);
+		rela_header->sh_link = dynsym_index;
+		rela_header->sh_entsize = sizeof(Elf64_Rela);
+	}
+	uint64_t section_flags[OUTPUT_SECTION_COUNT] = { SHF_ALLOC | SHF_EXECINSTR, SHF_ALLOC, SHF_ALLOC | SHF_WRITE, SHF_ALLOC | SHF_WRITE };
+	for(int i = 0;i < OUTPUT_SECTION_COUNT;i++) {
+		uint64_t size = i == OUTPUT_SECTION_DATA ? dynamic_offset : sections[i].buffer.size;
+		if(size != 0) {
+			section_index[i] = header_count;
+			Shared__section(headers, &header_count, names, &names_size, section_names[i], i == OUTPUT_SECTION_BSS ? SHT_NOBITS : SHT_PROGBITS,
+				section_flags[i], sections[i].address, size, sections[i].alignment);
+		}
+		if(i == OUTPUT_SECTION_DATA) {
+			Elf64_Shdr* dynamic_header = Shared__section(headers, &header_count, names, &names_size, ".dynamic", SHT_DYNAMIC, SHF_ALLOC | SHF_WRITE,
+				sections[i].address + dynamic_offset, dynamic_count * sizeof(Elf64_Dyn), 8);
+			dynamic_header->sh_link = dynstr_index;
+			dynamic_header->sh_entsize = sizeof(Elf64_Dyn);
+		}
+	}
+	OUTPUT_SECTION* last = &sections[OUTPUT_SECTION_DATA];
+	uint64_t shstrtab_offset = last->file_offset + last->buffer.size;
+	Shared__section(headers, &header_count, names, &names_size, ".shstrtab", SHT_STRTAB, 0, shstrtab_offset, 0, 1);
+	headers[header_count - 1].sh_size = names_size;
+	uint64_t section_header_offset = Shared__align(shstrtab_offset + names_size, 8);
+	uint64_t size = section_header_offset + header_count * sizeof(Elf64_Shdr);
+	file = calloc(size, 1);
+	if(file == NULL) {
+		printf("[ERROR] Could not allocate output buffer.\n");
+		goto CLEANUP;
+	}
+
+	// .dynamic
+	uint64_t dynamic_address = sections[OUTPUT_SECTION_DATA].address + dynamic_offset;
+	Elf64_Dyn* dynamic = (Elf64_Dyn*)(data->data + dynamic_offset);
+	int count = 0;
+	if(soname != NULL) {
+		dynamic[count].d_tag = DT_SONAME;
+		dynamic[count++].d_un.d_val = soname_offset;
+	}
+	Elf64_Sxword tags[5] = { DT_GNU_HASH, DT_SYMTAB, DT_STRTAB, DT_STRSZ, DT_SYMENT };
+	uint64_t values[5] = { hash_offset, dynsym_offset, dynstr_offset, strings_size, sizeof(Elf64_Sym) };
+	for(int i = 0;i < 5;i++) {
+		dynamic[count].d_tag = tags[i];
+		dynamic[count++].d_un.d_val = values[i];
+	}
+	int relative_count = 0;
+	for(int i = 0;i < data->relocation_count;i++) {
+		if(data->relocations[i].type == RELOCATION_ABS64 && Linker__lookup(image, data->relocations[i].symbol) != NULL) {
+			relative_count++;
+		}
+	}
+	if(relocation_count > 0) {
+		Elf64_Sxword rela_tags[4] = { DT_RELA, DT_RELASZ, DT_RELAENT, DT_RELACOUNT };
+		uint64_t rela_values[4] = { rela_offset, rela_size, sizeof(Elf64_Rela), relative_count };
+		for(int i = 0;i < 4;i++) {
+			dynamic[count].d_tag = rela_tags[i];
+			dynamic[count++].d_un.d_val = rela_values[i];
+		}
+	}
+	dynamic[count].d_tag = DT_FLAGS;
+	dynamic[count++].d_un.d_val = DF_BIND_NOW;
+	dynamic[count].d_tag = DT_FLAGS_1;
+	dynamic[count++].d_un.d_val = DF_1_NOW;
+	dynamic[count].d_tag = DT_NULL;
+
+	// ELF and program headers
+	Elf64_Ehdr* header = (Elf64_Ehdr*)file;
+	memcpy(header->e_ident, ELFMAG, SELFMAG);
+	header->e_ident[EI_CLASS] = ELFCLASS64;
+	header->e_ident[EI_DATA] = ELFDATA2LSB;
+	header->e_ident[EI_VERSION] = EV_CURRENT;
+	header->e_ident[EI_OSABI] = ELFOSABI_SYSV;
+	header->e_type = ET_DYN;
+	header->e_machine = EM_X86_64;
+	header->e_version = EV_CURRENT;
+	header->e_phoff = sizeof(Elf64_Ehdr);
+	header->e_shoff = section_header_offset;
+	header->e_ehsize = sizeof(Elf64_Ehdr);
+	header->e_phentsize = sizeof(Elf64_Phdr);
+	header->e_phnum = segment_count;
+	header->e_shentsize = sizeof(Elf64_Shdr);
+	header->e_shnum = header_count;
+	header->e_shstrndx = header_count - 1;
+	Elf64_Phdr* program_headers = (Elf64_Phdr*)(file + sizeof(Elf64_Ehdr));
+	program_headers[0].p_type = PT_LOAD;
+	program_headers[0].p_flags = PF_R;
+	program_headers[0].p_filesz = image->header_size;
+	program_headers[0].p_memsz = image->header_size;
+	program_headers[0].p_align = image->page_size;
+	uint32_t segment_flags[OUTPUT_SECTION_COUNT] = { PF_R | PF_X, PF_R, PF_R | PF_W, PF_R | PF_W };
+	int segment = 1;
+	for(int i = 0;i < OUTPUT_SECTION_COUNT;i++) {
+		OUTPUT_SECTION* section = &sections[i];
+		if(section->buffer.size == 0) {
+			continue;
+		}
+		bool bss = i == OUTPUT_SECTION_BSS;
+		if(!bss) {
+			memcpy(file + section->file_offset, section->buffer.data, section->buffer.size);
+		}
+		Elf64_Phdr* program_header = &program_headers[segment++];
+		program_header->p_type = PT_LOAD;
+		program_header->p_flags = segment_flags[i];
+		program_header->p_offset = section->file_offset;
+		program_header->p_vaddr = section->address;
+		program_header->p_paddr = section->address;
+		program_header->p_filesz = bss ? 0 : section->buffer.size;
+		program_header->p_memsz = section->buffer.size;
+		program_header->p_align = image->page_size;
+	}
+	Elf64_Phdr* dynamic_header = &program_headers[segment++];
+	dynamic_header->p_type = PT_DYNAMIC;
+	dynamic_header->p_flags = PF_R | PF_W;
+	dynamic_header->p_offset = dynamic_address;
+	dynamic_header->p_vaddr = dynamic_address;
+	dynamic_header->p_paddr = dynamic_address;
+	dynamic_header->p_filesz = dynamic_count * sizeof(Elf64_Dyn);
+	dynamic_header->p_memsz = dynamic_count * sizeof(Elf64_Dyn);
+	dynamic_header->p_align = 8;
+	program_headers[segment].p_type = PT_GNU_STACK;
+	program_headers[segment].p_flags = PF_R | PF_W;
+	program_headers[segment].p_align = 16;
+
+	// .gnu.hash: nbuckets, symoffset, bloom_size, bloom_shift, bloom, buckets, chains
+	uint32_t* hash_table = (uint32_t*)(file + hash_offset);
+	hash_table[0] = bucket_count;
+	hash_table[1] = first_hashed;
+	hash_table[2] = bloom_count;
+	hash_table[3] = 6;
+	uint64_t* bloom = (uint64_t*)(hash_table + 4);
+	uint32_t* buckets = (uint32_t*)(bloom + bloom_count);
+	uint32_t* chains = buckets + bucket_count;
+	SHARED_SYMBOL* sorted = malloc((symbol_count + 1) * sizeof(SHARED_SYMBOL));
+	if(sorted == NULL) {
+		goto CLEANUP;
+	}
+	memcpy(sorted, symbols, first_hashed * sizeof(SHARED_SYMBOL));
+	for(int i = 0;i < hashed_count;i++) {
+		SHARED_SYMBOL* symbol = &symbols[order[i * 2 + 1]];
+		sorted[first_hashed + i] = *symbol;
+		bloom[(symbol->hash / 64) % bloom_count] |= (1ull << (symbol->hash % 64)) | (1ull << ((symbol->hash >> 6) % 64));
+		uint32_t bucket = order[i * 2];
+		if(buckets[bucket] == 0) {
+			buckets[bucket] = first_hashed + i;
+		}
+		bool last = i + 1 == hashed_count || order[(i + 1) * 2] != bucket;
+		chains[i] = (symbol->hash & ~1u) | (last ? 1 : 0);
+	}
+
+	// .dynsym (undefined symbols keep their index, hashed ones are sorted by bucket), .dynstr
+	Elf64_Sym* dynsym = (Elf64_Sym*)(file + dynsym_offset);
+	for(int i = 1;i < symbol_count;i++) {
+		SHARED_SYMBOL* symbol = &sorted[i];
+		dynsym[i].st_name = symbol->name_offset;
+		if(symbol->symbol == NULL) {
+			dynsym[i].st_info = ELF64_ST_INFO(STB_GLOBAL, STT_NOTYPE);
+			dynsym[i].st_shndx = SHN_UNDEF;
+			continue;
+		}
+		// Linker__resolve built a new symbol table after the symbols were collected
+		OUTPUT_SYMBOL* defined = Linker__lookup(image, symbol->name);
+		int section = defined->section;
+		dynsym[i].st_info = ELF64_ST_INFO(STB_GLOBAL, section == OUTPUT_SECTION_TEXT ? STT_FUNC : STT_OBJECT);
+		dynsym[i].st_other = STV_DEFAULT;
+		dynsym[i].st_shndx = section_index[section];
+		dynsym[i].st_value = Linker__symbol_address(image, defined);
+		dynsym[i].st_size = symbol->size;
+	}
+	free(sorted);
+	memcpy(file + dynstr_offset, strings, strings_size);
+
+	// .rela.dyn: R_X86_64_RELATIVE first (DT_RELACOUNT), then symbol relocations
+	Elf64_Rela* rela = (Elf64_Rela*)(file + rela_offset);
+	int written = 0;
+	for(int pass = 0;pass < 2;pass++) {
+		for(int i = 0;i < data->relocation_count;i++) {
+			CODE_RELOCATION* relocation = &data->relocations[i];
+			if(relocation->type != RELOCATION_ABS64) {
+				continue;
+			}
+			OUTPUT_SYMBOL* symbol = Linker__lookup(image, relocation->symbol);
+			if((symbol != NULL) != (pass == 0)) {
+				continue;
+			}
+			rela[written].r_offset = sections[OUTPUT_SECTION_DATA].address + relocation->offset;
+			if(symbol != NULL) {
+				rela[written].r_info = ELF64_R_INFO(0, R_X86_64_RELATIVE);
+				rela[written].r_addend = Linker__symbol_address(image, symbol) + relocation->addend;
+			}
+			else {
+				rela[written].r_info = ELF64_R_INFO(*Shared__find(&undefined_names, relocation->symbol), R_X86_64_64);
+				rela[written].r_addend = relocation->addend;
+			}
+			written++;
+		}
+	}
+
+	memcpy(file + shstrtab_offset, names, names_size);
+	memcpy(file + section_header_offset, headers, header_count * sizeof(Elf64_Shdr));
+	ret = 0;
+	uint8_t* position = file;
+	uint64_t remaining = size;
+	while(remaining > 0) {
+		ssize_t result = write(fd, position, remaining);
+		if(result <= 0) {
+			printf("[ERROR] Could not write output file.\n");
+			ret = -1;
+			break;
+		}
+		position = position + result;
+		remaining = remaining - result;
+	}
+
+	CLEANUP:
+	Shared__free(&undefined_names);
+	free(symbols);
+	free(order);
+	free(strings);
+	free(file);
+	return ret;
+}
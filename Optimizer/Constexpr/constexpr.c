@@ -0,0 +1,307 @@
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "constexpr.h"
+#include "./../../Script/Bytecode/bytecode.h"
+#include "./../../Translator/x86_64/translator.h"
+
+#define C compiler
+
+static int Constexpr__call(COMPILER* compiler, const char* name, const int64_t* args, int count, int64_t* value);
+
+static bool Constexpr__name(const char* str) {
+	return isalpha((unsigned char)str[0]) || str[0] == '_';
+}
+
+static CONSTEXPR_FUNCTION* Constexpr__find(COMPILER* compiler, const char* name) {
+	for(int i = 0;i < C->evaluator.function_count;i++) {
+		if(strcmp(C->evaluator.functions[i].name, name) == 0) {
+			return &C->evaluator.functions[i];
+		}
+	}
+	return NULL;
+}
+
+int Constexpr__declare(COMPILER* compiler, int i) {
+	// "constexpr int name(int a, ...) { ... }", returns the index of the closing '}'
+	Token* tokens = C->tokens;
+	int count = C->current_token_index;
+	if(i + 3 >= count || strcmp(tokens[i + 1].str, "int") != 0 || !Constexpr__name(tokens[i + 2].str) || strcmp(tokens[i + 3].str, "(") != 0) {
+		printf("[ERROR] Expected \"constexpr int <name>(\", at %d:%d.\n", tokens[i].line, tokens[i].column);
+		return -1;
+	}
+	CONSTEXPR_FUNCTION function;
+	memset(&function, 0, sizeof(CONSTEXPR_FUNCTION));
+	function.name = tokens[i + 2].str;
+	if(Constexpr__find(C, function.name) != NULL) {
+		printf("[ERROR] Constexpr function \"%s\" is declared twice, at %d:%d.\n", function.name, tokens[i + 2].line, tokens[i + 2].column);
+		return -1;
+	}
+
+	// Arguments
+	i = i + 4;
+	while(i < count && strcmp(tokens[i].str, ")") != 0) {
+		if(function.arg_count > 0) {
+			if(strcmp(tokens[i].str, ",") != 0) {
+				break;
+			}
+			i++;
+		}
+		if(i + 1 >= count || strcmp(tokens[i].str, "int") != 0 || !Constexpr__name(tokens[i + 1].str)) {
+			break;
+		}
+		char** args = realloc(function.args, (function.arg_count + 1) * sizeof(char*));
+		if(args == NULL) {
+			free(function.args);
+			return -1;
+		}
+		function.args = args;
+		function.args[function.arg_count++] = tokens[i + 1].str;
+		i = i + 2;
+	}
+	if(i + 1 >= count || strcmp(tokens[i].str, ")") != 0 || strcmp(tokens[i + 1].str, "{") != 0) {
+		int at = i < count ? i : count - 1;
+		printf("[ERROR] Invalid argument list of constexpr function \"%s\", at %d:%d.\n", function.name, tokens[at].line, tokens[at].column);
+		free(function.args);
+		return -1;
+	}
+
+	// Body
+	function.token_start = i + 2;
+	int depth = 1;
+	for(i = i + 2;i < count;i++) {
+		if(strcmp(tokens[i].str, "{") == 0) {
+			depth++;
+		}
+		else if(strcmp(tokens[i].str, "}") == 0 && --depth == 0) {
+			break;
+		}
+	}
+	if(i >= count) {
+		printf("[ERROR] Constexpr function \"%s\" has no end.\n", function.name);
+		free(function.args);
+		return -1;
+	}
+	function.token_end = i;
+
+	CONSTEXPR_FUNCTION* functions = realloc(C->evaluator.functions, (C->evaluator.function_count + 1) * sizeof(CONSTEXPR_FUNCTION));
+	if(functions == NULL) {
+		free(function.args);
+		return -1;
+	}
+	C->evaluator.functions = functions;
+	C->evaluator.functions[C->evaluator.function_count++] = function;
+	return i;
+}
+
+static int Constexpr__global(COMPILER* compiler, const char* name, int64_t* value) {
+	// Globals evaluated before the current entry (nothing stores to globals)
+	for(int i = C->evaluator.current - 1;i >= 0;i--) {
+		CODE_OBJECT* object = &C->pre_compiled_code[i];
+		if(object->type == CODE_OBJECT_TYPE_INT && object->CODE_OBJECT_DATA._int->global && object->CODE_OBJECT_DATA._int->count_start == 0 &&
+		   object->CODE_OBJECT_DATA._int->identifier != NULL && strcmp(object->CODE_OBJECT_DATA._int->identifier, name) == 0) {
+			*value = object->CODE_OBJECT_DATA._int->value;
+			return 0;
+		}
+	}
+	return 1;
+}
+
+static int* Constexpr__tokens(int start, int end) {
+	int* tokens = malloc((end - start + 1) * sizeof(int));
+	for(int i = start;tokens != NULL && i < end;i++) {
+		tokens[i - start] = i;
+	}
+	return tokens;
+}
+
+static int Constexpr__compile(COMPILER* compiler, CONSTEXPR_FUNCTION* function) {
+	int* tokens = Constexpr__tokens(function->token_start, function->token_end);
+	if(tokens == NULL) {
+		return -1;
+	}
+	BYTECODE_SOURCE source = { function->name, tokens, function->token_end - function->token_start,
+		(const char**)function->args, function->arg_count, Constexpr__global, Constexpr__call };
+	uint8_t* bytecode;
+	uint64_t size;
+	int ret = Bytecode__build(C, &source, &bytecode, &size);
+	if(ret == 0) {
+		ret = Script__load(&function->vm, bytecode, size);
+	}
+	free(bytecode);
+	free(tokens);
+	return ret;
+}
+
+static int Constexpr__call(COMPILER* compiler, const char* name, const int64_t* args, int count, int64_t* value) {
+	CONSTEXPR_STATE* evaluator = &C->evaluator;
+	CONSTEXPR_FUNCTION* function = Constexpr__find(C, name);
+	if(function == NULL) {
+		return 1;
+	}
+	if(count != function->arg_count) {
+		printf("[ERROR] Constexpr function \"%s\" takes %d arguments, not %d.\n", name, function->arg_count, count);
+		return -1;
+	}
+	if(function->state == 1) {
+		printf("[ERROR] Constexpr function \"%s\" calls itself (calls are evaluated while compiling, their arguments must be constant).\n", name);
+		return -1;
+	}
+	if(function->state == 0) {
+		if(evaluator->depth >= evaluator->max_depth) {
+			printf("[ERROR] Constexpr calls are nested deeper than %d (-fconstexpr-depth).\n", evaluator->max_depth);
+			return -1;
+		}
+		function->state = 1;
+		evaluator->depth++;
+		int ret = Constexpr__compile(C, function);
+		evaluator->depth--;
+		function->state = ret == 0 ? 2 : -1;
+	}
+	if(function->state != 2) {
+		// Error printed when it was compiled
+		return -1;
+	}
+	function->vm.budget = evaluator->steps;
+	int ret = Script__run(&function->vm, args, value);
+	if(ret != SCRIPT_OK) {
+		printf("[ERROR] Constexpr call of \"%s\" stopped: %s.\n", name,
+			ret == SCRIPT_ERROR_DIVISION ? "division by zero" : "more loop iterations than -fconstexpr-steps");
+		return -1;
+	}
+	return 0;
+}
+
+static const char* Constexpr__unsigned(COMPILER* compiler, int start, int end) {
+	// Value of an expression with a division that long long can not hold:
+	// a global of type unsigned long (long) or a larger literal, NULL = none
+	bool division = false;
+	const char* operand = NULL;
+	for(int i = start;i < end;i++) {
+		const char* str = C->tokens[i].str;
+		division = division || strcmp(str, "/") == 0 || strcmp(str, "%") == 0;
+		if(isdigit((unsigned char)str[0]) && strtoull(str, NULL, 10) > INT64_MAX) {
+			operand = str;
+		}
+		for(int j = 0;j < C->evaluator.current && (isalpha((unsigned char)str[0]) || str[0] == '_');j++) {
+			CODE_OBJECT* object = &C->pre_compiled_code[j];
+			if(object->type == CODE_OBJECT_TYPE_INT && object->CODE_OBJECT_DATA._int->global && strcmp(object->CODE_OBJECT_DATA._int->identifier, str) == 0 &&
+			   (object->CODE_OBJECT_DATA._int->type == CODE_OBJECT_TYPE_ULONG || object->CODE_OBJECT_DATA._int->type == CODE_OBJECT_TYPE_ULONGLONG)) {
+				operand = str;
+			}
+		}
+	}
+	return division ? operand : NULL;
+}
+
+static int Constexpr__expression(COMPILER* compiler, const char* name, int start, int end, int64_t* value) {
+	int* tokens = Constexpr__tokens(start, end);
+	if(tokens == NULL) {
+		return -1;
+	}
+	BYTECODE_SOURCE source = { name, tokens, end - start, NULL, 0, Constexpr__global, Constexpr__call };
+	int ret = Bytecode__constant(C, &source, value);
+	free(tokens);
+	return ret;
+}
+
+int Constexpr__evaluate(COMPILER* compiler) {
+	CONSTEXPR_STATE* evaluator = &C->evaluator;
+	int initializers = 0, tables = 0;
+	uint64_t bytes = 0;
+	for(int i = 0;i < C->pcc_entries;i++) {
+		if(C->pre_compiled_code[i].type != CODE_OBJECT_TYPE_INT && C->pre_compiled_code[i].type != CODE_OBJECT_TYPE_RETURN) {
+			continue;
+		}
+		PCC__INT* integer = C->pre_compiled_code[i].CODE_OBJECT_DATA._int;
+		if(integer->init_start == 0 && integer->count_start == 0) {
+			continue;
+		}
+		if(integer->call != NULL) {
+			if(Constexpr__find(C, integer->call) == NULL) {
+				// Call at run time (see Translator/x86_64/translator.c)
+				continue;
+			}
+			integer->call = NULL;
+		}
+		evaluator->current = i;
+		int64_t value = integer->value;
+		if(integer->count_start == 0) {
+			const char* operand = Constexpr__unsigned(C, integer->init_start, integer->init_end);
+			if(operand != NULL) {
+				printf("[ERROR] Initializer of \"%s\" divides \"%s\", constant expressions are calculated in long long.\n",
+					integer->identifier != NULL ? integer->identifier : "return", operand);
+				return -1;
+			}
+			if(Constexpr__expression(C, integer->identifier != NULL ? integer->identifier : "return", integer->init_start, integer->init_end, &value) != 0) {
+				return -1;
+			}
+			// Converted to the type of the variable, like a literal
+			integer->value = Translator__value(integer->type, value);
+			initializers++;
+			continue;
+		}
+
+		// Table
+		int64_t count;
+		if(Constexpr__expression(C, integer->identifier, integer->count_start, integer->count_end, &count) != 0) {
+			return -1;
+		}
+		if(count <= 0 || count > INT32_MAX) {
+			printf("[ERROR] Table \"%s\" needs a positive number of elements, not %lld.\n", integer->identifier, (long long)count);
+			return -1;
+		}
+		if(bytes + (uint64_t)count * sizeof(int32_t) > evaluator->memory) {
+			printf("[ERROR] Tables need more than %llu bytes (-fconstexpr-memory).\n", (unsigned long long)evaluator->memory);
+			return -1;
+		}
+		free(integer->table);
+		integer->table = malloc(count * sizeof(int32_t));
+		if(integer->table == NULL) {
+			printf("[ERROR] Could not allocate table \"%s\".\n", integer->identifier);
+			return -1;
+		}
+		integer->count = count;
+		bytes = bytes + (uint64_t)count * sizeof(int32_t);
+		tables++;
+
+		// Element k is f(k) for a constexpr function f, otherwise every element is the initializer
+		const char* generator = integer->init_end == integer->init_start + 1 ? C->tokens[integer->init_start].str : NULL;
+		if(generator != NULL && Constexpr__find(C, generator) != NULL) {
+			for(int64_t k = 0;k < count;k++) {
+				if(Constexpr__call(C, generator, &k, 1, &value) != 0) {
+					return -1;
+				}
+				integer->table[k] = (int32_t)value;
+			}
+			continue;
+		}
+		if(integer->init_start != 0 && Constexpr__expression(C, integer->identifier, integer->init_start, integer->init_end, &value) != 0) {
+			return -1;
+		}
+		for(int64_t k = 0;k < count;k++) {
+			integer->table[k] = (int32_t)value;
+		}
+	}
+	if(initializers + tables > 0 && C->verbose) {
+		printf("[INFO] Compile-time evaluation: %d initializers, %d tables (%llu bytes).\n", initializers, tables, (unsigned long long)bytes);
+	}
+	return 0;
+}
+
+void Constexpr__free(COMPILER* compiler) {
+	for(int i = 0;i < C->evaluator.function_count;i++) {
+		free(C->evaluator.functions[i].args);
+		Script__free(&C->evaluator.functions[i].vm);
+	}
+	free(C->evaluator.functions);
+	C->evaluator.functions = NULL;
+	C->evaluator.function_count = 0;
+	for(int i = 0;i < C->pcc_entries;i++) {
+		if(C->pre_compiled_code[i].type == CODE_OBJECT_TYPE_INT) {
+			free(C->pre_compiled_code[i].CODE_OBJECT_DATA._int->table);
+			C->pre_compiled_code[i].CODE_OBJECT_DATA._int->table = NULL;
+		}
+	}
+}
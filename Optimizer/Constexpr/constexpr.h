@@ -0,0 +1,33 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "./../../structures.h"
+
+// Compile-time evaluation
+//   "constexpr int f(int a, int b) { ... }" declares a function that only
+//   exists while compiling. Its body has the statements of script sections
+//   (see Script/Bytecode/bytecode.h) and runs in the script VM, compiled
+//   once on its first call.
+//   Initializers of globals and locals are constant expressions of
+//   literals, earlier globals and calls of constexpr functions with
+//   constant arguments. They are evaluated before translation, so _start
+//   and the translated code only see the results. They are calculated in
+//   long long and converted to the type of the variable, divisions of
+//   unsigned long (long) values fail.
+//   "int name[count] = f;" is a table with the elements f(0) .. f(count - 1)
+//   ("= expression;" repeats one value). Tables are written into .rodata
+//   as __GLOBALVAR_<name> instead of being built at run time.
+//   Limits: loop iterations per call (-fconstexpr-steps), nested compiles
+//   of constexpr functions (-fconstexpr-depth) and bytes of all tables
+//   (-fconstexpr-memory). Registers are limited by the VM.
+
+#define CONSTEXPR_DEFAULT_STEPS 10000000
+#define CONSTEXPR_DEFAULT_DEPTH 64
+#define CONSTEXPR_DEFAULT_MEMORY (16 * 1024 * 1024)
+
+int Constexpr__declare(COMPILER* compiler, int i);
+int Constexpr__evaluate(COMPILER* compiler);
+void Constexpr__free(COMPILER* compiler);
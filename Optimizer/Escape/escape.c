@@ -0,0 +1,193 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "escape.h"
+#include "./../LTO/lto.h"
+
+#define C compiler
+
+typedef struct _ESCAPE_USES_ {
+	bool escapes;                      // Passed to a C function or to an argument that escapes
+	bool passed;                       // Passed to a call
+	bool dynamic;                      // Read with an index that is not a number
+	bool changed;                      // A variable of an initializer is declared again
+} ESCAPE_USES;
+
+static FUNCTION* Escape__function(COMPILER* compiler, const char* name) {
+	for(int i = 0;i < C->current_function;i++) {
+		if(strcmp(C->functions[i].name, name) == 0) {
+			return &C->functions[i];
+		}
+	}
+	return NULL;
+}
+
+static int Escape__join(COMPILER* compiler, PCC_CODE_BLOCK* block, int spawn) {
+	// The join of the handle if it is its only use before the next return, else -1
+	const char* handle = C->pre_compiled_code[spawn].CODE_OBJECT_DATA._int->identifier;
+	int join = -1, uses = 0;
+	for(int i = spawn + 1;i < block->end_index;i++) {
+		CODE_OBJECT* object = &C->pre_compiled_code[i];
+		const char* identifier;
+		for(int k = 0;(identifier = Lto__reference(object, k)) != NULL;k++) {
+			uses = uses + (strcmp(identifier, handle) == 0);
+		}
+		if(object->type == CODE_OBJECT_TYPE_RETURN) {
+			break;
+		}
+		if(object->type != CODE_OBJECT_TYPE_INT) {
+			continue;
+		}
+		PCC__INT* integer = object->CODE_OBJECT_DATA._int;
+		if(join < 0 && integer->task == PCC_TASK_JOIN && strcmp(integer->task_operand, handle) == 0) {
+			join = i;
+		}
+		if(integer->identifier != NULL && strcmp(integer->identifier, handle) == 0) {
+			// Declared after its initializer ("int h = join h;"), later uses are the new variable
+			break;
+		}
+	}
+	return uses == 1 ? join : -1;
+}
+
+static bool Escape__declares(CODE_OBJECT* object, const char* name) {
+	if(object->type == CODE_OBJECT_TYPE_ARRAY) {
+		return strcmp(object->CODE_OBJECT_DATA._pointer->identifier, name) == 0;
+	}
+	return object->type == CODE_OBJECT_TYPE_INT && object->CODE_OBJECT_DATA._int->identifier != NULL && strcmp(object->CODE_OBJECT_DATA._int->identifier, name) == 0;
+}
+
+static void Escape__uses(COMPILER* compiler, PCC_CODE_BLOCK* block, int start, const char* name, PCC__POINTER* array, ESCAPE_USES* uses) {
+	// Uses of an array from start until it is declared again, array = its initializers (NULL for arguments)
+	memset(uses, 0, sizeof(*uses));
+	for(int j = 0;array != NULL && j < array->element_count;j++) {
+		uses->changed = uses->changed || (array->elements[j] != NULL && strcmp(array->elements[j], name) == 0);
+	}
+	for(int i = start;i < block->end_index;i++) {
+		CODE_OBJECT* object = &C->pre_compiled_code[i];
+		PCC__INT* integer = object->type == CODE_OBJECT_TYPE_INT || object->type == CODE_OBJECT_TYPE_RETURN ? object->CODE_OBJECT_DATA._int : NULL;
+		if(integer != NULL && integer->element != NULL && strcmp(integer->element, name) == 0) {
+			uses->dynamic = uses->dynamic || integer->index != NULL;
+		}
+		for(int j = 0;integer != NULL && integer->call != NULL && j < integer->call_arg_count;j++) {
+			if(strcmp(integer->call_args[j], name) != 0) {
+				continue;
+			}
+			// Functions the translator rejects (C functions, argument count or type) keep the array on the heap
+			FUNCTION* function = Escape__function(C, integer->call);
+			uses->passed = true;
+			uses->escapes = uses->escapes || function == NULL || function->arg_count != integer->call_arg_count ||
+				function->args[j].type != CODE_OBJECT_TYPE_ARRAY || function->args[j].escapes;
+		}
+		for(int j = 0;array != NULL && j < array->element_count;j++) {
+			uses->changed = uses->changed || (array->elements[j] != NULL && Escape__declares(object, array->elements[j]));
+		}
+		if(Escape__declares(object, name)) {
+			// Later uses are the new variable
+			break;
+		}
+	}
+}
+
+static void Escape__arrays(COMPILER* compiler) {
+	// Arguments first: one that is passed on to a C function or to an
+	// argument that escapes escapes too, until nothing changes
+	bool changed = true;
+	while(changed) {
+		changed = false;
+		for(int i = 0;i < C->current_function;i++) {
+			FUNCTION* function = &C->functions[i];
+			PCC_CODE_BLOCK* block = C->pre_compiled_code[function->id].CODE_OBJECT_DATA._code_block;
+			for(int j = 0;j < function->arg_count;j++) {
+				ESCAPE_USES uses;
+				if(function->args[j].type != CODE_OBJECT_TYPE_ARRAY || function->args[j].escapes) {
+					continue;
+				}
+				Escape__uses(C, block, block->start_index, function->args[j].name, NULL, &uses);
+				function->args[j].escapes = uses.escapes;
+				changed = changed || uses.escapes;
+			}
+		}
+	}
+
+	int arrays = 0, replaced = 0, frames = 0;
+	for(int entry = 0;entry < C->pcc_entries;entry++) {
+		if(C->pre_compiled_code[entry].type != CODE_OBJECT_TYPE_FUNCTION) {
+			continue;
+		}
+		PCC_CODE_BLOCK* block = C->pre_compiled_code[entry].CODE_OBJECT_DATA._code_block;
+		for(int i = block->start_index;i < block->end_index;i++) {
+			if(C->pre_compiled_code[i].type != CODE_OBJECT_TYPE_ARRAY) {
+				continue;
+			}
+			PCC__POINTER* array = C->pre_compiled_code[i].CODE_OBJECT_DATA._pointer;
+			ESCAPE_USES uses;
+			Escape__uses(C, block, i + 1, array->identifier, array, &uses);
+			arrays++;
+			if(uses.escapes) {
+				// The heap comes with the runtime
+				array->storage = PCC_STORAGE_HEAP;
+				C->tasks = true;
+			}
+			else if(uses.passed || uses.dynamic || uses.changed) {
+				array->storage = PCC_STORAGE_FRAME;
+				frames++;
+			}
+			else {
+				array->storage = PCC_STORAGE_NONE;
+				replaced++;
+			}
+		}
+	}
+	if(arrays > 0 && C->verbose) {
+		printf("[INFO] Escape analysis: %d of %d arrays replaced by their elements, %d in frames, %d on the heap.\n", replaced, arrays, frames, arrays - replaced - frames);
+	}
+}
+
+int Escape__analyze(COMPILER* compiler) {
+	Escape__arrays(C);
+	int spawns = 0, frames = 0, calls = 0;
+	for(int entry = 0;entry < C->pcc_entries;entry++) {
+		if(C->pre_compiled_code[entry].type != CODE_OBJECT_TYPE_FUNCTION) {
+			continue;
+		}
+		PCC_CODE_BLOCK* block = C->pre_compiled_code[entry].CODE_OBJECT_DATA._code_block;
+		for(int i = block->start_index;i < block->end_index;i++) {
+			CODE_OBJECT* object = &C->pre_compiled_code[i];
+			if(object->type != CODE_OBJECT_TYPE_INT || object->CODE_OBJECT_DATA._int->task != PCC_TASK_SPAWN) {
+				continue;
+			}
+			PCC__INT* spawn = object->CODE_OBJECT_DATA._int;
+			spawns++;
+			// Functions the translator rejects keep their errors
+			FUNCTION* function = Escape__function(C, spawn->task_operand);
+			int join = function != NULL && function->arg_count == 0 ? Escape__join(C, block, i) : -1;
+			if(join < 0) {
+				continue;
+			}
+			PCC__INT* result = C->pre_compiled_code[join].CODE_OBJECT_DATA._int;
+			if(join > i + 1) {
+				spawn->storage = PCC_STORAGE_FRAME;
+				result->storage = PCC_STORAGE_FRAME;
+				frames++;
+				continue;
+			}
+			// "int r = f();"
+			result->call_args = malloc(sizeof(char*));
+			if(result->call_args == NULL) {
+				printf("[ERROR] Could not allocate escape analysis.\n");
+				return -1;
+			}
+			result->call = spawn->task_operand;
+			result->call_arg_count = 0;
+			result->task = PCC_TASK_NONE;
+			result->task_operand = NULL;
+			spawn->storage = PCC_STORAGE_NONE;
+			calls++;
+		}
+	}
+	if(spawns > 0 && C->verbose) {
+		printf("[INFO] Escape analysis: %d of %d task records in frames, %d joined right away.\n", frames, spawns, calls);
+	}
+	return 0;
+}
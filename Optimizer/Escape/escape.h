@@ -0,0 +1,42 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "./../../structures.h"
+
+// Escape analysis of spawned tasks
+//   "int h = spawn f;" takes a TASK record (see Runtime/Tasks/tasks.h)
+//   from the free list of the worker, which grows by mapped slabs. The
+//   record only has to outlive the function if the handle does. Function
+//   bodies are straight-line code, so a handle whose only use is one
+//   "join h" before the next return can not escape:
+//   - a join right after the spawn leaves nothing to run in parallel, the
+//     pair becomes a call of f and the result stays in a register
+//     (PCC_STORAGE_NONE),
+//   - any other join keeps the record in a frame slot of the spawning
+//     function (PCC_STORAGE_FRAME, __chaos_spawn_at/__chaos_join_at).
+//   Handles that are returned, printed, passed on, used in a calculation,
+//   joined twice or not joined before a return stay with the runtime
+//   (PCC_STORAGE_HEAP). Coroutines (go/await) own their stack, so they
+//   always come from the runtime.
+// Escape analysis of arrays
+//   "int a[N] = { x, 2 };" is a local array of int, "int f(int a[])" takes
+//   one as a pointer. An array escapes if it can outlive the function:
+//   passed to a C function (anything not defined in the file), to an
+//   argument of the wrong type or count, or to an array argument that
+//   escapes. Arguments are solved first, an argument escapes if its
+//   function passes it on to one of these, repeated until nothing changes.
+//   - Escaping arrays come from the heap of the runtime (__chaos_new, see
+//     Runtime/Memory/memory.h) and belong to the function they escaped to,
+//     the compiler never frees them (PCC_STORAGE_HEAP).
+//   - Arrays passed to functions that keep them to themselves, or read
+//     with an index that is a variable, live in the frame (PCC_STORAGE_FRAME),
+//     like C arrays. A call that passes one is never a tail call.
+//   - Everything else is only read with numbers as indices, "a[2]" is the
+//     initializer of element 2: the array is replaced by its elements and
+//     takes no memory (PCC_STORAGE_NONE). Elements whose variable is
+//     declared again before a read keep the array in the frame.
+
+int Escape__analyze(COMPILER* compiler);
@@ -0,0 +1,254 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "lto.h"
+#include "./../../Linker/ELF64/linker.h"
+#include "./../../Linker/Archive/archive.h"
+
+#define C compiler
+
+static int Lto__find(COMPILER* compiler, const char* identifier) {
+	// Pre-compiled code entry of a global or function, -1 if there is none
+	for(int i = 0;i < C->pcc_entries;i++) {
+		CODE_OBJECT* object = &C->pre_compiled_code[i];
+		if(object->type == CODE_OBJECT_TYPE_INT && object->CODE_OBJECT_DATA._int->global &&
+		   strcmp(object->CODE_OBJECT_DATA._int->identifier, identifier) == 0) {
+			return i;
+		}
+		if(object->type == CODE_OBJECT_TYPE_FUNCTION && strcmp(object->CODE_OBJECT_DATA._code_block->identifier, identifier) == 0) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+const char* Lto__reference(CODE_OBJECT* object, int k) {
+	// k-th identifier a statement refers to, NULL after the last one
+	if(object->type == CODE_OBJECT_TYPE_ARRAY) {
+		// Variables of the initializers (numbers are not found)
+		PCC__POINTER* array = object->CODE_OBJECT_DATA._pointer;
+		for(int j = 0;j < array->element_count;j++) {
+			if(array->elements[j] != NULL && k-- == 0) {
+				return array->elements[j];
+			}
+		}
+		return NULL;
+	}
+	if(object->type != CODE_OBJECT_TYPE_INT && object->type != CODE_OBJECT_TYPE_RETURN && object->type != CODE_OBJECT_TYPE_PRINT) {
+		return NULL;
+	}
+	PCC__INT* integer = object->CODE_OBJECT_DATA._int;
+	if(integer->call != NULL) {
+		// Called function, then its arguments (numbers are not found)
+		return k == 0 ? integer->call : k <= integer->call_arg_count ? integer->call_args[k - 1] : NULL;
+	}
+	if(integer->operation != 0) {
+		// Variables of a calculation (numbers are NULL)
+		const char* first = integer->operands[0] != NULL ? integer->operands[0] : integer->operands[1];
+		return k == 0 ? first : k == 1 && integer->operands[0] != NULL ? integer->operands[1] : NULL;
+	}
+	if(integer->element != NULL) {
+		// Array, then the index (a number is NULL)
+		return k == 0 ? integer->element : k == 1 ? integer->index : NULL;
+	}
+	if(object->type != CODE_OBJECT_TYPE_INT) {
+		return k == 0 ? integer->identifier : NULL;
+	}
+	if(integer->task != PCC_TASK_NONE) {
+		// Spawned function or coroutine, joined or awaited handle
+		return k == 0 ? integer->task_operand : NULL;
+	}
+	return NULL;
+}
+
+bool Lto__constant(COMPILER* compiler, PCC__INT* global) {
+	// The IR has no stores to globals, so a global keeps its initial value
+	// unless code outside of the program writes it (only possible if exported)
+	return C->whole_program && global->global && !global->exported && global->count_start == 0;
+}
+
+int Lto__analyze(COMPILER* compiler) {
+	free(C->live);
+	C->live = calloc(C->pcc_entries + 1, sizeof(bool));
+	int* work = malloc((C->pcc_entries + 1) * sizeof(int));
+	if(C->live == NULL || work == NULL) {
+		printf("[ERROR] Could not allocate whole program analysis.\n");
+		free(work);
+		return -1;
+	}
+
+	// Roots: main and everything exported
+	int count = 0, folded = 0;
+	for(int i = 0;i < C->pcc_entries;i++) {
+		CODE_OBJECT* object = &C->pre_compiled_code[i];
+		bool root = false;
+		if(object->type == CODE_OBJECT_TYPE_FUNCTION) {
+			root = object->CODE_OBJECT_DATA._code_block->exported || strcmp(object->CODE_OBJECT_DATA._code_block->identifier, "main") == 0;
+		}
+		else if(object->type == CODE_OBJECT_TYPE_INT && object->CODE_OBJECT_DATA._int->global) {
+			root = object->CODE_OBJECT_DATA._int->exported;
+		}
+		if(root) {
+			C->live[i] = true;
+			work[count++] = i;
+		}
+	}
+
+	// Everything the reachable functions reference
+	while(count > 0) {
+		int entry = work[--count];
+		if(C->pre_compiled_code[entry].type != CODE_OBJECT_TYPE_FUNCTION) {
+			continue;
+		}
+		PCC_CODE_BLOCK* block = C->pre_compiled_code[entry].CODE_OBJECT_DATA._code_block;
+		FUNCTION* function = &C->functions[block->function_index];
+		for(int i = block->start_index;i < block->end_index;i++) {
+			const char* identifier;
+			for(int k = 0;(identifier = Lto__reference(&C->pre_compiled_code[i], k)) != NULL;k++) {
+				// Arguments and locals declared before shadow globals
+				bool local = false;
+				for(int j = 0;j < function->arg_count && !local;j++) {
+					local = strcmp(function->args[j].name, identifier) == 0;
+				}
+				for(int j = block->start_index;j < i && !local;j++) {
+					local = (C->pre_compiled_code[j].type == CODE_OBJECT_TYPE_INT && strcmp(C->pre_compiled_code[j].CODE_OBJECT_DATA._int->identifier, identifier) == 0) ||
+					        (C->pre_compiled_code[j].type == CODE_OBJECT_TYPE_ARRAY && strcmp(C->pre_compiled_code[j].CODE_OBJECT_DATA._pointer->identifier, identifier) == 0);
+				}
+				int target = local ? -1 : Lto__find(C, identifier);
+				if(target < 0) {
+					// Unknown identifiers are reported by the translator
+					continue;
+				}
+				if(C->pre_compiled_code[target].type == CODE_OBJECT_TYPE_INT && Lto__constant(C, C->pre_compiled_code[target].CODE_OBJECT_DATA._int)) {
+					// Load becomes an immediate, the global is not needed for it
+					folded++;
+					continue;
+				}
+				if(!C->live[target]) {
+					C->live[target] = true;
+					work[count++] = target;
+				}
+			}
+		}
+	}
+	free(work);
+
+	int functions = 0, globals = 0, dead_functions = 0, dead_globals = 0;
+	for(int i = 0;i < C->pcc_entries;i++) {
+		if(C->pre_compiled_code[i].type == CODE_OBJECT_TYPE_FUNCTION) {
+			functions++;
+			dead_functions = dead_functions + !C->live[i];
+		}
+		else if(C->pre_compiled_code[i].type == CODE_OBJECT_TYPE_INT && C->pre_compiled_code[i].CODE_OBJECT_DATA._int->global) {
+			globals++;
+			dead_globals = dead_globals + !C->live[i];
+		}
+	}
+	if(C->verbose) {
+		printf("[INFO] Whole program: %d of %d functions and %d of %d globals removed, %d loads folded.\n",
+		dead_functions, functions, dead_globals, globals, folded);
+	}
+	return 0;
+}
+
+static uint8_t* Lto__read(const char* path, uint64_t* size) {
+	FILE* file = fopen(path, "rb");
+	if(file == NULL) {
+		printf("[ERROR] Could not open \"%s\".\n", path);
+		return NULL;
+	}
+	fseek(file, 0, SEEK_END);
+	long length = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	uint8_t* data = malloc(length > 0 ? length : 1);
+	if(data == NULL || fread(data, 1, length, file) != (size_t)length) {
+		printf("[ERROR] Could not read \"%s\".\n", path);
+		free(data);
+		fclose(file);
+		return NULL;
+	}
+	fclose(file);
+	*size = length;
+	return data;
+}
+
+int Lto__link(const char* output, char** inputs, int input_count, uint8_t format, bool verbose, LTO_COMPILER compile) {
+	// Merge the sources of all -flto objects (archives are linked as usual)
+	char source[4200], object[4200];
+	snprintf(source, sizeof(source), "%s.lto.chaos", output);
+	snprintf(object, sizeof(object), "%s.lto.o", output);
+	char** rest = malloc((input_count + 2) * sizeof(char*));
+	if(rest == NULL) {
+		return -1;
+	}
+	int rest_count = 1, units = 0, ret = -1;
+	FILE* merged = fopen(source, "wb");
+	if(merged == NULL) {
+		printf("[ERROR] Could not create \"%s\".\n", source);
+		free(rest);
+		return -1;
+	}
+	for(int i = 0;i < input_count;i++) {
+		uint64_t size;
+		uint8_t* data = Lto__read(inputs[i], &size);
+		if(data == NULL) {
+			fclose(merged);
+			goto CLEANUP;
+		}
+		const uint8_t* ir;
+		uint64_t ir_size;
+		int found = 1;
+		if(size < ARCHIVE_MAGIC_SIZE || memcmp(data, ARCHIVE_MAGIC, ARCHIVE_MAGIC_SIZE) != 0) {
+			found = Linker__object_ir(data, size, &ir, &ir_size);
+		}
+		if(found == 0) {
+			fwrite(ir, 1, ir_size, merged);
+			fputc('\n', merged);
+			units++;
+		}
+		else if(found == 1) {
+			rest[rest_count++] = inputs[i];
+		}
+		free(data);
+		if(found < 0) {
+			printf("[ERROR] \"%s\" is not an object or archive.\n", inputs[i]);
+			fclose(merged);
+			goto CLEANUP;
+		}
+	}
+	if(fclose(merged) != 0) {
+		printf("[ERROR] Could not write \"%s\".\n", source);
+		goto CLEANUP;
+	}
+	if(units == 0) {
+		// Nothing was compiled with -flto
+		ret = Linker__link(output, rest + 1, rest_count - 1, format);
+		goto CLEANUP;
+	}
+
+	// One unit for the whole program, linked with everything else
+	if(verbose) {
+		printf("[INFO] Link-time optimization of %d units.\n", units);
+	}
+	char* argv[14] = { "lto", source, "1000", "1000", "100", "100000", "1", "-c", "--whole-program", "-o", object };
+	int argc = 11;
+	if(format == OUTPUT_FORMAT_ELF64_SHARED) {
+		argv[argc++] = "-fPIC";
+	}
+	if(verbose) {
+		argv[argc++] = "-v";
+	}
+	argv[argc] = NULL;
+	if(compile(argc, argv) != 0) {
+		printf("[ERROR] Link-time optimization of \"%s\" failed.\n", output);
+		goto CLEANUP;
+	}
+	rest[0] = object;
+	ret = Linker__link(output, rest, rest_count, format);
+
+	CLEANUP:
+	remove(source);
+	remove(object);
+	free(rest);
+	return ret;
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "./../../structures.h"
+
+// Link-time optimization
+//   Objects compiled with -flto are "fat": they carry their machine code and
+//   the source of the unit (.chaos.ir), so they still link without LTO.
+//   "--link -flto" merges the sources of all such objects into one unit and
+//   compiles it with --whole-program, then links it with the other inputs.
+//   Whole program compiles translate only what main and exported
+//   declarations can reach and fold loads of globals that can not change.
+
+typedef int (*LTO_COMPILER)(int argc, char** argv);
+
+int Lto__analyze(COMPILER* compiler);
+bool Lto__constant(COMPILER* compiler, PCC__INT* global);
+const char* Lto__reference(CODE_OBJECT* object, int k);
+int Lto__link(const char* output, char** inputs, int input_count, uint8_t format, bool verbose, LTO_COMPILER compile);
@@ -0,0 +1,144 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "pgo.h"
+#include "./../../ProfileReport/profile_report.h"
+
+#define C compiler
+
+static __thread PROFILE_DATA* sort_profile;
+
+static int Pgo__compare_edges(const void* a, const void* b) {
+	// Most calls first, the order of the profile breaks ties
+	uint64_t x = sort_profile->counters[sort_profile->header->function_count + *(const int*)a].calls;
+	uint64_t y = sort_profile->counters[sort_profile->header->function_count + *(const int*)b].calls;
+	if(x != y) {
+		return x < y ? 1 : -1;
+	}
+	return *(const int*)a - *(const int*)b;
+}
+
+static int Pgo__find(COMPILER* compiler, const char* name) {
+	for(int i = 0;i < C->current_function;i++) {
+		if(strcmp(C->functions[i].name, name) == 0) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+int Pgo__load(COMPILER* compiler) {
+	PROFILE_DATA profile;
+	if(ProfileReport__load(C->pgo.path, &profile) != 0) {
+		return -1;
+	}
+	int count = C->current_function;
+	int ret = -1;
+	int* function_of = malloc((profile.header->symbol_count + 1) * sizeof(int)); // Profile symbol -> function
+	uint64_t* cycles = calloc(count + 1, sizeof(uint64_t));
+	int* next = malloc((count + 1) * sizeof(int));                               // Chains as lists
+	int* head = malloc((count + 1) * sizeof(int));
+	int* tail = malloc((count + 1) * sizeof(int));
+	int* order = malloc((profile.header->edge_count + count + 1) * sizeof(int));
+	C->pgo.rank = malloc((count + 1) * sizeof(int));
+	C->pgo.heat = calloc(count + 1, sizeof(uint8_t));
+	if(function_of == NULL || cycles == NULL || next == NULL || head == NULL || tail == NULL || order == NULL || C->pgo.rank == NULL || C->pgo.heat == NULL) {
+		printf("[ERROR] Could not allocate the profile layout.\n");
+		goto CLEANUP;
+	}
+
+	// Heat of every function, every hot function starts as its own chain
+	for(int i = 0;i < count;i++) {
+		next[i] = -1;
+		head[i] = i;
+		tail[i] = i;
+	}
+	int hot = 0, cold = 0;
+	for(uint32_t i = 0;i < profile.header->symbol_count;i++) {
+		function_of[i] = i < profile.header->function_count ? Pgo__find(C, profile.names[i]) : -1;
+		if(function_of[i] < 0) {
+			continue;
+		}
+		bool ran = profile.counters[i].calls > 0;
+		C->pgo.heat[function_of[i]] = ran ? PGO_HOT : PGO_COLD;
+		cycles[function_of[i]] = profile.counters[i].cycles;
+		hot = hot + ran;
+		cold = cold + !ran;
+	}
+
+	// Join the chains of caller and callee, most frequent calls first
+	for(uint32_t i = 0;i < profile.header->edge_count;i++) {
+		order[i] = (int)i;
+	}
+	sort_profile = &profile;
+	qsort(order, profile.header->edge_count, sizeof(int), Pgo__compare_edges);
+	for(uint32_t i = 0;i < profile.header->edge_count;i++) {
+		PROFILE_EDGE* edge = &profile.edges[order[i]];
+		int caller = function_of[edge->caller];
+		int callee = edge->callee < profile.header->function_count ? function_of[edge->callee] : -1;
+		if(caller < 0 || callee < 0 || C->pgo.heat[caller] != PGO_HOT || C->pgo.heat[callee] != PGO_HOT || head[caller] == head[callee]) {
+			continue;
+		}
+		int first = head[caller], second = head[callee];
+		next[tail[first]] = second;
+		tail[first] = tail[second];
+		cycles[first] = cycles[first] + cycles[second];
+		for(int j = second;j >= 0;j = next[j]) {
+			head[j] = first;
+		}
+	}
+
+	// Ranks: chains by cycles, unknown functions in source order, cold functions
+	int chains = 0;
+	for(int i = 0;i < count;i++) {
+		if(C->pgo.heat[i] == PGO_HOT && head[i] == i) {
+			order[chains++] = i;
+		}
+	}
+	for(int i = 1;i < chains;i++) {
+		// Insertion sort, chains with more cycles first
+		int chain = order[i], j = i;
+		for(;j > 0 && cycles[order[j - 1]] < cycles[chain];j--) {
+			order[j] = order[j - 1];
+		}
+		order[j] = chain;
+	}
+	int rank = 0;
+	for(int i = 0;i < chains;i++) {
+		for(int j = order[i];j >= 0;j = next[j]) {
+			C->pgo.rank[j] = rank++;
+		}
+	}
+	static const uint8_t after[2] = { PGO_UNKNOWN, PGO_COLD };
+	for(int k = 0;k < 2;k++) {
+		for(int i = 0;i < count;i++) {
+			if(C->pgo.heat[i] == after[k]) {
+				C->pgo.rank[i] = rank++;
+			}
+		}
+	}
+	if(C->verbose) {
+		printf("[INFO] Profile layout: %d hot, %d cold and %d functions not in the profile.\n", hot, cold, count - hot - cold);
+	}
+	ret = 0;
+
+	CLEANUP:
+	free(function_of);
+	free(cycles);
+	free(next);
+	free(head);
+	free(tail);
+	free(order);
+	ProfileReport__free(&profile);
+	if(ret != 0) {
+		Pgo__free(C);
+	}
+	return ret;
+}
+
+void Pgo__free(COMPILER* compiler) {
+	free(C->pgo.rank);
+	free(C->pgo.heat);
+	C->pgo.rank = NULL;
+	C->pgo.heat = NULL;
+}
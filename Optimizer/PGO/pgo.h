@@ -0,0 +1,29 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "./../../structures.h"
+
+// Profile-guided function layout (-fprofile-use=<file>)
+//   Reads a profile of an earlier run of the program (-finstrument, see
+//   Runtime/Profile/profile.h) and matches its functions by name. Functions
+//   that ran are hot: they are clustered along their most frequent calls
+//   (Pettis-Hansen: the edges are visited by call count and the chains of
+//   caller and callee are joined), the chains are placed by cycles at the
+//   start of .text and every hot function is aligned to PGO_HOT_ALIGNMENT.
+//   Functions that did not run are cold and go to .text.cold at the end of
+//   .text (see Linker/ELF64/linker.h), packed without alignment. Functions
+//   the profile does not know stay between the two in source order.
+
+#define PGO_HOT_ALIGNMENT 16
+
+enum PGO_HEAT {
+	PGO_UNKNOWN,                       // Not in the profile
+	PGO_HOT,
+	PGO_COLD,
+};
+
+int Pgo__load(COMPILER* compiler);
+void Pgo__free(COMPILER* compiler);
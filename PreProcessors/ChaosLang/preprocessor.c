@@ -1,3 +1,7 @@
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
 #include "preprocessor.h"
 
 // Pre-processor directives:
@@ -32,23 +36,24 @@
 	//     Options: true, false
 	//   - DEFINES_REQ:
 	//     Sets which defines are needed to compile the program.
-FILE* PreProcessor(FILE* fptr, COMPILER* compiler) {
-    // Create/Reopen a temporary file for the pre-processed code
-	FILE* preProcessedFile = fopen("./build/temp_preprocessed.pre", "w+");
+int PreProcessor(FILE* fptr, COMPILER* compiler) {
+    // Create a temporary file for the pre-processed code (one per compile, builds run several at once)
+	FILE* preProcessedFile = tmpfile();
 	if(preProcessedFile == NULL) {
 		printf("[ERROR] Could not create temporary pre-processed file.\n");
 		return -1;
-	}fptr;
+	}
 
     FILE* originalFile = compiler->fptr;
 
 	// Find a pre-processor directive
 	bool included_file = false;
+	bool line_start = true;           // Directives start a line, "#" in comments is code
 	int c = fgetc(fptr);
 	do {
 		included_file = false;
 		while(c != EOF) {
-			if(c == (int)'#') {
+			if(c == (int)'#' && line_start) {
 				// Read directive
 				char directive_buffer[33] = { 0 };
 				directive_buffer[32] = '\0';
@@ -164,6 +169,7 @@ FILE* PreProcessor(FILE* fptr, COMPILER* compiler) {
 			else {
 				// Write character to pre-processed file
 				fputc(c, preProcessedFile);
+				line_start = c == (int)'\n' || (line_start && (c == (int)' ' || c == (int)'\t'));
 			}
 			c = fgetc(fptr);
 		}
@@ -5,4 +5,5 @@
 
 #include "./../../structures.h"
 
-File* ChaosLang__PreProcessor(File raw_file, const char* extension);
\ No newline at end of file
+File* ChaosLang__PreProcessor(File raw_file, const char* extension);
+int PreProcessor(FILE* fptr, COMPILER* compiler);
\ No newline at end of file
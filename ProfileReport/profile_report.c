@@ -0,0 +1,200 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "profile_report.h"
+
+typedef struct _PROFILE_ENTRY_ {
+	const char* name;
+	uint64_t calls;
+	uint64_t self;                     // Cycles without the calls into other functions
+	uint64_t total;
+} PROFILE_ENTRY;
+
+static PROFILE_ENTRY* report_entries;
+
+static int ProfileReport__compare_self(const void* a, const void* b) {
+	const PROFILE_ENTRY* x = &report_entries[*(const int*)a];
+	const PROFILE_ENTRY* y = &report_entries[*(const int*)b];
+	if(x->self != y->self) {
+		return x->self < y->self ? 1 : -1;
+	}
+	return *(const int*)a - *(const int*)b;
+}
+
+static int ProfileReport__compare_total(const void* a, const void* b) {
+	const PROFILE_ENTRY* x = &report_entries[*(const int*)a];
+	const PROFILE_ENTRY* y = &report_entries[*(const int*)b];
+	if(x->total != y->total) {
+		return x->total < y->total ? 1 : -1;
+	}
+	return *(const int*)a - *(const int*)b;
+}
+
+static uint8_t* ProfileReport__read(const char* path, long* size) {
+	FILE* file = fopen(path, "rb");
+	if(file == NULL) {
+		printf("[ERROR] Could not open profile \"%s\".\n", path);
+		return NULL;
+	}
+	fseek(file, 0, SEEK_END);
+	*size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	uint8_t* data = malloc(*size > 0 ? *size : 1);
+	if(data == NULL || fread(data, 1, *size, file) != (size_t)*size) {
+		printf("[ERROR] Could not read profile \"%s\".\n", path);
+		free(data);
+		data = NULL;
+	}
+	fclose(file);
+	return data;
+}
+
+int ProfileReport__load(const char* path, PROFILE_DATA* profile) {
+	long size = 0;
+	memset(profile, 0, sizeof(PROFILE_DATA));
+	profile->data = ProfileReport__read(path, &size);
+	if(profile->data == NULL) {
+		return -1;
+	}
+	PROFILE_HEADER* header = (PROFILE_HEADER*)profile->data;
+	if(size < (long)sizeof(PROFILE_HEADER) || memcmp(header->magic, PROFILE_MAGIC, 8) != 0 || header->version != PROFILE_VERSION) {
+		printf("[ERROR] \"%s\" is not a profile (version %d).\n", path, PROFILE_VERSION);
+		ProfileReport__free(profile);
+		return -1;
+	}
+	uint64_t names = sizeof(PROFILE_HEADER) + (uint64_t)header->edge_count * sizeof(PROFILE_EDGE);
+	uint64_t counters = names + header->names_size;
+	if(header->function_count > header->symbol_count ||
+	   counters + (uint64_t)(header->function_count + header->edge_count) * sizeof(PROFILE_COUNTER) > (uint64_t)size) {
+		printf("[ERROR] Profile \"%s\" is truncated.\n", path);
+		ProfileReport__free(profile);
+		return -1;
+	}
+	profile->header = header;
+	profile->edges = (PROFILE_EDGE*)(profile->data + sizeof(PROFILE_HEADER));
+	profile->counters = (PROFILE_COUNTER*)(profile->data + counters);
+	profile->names = malloc((header->symbol_count + 1) * sizeof(char*));
+	if(profile->names == NULL) {
+		printf("[ERROR] Could not allocate the profile names.\n");
+		ProfileReport__free(profile);
+		return -1;
+	}
+	const char* name = (const char*)(profile->data + names);
+	const char* names_end = (const char*)profile->data + counters;
+	for(uint32_t i = 0;i < header->symbol_count;i++) {
+		if(name >= names_end || memchr(name, '\0', names_end - name) == NULL) {
+			printf("[ERROR] Profile \"%s\" is truncated.\n", path);
+			ProfileReport__free(profile);
+			return -1;
+		}
+		profile->names[i] = name;
+		name = name + strlen(name) + 1;
+	}
+	for(uint32_t i = 0;i < header->edge_count;i++) {
+		if(profile->edges[i].caller >= header->function_count || profile->edges[i].callee >= header->symbol_count) {
+			printf("[ERROR] Profile \"%s\" is corrupt.\n", path);
+			ProfileReport__free(profile);
+			return -1;
+		}
+	}
+	return 0;
+}
+
+void ProfileReport__free(PROFILE_DATA* profile) {
+	free(profile->names);
+	free(profile->data);
+	memset(profile, 0, sizeof(PROFILE_DATA));
+}
+
+int ProfileReport__print(const char* path, bool call_graph) {
+	PROFILE_DATA profile;
+	if(ProfileReport__load(path, &profile) != 0) {
+		return -1;
+	}
+	int ret = -1;
+	PROFILE_HEADER* header = profile.header;
+	PROFILE_EDGE* edges = profile.edges;
+	PROFILE_COUNTER* counter = profile.counters;
+
+	// Symbols: names, counters of the functions, self = total - edges
+	PROFILE_ENTRY* entries = calloc(header->symbol_count + 1, sizeof(PROFILE_ENTRY));
+	int* order = malloc((header->symbol_count + 1) * sizeof(int));
+	if(entries == NULL || order == NULL) {
+		printf("[ERROR] Could not allocate the profile report.\n");
+		goto CLEANUP;
+	}
+	for(uint32_t i = 0;i < header->symbol_count;i++) {
+		entries[i].name = profile.names[i];
+		if(i < header->function_count) {
+			entries[i].calls = counter[i].calls;
+			entries[i].self = counter[i].cycles;
+			entries[i].total = counter[i].cycles;
+		}
+	}
+	for(uint32_t i = 0;i < header->edge_count;i++) {
+		PROFILE_COUNTER* edge = &counter[header->function_count + i];
+		PROFILE_ENTRY* caller = &entries[edges[i].caller];
+		caller->self = edge->cycles < caller->self ? caller->self - edge->cycles : 0;
+		if(edges[i].callee >= header->function_count) {
+			// External: known from its calls only
+			entries[edges[i].callee].calls += edge->calls;
+			entries[edges[i].callee].self += edge->cycles;
+			entries[edges[i].callee].total += edge->cycles;
+		}
+	}
+	uint64_t all = 0;
+	int count = 0;
+	for(uint32_t i = 0;i < header->symbol_count;i++) {
+		all = all + entries[i].self;
+		if(entries[i].calls > 0) {
+			order[count++] = (int)i;
+		}
+	}
+	report_entries = entries;
+
+	if(!call_graph) {
+		qsort(order, count, sizeof(int), ProfileReport__compare_self);
+		printf("[INFO] Flat profile of \"%s\" (%llu cycles):\n", path, (unsigned long long)all);
+		printf("  %7s %16s %16s %12s %14s  %s\n", "% self", "self cycles", "total cycles", "calls", "cycles/call", "function");
+		for(int i = 0;i < count;i++) {
+			PROFILE_ENTRY* entry = &entries[order[i]];
+			printf("  %6.2f%% %16llu %16llu %12llu %14.1f  %s%s\n", all > 0 ? entry->self * 100.0 / all : 0.0,
+				(unsigned long long)entry->self, (unsigned long long)entry->total, (unsigned long long)entry->calls,
+				(double)entry->total / entry->calls, entry->name, order[i] >= (int)header->function_count ? " (external)" : "");
+		}
+		ret = 0;
+		goto CLEANUP;
+	}
+
+	// Edges also carry the counting of their callee, so the total of main can be above the sum
+	qsort(order, count, sizeof(int), ProfileReport__compare_total);
+	all = count > 0 && entries[order[0]].total > all ? entries[order[0]].total : all;
+	printf("[INFO] Call graph of \"%s\" (%llu cycles):\n", path, (unsigned long long)all);
+	printf("  %7s %16s %16s %12s  %s\n", "% total", "self cycles", "total cycles", "calls", "function");
+	for(int i = 0;i < count;i++) {
+		int symbol = order[i];
+		PROFILE_ENTRY* entry = &entries[symbol];
+		printf("  --\n");
+		for(uint32_t j = 0;j < header->edge_count;j++) {
+			if(edges[j].callee == (uint32_t)symbol) {
+				PROFILE_COUNTER* edge = &counter[header->function_count + j];
+				printf("  %7s %16s %16llu %12llu      %s (caller)\n", "", "", (unsigned long long)edge->cycles, (unsigned long long)edge->calls, entries[edges[j].caller].name);
+			}
+		}
+		printf("  %6.2f%% %16llu %16llu %12llu  %s\n", all > 0 ? entry->total * 100.0 / all : 0.0,
+			(unsigned long long)entry->self, (unsigned long long)entry->total, (unsigned long long)entry->calls, entry->name);
+		for(uint32_t j = 0;j < header->edge_count;j++) {
+			if(edges[j].caller == (uint32_t)symbol) {
+				PROFILE_COUNTER* edge = &counter[header->function_count + j];
+				printf("  %7s %16s %16llu %12llu      %s\n", "", "", (unsigned long long)edge->cycles, (unsigned long long)edge->calls, entries[edges[j].callee].name);
+			}
+		}
+	}
+	ret = 0;
+
+	CLEANUP:
+	free(order);
+	free(entries);
+	ProfileReport__free(&profile);
+	return ret;
+}
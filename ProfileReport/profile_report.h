@@ -0,0 +1,30 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "./../Runtime/Profile/profile.h"
+
+// Profile report (--profile-report <file> [--call-graph])
+//   Reads a profile written by an executable compiled with -finstrument
+//   (see Runtime/Profile/profile.h). The flat report lists the functions
+//   by self cycles: calls, self and total cycles and cycles per call. The
+//   call graph lists every called function with its callers above and its
+//   callees below, with the calls and cycles of each edge. External
+//   functions only appear as callees, their cycles are the ones of the
+//   calls into them.
+//   ProfileReport__load checks a profile and points into it, -fprofile-use
+//   (see Optimizer/PGO/pgo.h) reads it the same way.
+
+typedef struct _PROFILE_DATA_ {
+	uint8_t* data;                     // The whole file
+	PROFILE_HEADER* header;
+	PROFILE_EDGE* edges;
+	PROFILE_COUNTER* counters;         // Functions, then edges
+	const char** names;                // Of all symbols
+} PROFILE_DATA;
+
+int ProfileReport__load(const char* path, PROFILE_DATA* profile);
+void ProfileReport__free(PROFILE_DATA* profile);
+int ProfileReport__print(const char* path, bool call_graph);
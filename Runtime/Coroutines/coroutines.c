@@ -0,0 +1,369 @@
+#include "coroutines.h"
+#include "./../Tasks/tasks.h"
+
+// System calls (x86_64 Linux)
+#define COROUTINES_SYS_READ 0
+#define COROUTINES_SYS_WRITE 1
+#define COROUTINES_SYS_MMAP 9
+#define COROUTINES_SYS_MPROTECT 10
+#define COROUTINES_SYS_MUNMAP 11
+#define COROUTINES_SYS_SENDTO 44
+#define COROUTINES_SYS_RECVFROM 45
+#define COROUTINES_SYS_FCNTL 72
+#define COROUTINES_SYS_EXIT_GROUP 231
+#define COROUTINES_SYS_EPOLL_WAIT 232
+#define COROUTINES_SYS_EPOLL_CTL 233
+#define COROUTINES_SYS_ACCEPT4 288
+#define COROUTINES_SYS_EPOLL_CREATE1 291
+#define COROUTINES_ENOENT 2
+#define COROUTINES_EINTR 4
+#define COROUTINES_EAGAIN 11
+#define COROUTINES_ENOTSOCK 88
+#define COROUTINES_EPOLLIN 0x001
+#define COROUTINES_EPOLLOUT 0x004
+#define COROUTINES_EPOLLONESHOT 0x40000000
+#define COROUTINES_EPOLL_CTL_ADD 1
+#define COROUTINES_EPOLL_CTL_MOD 3
+#define COROUTINES_O_NONBLOCK 04000
+#define COROUTINES_O_CLOEXEC 02000000
+#define COROUTINES_MSG_DONTWAIT 0x40
+#define COROUTINES_MSG_NOSIGNAL 0x4000
+
+typedef struct __attribute__((packed)) _COROUTINE_EVENT_ {
+	uint32_t events;
+	uint64_t data;                         // Parked coroutine
+} COROUTINE_EVENT;
+
+typedef struct _COROUTINE_SCHEDULER_ {
+	COROUTINE* current;                    // Running coroutine, NULL = scheduler or no coroutine
+	void* sp;                              // Saved stack pointer of the scheduler
+	COROUTINE* ready_head;
+	COROUTINE* ready_tail;
+	COROUTINE* pool;                       // Idle stacks
+	int pool_count;
+	bool polling;                          // poller is created
+	int poller;                            // epoll descriptor
+	int parked;                            // Coroutines waiting in epoll
+	int live;                              // Started and not awaited yet
+	uint64_t owner;                        // fs:0 of the host thread using it, 0 = free (threads only)
+} COROUTINE_SCHEDULER;
+
+static COROUTINE_SCHEDULER schedulers[TASKS_MAX_WORKERS];  // One per task worker
+static COROUTINE_SCHEDULER threads[COROUTINES_MAX_THREADS]; // Host threads without a slot (TASKS_SHARED), claimed by owner
+
+// Saves the callee-saved registers on the current stack, stores the stack
+// pointer in *save and continues with the registers saved on stack.
+// A new coroutine starts in Coroutines__entry with itself in r12.
+void Coroutines__switch(void** save, void* stack) __attribute__((visibility("hidden")));
+void Coroutines__entry(void) __attribute__((visibility("hidden")));
+void Coroutines__main(COROUTINE* coroutine) __attribute__((visibility("hidden"), used, noreturn));
+__asm__(
+	".text\n"
+	".globl Coroutines__switch\n"
+	".hidden Coroutines__switch\n"
+	".type Coroutines__switch, @function\n"
+	"Coroutines__switch:\n"
+	"\tpushq %rbp\n"
+	"\tpushq %rbx\n"
+	"\tpushq %r12\n"
+	"\tpushq %r13\n"
+	"\tpushq %r14\n"
+	"\tpushq %r15\n"
+	"\tmovq %rsp, (%rdi)\n"
+	"\tmovq %rsi, %rsp\n"
+	"\tpopq %r15\n"
+	"\tpopq %r14\n"
+	"\tpopq %r13\n"
+	"\tpopq %r12\n"
+	"\tpopq %rbx\n"
+	"\tpopq %rbp\n"
+	"\tret\n"
+	".size Coroutines__switch, .-Coroutines__switch\n"
+	".globl Coroutines__entry\n"
+	".hidden Coroutines__entry\n"
+	".type Coroutines__entry, @function\n"
+	"Coroutines__entry:\n"
+	"\tmovq %r12, %rdi\n"
+	"\tcall Coroutines__main\n"
+	"\tud2\n"
+	".size Coroutines__entry, .-Coroutines__entry\n"
+);
+
+static long Coroutines__syscall(long number, long a, long b, long c, long d, long e, long f) {
+	register long r10 __asm__("r10") = d;
+	register long r8 __asm__("r8") = e;
+	register long r9 __asm__("r9") = f;
+	long ret;
+	__asm__ volatile("syscall" : "=a"(ret) : "a"(number), "D"(a), "S"(b), "d"(c), "r"(r10), "r"(r8), "r"(r9) : "rcx", "r11", "memory");
+	return ret;
+}
+
+static __attribute__((noreturn)) void Coroutines__fail(const char* message, int length) {
+	Coroutines__syscall(COROUTINES_SYS_WRITE, 2, (long)message, length, 0, 0, 0);
+	Coroutines__syscall(COROUTINES_SYS_EXIT_GROUP, 1, 0, 0, 0, 0, 0);
+	__builtin_unreachable();
+}
+
+static COROUTINE_SCHEDULER* Coroutines__scheduler(void) {
+	// Coroutines stay on the worker or host thread that started them
+	int worker = __chaos_worker();
+	if(worker != TASKS_SHARED) {
+		return &schedulers[worker];
+	}
+	// Threads without a slot are told apart by their libc thread pointer
+	uint64_t thread;
+	__asm__ volatile("movq %%fs:0, %0" : "=r"(thread));
+	int first = (int)((thread >> 12) % COROUTINES_MAX_THREADS);
+	for(int i = 0;i < COROUTINES_MAX_THREADS;i++) {
+		COROUTINE_SCHEDULER* self = &threads[(first + i) % COROUTINES_MAX_THREADS];
+		if(__atomic_load_n(&self->owner, __ATOMIC_ACQUIRE) == thread) {
+			return self;
+		}
+	}
+	for(int i = 0;i < COROUTINES_MAX_THREADS;i++) {
+		COROUTINE_SCHEDULER* self = &threads[(first + i) % COROUTINES_MAX_THREADS];
+		uint64_t free = 0;
+		if(__atomic_compare_exchange_n(&self->owner, &free, thread, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+			return self;
+		}
+	}
+	Coroutines__fail("[ERROR] Too many threads with coroutines.\n", 42);
+}
+
+static void Coroutines__leave(COROUTINE_SCHEDULER* self) {
+	// A host thread gives its scheduler back when nothing runs or waits on it,
+	// its stack pool and epoll descriptor stay for the next thread
+	if(self->owner != 0 && self->current == 0 && self->live == 0 && self->parked == 0) {
+		__atomic_store_n(&self->owner, 0, __ATOMIC_RELEASE);
+	}
+}
+
+static void Coroutines__ready(COROUTINE_SCHEDULER* self, COROUTINE* coroutine) {
+	coroutine->next = 0;
+	if(self->ready_tail != 0) {
+		self->ready_tail->next = coroutine;
+	}
+	else {
+		self->ready_head = coroutine;
+	}
+	self->ready_tail = coroutine;
+}
+
+static void Coroutines__suspend(COROUTINE_SCHEDULER* self) {
+	// Back to the scheduler, returns when the coroutine is resumed
+	Coroutines__switch(&self->current->sp, self->sp);
+}
+
+void Coroutines__main(COROUTINE* coroutine) {
+	coroutine->result = coroutine->function();
+	coroutine->done = true;
+	COROUTINE_SCHEDULER* self = Coroutines__scheduler();
+	if(coroutine->waiter != 0) {
+		Coroutines__ready(self, coroutine->waiter);
+	}
+	// Never resumed, the stack is released by __chaos_await
+	Coroutines__switch(&coroutine->sp, self->sp);
+	Coroutines__fail("[ERROR] Finished coroutine resumed.\n", 36);
+}
+
+static COROUTINE* Coroutines__allocate(COROUTINE_SCHEDULER* self) {
+	COROUTINE* coroutine = self->pool;
+	if(coroutine != 0) {
+		self->pool = coroutine->next;
+		self->pool_count--;
+		return coroutine;
+	}
+	long stack = Coroutines__syscall(COROUTINES_SYS_MMAP, 0, COROUTINES_STACK_SIZE, 3, 0x22, -1, 0); // RW, private anonymous
+	if(stack < 0 && stack > -4096) {
+		Coroutines__fail("[ERROR] Could not allocate a coroutine stack.\n", 46);
+	}
+	Coroutines__syscall(COROUTINES_SYS_MPROTECT, stack, 4096, 0, 0, 0, 0);
+
+	// The coroutine is kept above its stack
+	coroutine = (COROUTINE*)(stack + COROUTINES_STACK_SIZE - ((sizeof(COROUTINE) + 63) & ~63));
+	coroutine->stack = (char*)stack;
+	return coroutine;
+}
+
+static void Coroutines__release(COROUTINE_SCHEDULER* self, COROUTINE* coroutine) {
+	if(self->pool_count >= COROUTINES_POOL_KEEP) {
+		Coroutines__syscall(COROUTINES_SYS_MUNMAP, (long)coroutine->stack, COROUTINES_STACK_SIZE, 0, 0, 0, 0);
+		return;
+	}
+	coroutine->next = self->pool;
+	self->pool = coroutine;
+	self->pool_count++;
+}
+
+static int Coroutines__schedule(COROUTINE_SCHEDULER* self, COROUTINE* until) {
+	// Runs coroutines on the stack of the caller until "until" is done
+	COROUTINE_EVENT events[COROUTINES_EVENTS];
+	while(!until->done) {
+		COROUTINE* coroutine = self->ready_head;
+		if(coroutine != 0) {
+			self->ready_head = coroutine->next;
+			if(self->ready_head == 0) {
+				self->ready_tail = 0;
+			}
+			self->current = coroutine;
+			Coroutines__switch(&self->sp, coroutine->sp);
+			self->current = 0;
+			continue;
+		}
+		if(self->parked == 0) {
+			// Everything waits for a coroutine
+			return -1;
+		}
+		long count = Coroutines__syscall(COROUTINES_SYS_EPOLL_WAIT, self->poller, (long)events, COROUTINES_EVENTS, -1, 0, 0);
+		for(long i = 0;i < count;i++) {
+			self->parked--;
+			Coroutines__ready(self, (COROUTINE*)events[i].data);
+		}
+	}
+	return 0;
+}
+
+static int Coroutines__park(COROUTINE_SCHEDULER* self, int fd, uint32_t events) {
+	// Suspends the current coroutine until fd is ready (one shot, rearmed by the next park)
+	if(!self->polling) {
+		int poller = (int)Coroutines__syscall(COROUTINES_SYS_EPOLL_CREATE1, COROUTINES_O_CLOEXEC, 0, 0, 0, 0, 0);
+		if(poller < 0) {
+			return poller;
+		}
+		self->poller = poller;
+		self->polling = true;
+	}
+	COROUTINE_EVENT event = { events | COROUTINES_EPOLLONESHOT, (uint64_t)self->current };
+	long ret = Coroutines__syscall(COROUTINES_SYS_EPOLL_CTL, self->poller, COROUTINES_EPOLL_CTL_MOD, fd, (long)&event, 0, 0);
+	if(ret == -COROUTINES_ENOENT) {
+		ret = Coroutines__syscall(COROUTINES_SYS_EPOLL_CTL, self->poller, COROUTINES_EPOLL_CTL_ADD, fd, (long)&event, 0, 0);
+	}
+	if(ret < 0) {
+		return (int)ret;
+	}
+	self->parked++;
+	Coroutines__suspend(self);
+	return 0;
+}
+
+static void Coroutines__nonblocking(int fd) {
+	long flags = Coroutines__syscall(COROUTINES_SYS_FCNTL, fd, 3, 0, 0, 0, 0); // F_GETFL
+	if(flags >= 0 && !(flags & COROUTINES_O_NONBLOCK)) {
+		Coroutines__syscall(COROUTINES_SYS_FCNTL, fd, 4, flags | COROUTINES_O_NONBLOCK, 0, 0, 0); // F_SETFL
+	}
+}
+
+static long Coroutines__transfer(int fd, void* buffer, long size, bool write) {
+	// Returns the bytes transferred or a negative errno
+	COROUTINE_SCHEDULER* self = Coroutines__scheduler();
+	COROUTINE* current = self->current;
+	if(current == 0) {
+		// Blocks the thread, the scheduler is not needed
+		Coroutines__leave(self);
+	}
+	while(true) {
+		long ret;
+		if(current == 0) {
+			ret = Coroutines__syscall(write ? COROUTINES_SYS_WRITE : COROUTINES_SYS_READ, fd, (long)buffer, size, 0, 0, 0);
+		}
+		else {
+			// Sockets without a system call for the mode, other descriptors are switched to non-blocking
+			ret = Coroutines__syscall(write ? COROUTINES_SYS_SENDTO : COROUTINES_SYS_RECVFROM, fd, (long)buffer, size,
+				COROUTINES_MSG_DONTWAIT | (write ? COROUTINES_MSG_NOSIGNAL : 0), 0, 0);
+			if(ret == -COROUTINES_ENOTSOCK) {
+				Coroutines__nonblocking(fd);
+				ret = Coroutines__syscall(write ? COROUTINES_SYS_WRITE : COROUTINES_SYS_READ, fd, (long)buffer, size, 0, 0, 0);
+			}
+		}
+		if(ret == -COROUTINES_EINTR) {
+			continue;
+		}
+		if(ret != -COROUTINES_EAGAIN || current == 0) {
+			return ret;
+		}
+		int error = Coroutines__park(self, fd, write ? COROUTINES_EPOLLOUT : COROUTINES_EPOLLIN);
+		if(error < 0) {
+			return error;
+		}
+	}
+}
+
+COROUTINE* __chaos_go(COROUTINE_FUNCTION function) {
+	COROUTINE_SCHEDULER* self = Coroutines__scheduler();
+	COROUTINE* coroutine = Coroutines__allocate(self);
+	self->live++;
+	coroutine->function = function;
+	coroutine->done = false;
+	coroutine->waiter = 0;
+
+	// First frame for Coroutines__switch: r15 r14 r13 r12 rbx rbp, return address (16 byte aligned after it)
+	uint64_t* sp = (uint64_t*)coroutine - 9;
+	for(int i = 0;i < 9;i++) {
+		sp[i] = 0;
+	}
+	sp[3] = (uint64_t)coroutine;
+	sp[6] = (uint64_t)Coroutines__entry;
+	coroutine->sp = sp;
+	Coroutines__ready(self, coroutine);
+	return coroutine;
+}
+
+int __chaos_await(COROUTINE* coroutine) {
+	COROUTINE_SCHEDULER* self = Coroutines__scheduler();
+	if(self->current != 0) {
+		if(!coroutine->done) {
+			coroutine->waiter = self->current;
+			Coroutines__suspend(self);
+		}
+	}
+	else if(Coroutines__schedule(self, coroutine) != 0) {
+		Coroutines__fail("[ERROR] Awaited coroutine can not finish, all coroutines wait.\n", 63);
+	}
+	int result = coroutine->result;
+	Coroutines__release(self, coroutine);
+	self->live--;
+	Coroutines__leave(self);
+	return result;
+}
+
+void __chaos_yield(void) {
+	COROUTINE_SCHEDULER* self = Coroutines__scheduler();
+	if(self->current != 0) {
+		Coroutines__ready(self, self->current);
+		Coroutines__suspend(self);
+	}
+	Coroutines__leave(self);
+}
+
+long __chaos_read(int fd, void* buffer, long size) {
+	return Coroutines__transfer(fd, buffer, size, false);
+}
+
+long __chaos_write(int fd, const void* buffer, long size) {
+	return Coroutines__transfer(fd, (void*)buffer, size, true);
+}
+
+int __chaos_accept(int fd) {
+	// Accepted sockets are non-blocking
+	COROUTINE_SCHEDULER* self = Coroutines__scheduler();
+	COROUTINE* current = self->current;
+	if(current != 0) {
+		Coroutines__nonblocking(fd);
+	}
+	else {
+		Coroutines__leave(self);
+	}
+	while(true) {
+		long ret = Coroutines__syscall(COROUTINES_SYS_ACCEPT4, fd, 0, 0, COROUTINES_O_NONBLOCK | COROUTINES_O_CLOEXEC, 0, 0);
+		if(ret == -COROUTINES_EINTR) {
+			continue;
+		}
+		if(ret != -COROUTINES_EAGAIN || current == 0) {
+			return (int)ret;
+		}
+		int error = Coroutines__park(self, fd, COROUTINES_EPOLLIN);
+		if(error < 0) {
+			return error;
+		}
+	}
+}
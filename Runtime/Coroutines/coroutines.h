@@ -0,0 +1,55 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Coroutine runtime (linked into programs that use go/await)
+//   int handle = go function;       handle = __chaos_go(function)
+//   int result = await handle;      result = __chaos_await(handle)
+//   Coroutines run on one thread with their own stack, switching saves the
+//   callee-saved registers and the stack pointer (Coroutines__switch).
+//   Stacks come from a pool: every stack reserves COROUTINES_STACK_SIZE of
+//   address space but the kernel only commits the pages that are touched,
+//   so a small coroutine costs a few KiB and a deep one grows up to the
+//   reservation (the lowest page is a guard).
+//   The scheduler runs on the thread that awaits outside of a coroutine. It
+//   resumes ready coroutines in FIFO order and otherwise waits in epoll for
+//   the descriptors parked coroutines wait on. __chaos_read, __chaos_write
+//   and __chaos_accept park the calling coroutine instead of blocking the
+//   thread (outside of a coroutine they block). Every handle is awaited
+//   once, awaiting releases the coroutine and its stack.
+//   Every task worker (see Runtime/Tasks/tasks.h) has its own scheduler,
+//   run queue, stack pool and epoll descriptor, so tasks may use go/await.
+//   A coroutine runs on the worker that started it and its handle is
+//   awaited there. Threads of a host without a slot (TASKS_SHARED) claim
+//   one of COROUTINES_MAX_THREADS schedulers by their libc thread pointer
+//   and give it back once all their coroutines are awaited.
+//   Freestanding like Runtime/Tasks/tasks.h, built into the same object by
+//     make runtime
+
+#define COROUTINES_STACK_SIZE (256 << 10)  // Reserved per coroutine, committed when touched
+#define COROUTINES_POOL_KEEP 1024          // Idle stacks kept for reuse, more are unmapped
+#define COROUTINES_EVENTS 256              // epoll events read at once
+#define COROUTINES_MAX_THREADS 256         // Host threads with coroutines at once
+
+#define COROUTINES_GO_SYMBOL "__chaos_go"
+#define COROUTINES_AWAIT_SYMBOL "__chaos_await"
+
+typedef int (*COROUTINE_FUNCTION)(void);
+
+typedef struct _COROUTINE_ {
+	void* sp;                              // Saved stack pointer while suspended
+	COROUTINE_FUNCTION function;
+	int result;
+	bool done;
+	struct _COROUTINE_* waiter;            // Coroutine awaiting this one
+	struct _COROUTINE_* next;              // Ready queue or stack pool
+	char* stack;                           // Lowest address of the mapping (guard page)
+} COROUTINE;
+
+COROUTINE* __chaos_go(COROUTINE_FUNCTION function);
+int __chaos_await(COROUTINE* coroutine);
+void __chaos_yield(void);
+long __chaos_read(int fd, void* buffer, long size);
+long __chaos_write(int fd, const void* buffer, long size);
+int __chaos_accept(int fd);
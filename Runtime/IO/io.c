@@ -0,0 +1,246 @@
+#include "io.h"
+#include "./../Tasks/tasks.h"
+#include "./../Kernels/kernels.h"
+
+// System calls (x86_64 Linux)
+#define IO_SYS_CLOSE 3
+#define IO_SYS_FSTAT 5
+#define IO_SYS_MMAP 9
+#define IO_SYS_MUNMAP 11
+#define IO_SYS_IOCTL 16
+#define IO_SYS_WRITEV 20
+#define IO_SYS_MADVISE 28
+#define IO_SYS_EXIT_GROUP 231
+#define IO_SYS_OPENAT 257
+#define IO_EINTR 4
+#define IO_AT_FDCWD -100
+#define IO_O_CLOEXEC 02000000
+#define IO_TCGETS 0x5401
+#define IO_MADV_SEQUENTIAL 2
+
+typedef struct _IO_RUN_ {
+	int fd;
+	uint32_t offset;
+	uint32_t size;
+} IO_RUN;
+
+typedef struct _IO_BUFFER_ {
+	IO_RUN runs[IO_RUNS];
+	int run_count;
+	uint32_t used;
+	char data[IO_BUFFER_SIZE];
+} IO_BUFFER;
+
+typedef struct _IO_VECTOR_ {
+	const void* base;
+	uint64_t size;
+} IO_VECTOR;
+
+static IO_BUFFER* buffers[TASKS_MAX_WORKERS];  // Mapped on the first write of a worker
+static uint8_t modes[IO_MAX_FD];
+static int shared_lock;                       // buffers[0] of threads without a slot (TASKS_SHARED)
+
+static long Io__syscall(long number, long a, long b, long c, long d, long e, long f) {
+	register long r10 __asm__("r10") = d;
+	register long r8 __asm__("r8") = e;
+	register long r9 __asm__("r9") = f;
+	long ret;
+	__asm__ volatile("syscall" : "=a"(ret) : "a"(number), "D"(a), "S"(b), "d"(c), "r"(r10), "r"(r8), "r"(r9) : "rcx", "r11", "memory");
+	return ret;
+}
+
+static int Io__mode(int fd) {
+	if(fd < 0 || fd >= IO_MAX_FD) {
+		return IO_MODE_FULL;
+	}
+	if(modes[fd] == IO_MODE_DEFAULT) {
+		uint8_t termios[64];
+		modes[fd] = Io__syscall(IO_SYS_IOCTL, fd, IO_TCGETS, (long)termios, 0, 0, 0) == 0 ? IO_MODE_LINE : IO_MODE_FULL;
+	}
+	return modes[fd];
+}
+
+static long Io__writev(int fd, IO_VECTOR* vectors, int count) {
+	// Writes everything (short writes continue), returns the bytes or a negative errno
+	long total = 0;
+	while(count > 0) {
+		long ret = Io__syscall(IO_SYS_WRITEV, fd, (long)vectors, count, 0, 0, 0);
+		if(ret == -IO_EINTR) {
+			continue;
+		}
+		if(ret < 0) {
+			return ret;
+		}
+		total = total + ret;
+		while(count > 0 && (uint64_t)ret >= vectors->size) {
+			ret = ret - vectors->size;
+			vectors++;
+			count--;
+		}
+		if(count > 0) {
+			vectors->base = (const char*)vectors->base + ret;
+			vectors->size = vectors->size - ret;
+		}
+	}
+	return total;
+}
+
+static long Io__flush(IO_BUFFER* buffer, int fd, const void* data, uint64_t size) {
+	// Writes the runs in order, data for fd goes into the same writev as the last run if that is fd
+	long ret = 0;
+	for(int i = 0;i < buffer->run_count && ret >= 0;i++) {
+		IO_VECTOR vectors[2] = { { buffer->data + buffer->runs[i].offset, buffer->runs[i].size }, { data, size } };
+		bool joined = i == buffer->run_count - 1 && buffer->runs[i].fd == fd && size > 0;
+		ret = Io__writev(buffer->runs[i].fd, vectors, joined ? 2 : 1);
+		if(joined) {
+			size = 0;
+		}
+	}
+	buffer->run_count = 0;
+	buffer->used = 0;
+	if(ret >= 0 && size > 0) {
+		IO_VECTOR vector = { data, size };
+		ret = Io__writev(fd, &vector, 1);
+	}
+	return ret < 0 ? ret : 0;
+}
+
+static IO_BUFFER* Io__buffer(int worker) {
+	// Thread slot of the worker, right on coroutine stacks too
+	if(buffers[worker] == 0) {
+		long buffer = Io__syscall(IO_SYS_MMAP, 0, sizeof(IO_BUFFER), 3, 0x22, -1, 0); // RW, private anonymous
+		if(buffer < 0 && buffer > -4096) {
+			return 0;
+		}
+		buffers[worker] = (IO_BUFFER*)buffer;
+	}
+	return buffers[worker];
+}
+
+static long Io__out(IO_BUFFER* buffer, int fd, const void* data, uint64_t size) {
+	int mode = Io__mode(fd);
+	if(buffer == 0 || mode == IO_MODE_NONE || size > IO_BUFFER_SIZE - buffer->used) {
+		// Does not fit (or not buffered): everything in one go
+		if(buffer == 0) {
+			IO_VECTOR vector = { data, size };
+			long ret = Io__writev(fd, &vector, 1);
+			return ret < 0 ? ret : (long)size;
+		}
+		long ret = Io__flush(buffer, fd, data, size);
+		return ret < 0 ? ret : (long)size;
+	}
+
+	IO_RUN* run = buffer->run_count > 0 ? &buffer->runs[buffer->run_count - 1] : 0;
+	if(run == 0 || run->fd != fd) {
+		if(buffer->run_count == IO_RUNS) {
+			long ret = Io__flush(buffer, fd, 0, 0);
+			if(ret < 0) {
+				return ret;
+			}
+		}
+		run = &buffer->runs[buffer->run_count++];
+		run->fd = fd;
+		run->offset = buffer->used;
+		run->size = 0;
+	}
+	__chaos_memcpy(buffer->data + buffer->used, data, size);
+	buffer->used = buffer->used + size;
+	run->size = run->size + size;
+	if(mode == IO_MODE_LINE && __chaos_memchr(data, '\n', size) != 0) {
+		long ret = Io__flush(buffer, fd, 0, 0);
+		if(ret < 0) {
+			return ret;
+		}
+	}
+	return (long)size;
+}
+
+static int Io__slot(void) {
+	// In a host every thread writes through buffers[0] one at a time, so
+	// __chaos_flush of the host also gets what the workers wrote
+	return Tasks__hosted() ? TASKS_SHARED : __chaos_worker();
+}
+
+long __chaos_out(int fd, const void* data, uint64_t size) {
+	int worker = Io__slot();
+	if(worker == TASKS_SHARED) {
+		Tasks__lock(&shared_lock);
+		long ret = Io__out(Io__buffer(0), fd, data, size);
+		Tasks__unlock(&shared_lock);
+		return ret;
+	}
+	return Io__out(Io__buffer(worker), fd, data, size);
+}
+
+int __chaos_flush(void) {
+	int worker = Io__slot();
+	if(worker == TASKS_SHARED) {
+		Tasks__lock(&shared_lock);
+		int ret = buffers[0] == 0 ? 0 : (int)Io__flush(buffers[0], -1, 0, 0);
+		Tasks__unlock(&shared_lock);
+		return ret;
+	}
+	IO_BUFFER* buffer = buffers[worker];
+	return buffer == 0 ? 0 : (int)Io__flush(buffer, -1, 0, 0);
+}
+
+void __chaos_io_mode(int fd, int mode) {
+	if(fd >= 0 && fd < IO_MAX_FD) {
+		modes[fd] = (uint8_t)mode;
+	}
+}
+
+void __chaos_print_int(int value) {
+	char text[16];
+	int start = sizeof(text);
+	uint32_t digits = value < 0 ? -(uint32_t)value : (uint32_t)value;
+	text[--start] = '\n';
+	do {
+		text[--start] = (char)('0' + digits % 10);
+		digits = digits / 10;
+	} while(digits != 0);
+	if(value < 0) {
+		text[--start] = '-';
+	}
+	__chaos_out(1, text + start, sizeof(text) - start);
+}
+
+void __chaos_exit(int status) {
+	// Other workers only write while main runs, their buffers are complete here
+	for(int i = 0;i < TASKS_MAX_WORKERS;i++) {
+		if(buffers[i] != 0) {
+			Io__flush(buffers[i], -1, 0, 0);
+		}
+	}
+	Io__syscall(IO_SYS_EXIT_GROUP, status, 0, 0, 0, 0, 0);
+	__builtin_unreachable();
+}
+
+long __chaos_map_file(const char* path, const void** data) {
+	*data = 0;
+	long fd = Io__syscall(IO_SYS_OPENAT, IO_AT_FDCWD, (long)path, IO_O_CLOEXEC, 0, 0, 0); // O_RDONLY
+	if(fd < 0) {
+		return fd;
+	}
+	uint64_t stat[18];                     // struct stat, st_size at byte 48
+	long ret = Io__syscall(IO_SYS_FSTAT, fd, (long)stat, 0, 0, 0, 0);
+	long size = ret < 0 ? ret : (long)stat[6];
+	if(size > 0) {
+		long mapping = Io__syscall(IO_SYS_MMAP, 0, size, 1, 0x02, fd, 0); // Read, private
+		if(mapping < 0 && mapping > -4096) {
+			size = mapping;
+		}
+		else {
+			Io__syscall(IO_SYS_MADVISE, mapping, size, IO_MADV_SEQUENTIAL, 0, 0, 0);
+			*data = (const void*)mapping;
+		}
+	}
+	Io__syscall(IO_SYS_CLOSE, fd, 0, 0, 0, 0, 0);
+	return size;
+}
+
+void __chaos_unmap_file(const void* data, long size) {
+	if(data != 0 && size > 0) {
+		Io__syscall(IO_SYS_MUNMAP, (long)data, size, 0, 0, 0, 0);
+	}
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Output and file runtime
+//   print x;                        __chaos_print_int(x), decimal and '\n' on stdout
+//   Every task worker (see Runtime/Tasks/tasks.h) collects its output in
+//   its own IO_BUFFER_SIZE buffer as runs of bytes per descriptor, in the
+//   order it was written (the worker comes from its thread slot, see
+//   __chaos_worker, so coroutines use the buffer of the worker they run
+//   on). Loaded into a libc process all threads share one buffer under a
+//   lock, the host calls __chaos_flush before it exits.
+//   A buffer is written with writev when it is full
+//   (together with the data that did not fit, in the same call), when a
+//   line ends on a line buffered descriptor, on __chaos_flush and on
+//   __chaos_exit, which flushes all workers before exit_group. Executables
+//   that link the runtime leave _start through __chaos_exit.
+//   Modes: terminals are line buffered, everything else fully buffered,
+//   __chaos_io_mode changes it per descriptor (IO_MODE_NONE writes at once).
+//   __chaos_map_file maps a whole file read-only instead of reading it.
+//   Errors are negative errno values, like the system calls.
+
+#define IO_BUFFER_SIZE (64 << 10)
+#define IO_RUNS 64                         // Descriptor changes per buffer before it is flushed
+#define IO_MAX_FD 1024                     // Descriptors with a mode, higher ones are fully buffered
+
+enum IO_MODE {
+	IO_MODE_DEFAULT,                       // Decided on the first write (isatty)
+	IO_MODE_NONE,
+	IO_MODE_LINE,
+	IO_MODE_FULL,
+};
+
+#define IO_PRINT_SYMBOL "__chaos_print_int"
+#define IO_EXIT_SYMBOL "__chaos_exit"
+
+long __chaos_out(int fd, const void* data, uint64_t size);
+int __chaos_flush(void);
+void __chaos_io_mode(int fd, int mode);
+void __chaos_print_int(int value);                     // The language int is 4 bytes
+__attribute__((noreturn)) void __chaos_exit(int status);
+long __chaos_map_file(const char* path, const void** data);  // Size of the file
+void __chaos_unmap_file(const void* data, long size);
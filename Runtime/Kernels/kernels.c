@@ -0,0 +1,405 @@
+#include <cpuid.h>
+#include <immintrin.h>
+
+#include "kernels.h"
+#include "./../IO/io.h"
+
+typedef void* (*KERNELS_MEMCPY)(void* destination, const void* source, uint64_t size);
+typedef void* (*KERNELS_MEMSET)(void* destination, int value, uint64_t size);
+typedef int (*KERNELS_MEMCMP)(const void* a, const void* b, uint64_t size);
+typedef void* (*KERNELS_MEMCHR)(const void* source, int value, uint64_t size);
+typedef uint64_t (*KERNELS_STRLEN)(const char* string);
+
+// Set by Kernels__select (in .bss, no relocations for shared objects)
+static int features;
+static KERNELS_MEMCPY memcpy_kernel;
+static KERNELS_MEMSET memset_kernel;
+static KERNELS_MEMCMP memcmp_kernel;
+static KERNELS_MEMCHR memchr_kernel;
+static KERNELS_STRLEN strlen_kernel;
+
+// Short inputs (scalar, overlapping)
+
+static inline void Kernels__copy_small(char* destination, const char* source, uint64_t size) {
+	if(size >= 8) {
+		uint64_t a, b;
+		__builtin_memcpy(&a, source, 8);
+		__builtin_memcpy(&b, source + size - 8, 8);
+		__builtin_memcpy(destination, &a, 8);
+		__builtin_memcpy(destination + size - 8, &b, 8);
+	}
+	else if(size >= 4) {
+		uint32_t a, b;
+		__builtin_memcpy(&a, source, 4);
+		__builtin_memcpy(&b, source + size - 4, 4);
+		__builtin_memcpy(destination, &a, 4);
+		__builtin_memcpy(destination + size - 4, &b, 4);
+	}
+	else if(size > 0) {
+		// 1 to 3 bytes: first, middle and last
+		char a = source[0], b = source[size >> 1], c = source[size - 1];
+		destination[0] = a;
+		destination[size >> 1] = b;
+		destination[size - 1] = c;
+	}
+}
+
+static inline void Kernels__set_small(char* destination, uint8_t value, uint64_t size) {
+	uint64_t pattern = value * 0x0101010101010101ull;
+	if(size >= 8) {
+		__builtin_memcpy(destination, &pattern, 8);
+		__builtin_memcpy(destination + size - 8, &pattern, 8);
+	}
+	else if(size >= 4) {
+		__builtin_memcpy(destination, &pattern, 4);
+		__builtin_memcpy(destination + size - 4, &pattern, 4);
+	}
+	else if(size > 0) {
+		destination[0] = value;
+		destination[size >> 1] = value;
+		destination[size - 1] = value;
+	}
+}
+
+static inline void Kernels__rep_movsb(void* destination, const void* source, uint64_t size) {
+	__asm__ volatile("rep movsb" : "+D"(destination), "+S"(source), "+c"(size) : : "memory");
+}
+
+static inline void Kernels__rep_stosb(void* destination, uint8_t value, uint64_t size) {
+	__asm__ volatile("rep stosb" : "+D"(destination), "+c"(size) : "a"(value) : "memory");
+}
+
+// SSE2 (every x86_64 CPU)
+
+static void* Kernels__memcpy_sse2(void* destination, const void* source, uint64_t size) {
+	char* d = destination;
+	const char* s = source;
+	if(size < 16) {
+		Kernels__copy_small(d, s, size);
+		return destination;
+	}
+	if(size >= KERNELS_ERMS_MIN && (features & KERNELS_FEATURE_ERMS)) {
+		Kernels__rep_movsb(d, s, size);
+		return destination;
+	}
+	__m128i last = _mm_loadu_si128((const __m128i*)(s + size - 16));
+	uint64_t i = 0;
+	for(;i + 64 <= size;i = i + 64) {
+		__m128i a = _mm_loadu_si128((const __m128i*)(s + i));
+		__m128i b = _mm_loadu_si128((const __m128i*)(s + i + 16));
+		__m128i c = _mm_loadu_si128((const __m128i*)(s + i + 32));
+		__m128i e = _mm_loadu_si128((const __m128i*)(s + i + 48));
+		_mm_storeu_si128((__m128i*)(d + i), a);
+		_mm_storeu_si128((__m128i*)(d + i + 16), b);
+		_mm_storeu_si128((__m128i*)(d + i + 32), c);
+		_mm_storeu_si128((__m128i*)(d + i + 48), e);
+	}
+	for(;i + 16 <= size;i = i + 16) {
+		_mm_storeu_si128((__m128i*)(d + i), _mm_loadu_si128((const __m128i*)(s + i)));
+	}
+	_mm_storeu_si128((__m128i*)(d + size - 16), last);
+	return destination;
+}
+
+static void* Kernels__memset_sse2(void* destination, int value, uint64_t size) {
+	char* d = destination;
+	if(size < 16) {
+		Kernels__set_small(d, (uint8_t)value, size);
+		return destination;
+	}
+	if(size >= KERNELS_ERMS_MIN && (features & KERNELS_FEATURE_ERMS)) {
+		Kernels__rep_stosb(d, (uint8_t)value, size);
+		return destination;
+	}
+	__m128i pattern = _mm_set1_epi8((char)value);
+	uint64_t i = 0;
+	for(;i + 64 <= size;i = i + 64) {
+		_mm_storeu_si128((__m128i*)(d + i), pattern);
+		_mm_storeu_si128((__m128i*)(d + i + 16), pattern);
+		_mm_storeu_si128((__m128i*)(d + i + 32), pattern);
+		_mm_storeu_si128((__m128i*)(d + i + 48), pattern);
+	}
+	for(;i + 16 <= size;i = i + 16) {
+		_mm_storeu_si128((__m128i*)(d + i), pattern);
+	}
+	_mm_storeu_si128((__m128i*)(d + size - 16), pattern);
+	return destination;
+}
+
+static int Kernels__memcmp_sse2(const void* a, const void* b, uint64_t size) {
+	const uint8_t* x = a;
+	const uint8_t* y = b;
+	uint64_t i = 0;
+	for(;i + 16 <= size;i = i + 16) {
+		__m128i equal = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(x + i)), _mm_loadu_si128((const __m128i*)(y + i)));
+		unsigned mask = (unsigned)_mm_movemask_epi8(equal) ^ 0xffffu;
+		if(mask != 0) {
+			i = i + __builtin_ctz(mask);
+			return x[i] - y[i];
+		}
+	}
+	for(;i < size;i++) {
+		if(x[i] != y[i]) {
+			return x[i] - y[i];
+		}
+	}
+	return 0;
+}
+
+static void* Kernels__memchr_sse2(const void* source, int value, uint64_t size) {
+	const uint8_t* s = source;
+	__m128i pattern = _mm_set1_epi8((char)value);
+	uint64_t i = 0;
+	for(;i + 16 <= size;i = i + 16) {
+		unsigned mask = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(s + i)), pattern));
+		if(mask != 0) {
+			return (void*)(s + i + __builtin_ctz(mask));
+		}
+	}
+	for(;i < size;i++) {
+		if(s[i] == (uint8_t)value) {
+			return (void*)(s + i);
+		}
+	}
+	return 0;
+}
+
+static uint64_t Kernels__strlen_sse2(const char* string) {
+	// Aligned loads never cross a page, bytes before the string are masked out
+	const char* block = (const char*)((uint64_t)string & ~(uint64_t)15);
+	__m128i zero = _mm_setzero_si128();
+	unsigned mask = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_load_si128((const __m128i*)block), zero)) >> (string - block);
+	if(mask != 0) {
+		return __builtin_ctz(mask);
+	}
+	while(true) {
+		block = block + 16;
+		mask = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_load_si128((const __m128i*)block), zero));
+		if(mask != 0) {
+			return (uint64_t)(block - string) + __builtin_ctz(mask);
+		}
+	}
+}
+
+// AVX2
+
+__attribute__((target("avx2"))) static void* Kernels__memcpy_avx2(void* destination, const void* source, uint64_t size) {
+	char* d = destination;
+	const char* s = source;
+	if(size < 32) {
+		if(size < 16) {
+			Kernels__copy_small(d, s, size);
+			return destination;
+		}
+		__m128i a = _mm_loadu_si128((const __m128i*)s);
+		__m128i b = _mm_loadu_si128((const __m128i*)(s + size - 16));
+		_mm_storeu_si128((__m128i*)d, a);
+		_mm_storeu_si128((__m128i*)(d + size - 16), b);
+		return destination;
+	}
+	if(size >= KERNELS_ERMS_MIN && (features & KERNELS_FEATURE_ERMS)) {
+		Kernels__rep_movsb(d, s, size);
+		return destination;
+	}
+	__m256i last = _mm256_loadu_si256((const __m256i*)(s + size - 32));
+	uint64_t i = 0;
+	for(;i + 128 <= size;i = i + 128) {
+		__m256i a = _mm256_loadu_si256((const __m256i*)(s + i));
+		__m256i b = _mm256_loadu_si256((const __m256i*)(s + i + 32));
+		__m256i c = _mm256_loadu_si256((const __m256i*)(s + i + 64));
+		__m256i e = _mm256_loadu_si256((const __m256i*)(s + i + 96));
+		_mm256_storeu_si256((__m256i*)(d + i), a);
+		_mm256_storeu_si256((__m256i*)(d + i + 32), b);
+		_mm256_storeu_si256((__m256i*)(d + i + 64), c);
+		_mm256_storeu_si256((__m256i*)(d + i + 96), e);
+	}
+	for(;i + 32 <= size;i = i + 32) {
+		_mm256_storeu_si256((__m256i*)(d + i), _mm256_loadu_si256((const __m256i*)(s + i)));
+	}
+	_mm256_storeu_si256((__m256i*)(d + size - 32), last);
+	_mm256_zeroupper();
+	return destination;
+}
+
+__attribute__((target("avx2"))) static void* Kernels__memset_avx2(void* destination, int value, uint64_t size) {
+	char* d = destination;
+	if(size < 32) {
+		return Kernels__memset_sse2(destination, value, size);
+	}
+	if(size >= KERNELS_ERMS_MIN && (features & KERNELS_FEATURE_ERMS)) {
+		Kernels__rep_stosb(d, (uint8_t)value, size);
+		return destination;
+	}
+	__m256i pattern = _mm256_set1_epi8((char)value);
+	uint64_t i = 0;
+	for(;i + 128 <= size;i = i + 128) {
+		_mm256_storeu_si256((__m256i*)(d + i), pattern);
+		_mm256_storeu_si256((__m256i*)(d + i + 32), pattern);
+		_mm256_storeu_si256((__m256i*)(d + i + 64), pattern);
+		_mm256_storeu_si256((__m256i*)(d + i + 96), pattern);
+	}
+	for(;i + 32 <= size;i = i + 32) {
+		_mm256_storeu_si256((__m256i*)(d + i), pattern);
+	}
+	_mm256_storeu_si256((__m256i*)(d + size - 32), pattern);
+	_mm256_zeroupper();
+	return destination;
+}
+
+__attribute__((target("avx2"))) static int Kernels__memcmp_avx2(const void* a, const void* b, uint64_t size) {
+	const uint8_t* x = a;
+	const uint8_t* y = b;
+	uint64_t i = 0;
+	for(;i + 32 <= size;i = i + 32) {
+		__m256i equal = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(x + i)), _mm256_loadu_si256((const __m256i*)(y + i)));
+		unsigned mask = ~(unsigned)_mm256_movemask_epi8(equal);
+		if(mask != 0) {
+			_mm256_zeroupper();
+			i = i + __builtin_ctz(mask);
+			return x[i] - y[i];
+		}
+	}
+	_mm256_zeroupper();
+	return Kernels__memcmp_sse2(x + i, y + i, size - i);
+}
+
+__attribute__((target("avx2"))) static void* Kernels__memchr_avx2(const void* source, int value, uint64_t size) {
+	const uint8_t* s = source;
+	__m256i pattern = _mm256_set1_epi8((char)value);
+	uint64_t i = 0;
+	for(;i + 32 <= size;i = i + 32) {
+		unsigned mask = (unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(s + i)), pattern));
+		if(mask != 0) {
+			_mm256_zeroupper();
+			return (void*)(s + i + __builtin_ctz(mask));
+		}
+	}
+	_mm256_zeroupper();
+	return Kernels__memchr_sse2(s + i, value, size - i);
+}
+
+__attribute__((target("avx2"))) static uint64_t Kernels__strlen_avx2(const char* string) {
+	const char* block = (const char*)((uint64_t)string & ~(uint64_t)31);
+	__m256i zero = _mm256_setzero_si256();
+	unsigned mask = (unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_load_si256((const __m256i*)block), zero)) >> (string - block);
+	while(mask == 0) {
+		block = block + 32;
+		mask = (unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_load_si256((const __m256i*)block), zero));
+		if(mask != 0) {
+			_mm256_zeroupper();
+			return (uint64_t)(block - string) + __builtin_ctz(mask);
+		}
+	}
+	_mm256_zeroupper();
+	return __builtin_ctz(mask);
+}
+
+// Dispatch
+
+static void Kernels__select(void) {
+	unsigned a, b, c, d;
+	int found = KERNELS_FEATURE_SSE2;
+	if(__get_cpuid(1, &a, &b, &c, &d) && (c & bit_OSXSAVE) && (c & bit_AVX)) {
+		unsigned low, high;
+		__asm__ volatile("xgetbv" : "=a"(low), "=d"(high) : "c"(0));
+		if((low & 6) == 6 && __get_cpuid_count(7, 0, &a, &b, &c, &d) && (b & bit_AVX2)) {
+			found = found | KERNELS_FEATURE_AVX2;
+		}
+	}
+	if(__get_cpuid_count(7, 0, &a, &b, &c, &d) && (b & (1u << 9))) {
+		found = found | KERNELS_FEATURE_ERMS;
+	}
+	bool avx2 = found & KERNELS_FEATURE_AVX2;
+	memcpy_kernel = avx2 ? Kernels__memcpy_avx2 : Kernels__memcpy_sse2;
+	memset_kernel = avx2 ? Kernels__memset_avx2 : Kernels__memset_sse2;
+	memcmp_kernel = avx2 ? Kernels__memcmp_avx2 : Kernels__memcmp_sse2;
+	memchr_kernel = avx2 ? Kernels__memchr_avx2 : Kernels__memchr_sse2;
+	strlen_kernel = avx2 ? Kernels__strlen_avx2 : Kernels__strlen_sse2;
+	// Last, threads that see it also see the kernels
+	__atomic_store_n(&features, found, __ATOMIC_RELEASE);
+}
+
+static long Kernels__level(void) {
+	// Every feature of a level and the ones below, ymm and zmm state saved by the OS
+	unsigned a, b, c, d;
+	unsigned leaf1 = 0, leaf7 = 0, extended = 0, low = 0, high;
+	if(__get_cpuid(1, &a, &b, &leaf1, &d) == 0) {
+		return KERNELS_LEVEL_X86_64;
+	}
+	if(__get_cpuid_count(7, 0, &a, &b, &c, &d)) {
+		leaf7 = b;
+	}
+	if(__get_cpuid(0x80000001, &a, &b, &c, &d)) {
+		extended = c;
+	}
+	if(leaf1 & bit_OSXSAVE) {
+		__asm__ volatile("xgetbv" : "=a"(low), "=d"(high) : "c"(0));
+	}
+	const unsigned v2 = bit_SSE3 | bit_SSSE3 | bit_SSE4_1 | bit_SSE4_2 | bit_POPCNT | bit_CMPXCHG16B;
+	const unsigned v3 = bit_AVX | bit_FMA | bit_F16C | bit_MOVBE | bit_OSXSAVE;
+	const unsigned v3_leaf7 = bit_AVX2 | bit_BMI | bit_BMI2;
+	const unsigned v4_leaf7 = bit_AVX512F | bit_AVX512BW | bit_AVX512CD | bit_AVX512DQ | bit_AVX512VL;
+	if((leaf1 & v2) != v2 || !(extended & bit_LAHF_LM)) {
+		return KERNELS_LEVEL_X86_64;
+	}
+	if((leaf1 & v3) != v3 || (leaf7 & v3_leaf7) != v3_leaf7 || !(extended & bit_LZCNT) || (low & 0x06) != 0x06) {
+		return KERNELS_LEVEL_V2;
+	}
+	if((leaf7 & v4_leaf7) != v4_leaf7 || (low & 0xE6) != 0xE6) {
+		// xmm, ymm, opmask and both halves of the zmm registers
+		return KERNELS_LEVEL_V3;
+	}
+	return KERNELS_LEVEL_V4;
+}
+
+long __chaos_cpu_level(long required) {
+	long level = Kernels__level();
+	if(level < required) {
+		static const char message[] = "[ERROR] The CPU does not support the -march level of this program.\n";
+		__chaos_out(2, message, sizeof(message) - 1);
+		__chaos_exit(1);
+	}
+	return level;
+}
+
+int __chaos_cpu_features(void) {
+	if(__atomic_load_n(&features, __ATOMIC_ACQUIRE) == 0) {
+		Kernels__select();
+	}
+	return features;
+}
+
+void* __chaos_memcpy(void* destination, const void* source, uint64_t size) {
+	if(__builtin_expect(__atomic_load_n(&features, __ATOMIC_ACQUIRE) == 0, 0)) {
+		Kernels__select();
+	}
+	return memcpy_kernel(destination, source, size);
+}
+
+void* __chaos_memset(void* destination, int value, uint64_t size) {
+	if(__builtin_expect(__atomic_load_n(&features, __ATOMIC_ACQUIRE) == 0, 0)) {
+		Kernels__select();
+	}
+	return memset_kernel(destination, value, size);
+}
+
+int __chaos_memcmp(const void* a, const void* b, uint64_t size) {
+	if(__builtin_expect(__atomic_load_n(&features, __ATOMIC_ACQUIRE) == 0, 0)) {
+		Kernels__select();
+	}
+	return memcmp_kernel(a, b, size);
+}
+
+void* __chaos_memchr(const void* source, int value, uint64_t size) {
+	if(__builtin_expect(__atomic_load_n(&features, __ATOMIC_ACQUIRE) == 0, 0)) {
+		Kernels__select();
+	}
+	return memchr_kernel(source, value, size);
+}
+
+uint64_t __chaos_strlen(const char* string) {
+	if(__builtin_expect(__atomic_load_n(&features, __ATOMIC_ACQUIRE) == 0, 0)) {
+		Kernels__select();
+	}
+	return strlen_kernel(string);
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Memory and string kernels
+//   memcpy, memset, memcmp, memchr and strlen with SSE2 and AVX2 variants.
+//   Copies and fills of at least KERNELS_ERMS_MIN bytes use rep movsb and
+//   rep stosb on CPUs with ERMS (enhanced rep movsb/stosb).
+//   The variants are chosen with cpuid on the first call of any kernel,
+//   afterwards a call costs a load, a branch and an indirect call. AVX2 is
+//   only used when the OS saves the ymm registers (OSXSAVE and XCR0).
+//   Copies and fills below one vector use overlapping scalar moves, up to
+//   two vectors two overlapping vector moves. memcpy does not support
+//   overlap.
+//   Built with the rest of the runtime (make runtime), but without
+//   -mgeneral-regs-only.
+//   The translator inlines copies of known size up to
+//   TRANSLATOR_INLINE_MOVES moves of the widest register of its -march
+//   level and calls __chaos_memcpy for longer ones when the runtime is
+//   linked.
+//   __chaos_cpu_level returns the highest x86-64 psABI level the CPU and
+//   the OS support. _start of executables built with -march above x86-64
+//   or with target_clones calls it once, it exits if the CPU is below the
+//   level the program needs.
+
+#define KERNELS_ERMS_MIN 2048
+
+// __chaos_cpu_features bits
+#define KERNELS_FEATURE_SSE2 1
+#define KERNELS_FEATURE_AVX2 2
+#define KERNELS_FEATURE_ERMS 4
+
+// x86-64 psABI levels (-march, __chaos_cpu_level)
+#define KERNELS_LEVEL_X86_64 1             // SSE2
+#define KERNELS_LEVEL_V2 2                 // + SSE3, SSSE3, SSE4.1, SSE4.2, POPCNT, CMPXCHG16B, LAHF
+#define KERNELS_LEVEL_V3 3                 // + AVX, AVX2, BMI1, BMI2, FMA, F16C, LZCNT, MOVBE
+#define KERNELS_LEVEL_V4 4                 // + AVX-512 F, BW, CD, DQ, VL
+
+#define KERNELS_MEMCPY_SYMBOL "__chaos_memcpy"
+#define KERNELS_CPU_LEVEL_SYMBOL "__chaos_cpu_level"
+
+void* __chaos_memcpy(void* destination, const void* source, uint64_t size);
+void* __chaos_memset(void* destination, int value, uint64_t size);
+int __chaos_memcmp(const void* a, const void* b, uint64_t size);
+void* __chaos_memchr(const void* source, int value, uint64_t size);
+uint64_t __chaos_strlen(const char* string);
+int __chaos_cpu_features(void);
+long __chaos_cpu_level(long required);
@@ -0,0 +1,358 @@
+#include "memory.h"
+#include "./../Tasks/tasks.h"
+#include "./../IO/io.h"
+
+// System calls (x86_64 Linux)
+#define MEMORY_SYS_MMAP 9
+#define MEMORY_SYS_MUNMAP 11
+#define MEMORY_PAGE 4096
+#define MEMORY_CLASS_LARGE 0xffffffffu
+#define MEMORY_SPAN_HEADER 64                // Blocks start after it (16 byte aligned)
+
+typedef struct _MEMORY_SPAN_ {
+	uint32_t size_class;                     // MEMORY_CLASS_LARGE = one large block
+	uint32_t block_size;
+	uint64_t mapping_size;                   // Large blocks: size of the mapping that starts with the span
+} MEMORY_SPAN;
+
+typedef struct _MEMORY_BLOCK_ {
+	struct _MEMORY_BLOCK_* next;
+	struct _MEMORY_BLOCK_* batch;            // First block of a batch in a central list: next batch
+} MEMORY_BLOCK;
+
+typedef struct _MEMORY_CACHE_ {
+	MEMORY_BLOCK* lists[MEMORY_CLASSES];
+	uint32_t counts[MEMORY_CLASSES];
+	// Frees of blocks from other workers make these negative, the sum is right
+	int64_t small_used;
+	int64_t large_used;
+	int64_t arena_used;
+	uint64_t allocations;
+	uint64_t frees;
+	uint64_t arena_resets;
+} __attribute__((aligned(64))) MEMORY_CACHE;
+
+typedef struct _MEMORY_CENTRAL_ {
+	int lock;
+	MEMORY_BLOCK* batches;
+} __attribute__((aligned(64))) MEMORY_CENTRAL;
+
+static MEMORY_CACHE caches[TASKS_MAX_WORKERS];
+static MEMORY_CENTRAL centrals[MEMORY_CLASSES];
+static int span_lock;
+static char* span_next;                      // Unused spans of the last chunk
+static char* span_end;
+static uint64_t mapped;
+static int shared_lock;                      // caches[0] of threads without a slot (TASKS_SHARED)
+
+static long Memory__syscall(long number, long a, long b, long c, long d, long e, long f) {
+	register long r10 __asm__("r10") = d;
+	register long r8 __asm__("r8") = e;
+	register long r9 __asm__("r9") = f;
+	long ret;
+	__asm__ volatile("syscall" : "=a"(ret) : "a"(number), "D"(a), "S"(b), "d"(c), "r"(r10), "r"(r8), "r"(r9) : "rcx", "r11", "memory");
+	return ret;
+}
+
+static void Memory__lock(int* lock) {
+	while(__atomic_exchange_n(lock, 1, __ATOMIC_ACQUIRE) != 0) {
+		while(__atomic_load_n(lock, __ATOMIC_RELAXED) != 0) {
+			__builtin_ia32_pause();
+		}
+	}
+}
+
+static void Memory__unlock(int* lock) {
+	__atomic_store_n(lock, 0, __ATOMIC_RELEASE);
+}
+
+static char* Memory__map(uint64_t size, uint64_t alignment) {
+	// Rounded to pages, the ends beyond the alignment are unmapped again
+	size = (size + MEMORY_PAGE - 1) & ~(uint64_t)(MEMORY_PAGE - 1);
+	uint64_t length = alignment > MEMORY_PAGE ? size + alignment : size;
+	long base = Memory__syscall(MEMORY_SYS_MMAP, 0, (long)length, 3, 0x22, -1, 0); // RW, private anonymous
+	if(base < 0 && base > -4096) {
+		return 0;
+	}
+	uint64_t start = ((uint64_t)base + alignment - 1) & ~(alignment - 1);
+	if(start > (uint64_t)base) {
+		Memory__syscall(MEMORY_SYS_MUNMAP, base, (long)(start - (uint64_t)base), 0, 0, 0, 0);
+	}
+	if((uint64_t)base + length > start + size) {
+		Memory__syscall(MEMORY_SYS_MUNMAP, (long)(start + size), (long)((uint64_t)base + length - start - size), 0, 0, 0, 0);
+	}
+	__atomic_add_fetch(&mapped, size, __ATOMIC_RELAXED);
+	return (char*)start;
+}
+
+static void Memory__unmap(void* start, uint64_t size) {
+	Memory__syscall(MEMORY_SYS_MUNMAP, (long)start, (long)size, 0, 0, 0, 0);
+	__atomic_sub_fetch(&mapped, size, __ATOMIC_RELAXED);
+}
+
+static int Memory__class(uint64_t size) {
+	if(size <= 128) {
+		return size == 0 ? 0 : (int)((size + 15) >> 4) - 1;
+	}
+	int log = 63 - __builtin_clzll(size - 1);
+	return 8 + (log - 7) * 4 + (int)(((size - 1) >> (log - 2)) & 3);
+}
+
+static uint32_t Memory__class_size(int size_class) {
+	if(size_class < 8) {
+		return (size_class + 1) * 16;
+	}
+	int log = 7 + (size_class - 8) / 4;
+	return (1u << log) + ((size_class - 8) % 4 + 1) * (1u << (log - 2));
+}
+
+static MEMORY_CACHE* Memory__enter(int worker) {
+	// Thread slot of the worker, right on coroutine stacks too
+	if(worker == TASKS_SHARED) {
+		Tasks__lock(&shared_lock);
+		return &caches[0];
+	}
+	return &caches[worker];
+}
+
+static void Memory__leave(int worker) {
+	if(worker == TASKS_SHARED) {
+		Tasks__unlock(&shared_lock);
+	}
+}
+
+static int Memory__refill(MEMORY_CACHE* cache, int size_class) {
+	// A batch from the central list, otherwise a new span
+	MEMORY_CENTRAL* central = &centrals[size_class];
+	Memory__lock(&central->lock);
+	MEMORY_BLOCK* batch = central->batches;
+	if(batch != 0) {
+		central->batches = batch->batch;
+	}
+	Memory__unlock(&central->lock);
+	if(batch != 0) {
+		cache->lists[size_class] = batch;
+		cache->counts[size_class] = MEMORY_BATCH;
+		return 0;
+	}
+
+	Memory__lock(&span_lock);
+	if(span_next == span_end) {
+		span_next = Memory__map(MEMORY_SPAN_CHUNK, MEMORY_SPAN_SIZE);
+		span_end = span_next != 0 ? span_next + MEMORY_SPAN_CHUNK : 0;
+	}
+	MEMORY_SPAN* span = (MEMORY_SPAN*)span_next;
+	if(span != 0) {
+		span_next = span_next + MEMORY_SPAN_SIZE;
+	}
+	Memory__unlock(&span_lock);
+	if(span == 0) {
+		return -1;
+	}
+	uint32_t size = Memory__class_size(size_class);
+	span->size_class = size_class;
+	span->block_size = size;
+	MEMORY_BLOCK* list = 0;
+	uint32_t count = 0;
+	for(char* block = (char*)span + MEMORY_SPAN_SIZE - size;block >= (char*)span + MEMORY_SPAN_HEADER;block = block - size) {
+		((MEMORY_BLOCK*)block)->next = list;
+		list = (MEMORY_BLOCK*)block;
+		count++;
+	}
+	cache->lists[size_class] = list;
+	cache->counts[size_class] = count;
+	return 0;
+}
+
+static void Memory__release(MEMORY_CACHE* cache, int size_class) {
+	// Moves one batch from the front of a long list to the central list
+	MEMORY_BLOCK* batch = cache->lists[size_class];
+	MEMORY_BLOCK* last = batch;
+	for(int i = 1;i < MEMORY_BATCH;i++) {
+		last = last->next;
+	}
+	cache->lists[size_class] = last->next;
+	cache->counts[size_class] = cache->counts[size_class] - MEMORY_BATCH;
+	last->next = 0;
+	MEMORY_CENTRAL* central = &centrals[size_class];
+	Memory__lock(&central->lock);
+	batch->batch = central->batches;
+	central->batches = batch;
+	Memory__unlock(&central->lock);
+}
+
+static void* Memory__alloc(MEMORY_CACHE* cache, uint64_t size) {
+	if(size > MEMORY_SMALL_MAX) {
+		// Own mapping, span aligned so free finds the header
+		uint64_t length = (size + MEMORY_SPAN_HEADER + MEMORY_PAGE - 1) & ~(uint64_t)(MEMORY_PAGE - 1);
+		if(size > length) {
+			return 0;
+		}
+		MEMORY_SPAN* span = (MEMORY_SPAN*)Memory__map(length, MEMORY_SPAN_SIZE);
+		if(span == 0) {
+			return 0;
+		}
+		span->size_class = MEMORY_CLASS_LARGE;
+		span->mapping_size = length;
+		cache->large_used = cache->large_used + length;
+		cache->allocations++;
+		return (char*)span + MEMORY_SPAN_HEADER;
+	}
+	int size_class = Memory__class(size);
+	if(cache->lists[size_class] == 0 && Memory__refill(cache, size_class) != 0) {
+		return 0;
+	}
+	MEMORY_BLOCK* block = cache->lists[size_class];
+	cache->lists[size_class] = block->next;
+	cache->counts[size_class]--;
+	cache->small_used = cache->small_used + Memory__class_size(size_class);
+	cache->allocations++;
+	return block;
+}
+
+void* __chaos_alloc(uint64_t size) {
+	int worker = __chaos_worker();
+	MEMORY_CACHE* cache = Memory__enter(worker);
+	void* block = Memory__alloc(cache, size);
+	Memory__leave(worker);
+	return block;
+}
+
+void* __chaos_new(uint64_t size) {
+	void* block = __chaos_alloc(size);
+	if(block == 0) {
+		static const char message[] = "[ERROR] Out of memory.\n";
+		__chaos_out(2, message, sizeof(message) - 1);
+		__chaos_exit(1);
+	}
+	return block;
+}
+
+static void Memory__free(MEMORY_CACHE* cache, void* block) {
+	MEMORY_SPAN* span = (MEMORY_SPAN*)((uint64_t)block & ~(uint64_t)(MEMORY_SPAN_SIZE - 1));
+	cache->frees++;
+	if(span->size_class == MEMORY_CLASS_LARGE) {
+		cache->large_used = cache->large_used - span->mapping_size;
+		Memory__unmap(span, span->mapping_size);
+		return;
+	}
+	int size_class = span->size_class;
+	((MEMORY_BLOCK*)block)->next = cache->lists[size_class];
+	cache->lists[size_class] = block;
+	cache->small_used = cache->small_used - span->block_size;
+	if(++cache->counts[size_class] >= 2 * MEMORY_BATCH) {
+		Memory__release(cache, size_class);
+	}
+}
+
+void __chaos_free(void* block) {
+	if(block == 0) {
+		return;
+	}
+	int worker = __chaos_worker();
+	Memory__free(Memory__enter(worker), block);
+	Memory__leave(worker);
+}
+
+// Arenas
+
+static void Memory__arena_count(int64_t used, uint64_t resets) {
+	// Statistics only, the arena itself belongs to the caller
+	int worker = __chaos_worker();
+	MEMORY_CACHE* cache = Memory__enter(worker);
+	cache->arena_used += used;
+	cache->arena_resets += resets;
+	Memory__leave(worker);
+}
+
+static MEMORY_ARENA_CHUNK* Memory__chunk(uint64_t size) {
+	MEMORY_ARENA_CHUNK* chunk = (MEMORY_ARENA_CHUNK*)Memory__map(size, MEMORY_PAGE);
+	if(chunk != 0) {
+		chunk->next = 0;
+		chunk->size = size;
+	}
+	return chunk;
+}
+
+static void Memory__rewind(MEMORY_ARENA* arena) {
+	// The arena itself stays at the start of the first chunk
+	arena->current = arena->first;
+	arena->next = (char*)arena->first + ((sizeof(MEMORY_ARENA_CHUNK) + sizeof(MEMORY_ARENA) + 15) & ~15);
+	arena->end = (char*)arena->first + arena->first->size;
+	Memory__arena_count(-(int64_t)arena->used, 0);
+	arena->used = 0;
+}
+
+MEMORY_ARENA* __chaos_arena_create(void) {
+	MEMORY_ARENA_CHUNK* chunk = Memory__chunk(MEMORY_ARENA_FIRST);
+	if(chunk == 0) {
+		return 0;
+	}
+	MEMORY_ARENA* arena = (MEMORY_ARENA*)(chunk + 1);
+	arena->first = chunk;
+	arena->used = 0;
+	Memory__rewind(arena);
+	return arena;
+}
+
+void* __chaos_arena_alloc(MEMORY_ARENA* arena, uint64_t size) {
+	size = (size + 15) & ~(uint64_t)15;
+	while((uint64_t)(arena->end - arena->next) < size) {
+		// Next kept chunk, or a new one twice as big as the current (at least big enough)
+		MEMORY_ARENA_CHUNK* next = arena->current->next;
+		if(next == 0) {
+			uint64_t chunk_size = arena->current->size * 2;
+			while(chunk_size < size + sizeof(MEMORY_ARENA_CHUNK)) {
+				chunk_size = chunk_size * 2;
+			}
+			next = Memory__chunk(chunk_size);
+			if(next == 0) {
+				return 0;
+			}
+			arena->current->next = next;
+		}
+		arena->current = next;
+		arena->next = (char*)(next + 1);
+		arena->end = (char*)next + next->size;
+	}
+	void* block = arena->next;
+	arena->next = arena->next + size;
+	arena->used = arena->used + size;
+	Memory__arena_count((int64_t)size, 0);
+	return block;
+}
+
+void __chaos_arena_reset(MEMORY_ARENA* arena) {
+	Memory__rewind(arena);
+	Memory__arena_count(0, 1);
+}
+
+void __chaos_arena_destroy(MEMORY_ARENA* arena) {
+	Memory__arena_count(-(int64_t)arena->used, 0);
+	MEMORY_ARENA_CHUNK* chunk = arena->first;
+	while(chunk != 0) {
+		MEMORY_ARENA_CHUNK* next = chunk->next;
+		Memory__unmap(chunk, chunk->size);
+		chunk = next;
+	}
+}
+
+void __chaos_memory_stats(MEMORY_STATS* stats) {
+	// Sum of all workers, counters of running workers may be a little behind
+	int64_t small_used = 0, large_used = 0, arena_used = 0;
+	stats->allocations = 0;
+	stats->frees = 0;
+	stats->arena_resets = 0;
+	for(int i = 0;i < TASKS_MAX_WORKERS;i++) {
+		small_used = small_used + __atomic_load_n(&caches[i].small_used, __ATOMIC_RELAXED);
+		large_used = large_used + __atomic_load_n(&caches[i].large_used, __ATOMIC_RELAXED);
+		arena_used = arena_used + __atomic_load_n(&caches[i].arena_used, __ATOMIC_RELAXED);
+		stats->allocations = stats->allocations + __atomic_load_n(&caches[i].allocations, __ATOMIC_RELAXED);
+		stats->frees = stats->frees + __atomic_load_n(&caches[i].frees, __ATOMIC_RELAXED);
+		stats->arena_resets = stats->arena_resets + __atomic_load_n(&caches[i].arena_resets, __ATOMIC_RELAXED);
+	}
+	stats->mapped = __atomic_load_n(&mapped, __ATOMIC_RELAXED);
+	stats->small_used = (uint64_t)small_used;
+	stats->large_used = (uint64_t)large_used;
+	stats->arena_used = (uint64_t)arena_used;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Memory runtime (heap without libc, on mmap)
+//   Small blocks (up to MEMORY_SMALL_MAX bytes) are rounded up to one of
+//   MEMORY_CLASSES size classes: 16 byte steps up to 128, then four classes
+//   per power of two. They are cut from MEMORY_SPAN_SIZE spans that are
+//   aligned to their size, the span header holds the class, so free finds
+//   it from the address. Every task worker (see Runtime/Tasks/tasks.h) has
+//   its own free list per class, allocating and freeing only touches it.
+//   The worker comes from its thread slot (__chaos_worker), not from the
+//   stack, so coroutines allocate from the cache of the worker they run on.
+//   Lists move MEMORY_BATCH blocks at a time to and from a central list per
+//   class when they run empty or grow too long.
+//   Larger blocks get their own mapping (also span aligned).
+//   Arrays that escape their function (see Optimizer/Escape/escape.h) come
+//   from __chaos_new.
+//   Arenas hand out memory by moving a pointer through chunks, reset makes
+//   all of it free at once and keeps the chunks, destroy unmaps them.
+//   Threads of a host without a slot (TASKS_SHARED, a -shared library in a
+//   libc process) take turns on the cache of slot 0 under a lock.
+//   Like the rest of the runtime it is built by
+//     make runtime
+
+#define MEMORY_SPAN_SIZE (64 << 10)        // Power of 2
+#define MEMORY_SPAN_CHUNK (4 << 20)        // Spans are mapped this many bytes at once
+#define MEMORY_SMALL_MAX 8192
+#define MEMORY_CLASSES 32
+#define MEMORY_BATCH 32                    // Blocks moved between a worker and the central list
+#define MEMORY_ARENA_FIRST (64 << 10)      // First chunk of an arena, later chunks double
+
+#define MEMORY_NEW_SYMBOL "__chaos_new"
+
+typedef struct _MEMORY_ARENA_CHUNK_ {
+	struct _MEMORY_ARENA_CHUNK_* next;
+	uint64_t size;                         // Mapping size (this header included)
+} MEMORY_ARENA_CHUNK;
+
+typedef struct _MEMORY_ARENA_ {
+	MEMORY_ARENA_CHUNK* first;             // Holds the arena itself
+	MEMORY_ARENA_CHUNK* current;
+	char* next;                            // Next free byte in current
+	char* end;
+	uint64_t used;                         // Bytes handed out since the last reset
+} MEMORY_ARENA;
+
+typedef struct _MEMORY_STATS_ {
+	uint64_t mapped;                       // Bytes mapped for spans, large blocks and arenas
+	uint64_t small_used;                   // Bytes of small blocks in use (class sizes)
+	uint64_t large_used;                   // Bytes of large blocks in use (mapping sizes)
+	uint64_t arena_used;                   // Bytes handed out by arenas since their last reset
+	uint64_t allocations;
+	uint64_t frees;
+	uint64_t arena_resets;
+} MEMORY_STATS;
+
+void* __chaos_alloc(uint64_t size);          // 16 byte aligned, NULL when out of memory
+void* __chaos_new(uint64_t size);            // __chaos_alloc of generated code (arrays that escape), exits when out of memory
+void __chaos_free(void* block);              // NULL is ignored
+MEMORY_ARENA* __chaos_arena_create(void);
+void* __chaos_arena_alloc(MEMORY_ARENA* arena, uint64_t size);
+void __chaos_arena_reset(MEMORY_ARENA* arena);
+void __chaos_arena_destroy(MEMORY_ARENA* arena);
+void __chaos_memory_stats(MEMORY_STATS* stats);
@@ -0,0 +1,54 @@
+#include "profile.h"
+#include "./../IO/io.h"
+
+// System calls (x86_64 Linux)
+#define PROFILE_SYS_WRITEV 20
+#define PROFILE_SYS_CLOSE 3
+#define PROFILE_SYS_OPENAT 257
+#define PROFILE_EINTR 4
+#define PROFILE_AT_FDCWD -100
+#define PROFILE_O_CREATE 01101             // O_WRONLY | O_CREAT | O_TRUNC
+
+typedef struct _PROFILE_VECTOR_ {
+	const void* base;
+	uint64_t size;
+} PROFILE_VECTOR;
+
+static long Profile__syscall(long number, long a, long b, long c, long d) {
+	register long r10 __asm__("r10") = d;
+	long ret;
+	__asm__ volatile("syscall" : "=a"(ret) : "a"(number), "D"(a), "S"(b), "d"(c), "r"(r10) : "rcx", "r11", "memory");
+	return ret;
+}
+
+long __chaos_profile_write(const char* path, const PROFILE_HEADER* meta, const PROFILE_COUNTER* counters) {
+	long fd = Profile__syscall(PROFILE_SYS_OPENAT, PROFILE_AT_FDCWD, (long)path, PROFILE_O_CREATE, 0644);
+	if(fd < 0) {
+		static const char message[] = "[ERROR] Could not write the profile.\n";
+		__chaos_out(2, message, sizeof(message) - 1);
+		return fd;
+	}
+	PROFILE_VECTOR vectors[2] = {
+		{ meta, sizeof(PROFILE_HEADER) + meta->edge_count * sizeof(PROFILE_EDGE) + meta->names_size },
+		{ counters, (uint64_t)(meta->function_count + meta->edge_count) * sizeof(PROFILE_COUNTER) },
+	};
+	long ret = 0;
+	for(int i = 0;i < 2 && ret >= 0;) {
+		// Short writes continue where they stopped
+		ret = Profile__syscall(PROFILE_SYS_WRITEV, fd, (long)&vectors[i], 2 - i, 0);
+		if(ret == -PROFILE_EINTR) {
+			ret = 0;
+			continue;
+		}
+		while(i < 2 && ret >= 0 && (uint64_t)ret >= vectors[i].size) {
+			ret = ret - vectors[i].size;
+			i++;
+		}
+		if(i < 2 && ret > 0) {
+			vectors[i].base = (const char*)vectors[i].base + ret;
+			vectors[i].size = vectors[i].size - ret;
+		}
+	}
+	Profile__syscall(PROFILE_SYS_CLOSE, fd, 0, 0, 0);
+	return ret < 0 ? ret : 0;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Function profile (-finstrument[=<file>])
+//   Instrumented executables count the calls and rdtsc cycles of every
+//   function and of every caller -> callee edge in a table of
+//   PROFILE_COUNTER in .bss, which the generated code updates inline (no
+//   calls). Cycles of a function run from its entry to its return or tail
+//   jump, cycles of an edge from the call to the return, so the self time
+//   of a function is its cycles minus the ones of its outgoing edges.
+//   _start passes the table and its description in .rodata to
+//   __chaos_profile_write after main returned, which writes the file:
+//     PROFILE_HEADER
+//     PROFILE_EDGE[edge_count]
+//     names (symbol_count strings, 0 terminated, functions first, padded to 8 bytes)
+//     PROFILE_COUNTER[function_count + edge_count]
+//   The compiler prints it with --profile-report <file> [--call-graph].
+
+#define PROFILE_MAGIC "CHAOSPRF"
+#define PROFILE_VERSION 1
+#define PROFILE_DEFAULT_FILE "chaos.prof"
+
+#define PROFILE_WRITE_SYMBOL "__chaos_profile_write"
+#define PROFILE_COUNTERS_SYMBOL "__chaos_profile_counters"
+#define PROFILE_META_SYMBOL "__chaos_profile_meta"
+#define PROFILE_PATH_SYMBOL "__chaos_profile_path"
+
+typedef struct _PROFILE_HEADER_ {
+	char magic[8];
+	uint32_t version;
+	uint32_t function_count;           // Functions of the program (counters 0 to function_count - 1)
+	uint32_t symbol_count;             // Functions and the external functions they call
+	uint32_t edge_count;
+	uint32_t names_size;               // Bytes of the names with the padding
+	uint32_t reserved;
+} PROFILE_HEADER;
+
+typedef struct _PROFILE_EDGE_ {
+	uint32_t caller;                   // Function
+	uint32_t callee;                   // Symbol
+} PROFILE_EDGE;
+
+typedef struct _PROFILE_COUNTER_ {
+	uint64_t calls;
+	uint64_t cycles;
+} PROFILE_COUNTER;
+
+long __chaos_profile_write(const char* path, const PROFILE_HEADER* meta, const PROFILE_COUNTER* counters);
@@ -0,0 +1,455 @@
+#include "tasks.h"
+
+// System calls (x86_64 Linux)
+#define TASKS_SYS_READ 0
+#define TASKS_SYS_CLOSE 3
+#define TASKS_SYS_MMAP 9
+#define TASKS_SYS_MPROTECT 10
+#define TASKS_SYS_WRITE 1
+#define TASKS_SYS_CLONE 56
+#define TASKS_SYS_FUTEX 202
+#define TASKS_SYS_SCHED_GETAFFINITY 204
+#define TASKS_SYS_EXIT 60
+#define TASKS_SYS_EXIT_GROUP 231
+#define TASKS_SYS_ARCH_PRCTL 158
+#define TASKS_SYS_OPENAT 257
+#define TASKS_ARCH_SET_GS 0x1001
+#define TASKS_ARCH_GET_FS 0x1003
+#define TASKS_ARCH_GET_GS 0x1004
+#define TASKS_AT_FDCWD -100
+#define TASKS_AT_HWCAP2 26
+#define TASKS_HWCAP2_FSGSBASE 2
+#define TASKS_CLONE_FLAGS 0x50f00       // VM | FS | FILES | SIGHAND | THREAD | SYSVSEM
+#define TASKS_FUTEX_WAIT 128            // FUTEX_WAIT | FUTEX_PRIVATE_FLAG
+#define TASKS_FUTEX_WAKE 129
+#define TASKS_SLAB_SIZE 65536           // Tasks are allocated in slabs of this size
+
+static TASK_WORKER* workers;
+static int worker_count;
+static int started;                     // 0 = no, 1 = starting, 2 = running
+static int wake;                        // Futex, changes when sleeping workers should look for work
+static int sleepers;
+static int mode;                        // 0 = not known yet, TASKS_MODE_FREESTANDING or TASKS_MODE_HOSTED
+static bool gs_readable;                // rdgsbase works (hosted only)
+static int shared_lock;                 // workers[0] of the threads without a slot (hosted only)
+
+enum TASKS_MODE {
+	TASKS_MODE_FREESTANDING = 1,        // Only the runtime starts threads, the first one is worker 0
+	TASKS_MODE_HOSTED = 2               // Loaded into a libc process, its threads share workers[0]
+};
+
+static long Tasks__syscall(long number, long a, long b, long c, long d, long e, long f) {
+	register long r10 __asm__("r10") = d;
+	register long r8 __asm__("r8") = e;
+	register long r9 __asm__("r9") = f;
+	long ret;
+	__asm__ volatile("syscall" : "=a"(ret) : "a"(number), "D"(a), "S"(b), "d"(c), "r"(r10), "r"(r8), "r"(r9) : "rcx", "r11", "memory");
+	return ret;
+}
+
+static void Tasks__fail(const char* message, int length) {
+	Tasks__syscall(TASKS_SYS_WRITE, 2, (long)message, length, 0, 0, 0);
+	Tasks__syscall(TASKS_SYS_EXIT_GROUP, 1, 0, 0, 0, 0, 0);
+	__builtin_unreachable();
+}
+
+static void* Tasks__map(uint64_t size) {
+	long ret = Tasks__syscall(TASKS_SYS_MMAP, 0, (long)size, 3, 0x22, -1, 0); // RW, private anonymous
+	if(ret < 0 && ret > -4096) {
+		return 0;
+	}
+	return (void*)ret;
+}
+
+void Tasks__lock(int* lock) {
+	// 0 = free, 1 = taken, 2 = taken and somebody waits
+	int state = 0;
+	if(__atomic_compare_exchange_n(lock, &state, 1, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+		return;
+	}
+	if(state != 2) {
+		state = __atomic_exchange_n(lock, 2, __ATOMIC_ACQUIRE);
+	}
+	while(state != 0) {
+		Tasks__syscall(TASKS_SYS_FUTEX, (long)lock, TASKS_FUTEX_WAIT, 2, 0, 0, 0);
+		state = __atomic_exchange_n(lock, 2, __ATOMIC_ACQUIRE);
+	}
+}
+
+void Tasks__unlock(int* lock) {
+	if(__atomic_exchange_n(lock, 0, __ATOMIC_RELEASE) == 2) {
+		Tasks__syscall(TASKS_SYS_FUTEX, (long)lock, TASKS_FUTEX_WAKE, 1, 0, 0, 0);
+	}
+}
+
+static int Tasks__mode(void) {
+	int known = __atomic_load_n(&mode, __ATOMIC_ACQUIRE);
+	if(known != 0) {
+		return known;
+	}
+	// Only a libc sets fs, a program of the compiler starts without it
+	uint64_t fs = 0;
+	Tasks__syscall(TASKS_SYS_ARCH_PRCTL, TASKS_ARCH_GET_FS, (long)&fs, 0, 0, 0, 0);
+	if(fs != 0) {
+		// rdgsbase if the kernel allows it (AT_HWCAP2), otherwise arch_prctl reads gs
+		uint64_t auxv[128] = {0};
+		long fd = Tasks__syscall(TASKS_SYS_OPENAT, TASKS_AT_FDCWD, (long)"/proc/self/auxv", 0, 0, 0, 0);
+		if(fd >= 0) {
+			long size = Tasks__syscall(TASKS_SYS_READ, fd, (long)auxv, sizeof(auxv) - 16, 0, 0, 0);
+			Tasks__syscall(TASKS_SYS_CLOSE, fd, 0, 0, 0, 0, 0);
+			for(long i = 0;size > 0 && i < size / 8 && auxv[i] != 0;i = i + 2) {
+				if(auxv[i] == TASKS_AT_HWCAP2) {
+					__atomic_store_n(&gs_readable, (auxv[i + 1] & TASKS_HWCAP2_FSGSBASE) != 0, __ATOMIC_RELAXED);
+				}
+			}
+		}
+	}
+	known = fs != 0 ? TASKS_MODE_HOSTED : TASKS_MODE_FREESTANDING;
+	__atomic_store_n(&mode, known, __ATOMIC_RELEASE);
+	return known;
+}
+
+bool Tasks__hosted(void) {
+	return Tasks__mode() == TASKS_MODE_HOSTED;
+}
+
+// Chase-Lev deque ("Dynamic Circular Work-Stealing Deque", fixed size)
+
+static int Tasks__push(TASK_DEQUE* deque, TASK* task) {
+	int64_t bottom = __atomic_load_n(&deque->bottom, __ATOMIC_RELAXED);
+	int64_t top = __atomic_load_n(&deque->top, __ATOMIC_ACQUIRE);
+	if(bottom - top >= TASKS_DEQUE_SIZE) {
+		return -1;
+	}
+	__atomic_store_n(&deque->tasks[bottom & (TASKS_DEQUE_SIZE - 1)], task, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	__atomic_store_n(&deque->bottom, bottom + 1, __ATOMIC_RELAXED);
+	return 0;
+}
+
+static TASK* Tasks__pop(TASK_DEQUE* deque) {
+	int64_t bottom = __atomic_load_n(&deque->bottom, __ATOMIC_RELAXED) - 1;
+	__atomic_store_n(&deque->bottom, bottom, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	int64_t top = __atomic_load_n(&deque->top, __ATOMIC_RELAXED);
+	if(top > bottom) {
+		// Empty
+		__atomic_store_n(&deque->bottom, bottom + 1, __ATOMIC_RELAXED);
+		return 0;
+	}
+	TASK* task = __atomic_load_n(&deque->tasks[bottom & (TASKS_DEQUE_SIZE - 1)], __ATOMIC_RELAXED);
+	if(top == bottom) {
+		// Last task, a thief may take it at the same time
+		if(!__atomic_compare_exchange_n(&deque->top, &top, top + 1, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+			task = 0;
+		}
+		__atomic_store_n(&deque->bottom, bottom + 1, __ATOMIC_RELAXED);
+	}
+	return task;
+}
+
+static TASK* Tasks__steal(TASK_DEQUE* deque) {
+	int64_t top = __atomic_load_n(&deque->top, __ATOMIC_ACQUIRE);
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	int64_t bottom = __atomic_load_n(&deque->bottom, __ATOMIC_ACQUIRE);
+	if(top >= bottom) {
+		return 0;
+	}
+	TASK* task = __atomic_load_n(&deque->tasks[top & (TASKS_DEQUE_SIZE - 1)], __ATOMIC_RELAXED);
+	if(!__atomic_compare_exchange_n(&deque->top, &top, top + 1, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+		// Lost against the owner or another thief
+		return 0;
+	}
+	return task;
+}
+
+// Workers
+
+static void Tasks__bind(TASK_WORKER* self) {
+	// The calling thread is this worker from now on
+	self->self = self;
+	if(Tasks__syscall(TASKS_SYS_ARCH_PRCTL, TASKS_ARCH_SET_GS, (long)self, 0, 0, 0, 0) < 0) {
+		Tasks__fail("[ERROR] Could not set the thread slot of a task worker.\n", 56);
+	}
+}
+
+static TASK_WORKER* Tasks__self(void) {
+	// Only valid in bound threads (the workers and the thread that started them)
+	TASK_WORKER* self;
+	__asm__ volatile("movq %%gs:%c1, %0" : "=r"(self) : "i"(__builtin_offsetof(TASK_WORKER, self)));
+	return self;
+}
+
+static TASK_WORKER* Tasks__hosted_self(void) {
+	// Threads of the libc have no gs base, only the ones the runtime started are workers
+	if(__atomic_load_n(&started, __ATOMIC_ACQUIRE) != 2) {
+		return 0;
+	}
+	uint64_t base = 0;
+	if(__atomic_load_n(&gs_readable, __ATOMIC_RELAXED)) {
+		__asm__ volatile("rdgsbase %0" : "=r"(base));
+	}
+	else {
+		Tasks__syscall(TASKS_SYS_ARCH_PRCTL, TASKS_ARCH_GET_GS, (long)&base, 0, 0, 0, 0);
+	}
+	if(base < (uint64_t)workers || base >= (uint64_t)(workers + worker_count)) {
+		return 0;
+	}
+	return (TASK_WORKER*)base;
+}
+
+static void Tasks__run(TASK* task) {
+	task->result = task->function();
+	__atomic_store_n(&task->done, 1, __ATOMIC_RELEASE);
+}
+
+static TASK* Tasks__find(TASK_WORKER* self) {
+	TASK* task = Tasks__pop(&self->deque);
+	for(int i = 0;task == 0 && i < worker_count;i++) {
+		self->random ^= self->random << 13;
+		self->random ^= self->random >> 7;
+		self->random ^= self->random << 17;
+		int victim = (int)(self->random % (uint64_t)worker_count);
+		if(victim != self->index) {
+			task = Tasks__steal(&workers[victim].deque);
+		}
+	}
+	return task;
+}
+
+static bool Tasks__pending(void) {
+	for(int i = 0;i < worker_count;i++) {
+		if(__atomic_load_n(&workers[i].deque.top, __ATOMIC_SEQ_CST) < __atomic_load_n(&workers[i].deque.bottom, __ATOMIC_SEQ_CST)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static __attribute__((noreturn)) void Tasks__thread(TASK_WORKER* self) {
+	Tasks__bind(self);
+	int idle = 0;
+	while(true) {
+		TASK* task = Tasks__find(self);
+		if(task != 0) {
+			Tasks__run(task);
+			idle = 0;
+			continue;
+		}
+		if(++idle < TASKS_SPIN) {
+			__builtin_ia32_pause();
+			continue;
+		}
+		// Sleep until something is spawned (rechecked after registering, see __chaos_spawn)
+		int seen = __atomic_load_n(&wake, __ATOMIC_SEQ_CST);
+		__atomic_add_fetch(&sleepers, 1, __ATOMIC_SEQ_CST);
+		if(!Tasks__pending()) {
+			Tasks__syscall(TASKS_SYS_FUTEX, (long)&wake, TASKS_FUTEX_WAIT, seen, 0, 0, 0);
+		}
+		__atomic_sub_fetch(&sleepers, 1, __ATOMIC_SEQ_CST);
+		idle = 0;
+	}
+}
+
+static long Tasks__clone(char* stack_top, TASK_WORKER* worker) {
+	// The new thread takes its entry and argument from its stack
+	void** top = (void**)stack_top;
+	top[-2] = (void*)Tasks__thread;
+	top[-1] = worker;
+	register long r10 __asm__("r10") = 0;
+	register long r8 __asm__("r8") = 0;
+	long ret;
+	__asm__ volatile(
+		"syscall\n\t"
+		"test %%rax, %%rax\n\t"
+		"jnz 1f\n\t"
+		"xor %%ebp, %%ebp\n\t"
+		"pop %%rax\n\t"
+		"pop %%rdi\n\t"
+		"call *%%rax\n\t"
+		"mov $60, %%eax\n\t"
+		"xor %%edi, %%edi\n\t"
+		"syscall\n\t"
+		"1:"
+		: "=a"(ret)
+		: "a"((long)TASKS_SYS_CLONE), "D"((long)TASKS_CLONE_FLAGS), "S"(top - 2), "d"(0L), "r"(r10), "r"(r8)
+		: "rcx", "r11", "memory");
+	return ret;
+}
+
+static void Tasks__start(void) {
+	int expected = 0;
+	if(!__atomic_compare_exchange_n(&started, &expected, 1, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+		while(__atomic_load_n(&started, __ATOMIC_ACQUIRE) != 2) {
+			__builtin_ia32_pause();
+		}
+		return;
+	}
+
+	// One worker per CPU this process may run on
+	uint64_t mask[16] = {0};
+	long size = Tasks__syscall(TASKS_SYS_SCHED_GETAFFINITY, 0, sizeof(mask), (long)mask, 0, 0, 0);
+	int count = 0;
+	for(long i = 0;i < size / 8;i++) {
+		// No popcnt, the runtime is built for any x86_64
+		for(uint64_t bits = mask[i];bits != 0;bits = bits & (bits - 1)) {
+			count++;
+		}
+	}
+	if(count < 1) {
+		count = 1;
+	}
+	if(count > TASKS_MAX_WORKERS) {
+		count = TASKS_MAX_WORKERS;
+	}
+
+	int current = Tasks__mode();
+	workers = Tasks__map(count * sizeof(TASK_WORKER));
+	if(workers == 0) {
+		Tasks__fail("[ERROR] Could not allocate task workers.\n", 41);
+	}
+	for(int i = 0;i < count;i++) {
+		workers[i].index = i;
+		workers[i].random = 0x9e3779b97f4a7c15ull * (i + 1);
+	}
+	if(current == TASKS_MODE_FREESTANDING) {
+		// Threads of a host keep their gs, workers[0] is shared by all of them
+		Tasks__bind(&workers[0]);
+	}
+	char* stacks = 0;                   // Stacks of the workers 1 .. count - 1
+	if(count > 1) {
+		// The lowest page of every stack is a guard
+		stacks = Tasks__map((uint64_t)(count - 1) * TASKS_STACK_SIZE);
+		if(stacks == 0) {
+			Tasks__fail("[ERROR] Could not allocate task stacks.\n", 40);
+		}
+	}
+	worker_count = count;
+	for(int i = 1;i < count;i++) {
+		char* stack = stacks + (uint64_t)(i - 1) * TASKS_STACK_SIZE;
+		Tasks__syscall(TASKS_SYS_MPROTECT, (long)stack, 4096, 0, 0, 0, 0);
+		if(Tasks__clone(stack + TASKS_STACK_SIZE, &workers[i]) < 0) {
+			Tasks__fail("[ERROR] Could not start a task worker.\n", 39);
+		}
+	}
+	__atomic_store_n(&started, 2, __ATOMIC_RELEASE);
+}
+
+static TASK* Tasks__allocate(TASK_WORKER* self) {
+	TASK* slab = Tasks__map(TASKS_SLAB_SIZE);
+	if(slab == 0) {
+		Tasks__fail("[ERROR] Could not allocate tasks.\n", 34);
+	}
+	int count = TASKS_SLAB_SIZE / sizeof(TASK);
+	for(int i = 1;i < count - 1;i++) {
+		slab[i].next = &slab[i + 1];
+	}
+	slab[count - 1].next = self->free;
+	self->free = &slab[1];
+	return &slab[0];
+}
+
+static bool Tasks__queue(TASK_WORKER* self, TASK* task, TASK_FUNCTION function) {
+	// False if the deque is full, the caller runs the task then
+	task->function = function;
+	task->done = 0;
+	return Tasks__push(&self->deque, task) == 0;
+}
+
+static TASK* Tasks__submit(TASK* task, bool queued) {
+	if(!queued) {
+		Tasks__run(task);
+		return task;
+	}
+	// Wake a sleeping worker (it registers before it checks the deques)
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	if(__atomic_load_n(&sleepers, __ATOMIC_SEQ_CST) > 0) {
+		__atomic_add_fetch(&wake, 1, __ATOMIC_SEQ_CST);
+		Tasks__syscall(TASKS_SYS_FUTEX, (long)&wake, TASKS_FUTEX_WAKE, 1, 0, 0, 0);
+	}
+	return task;
+}
+
+int __chaos_worker(void) {
+	if(Tasks__mode() == TASKS_MODE_FREESTANDING) {
+		// Before the first spawn only the main thread runs
+		if(__atomic_load_n(&started, __ATOMIC_ACQUIRE) != 2) {
+			return 0;
+		}
+		return Tasks__self()->index;
+	}
+	TASK_WORKER* self = Tasks__hosted_self();
+	return self != 0 ? self->index : TASKS_SHARED;
+}
+
+static TASK_WORKER* Tasks__enter(void) {
+	// Worker of the calling thread, workers[0] is locked for threads without one
+	if(__atomic_load_n(&started, __ATOMIC_ACQUIRE) != 2) {
+		Tasks__start();
+	}
+	int worker = __chaos_worker();
+	if(worker == TASKS_SHARED) {
+		Tasks__lock(&shared_lock);
+		return &workers[0];
+	}
+	return &workers[worker];
+}
+
+static void Tasks__leave(TASK_WORKER* self) {
+	// workers[0] of a hosted runtime belongs to no thread
+	if(self->index == 0 && __atomic_load_n(&mode, __ATOMIC_RELAXED) == TASKS_MODE_HOSTED) {
+		Tasks__unlock(&shared_lock);
+	}
+}
+
+TASK* __chaos_spawn(TASK_FUNCTION function) {
+	TASK_WORKER* self = Tasks__enter();
+	TASK* task = self->free;
+	if(task != 0) {
+		self->free = task->next;
+	}
+	else {
+		task = Tasks__allocate(self);
+	}
+	bool queued = Tasks__queue(self, task, function);
+	Tasks__leave(self);
+	return Tasks__submit(task, queued);
+}
+
+TASK* __chaos_spawn_at(TASK* task, TASK_FUNCTION function) {
+	TASK_WORKER* self = Tasks__enter();
+	bool queued = Tasks__queue(self, task, function);
+	Tasks__leave(self);
+	return Tasks__submit(task, queued);
+}
+
+static void Tasks__wait(TASK* task) {
+	// Run other tasks until this one is done (never with workers[0] locked)
+	while(!__atomic_load_n(&task->done, __ATOMIC_ACQUIRE)) {
+		TASK_WORKER* self = Tasks__enter();
+		TASK* other = Tasks__find(self);
+		Tasks__leave(self);
+		if(other != 0) {
+			Tasks__run(other);
+		}
+		else {
+			__builtin_ia32_pause();
+		}
+	}
+}
+
+int __chaos_join(TASK* task) {
+	Tasks__wait(task);
+	int result = task->result;
+	TASK_WORKER* self = Tasks__enter();
+	task->next = self->free;
+	self->free = task;
+	Tasks__leave(self);
+	return result;
+}
+
+int __chaos_join_at(TASK* task) {
+	// Nothing touches the task after done, the caller may reuse its memory
+	Tasks__wait(task);
+	return task->result;
+}
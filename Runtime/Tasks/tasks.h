@@ -0,0 +1,81 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Task runtime (linked into programs that use spawn/join)
+//   int handle = spawn function;    handle = __chaos_spawn(function)
+//   int result = join handle;       result = __chaos_join(handle)
+//   A fixed pool of workers (one per CPU, at most TASKS_MAX_WORKERS) is
+//   started with clone on the first spawn. Every worker owns a Chase-Lev
+//   deque: it pushes and pops at the bottom, idle workers steal from the
+//   top of the others. In programs of the compiler the thread that calls
+//   spawn first is worker 0.
+//   Spawning costs a task from a free list and a deque push. Joining runs
+//   other tasks until the result is there. Workers without work spin for a
+//   while and then sleep on a futex until something is spawned.
+//   Every worker finds itself through its thread slot: the gs base points
+//   at its TASK_WORKER (set with arch_prctl when it starts), so code on any
+//   stack, a coroutine stack too, gets the right worker. fs stays with the
+//   thread local storage of libc.
+//   Loaded into a libc process (a -shared library, fs is set) the threads
+//   of the host have no slot: __chaos_worker returns TASKS_SHARED for them,
+//   they spawn and join through workers[0] under a lock and the runtime
+//   only starts the workers 1 .. count - 1. Hosted gs is read with rdgsbase,
+//   or arch_prctl where the kernel does not allow it. Host threads started
+//   from inside a task inherit the gs of its worker and must not call in.
+//   Freestanding (raw system calls, no libc): build it with
+//     make runtime
+//   Programs exit with exit_group, which also ends the workers.
+//   __chaos_spawn_at/__chaos_join_at run a task whose record the caller
+//   owns (a frame slot, see Optimizer/Escape/escape.h): joining does not
+//   put it on the free list and nothing touches it after it is done.
+
+#define TASKS_MAX_WORKERS 64
+#define TASKS_DEQUE_SIZE 4096           // Power of 2, a full deque runs the task at once
+#define TASKS_STACK_SIZE (1 << 20)      // Worker stacks
+#define TASKS_SPIN 4096                 // Failed steal rounds before a worker sleeps
+#define TASKS_SHARED -1                 // __chaos_worker of threads without a slot
+
+#define TASKS_SPAWN_SYMBOL "__chaos_spawn"
+#define TASKS_JOIN_SYMBOL "__chaos_join"
+#define TASKS_SPAWN_AT_SYMBOL "__chaos_spawn_at"
+#define TASKS_JOIN_AT_SYMBOL "__chaos_join_at"
+#define TASKS_RUNTIME_DEFAULT "./build/ChaosLangCompiler/chaosrt.o"
+
+typedef int (*TASK_FUNCTION)(void);
+
+typedef struct _TASK_ {
+	TASK_FUNCTION function;
+	int result;
+	int done;                           // Set (release) after result
+	struct _TASK_* next;                // Free list
+} TASK;
+
+typedef struct _TASK_DEQUE_ {
+	int64_t top;                        // Thieves take from here
+	char padding[56];
+	int64_t bottom;                     // Owner pushes and pops here
+	char padding2[56];
+	TASK* tasks[TASKS_DEQUE_SIZE];
+} TASK_DEQUE;
+
+typedef struct _TASK_WORKER_ {
+	TASK_DEQUE deque;
+	TASK* free;                         // Only used by the owner
+	uint64_t random;                    // Victim selection (xorshift)
+	int index;
+	struct _TASK_WORKER_* self;         // Read through gs, see Tasks__self
+} TASK_WORKER;
+
+TASK* __chaos_spawn(TASK_FUNCTION function);
+int __chaos_join(TASK* task);
+TASK* __chaos_spawn_at(TASK* task, TASK_FUNCTION function);
+int __chaos_join_at(TASK* task);
+int __chaos_worker(void);                // Index of the calling worker (0 before the first spawn) or TASKS_SHARED
+
+// Futex lock of the runtime parts, threads without a slot (TASKS_SHARED)
+// take turns on slot 0 with it
+void Tasks__lock(int* lock) __attribute__((visibility("hidden")));
+void Tasks__unlock(int* lock) __attribute__((visibility("hidden")));
+bool Tasks__hosted(void) __attribute__((visibility("hidden")));     // Loaded into a libc process
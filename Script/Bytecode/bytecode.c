@@ -0,0 +1,674 @@
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "bytecode.h"
+
+#define C compiler
+
+typedef struct _SCRIPT_VALUE_ {
+	bool constant;                     // Folded, nothing emitted yet
+	int64_t value;
+	int reg;
+	bool temp;                         // reg is a temporary owned by the value
+} SCRIPT_VALUE;
+
+typedef struct _BYTECODE_STATE_ {
+	COMPILER* compiler;
+	const BYTECODE_SOURCE* source;
+	int position;                      // Index into source->tokens
+	const char* names[SCRIPT_MAX_REGISTERS]; // Variable in every register, NULL = temporary
+	bool used[SCRIPT_MAX_REGISTERS];
+	int registers;
+	int inputs;
+	uint32_t* code;
+	uint32_t code_count;
+	uint32_t code_capacity;
+	int64_t* constants;
+	uint32_t constant_count;
+	uint32_t constant_capacity;
+	bool failed;                       // An error was printed
+} BYTECODE_STATE;
+
+static int Bytecode__expression(BYTECODE_STATE* state, SCRIPT_VALUE* value);
+static int Bytecode__statement(BYTECODE_STATE* state);
+
+static const char* Bytecode__token(BYTECODE_STATE* state) {
+	COMPILER* compiler = state->compiler;
+	if(state->position >= state->source->count) {
+		return "";
+	}
+	return C->tokens[state->source->tokens[state->position]].str;
+}
+
+static bool Bytecode__accept(BYTECODE_STATE* state, const char* str) {
+	if(strcmp(Bytecode__token(state), str) == 0) {
+		state->position++;
+		return true;
+	}
+	return false;
+}
+
+static int Bytecode__error(BYTECODE_STATE* state, const char* message) {
+	// Only the first error, the ones after it are caused by it
+	COMPILER* compiler = state->compiler;
+	if(!state->failed) {
+		if(state->position < state->source->count) {
+			Token* token = &C->tokens[state->source->tokens[state->position]];
+			printf("[ERROR] %s: %s at %d:%d (\"%s\").\n", state->source->name, message, token->line, token->column, token->str);
+		}
+		else {
+			printf("[ERROR] %s: %s at the end.\n", state->source->name, message);
+		}
+	}
+	state->failed = true;
+	return -1;
+}
+
+static int Bytecode__expect(BYTECODE_STATE* state, const char* str) {
+	if(Bytecode__accept(state, str)) {
+		return 0;
+	}
+	char message[64];
+	snprintf(message, sizeof(message), "expected \"%s\"", str);
+	return Bytecode__error(state, message);
+}
+
+static int Bytecode__emit(BYTECODE_STATE* state, uint32_t instruction) {
+	if(state->code_count == state->code_capacity) {
+		uint32_t capacity = state->code_capacity ? state->code_capacity * 2 : 64;
+		uint32_t* code = realloc(state->code, capacity * sizeof(uint32_t));
+		if(code == NULL) {
+			printf("[ERROR] Could not allocate script bytecode.\n");
+			state->failed = true;
+			return -1;
+		}
+		state->code = code;
+		state->code_capacity = capacity;
+	}
+	state->code[state->code_count++] = instruction;
+	return 0;
+}
+
+static int Bytecode__patch(BYTECODE_STATE* state, uint32_t jump, uint32_t target) {
+	// Jump offsets are relative to the next instruction
+	int64_t offset = (int64_t)target - ((int64_t)jump + 1);
+	if(offset < INT16_MIN || offset > INT16_MAX) {
+		return Bytecode__error(state, "jump is too far (more than 32767 instructions)");
+	}
+	state->code[jump] = (state->code[jump] & 0xFFFF) | (uint32_t)(uint16_t)offset << 16;
+	return 0;
+}
+
+static int Bytecode__allocate(BYTECODE_STATE* state, const char* name) {
+	// Lowest free register
+	for(int reg = 0;reg < SCRIPT_MAX_REGISTERS;reg++) {
+		if(!state->used[reg]) {
+			state->used[reg] = true;
+			state->names[reg] = name;
+			if(reg >= state->registers) {
+				state->registers = reg + 1;
+			}
+			return reg;
+		}
+	}
+	return Bytecode__error(state, "more than 256 variables and temporaries");
+}
+
+static void Bytecode__release(BYTECODE_STATE* state, SCRIPT_VALUE* value) {
+	if(!value->constant && value->temp) {
+		state->used[value->reg] = false;
+	}
+}
+
+static int Bytecode__variable(BYTECODE_STATE* state, const char* name) {
+	for(int reg = 0;reg < state->registers;reg++) {
+		if(state->used[reg] && state->names[reg] != NULL && strcmp(state->names[reg], name) == 0) {
+			return reg;
+		}
+	}
+	return -1;
+}
+
+static int Bytecode__load(BYTECODE_STATE* state, int reg, int64_t value) {
+	if(value >= INT16_MIN && value <= INT16_MAX) {
+		return Bytecode__emit(state, SCRIPT_ENCODE_WIDE(SCRIPT_OP_LOADI, reg, value));
+	}
+	uint32_t index = 0;
+	while(index < state->constant_count && state->constants[index] != value) {
+		index++;
+	}
+	if(index == state->constant_count) {
+		if(index > 0xFFFF) {
+			return Bytecode__error(state, "more than 65536 constants");
+		}
+		if(state->constant_count == state->constant_capacity) {
+			uint32_t capacity = state->constant_capacity ? state->constant_capacity * 2 : 16;
+			int64_t* constants = realloc(state->constants, capacity * sizeof(int64_t));
+			if(constants == NULL) {
+				printf("[ERROR] Could not allocate script constants.\n");
+				state->failed = true;
+				return -1;
+			}
+			state->constants = constants;
+			state->constant_capacity = capacity;
+		}
+		state->constants[state->constant_count++] = value;
+	}
+	return Bytecode__emit(state, SCRIPT_ENCODE_WIDE(SCRIPT_OP_LOADK, reg, index));
+}
+
+static int Bytecode__register(BYTECODE_STATE* state, SCRIPT_VALUE* value) {
+	// Register of the value, constants are loaded into a temporary
+	if(value->constant) {
+		int reg = Bytecode__allocate(state, NULL);
+		if(reg < 0 || Bytecode__load(state, reg, value->value) != 0) {
+			return -1;
+		}
+		value->constant = false;
+		value->reg = reg;
+		value->temp = true;
+	}
+	return value->reg;
+}
+
+static int Bytecode__fold(BYTECODE_STATE* state, uint8_t op, int64_t left, int64_t right, int64_t* result) {
+	// Same results as the virtual machine
+	switch(op) {
+		case SCRIPT_OP_ADD: *result = (int64_t)((uint64_t)left + (uint64_t)right); break;
+		case SCRIPT_OP_SUB: *result = (int64_t)((uint64_t)left - (uint64_t)right); break;
+		case SCRIPT_OP_MUL: *result = (int64_t)((uint64_t)left * (uint64_t)right); break;
+		case SCRIPT_OP_DIV:
+		case SCRIPT_OP_MOD: {
+			if(right == 0) {
+				return Bytecode__error(state, "division by zero");
+			}
+			if(right == -1) {
+				*result = op == SCRIPT_OP_DIV ? (int64_t)(0 - (uint64_t)left) : 0;
+			}
+			else {
+				*result = op == SCRIPT_OP_DIV ? left / right : left % right;
+			}
+		} break;
+		case SCRIPT_OP_LT: *result = left < right; break;
+		case SCRIPT_OP_LE: *result = left <= right; break;
+		case SCRIPT_OP_EQ: *result = left == right; break;
+		case SCRIPT_OP_NE: *result = left != right; break;
+	}
+	return 0;
+}
+
+static int Bytecode__binary(BYTECODE_STATE* state, uint8_t op, SCRIPT_VALUE left, SCRIPT_VALUE right, SCRIPT_VALUE* result) {
+	if(left.constant && right.constant) {
+		int64_t value = 0;
+		if(Bytecode__fold(state, op, left.value, right.value, &value) != 0) {
+			return -1;
+		}
+		*result = (SCRIPT_VALUE){ true, value, 0, false };
+		return 0;
+	}
+
+	// Small constant added or subtracted
+	if((op == SCRIPT_OP_ADD && right.constant && right.value >= -128 && right.value <= 127) ||
+	   (op == SCRIPT_OP_SUB && right.constant && right.value >= -127 && right.value <= 128)) {
+		int64_t immediate = op == SCRIPT_OP_ADD ? right.value : -right.value;
+		int source = Bytecode__register(state, &left);
+		int target = left.temp ? left.reg : Bytecode__allocate(state, NULL);
+		if(source < 0 || target < 0 || Bytecode__emit(state, SCRIPT_ENCODE(SCRIPT_OP_ADDI, target, source, immediate)) != 0) {
+			return -1;
+		}
+		*result = (SCRIPT_VALUE){ false, 0, target, true };
+		return 0;
+	}
+
+	int a = Bytecode__register(state, &left);
+	int b = Bytecode__register(state, &right);
+	if(a < 0 || b < 0) {
+		return -1;
+	}
+	int target = left.temp ? left.reg : right.temp ? right.reg : Bytecode__allocate(state, NULL);
+	if(target < 0 || Bytecode__emit(state, SCRIPT_ENCODE(op, target, a, b)) != 0) {
+		return -1;
+	}
+	if(right.temp && right.reg != target) {
+		Bytecode__release(state, &right);
+	}
+	*result = (SCRIPT_VALUE){ false, 0, target, true };
+	return 0;
+}
+
+static int Bytecode__primary(BYTECODE_STATE* state, SCRIPT_VALUE* value) {
+	const char* token = Bytecode__token(state);
+	if(Bytecode__accept(state, "(")) {
+		if(Bytecode__expression(state, value) != 0) {
+			return -1;
+		}
+		return Bytecode__expect(state, ")");
+	}
+	if(isdigit((unsigned char)token[0])) {
+		uint64_t number = 0;
+		for(const char* c = token;*c;c++) {
+			if(!isdigit((unsigned char)*c)) {
+				return Bytecode__error(state, "invalid number");
+			}
+			if(number > (uint64_t)(INT64_MAX - (*c - '0')) / 10) {
+				return Bytecode__error(state, "number is too large");
+			}
+			number = number * 10 + (*c - '0');
+		}
+		state->position++;
+		*value = (SCRIPT_VALUE){ true, (int64_t)number, 0, false };
+		return 0;
+	}
+	if(isalpha((unsigned char)token[0]) || token[0] == '_') {
+		int reg = Bytecode__variable(state, token);
+		if(reg >= 0) {
+			state->position++;
+			*value = (SCRIPT_VALUE){ false, 0, reg, false };
+			return 0;
+		}
+		int name = state->position++;
+		int64_t result;
+		int found = 1;
+		bool call = Bytecode__accept(state, "(");
+		if(call) {
+			// Call, evaluated while compiling
+			int64_t args[SCRIPT_MAX_REGISTERS];
+			int count = 0;
+			while(!Bytecode__accept(state, ")")) {
+				if(count > 0 && Bytecode__expect(state, ",") != 0) {
+					return -1;
+				}
+				SCRIPT_VALUE arg;
+				if(count == SCRIPT_MAX_REGISTERS || Bytecode__expression(state, &arg) != 0) {
+					return count == SCRIPT_MAX_REGISTERS ? Bytecode__error(state, "too many arguments") : -1;
+				}
+				if(!arg.constant) {
+					return Bytecode__error(state, "arguments of calls must be constant");
+				}
+				args[count++] = arg.value;
+			}
+			if(state->source->call != NULL) {
+				found = state->source->call(state->compiler, token, args, count, &result);
+			}
+		}
+		else if(state->source->constant != NULL) {
+			found = state->source->constant(state->compiler, token, &result);
+		}
+		if(found != 0) {
+			state->position = name;
+			if(found < 0) {
+				state->failed = true;
+				return -1;
+			}
+			return Bytecode__error(state, call ? "unknown function" : "unknown variable");
+		}
+		*value = (SCRIPT_VALUE){ true, result, 0, false };
+		return 0;
+	}
+	return Bytecode__error(state, "expected an expression");
+}
+
+static int Bytecode__unary(BYTECODE_STATE* state, SCRIPT_VALUE* value) {
+	uint8_t op;
+	if(Bytecode__accept(state, "-")) {
+		op = SCRIPT_OP_NEG;
+	}
+	else if(Bytecode__accept(state, "!")) {
+		op = SCRIPT_OP_NOT;
+	}
+	else {
+		return Bytecode__primary(state, value);
+	}
+	SCRIPT_VALUE operand;
+	if(Bytecode__unary(state, &operand) != 0) {
+		return -1;
+	}
+	if(operand.constant) {
+		int64_t folded = op == SCRIPT_OP_NEG ? (int64_t)(0 - (uint64_t)operand.value) : !operand.value;
+		*value = (SCRIPT_VALUE){ true, folded, 0, false };
+		return 0;
+	}
+	int target = operand.temp ? operand.reg : Bytecode__allocate(state, NULL);
+	if(target < 0 || Bytecode__emit(state, SCRIPT_ENCODE(op, target, operand.reg, 0)) != 0) {
+		return -1;
+	}
+	*value = (SCRIPT_VALUE){ false, 0, target, true };
+	return 0;
+}
+
+static int Bytecode__term(BYTECODE_STATE* state, SCRIPT_VALUE* value) {
+	if(Bytecode__unary(state, value) != 0) {
+		return -1;
+	}
+	while(true) {
+		uint8_t op;
+		if(Bytecode__accept(state, "*")) {
+			op = SCRIPT_OP_MUL;
+		}
+		else if(Bytecode__accept(state, "/")) {
+			op = SCRIPT_OP_DIV;
+		}
+		else if(Bytecode__accept(state, "%")) {
+			op = SCRIPT_OP_MOD;
+		}
+		else {
+			return 0;
+		}
+		SCRIPT_VALUE right;
+		if(Bytecode__unary(state, &right) != 0 || Bytecode__binary(state, op, *value, right, value) != 0) {
+			return -1;
+		}
+	}
+}
+
+static int Bytecode__sum(BYTECODE_STATE* state, SCRIPT_VALUE* value) {
+	if(Bytecode__term(state, value) != 0) {
+		return -1;
+	}
+	while(true) {
+		uint8_t op;
+		if(Bytecode__accept(state, "+")) {
+			op = SCRIPT_OP_ADD;
+		}
+		else if(Bytecode__accept(state, "-")) {
+			op = SCRIPT_OP_SUB;
+		}
+		else {
+			return 0;
+		}
+		SCRIPT_VALUE right;
+		if(Bytecode__term(state, &right) != 0 || Bytecode__binary(state, op, *value, right, value) != 0) {
+			return -1;
+		}
+	}
+}
+
+static int Bytecode__relation(BYTECODE_STATE* state, SCRIPT_VALUE* value) {
+	// "<" "=" are two tokens, a > b is b < a
+	if(Bytecode__sum(state, value) != 0) {
+		return -1;
+	}
+	while(true) {
+		uint8_t op;
+		bool swap;
+		if(Bytecode__accept(state, "<")) {
+			op = Bytecode__accept(state, "=") ? SCRIPT_OP_LE : SCRIPT_OP_LT;
+			swap = false;
+		}
+		else if(Bytecode__accept(state, ">")) {
+			op = Bytecode__accept(state, "=") ? SCRIPT_OP_LE : SCRIPT_OP_LT;
+			swap = true;
+		}
+		else {
+			return 0;
+		}
+		SCRIPT_VALUE right;
+		if(Bytecode__sum(state, &right) != 0) {
+			return -1;
+		}
+		int ret = swap ? Bytecode__binary(state, op, right, *value, value) : Bytecode__binary(state, op, *value, right, value);
+		if(ret != 0) {
+			return -1;
+		}
+	}
+}
+
+static int Bytecode__expression(BYTECODE_STATE* state, SCRIPT_VALUE* value) {
+	// Equality, the lowest precedence
+	if(Bytecode__relation(state, value) != 0) {
+		return -1;
+	}
+	while(true) {
+		uint8_t op;
+		if(strcmp(Bytecode__token(state), "=") == 0 || strcmp(Bytecode__token(state), "!") == 0) {
+			op = Bytecode__token(state)[0] == '=' ? SCRIPT_OP_EQ : SCRIPT_OP_NE;
+			state->position++;
+			if(Bytecode__expect(state, "=") != 0) {
+				return -1;
+			}
+		}
+		else {
+			return 0;
+		}
+		SCRIPT_VALUE right;
+		if(Bytecode__relation(state, &right) != 0 || Bytecode__binary(state, op, *value, right, value) != 0) {
+			return -1;
+		}
+	}
+}
+
+static int Bytecode__assign(BYTECODE_STATE* state, int reg, SCRIPT_VALUE* value, uint32_t start) {
+	if(value->constant) {
+		return Bytecode__load(state, reg, value->value);
+	}
+	if(!value->temp) {
+		return value->reg == reg ? 0 : Bytecode__emit(state, SCRIPT_ENCODE(SCRIPT_OP_MOV, reg, value->reg, 0));
+	}
+	// The instruction that computed the temporary writes the variable instead
+	Bytecode__release(state, value);
+	if(state->code_count > start) {
+		uint32_t* last = &state->code[state->code_count - 1];
+		uint8_t op = *last & 0xFF;
+		if(((*last >> 8) & 0xFF) == (uint32_t)value->reg && op != SCRIPT_OP_JMP && op != SCRIPT_OP_JMPF &&
+		   op != SCRIPT_OP_JMPT && op != SCRIPT_OP_RET) {
+			*last = (*last & ~0xFF00u) | (uint32_t)reg << 8;
+			return 0;
+		}
+	}
+	return Bytecode__emit(state, SCRIPT_ENCODE(SCRIPT_OP_MOV, reg, value->reg, 0));
+}
+
+static int Bytecode__block(BYTECODE_STATE* state) {
+	if(Bytecode__expect(state, "{") != 0) {
+		return -1;
+	}
+	while(!Bytecode__accept(state, "}")) {
+		if(state->position >= state->source->count) {
+			return Bytecode__expect(state, "}");
+		}
+		if(Bytecode__statement(state) != 0) {
+			return -1;
+		}
+	}
+	return 0;
+}
+
+static int Bytecode__condition(BYTECODE_STATE* state, uint8_t op, uint32_t target) {
+	// Condition and the jump on it, to target or patched later (target = 0)
+	SCRIPT_VALUE value;
+	if(Bytecode__expression(state, &value) != 0) {
+		return -1;
+	}
+	int reg = Bytecode__register(state, &value);
+	if(reg < 0 || Bytecode__emit(state, SCRIPT_ENCODE_WIDE(op, reg, 0)) != 0) {
+		return -1;
+	}
+	Bytecode__release(state, &value);
+	return target == 0 ? 0 : Bytecode__patch(state, state->code_count - 1, target);
+}
+
+static int Bytecode__statement(BYTECODE_STATE* state) {
+	uint32_t start = state->code_count;
+	SCRIPT_VALUE value;
+	if(Bytecode__accept(state, "int")) {
+		const char* name = Bytecode__token(state);
+		if(!(isalpha((unsigned char)name[0]) || name[0] == '_')) {
+			return Bytecode__error(state, "expected a variable name");
+		}
+		if(Bytecode__variable(state, name) >= 0) {
+			return Bytecode__error(state, "variable already declared");
+		}
+		state->position++;
+		if(Bytecode__accept(state, ";")) {
+			// Inputs are the first registers
+			if(state->registers != state->inputs) {
+				state->position -= 2;
+				return Bytecode__error(state, "inputs must be declared before everything else");
+			}
+			state->inputs++;
+			return Bytecode__allocate(state, name) < 0 ? -1 : 0;
+		}
+		if(Bytecode__expect(state, "=") != 0 || Bytecode__expression(state, &value) != 0 || Bytecode__expect(state, ";") != 0) {
+			return -1;
+		}
+		// Declared after the value, "int x = x;" is an error
+		int reg = Bytecode__allocate(state, name);
+		return reg < 0 ? -1 : Bytecode__assign(state, reg, &value, start);
+	}
+	if(Bytecode__accept(state, "if")) {
+		if(Bytecode__condition(state, SCRIPT_OP_JMPF, 0) != 0) {
+			return -1;
+		}
+		uint32_t skip = state->code_count - 1;
+		if(Bytecode__block(state) != 0) {
+			return -1;
+		}
+		if(!Bytecode__accept(state, "else")) {
+			return Bytecode__patch(state, skip, state->code_count);
+		}
+		uint32_t end = state->code_count;
+		if(Bytecode__emit(state, SCRIPT_ENCODE_WIDE(SCRIPT_OP_JMP, 0, 0)) != 0 || Bytecode__patch(state, skip, state->code_count) != 0) {
+			return -1;
+		}
+		int ret = strcmp(Bytecode__token(state), "if") == 0 ? Bytecode__statement(state) : Bytecode__block(state);
+		return ret != 0 ? -1 : Bytecode__patch(state, end, state->code_count);
+	}
+	if(Bytecode__accept(state, "while")) {
+		// Body first, then the condition jumps back to it (one jump per iteration)
+		int condition = state->position;
+		while(state->position < state->source->count && strcmp(Bytecode__token(state), "{") != 0) {
+			state->position++;
+		}
+		uint32_t enter = state->code_count;
+		if(Bytecode__emit(state, SCRIPT_ENCODE_WIDE(SCRIPT_OP_JMP, 0, 0)) != 0 || Bytecode__block(state) != 0) {
+			return -1;
+		}
+		int end = state->position;
+		if(Bytecode__patch(state, enter, state->code_count) != 0) {
+			return -1;
+		}
+		state->position = condition;
+		if(Bytecode__condition(state, SCRIPT_OP_JMPT, enter + 1) != 0) {
+			return -1;
+		}
+		if(strcmp(Bytecode__token(state), "{") != 0) {
+			return Bytecode__expect(state, "{");
+		}
+		state->position = end;
+		return 0;
+	}
+	if(Bytecode__accept(state, "return")) {
+		if(Bytecode__expression(state, &value) != 0) {
+			return -1;
+		}
+		int reg = Bytecode__register(state, &value);
+		if(reg < 0 || Bytecode__emit(state, SCRIPT_ENCODE(SCRIPT_OP_RET, reg, 0, 0)) != 0) {
+			return -1;
+		}
+		Bytecode__release(state, &value);
+		return Bytecode__expect(state, ";");
+	}
+
+	// Assignment
+	int reg = Bytecode__variable(state, Bytecode__token(state));
+	if(reg < 0) {
+		return Bytecode__error(state, "unknown variable");
+	}
+	state->position++;
+	if(Bytecode__expect(state, "=") != 0 || Bytecode__expression(state, &value) != 0 || Bytecode__expect(state, ";") != 0) {
+		return -1;
+	}
+	return Bytecode__assign(state, reg, &value, start);
+}
+
+static int Bytecode__run(BYTECODE_STATE* state, COMPILER* compiler, const BYTECODE_SOURCE* source) {
+	memset(state, 0, sizeof(BYTECODE_STATE));
+	state->compiler = C;
+	state->source = source;
+	for(int i = 0;i < source->input_count;i++) {
+		if(Bytecode__allocate(state, source->inputs[i]) < 0) {
+			return -1;
+		}
+		state->inputs++;
+	}
+	while(state->position < source->count && !state->failed) {
+		Bytecode__statement(state);
+	}
+	if(!state->failed) {
+		// Implicit "return 0;"
+		int reg = Bytecode__allocate(state, NULL);
+		if(reg >= 0 && Bytecode__load(state, reg, 0) == 0) {
+			Bytecode__emit(state, SCRIPT_ENCODE(SCRIPT_OP_RET, reg, 0, 0));
+		}
+	}
+	return state->failed ? -1 : 0;
+}
+
+int Bytecode__build(COMPILER* compiler, const BYTECODE_SOURCE* source, uint8_t** bytecode, uint64_t* size) {
+	BYTECODE_STATE state;
+	*bytecode = NULL;
+	*size = 0;
+	int ret = Bytecode__run(&state, C, source);
+	if(ret == 0) {
+		SCRIPT_HEADER header = { SCRIPT_MAGIC, SCRIPT_VERSION, (uint16_t)state.registers, (uint16_t)state.inputs, 0,
+			state.constant_count, state.code_count, 0 };
+		uint64_t constants_size = (uint64_t)state.constant_count * sizeof(int64_t);
+		*size = sizeof(SCRIPT_HEADER) + constants_size + (uint64_t)state.code_count * sizeof(uint32_t);
+		*bytecode = malloc(*size);
+		if(*bytecode == NULL) {
+			printf("[ERROR] Could not allocate script bytecode.\n");
+			*size = 0;
+			ret = -1;
+		}
+		else {
+			memcpy(*bytecode, &header, sizeof(SCRIPT_HEADER));
+			memcpy(*bytecode + sizeof(SCRIPT_HEADER), state.constants, constants_size);
+			memcpy(*bytecode + sizeof(SCRIPT_HEADER) + constants_size, state.code, state.code_count * sizeof(uint32_t));
+		}
+	}
+	free(state.code);
+	free(state.constants);
+	return ret;
+}
+
+int Bytecode__constant(COMPILER* compiler, const BYTECODE_SOURCE* source, int64_t* value) {
+	// Without variables every expression folds, nothing is emitted
+	BYTECODE_STATE state;
+	memset(&state, 0, sizeof(BYTECODE_STATE));
+	state.compiler = C;
+	state.source = source;
+	SCRIPT_VALUE result;
+	int ret = Bytecode__expression(&state, &result);
+	if(ret == 0 && state.position < source->count) {
+		ret = Bytecode__error(&state, "expected the end of the expression");
+	}
+	if(ret == 0 && !result.constant) {
+		ret = Bytecode__error(&state, "expression is not constant");
+	}
+	if(ret == 0) {
+		*value = result.value;
+	}
+	free(state.code);
+	free(state.constants);
+	return ret;
+}
+
+int Bytecode__compile(COMPILER* compiler) {
+	free(C->script);
+	C->script = NULL;
+	C->script_size = 0;
+	if(C->script_token_count == 0) {
+		return 0;
+	}
+	BYTECODE_SOURCE source = { "Script", C->script_tokens, C->script_token_count, NULL, 0, NULL, NULL };
+	if(Bytecode__build(C, &source, &C->script, &C->script_size) != 0) {
+		return -1;
+	}
+	SCRIPT_HEADER header;
+	memcpy(&header, C->script, sizeof(SCRIPT_HEADER));
+	if(C->verbose) {
+		printf("[INFO] Script: %u instructions, %u registers, %u constants.\n", header.instructions, header.registers, header.constants);
+	}
+	return 0;
+}
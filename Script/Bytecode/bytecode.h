@@ -0,0 +1,39 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "./../../structures.h"
+#include "./../VM/vm.h"
+
+// Script bytecode compiler
+//   ParseCode collects the tokens of all __SEC_SCRIPT sections, they are
+//   compiled as one program for the register machine in Script/VM/vm.h.
+//   The translator embeds it in .rodata as the symbol __SCRIPT.
+//     int name;                        Input, set by the host for every run
+//     int name = expression;           Variable
+//     name = expression;
+//     if expression { ... } else { ... }
+//     while expression { ... }
+//     return expression;
+//   Expressions are 64 bit integers with + - * / % < <= > >= == != ! - and
+//   parentheses. Variables get one register each, temporaries are reused.
+//   Constant expressions are folded. Without a return the program returns 0.
+//   Other names and calls f(...) with constant arguments are resolved by
+//   the callbacks of the source (see Optimizer/Constexpr/constexpr.h).
+
+typedef struct _BYTECODE_SOURCE_ {
+	const char* name;                  // For errors ("Script", ...)
+	const int* tokens;                 // Indices into compiler->tokens
+	int count;
+	const char** inputs;               // Inputs declared before the statements
+	int input_count;
+	// 0 = found, 1 = unknown, -1 = error (printed)
+	int (*constant)(COMPILER* compiler, const char* name, int64_t* value);
+	int (*call)(COMPILER* compiler, const char* name, const int64_t* args, int count, int64_t* value);
+} BYTECODE_SOURCE;
+
+int Bytecode__build(COMPILER* compiler, const BYTECODE_SOURCE* source, uint8_t** bytecode, uint64_t* size);
+int Bytecode__constant(COMPILER* compiler, const BYTECODE_SOURCE* source, int64_t* value);
+int Bytecode__compile(COMPILER* compiler);
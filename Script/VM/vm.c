@@ -0,0 +1,222 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "vm.h"
+
+// Handlers after the opcodes: jumps to an earlier instruction, they count
+// against the budget so forward jumps stay free
+enum SCRIPT_HANDLER {
+	SCRIPT_HANDLER_JMP_LOOP = SCRIPT_OPCODE_COUNT,
+	SCRIPT_HANDLER_JMPF_LOOP,
+	SCRIPT_HANDLER_JMPT_LOOP,
+	SCRIPT_HANDLER_COUNT
+};
+
+// Operands of every opcode (checked by Script__load, not by Script__run)
+#define SCRIPT_USES_A 1
+#define SCRIPT_USES_B 2
+#define SCRIPT_USES_C 4
+#define SCRIPT_USES_CONSTANT 8
+#define SCRIPT_USES_TARGET 16
+static const uint8_t Script__operands[SCRIPT_OPCODE_COUNT] = {
+	[SCRIPT_OP_MOV] = SCRIPT_USES_A | SCRIPT_USES_B,
+	[SCRIPT_OP_LOADI] = SCRIPT_USES_A,
+	[SCRIPT_OP_LOADK] = SCRIPT_USES_A | SCRIPT_USES_CONSTANT,
+	[SCRIPT_OP_ADD] = SCRIPT_USES_A | SCRIPT_USES_B | SCRIPT_USES_C,
+	[SCRIPT_OP_SUB] = SCRIPT_USES_A | SCRIPT_USES_B | SCRIPT_USES_C,
+	[SCRIPT_OP_MUL] = SCRIPT_USES_A | SCRIPT_USES_B | SCRIPT_USES_C,
+	[SCRIPT_OP_DIV] = SCRIPT_USES_A | SCRIPT_USES_B | SCRIPT_USES_C,
+	[SCRIPT_OP_MOD] = SCRIPT_USES_A | SCRIPT_USES_B | SCRIPT_USES_C,
+	[SCRIPT_OP_ADDI] = SCRIPT_USES_A | SCRIPT_USES_B,
+	[SCRIPT_OP_LT] = SCRIPT_USES_A | SCRIPT_USES_B | SCRIPT_USES_C,
+	[SCRIPT_OP_LE] = SCRIPT_USES_A | SCRIPT_USES_B | SCRIPT_USES_C,
+	[SCRIPT_OP_EQ] = SCRIPT_USES_A | SCRIPT_USES_B | SCRIPT_USES_C,
+	[SCRIPT_OP_NE] = SCRIPT_USES_A | SCRIPT_USES_B | SCRIPT_USES_C,
+	[SCRIPT_OP_NOT] = SCRIPT_USES_A | SCRIPT_USES_B,
+	[SCRIPT_OP_NEG] = SCRIPT_USES_A | SCRIPT_USES_B,
+	[SCRIPT_OP_JMP] = SCRIPT_USES_TARGET,
+	[SCRIPT_OP_JMPF] = SCRIPT_USES_A | SCRIPT_USES_TARGET,
+	[SCRIPT_OP_JMPT] = SCRIPT_USES_A | SCRIPT_USES_TARGET,
+	[SCRIPT_OP_RET] = SCRIPT_USES_A
+};
+
+static int Script__execute(const SCRIPT_VM* vm, int64_t* r, int64_t* result, const void* const** table) {
+	// Label addresses only exist inside of this function, Script__load gets
+	// them by calling it with a table pointer
+	static const void* const handlers[SCRIPT_HANDLER_COUNT] = {
+		[SCRIPT_OP_MOV] = &&MOV, [SCRIPT_OP_LOADI] = &&LOAD, [SCRIPT_OP_LOADK] = &&LOAD,
+		[SCRIPT_OP_ADD] = &&ADD, [SCRIPT_OP_SUB] = &&SUB, [SCRIPT_OP_MUL] = &&MUL,
+		[SCRIPT_OP_DIV] = &&DIV, [SCRIPT_OP_MOD] = &&MOD, [SCRIPT_OP_ADDI] = &&ADDI,
+		[SCRIPT_OP_LT] = &&LT, [SCRIPT_OP_LE] = &&LE, [SCRIPT_OP_EQ] = &&EQ, [SCRIPT_OP_NE] = &&NE,
+		[SCRIPT_OP_NOT] = &&NOT, [SCRIPT_OP_NEG] = &&NEG,
+		[SCRIPT_OP_JMP] = &&JMP, [SCRIPT_OP_JMPF] = &&JMPF, [SCRIPT_OP_JMPT] = &&JMPT,
+		[SCRIPT_OP_RET] = &&RET,
+		[SCRIPT_HANDLER_JMP_LOOP] = &&JMP_LOOP, [SCRIPT_HANDLER_JMPF_LOOP] = &&JMPF_LOOP,
+		[SCRIPT_HANDLER_JMPT_LOOP] = &&JMPT_LOOP
+	};
+	if(table != NULL) {
+		*table = handlers;
+		return 0;
+	}
+
+	// Arithmetic wraps around (unsigned), like the machine code would
+	uint64_t budget = vm->budget ? vm->budget : UINT64_MAX;
+	const SCRIPT_INSTRUCTION* ip = vm->code;
+	const SCRIPT_INSTRUCTION* i;
+	#define DISPATCH() do { i = ip++; goto *i->handler; } while(0)
+	DISPATCH();
+
+	MOV:  r[i->a] = r[i->b]; DISPATCH();
+	LOAD: r[i->a] = i->value; DISPATCH();
+	ADD:  r[i->a] = (int64_t)((uint64_t)r[i->b] + (uint64_t)r[i->c]); DISPATCH();
+	SUB:  r[i->a] = (int64_t)((uint64_t)r[i->b] - (uint64_t)r[i->c]); DISPATCH();
+	MUL:  r[i->a] = (int64_t)((uint64_t)r[i->b] * (uint64_t)r[i->c]); DISPATCH();
+	DIV:
+		if(r[i->c] == 0) {
+			return SCRIPT_ERROR_DIVISION;
+		}
+		// INT64_MIN / -1 overflows
+		r[i->a] = r[i->c] == -1 ? (int64_t)(0 - (uint64_t)r[i->b]) : r[i->b] / r[i->c];
+		DISPATCH();
+	MOD:
+		if(r[i->c] == 0) {
+			return SCRIPT_ERROR_DIVISION;
+		}
+		r[i->a] = r[i->c] == -1 ? 0 : r[i->b] % r[i->c];
+		DISPATCH();
+	ADDI: r[i->a] = (int64_t)((uint64_t)r[i->b] + (uint64_t)i->value); DISPATCH();
+	LT:   r[i->a] = r[i->b] < r[i->c]; DISPATCH();
+	LE:   r[i->a] = r[i->b] <= r[i->c]; DISPATCH();
+	EQ:   r[i->a] = r[i->b] == r[i->c]; DISPATCH();
+	NE:   r[i->a] = r[i->b] != r[i->c]; DISPATCH();
+	NOT:  r[i->a] = !r[i->b]; DISPATCH();
+	NEG:  r[i->a] = (int64_t)(0 - (uint64_t)r[i->b]); DISPATCH();
+	JMP:  ip = i->target; DISPATCH();
+	JMPF: if(!r[i->a]) { ip = i->target; } DISPATCH();
+	JMPT: if(r[i->a]) { ip = i->target; } DISPATCH();
+	JMP_LOOP:
+		if(--budget == 0) {
+			return SCRIPT_ERROR_BUDGET;
+		}
+		ip = i->target;
+		DISPATCH();
+	JMPF_LOOP:
+		if(!r[i->a]) {
+			if(--budget == 0) {
+				return SCRIPT_ERROR_BUDGET;
+			}
+			ip = i->target;
+		}
+		DISPATCH();
+	JMPT_LOOP:
+		if(r[i->a]) {
+			if(--budget == 0) {
+				return SCRIPT_ERROR_BUDGET;
+			}
+			ip = i->target;
+		}
+		DISPATCH();
+	RET:
+		*result = r[i->a];
+		return SCRIPT_OK;
+	#undef DISPATCH
+}
+
+int Script__load(SCRIPT_VM* vm, const uint8_t* bytecode, uint64_t size) {
+	memset(vm, 0, sizeof(SCRIPT_VM));
+	SCRIPT_HEADER header;
+	if(size < sizeof(SCRIPT_HEADER)) {
+		printf("[ERROR] Script bytecode is truncated.\n");
+		return -1;
+	}
+	memcpy(&header, bytecode, sizeof(SCRIPT_HEADER));
+	if(header.magic != SCRIPT_MAGIC || header.version != SCRIPT_VERSION) {
+		printf("[ERROR] Script bytecode has an unknown format.\n");
+		return -1;
+	}
+	if(header.registers > SCRIPT_MAX_REGISTERS || header.inputs > header.registers || header.instructions == 0 ||
+	   size != sizeof(SCRIPT_HEADER) + (uint64_t)header.constants * 8 + (uint64_t)header.instructions * 4) {
+		printf("[ERROR] Script bytecode is damaged.\n");
+		return -1;
+	}
+	const uint8_t* constants = bytecode + sizeof(SCRIPT_HEADER);
+	const uint8_t* code = constants + (uint64_t)header.constants * 8;
+
+	const void* const* handlers;
+	Script__execute(NULL, NULL, NULL, &handlers);
+	vm->code = malloc(header.instructions * sizeof(SCRIPT_INSTRUCTION));
+	if(vm->code == NULL) {
+		printf("[ERROR] Could not allocate script instructions.\n");
+		return -1;
+	}
+	vm->count = header.instructions;
+	vm->registers = header.registers;
+	vm->inputs = header.inputs;
+
+	// Decode, every check is done here so the dispatch loop has none
+	for(uint32_t n = 0;n < header.instructions;n++) {
+		uint32_t word;
+		memcpy(&word, code + (uint64_t)n * 4, 4);
+		uint8_t op = word & 0xFF, a = (word >> 8) & 0xFF, b = (word >> 16) & 0xFF, c = word >> 24;
+		uint16_t bx = word >> 16;
+		SCRIPT_INSTRUCTION* instruction = &vm->code[n];
+		bool valid = op < SCRIPT_OPCODE_COUNT;
+		uint8_t uses = valid ? Script__operands[op] : 0;
+		valid = valid && (!(uses & SCRIPT_USES_A) || a < header.registers);
+		valid = valid && (!(uses & SCRIPT_USES_B) || b < header.registers);
+		valid = valid && (!(uses & SCRIPT_USES_C) || c < header.registers);
+		valid = valid && (!(uses & SCRIPT_USES_CONSTANT) || bx < header.constants);
+		int64_t target = (int64_t)n + 1 + (int16_t)bx;
+		valid = valid && (!(uses & SCRIPT_USES_TARGET) || (target >= 0 && target < header.instructions));
+		if(!valid) {
+			printf("[ERROR] Script bytecode has an invalid instruction at %u.\n", n);
+			Script__free(vm);
+			return -1;
+		}
+		instruction->handler = handlers[op];
+		instruction->a = a;
+		instruction->b = b;
+		instruction->c = c;
+		instruction->value = 0;
+		if(op == SCRIPT_OP_LOADI) {
+			instruction->value = (int16_t)bx;
+		}
+		else if(op == SCRIPT_OP_LOADK) {
+			memcpy(&instruction->value, constants + (uint64_t)bx * 8, 8);
+		}
+		else if(op == SCRIPT_OP_ADDI) {
+			instruction->value = (int8_t)c;
+		}
+		else if(uses & SCRIPT_USES_TARGET) {
+			instruction->target = &vm->code[target];
+			if(target <= n) {
+				instruction->handler = handlers[SCRIPT_HANDLER_JMP_LOOP + (op - SCRIPT_OP_JMP)];
+			}
+		}
+	}
+
+	// The last instruction may not fall through
+	uint8_t last = code[(uint64_t)(header.instructions - 1) * 4];
+	if(last != SCRIPT_OP_RET && last != SCRIPT_OP_JMP) {
+		printf("[ERROR] Script bytecode does not end with a return.\n");
+		Script__free(vm);
+		return -1;
+	}
+	return 0;
+}
+
+int Script__run(SCRIPT_VM* vm, const int64_t* inputs, int64_t* result) {
+	int64_t registers[SCRIPT_MAX_REGISTERS];
+	if(vm->inputs > 0) {
+		memcpy(registers, inputs, vm->inputs * sizeof(int64_t));
+	}
+	// Variables that were skipped by control flow read as 0
+	memset(registers + vm->inputs, 0, (vm->registers - vm->inputs) * sizeof(int64_t));
+	return Script__execute(vm, registers, result, NULL);
+}
+
+void Script__free(SCRIPT_VM* vm) {
+	free(vm->code);
+	vm->code = NULL;
+	vm->count = 0;
+}
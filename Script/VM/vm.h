@@ -0,0 +1,89 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// Script virtual machine
+//   Register machine for the bytecode of __SEC_SCRIPT sections (see
+//   Script/Bytecode/bytecode.h). Script__load checks the bytecode once and
+//   decodes it into instructions that hold the address of their
+//   implementation (direct threading), their operands and resolved
+//   constants and jump targets. Script__run only dispatches with computed
+//   gotos on a register file on the stack, it never allocates.
+//   It has no dependencies on the compiler, hosts can link it to run the
+//   __SCRIPT bytecode of an output.
+
+#define SCRIPT_MAGIC 0x42534c43         // "CLSB"
+#define SCRIPT_VERSION 1
+#define SCRIPT_MAX_REGISTERS 256
+
+// Bytecode layout: header, int64_t constants[constants], uint32_t code[instructions]
+typedef struct _SCRIPT_HEADER_ {
+	uint32_t magic;
+	uint16_t version;
+	uint16_t registers;                 // Registers used, inputs first
+	uint16_t inputs;                    // Registers set by the host before each run
+	uint16_t reserved;
+	uint32_t constants;
+	uint32_t instructions;
+	uint32_t reserved2;
+} SCRIPT_HEADER;
+
+// Instructions are 32 bit: op | A << 8 | B << 16 | C << 24
+//   sBx is B and C as signed 16 bit number, jumps are relative to the next instruction
+enum SCRIPT_OPCODE {
+	SCRIPT_OP_MOV,                      // A = B
+	SCRIPT_OP_LOADI,                    // A = sBx
+	SCRIPT_OP_LOADK,                    // A = constants[Bx]
+	SCRIPT_OP_ADD,                      // A = B + C
+	SCRIPT_OP_SUB,                      // A = B - C
+	SCRIPT_OP_MUL,                      // A = B * C
+	SCRIPT_OP_DIV,                      // A = B / C
+	SCRIPT_OP_MOD,                      // A = B % C
+	SCRIPT_OP_ADDI,                     // A = B + sC
+	SCRIPT_OP_LT,                       // A = B < C
+	SCRIPT_OP_LE,                       // A = B <= C
+	SCRIPT_OP_EQ,                       // A = B == C
+	SCRIPT_OP_NE,                       // A = B != C
+	SCRIPT_OP_NOT,                      // A = !B
+	SCRIPT_OP_NEG,                      // A = -B
+	SCRIPT_OP_JMP,                      // Jump sBx
+	SCRIPT_OP_JMPF,                     // Jump sBx if A == 0
+	SCRIPT_OP_JMPT,                     // Jump sBx if A != 0
+	SCRIPT_OP_RET,                      // Return A
+	SCRIPT_OPCODE_COUNT
+};
+
+#define SCRIPT_ENCODE(op, a, b, c) ((uint32_t)(op) | (uint32_t)(uint8_t)(a) << 8 | (uint32_t)(uint8_t)(b) << 16 | (uint32_t)(uint8_t)(c) << 24)
+#define SCRIPT_ENCODE_WIDE(op, a, bx) ((uint32_t)(op) | (uint32_t)(uint8_t)(a) << 8 | (uint32_t)(uint16_t)(bx) << 16)
+
+// Results of Script__run
+enum SCRIPT_RESULT {
+	SCRIPT_OK = 0,
+	SCRIPT_ERROR_DIVISION = -2,         // Division or modulo by zero
+	SCRIPT_ERROR_BUDGET = -3            // More loop iterations than vm->budget
+};
+
+typedef struct _SCRIPT_INSTRUCTION_ {
+	const void* handler;                // Implementation of the opcode in Script__execute
+	union {
+		int64_t value;                  // LOADI, LOADK, ADDI
+		const struct _SCRIPT_INSTRUCTION_* target; // Jumps
+	};
+	uint8_t a;
+	uint8_t b;
+	uint8_t c;
+} SCRIPT_INSTRUCTION;
+
+typedef struct _SCRIPT_VM_ {
+	SCRIPT_INSTRUCTION* code;
+	uint32_t count;
+	uint16_t registers;
+	uint16_t inputs;
+	uint64_t budget;                    // Backward jumps per run (0 = unlimited)
+} SCRIPT_VM;
+
+int Script__load(SCRIPT_VM* vm, const uint8_t* bytecode, uint64_t size);
+int Script__run(SCRIPT_VM* vm, const int64_t* inputs, int64_t* result);
+void Script__free(SCRIPT_VM* vm);
@@ -0,0 +1,351 @@
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#include "server.h"
+
+typedef struct _SERVER_STATE_ {
+	int server;                        // Listening socket
+	SERVER_HANDLER handler;
+	const char* home;
+	bool stop;                         // Set by a "--stop" request, atomic
+	pthread_mutex_t lock;              // Compiles of workers that share the working directory and stdout
+} SERVER_STATE;
+
+static int64_t Server__now(void) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (int64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+static int Server__read_all(int fd, void* data, size_t length, int64_t deadline) {
+	// deadline: Server__now() milliseconds, 0 = wait as long as it takes
+	uint8_t* bytes = data;
+	while(length > 0) {
+		if(deadline != 0) {
+			int64_t left = deadline - Server__now();
+			struct pollfd ready = { fd, POLLIN, 0 };
+			if(left <= 0 || poll(&ready, 1, (int)left) <= 0) {
+				return -1;
+			}
+		}
+		ssize_t n = read(fd, bytes, length);
+		if(n <= 0) {
+			return -1;
+		}
+		bytes = bytes + n;
+		length = length - n;
+	}
+	return 0;
+}
+
+static int Server__write_all(int fd, const void* data, size_t length) {
+	const uint8_t* bytes = data;
+	while(length > 0) {
+		ssize_t n = write(fd, bytes, length);
+		if(n <= 0) {
+			return -1;
+		}
+		bytes = bytes + n;
+		length = length - n;
+	}
+	return 0;
+}
+
+static int Server__address(const char* path, struct sockaddr_un* address) {
+	memset(address, 0, sizeof(*address));
+	address->sun_family = AF_UNIX;
+	if(strlen(path) >= sizeof(address->sun_path)) {
+		printf("[ERROR] Socket path \"%s\" is too long.\n", path);
+		return -1;
+	}
+	strcpy(address->sun_path, path);
+	return 0;
+}
+
+static int Server__handle(SERVER_STATE* state, int client, bool private, bool* stop) {
+	// Read request, a stalled client must not hang the server
+	int64_t deadline = Server__now() + SERVER_TIMEOUT;
+	uint32_t length = 0;
+	if(Server__read_all(client, &length, sizeof(length), deadline) != 0 || length == 0 || length > SERVER_MAX_REQUEST) {
+		return -1;
+	}
+	char* request = malloc(length + 1);
+	if(request == NULL) {
+		return -1;
+	}
+	if(Server__read_all(client, request, length, deadline) != 0) {
+		free(request);
+		return -1;
+	}
+	request[length] = '\0';
+
+	// Split into working directory and arguments
+	int argc = -1;
+	for(uint32_t i = 0;i < length;i++) {
+		if(request[i] == '\0') {
+			argc++;
+		}
+	}
+	char** argv = malloc((argc + 2) * sizeof(char*));
+	if(argv == NULL || argc < 1) {
+		free(argv);
+		free(request);
+		return -1;
+	}
+	char* cwd = request;
+	char* p = request + strlen(request) + 1;
+	for(int i = 0;i < argc;i++) {
+		argv[i] = p;
+		p = p + strlen(p) + 1;
+	}
+	argv[argc] = NULL;
+
+	int32_t status = 0;
+	char* output = NULL;
+	uint64_t output_length = 0;
+	if(argc >= 2 && strcmp(argv[1], "--stop") == 0) {
+		*stop = true;
+	}
+	else {
+		// A worker without its own working directory and descriptors compiles alone
+		if(!private) {
+			pthread_mutex_lock(&state->lock);
+		}
+		if(chdir(cwd) != 0) {
+			status = -1;
+			output = strdup("[ERROR] Server could not enter the working directory of the client.\n");
+			output_length = strlen(output);
+		}
+		else {
+			// Everything the compile prints goes to the client
+			int capture = memfd_create("chaoslang-output", 0);
+			int saved = dup(STDOUT_FILENO);
+			fflush(stdout);
+			if(capture >= 0 && saved >= 0) {
+				dup2(capture, STDOUT_FILENO);
+			}
+			status = state->handler(argc, argv);
+			fflush(stdout);
+			if(capture >= 0 && saved >= 0) {
+				dup2(saved, STDOUT_FILENO);
+				off_t end = lseek(capture, 0, SEEK_END);
+				output = malloc(end > 0 ? end : 1);
+				if(output != NULL && end > 0 && pread(capture, output, end, 0) == end) {
+					output_length = end;
+				}
+			}
+			if(saved >= 0) {
+				close(saved);
+			}
+			if(capture >= 0) {
+				close(capture);
+			}
+			if(chdir(state->home) != 0) {
+				printf("[WARNING] Server could not return to \"%s\".\n", state->home);
+			}
+		}
+		if(!private) {
+			pthread_mutex_unlock(&state->lock);
+		}
+	}
+
+	// Send response (writes time out as well)
+	struct timeval timeout = { SERVER_TIMEOUT / 1000, (SERVER_TIMEOUT % 1000) * 1000 };
+	setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+	int ret = Server__write_all(client, &status, sizeof(status));
+	if(ret == 0) {
+		ret = Server__write_all(client, &output_length, sizeof(output_length));
+	}
+	if(ret == 0 && output_length > 0) {
+		ret = Server__write_all(client, output, output_length);
+	}
+	free(output);
+	free(argv);
+	free(request);
+	return ret;
+}
+
+static void* Server__worker(void* argument) {
+	SERVER_STATE* state = argument;
+	// Own working directory and descriptor table, so chdir and the redirected
+	// stdout of one compile do not reach the compiles of the other workers
+	bool private = unshare(CLONE_FS | CLONE_FILES) == 0;
+	while(!__atomic_load_n(&state->stop, __ATOMIC_ACQUIRE)) {
+		int client = accept(state->server, NULL, NULL);
+		if(client < 0) {
+			continue;
+		}
+		bool stop = false;
+		Server__handle(state, client, private, &stop);
+		close(client);
+		if(stop) {
+			// Wakes the workers waiting in accept
+			__atomic_store_n(&state->stop, true, __ATOMIC_RELEASE);
+			shutdown(state->server, SHUT_RDWR);
+		}
+	}
+	if(private) {
+		close(state->server);
+	}
+	return NULL;
+}
+
+int Server__run(const char* path, SERVER_HANDLER handler) {
+	char home[4096];
+	if(getcwd(home, sizeof(home)) == NULL) {
+		printf("[ERROR] Server could not get the working directory.\n");
+		return -1;
+	}
+	struct sockaddr_un address;
+	if(Server__address(path, &address) != 0) {
+		return -1;
+	}
+	int server = socket(AF_UNIX, SOCK_STREAM, 0);
+	if(server < 0) {
+		printf("[ERROR] Server could not create a socket.\n");
+		return -1;
+	}
+	// Only a stale socket is replaced
+	struct stat status;
+	if(lstat(path, &status) == 0) {
+		if(!S_ISSOCK(status.st_mode)) {
+			printf("[ERROR] \"%s\" exists and is not a socket.\n", path);
+			close(server);
+			return -1;
+		}
+		int probe = socket(AF_UNIX, SOCK_STREAM, 0);
+		bool listening = probe >= 0 && connect(probe, (struct sockaddr*)&address, sizeof(address)) == 0;
+		if(probe >= 0) {
+			close(probe);
+		}
+		if(listening) {
+			printf("[ERROR] A server is already listening on \"%s\".\n", path);
+			close(server);
+			return -1;
+		}
+		unlink(path);
+	}
+	if(bind(server, (struct sockaddr*)&address, sizeof(address)) != 0 || listen(server, 64) != 0) {
+		printf("[ERROR] Server could not listen on \"%s\".\n", path);
+		close(server);
+		return -1;
+	}
+	// Clients that went away must not end the server
+	signal(SIGPIPE, SIG_IGN);
+	printf("[INFO] Compile server listening on \"%s\".\n", path);
+	fflush(stdout);
+
+	// printf of every compile goes straight to the stdout of its worker
+	setvbuf(stdout, NULL, _IONBF, 0);
+
+	SERVER_STATE state = {0};
+	state.server = server;
+	state.handler = handler;
+	state.home = home;
+	pthread_mutex_init(&state.lock, NULL);
+	pthread_t workers[SERVER_WORKERS];
+	int count = 0;
+	for(;count < SERVER_WORKERS;count++) {
+		if(pthread_create(&workers[count], NULL, Server__worker, &state) != 0) {
+			break;
+		}
+	}
+	if(count == 0) {
+		Server__worker(&state);
+	}
+	for(int i = 0;i < count;i++) {
+		pthread_join(workers[i], NULL);
+	}
+	pthread_mutex_destroy(&state.lock);
+	close(server);
+	unlink(path);
+	return 0;
+}
+
+int Server__request(const char* path, int argc, char* argv[], int* status) {
+	// Returns -1 if no server is running
+	struct sockaddr_un address;
+	if(Server__address(path, &address) != 0) {
+		return -1;
+	}
+	int server = socket(AF_UNIX, SOCK_STREAM, 0);
+	if(server < 0) {
+		return -1;
+	}
+	if(connect(server, (struct sockaddr*)&address, sizeof(address)) != 0) {
+		close(server);
+		return -1;
+	}
+
+	// Build request
+	char cwd[4096];
+	if(getcwd(cwd, sizeof(cwd)) == NULL) {
+		close(server);
+		return -1;
+	}
+	size_t length = strlen(cwd) + 1;
+	for(int i = 0;i < argc;i++) {
+		length = length + strlen(argv[i]) + 1;
+	}
+	if(length > SERVER_MAX_REQUEST) {
+		printf("[ERROR] Arguments are too long for the compile server.\n");
+		close(server);
+		return -1;
+	}
+	char* request = malloc(length);
+	if(request == NULL) {
+		close(server);
+		return -1;
+	}
+	char* p = request;
+	strcpy(p, cwd);
+	p = p + strlen(cwd) + 1;
+	for(int i = 0;i < argc;i++) {
+		strcpy(p, argv[i]);
+		p = p + strlen(argv[i]) + 1;
+	}
+	uint32_t request_length = length;
+	int ret = Server__write_all(server, &request_length, sizeof(request_length));
+	if(ret == 0) {
+		ret = Server__write_all(server, request, length);
+	}
+	free(request);
+
+	// Print output of the compile
+	int32_t result = 0;
+	uint64_t output_length = 0;
+	if(ret == 0) {
+		ret = Server__read_all(server, &result, sizeof(result), 0);
+	}
+	if(ret == 0) {
+		ret = Server__read_all(server, &output_length, sizeof(output_length), 0);
+	}
+	char buffer[4096];
+	while(ret == 0 && output_length > 0) {
+		size_t chunk = output_length < sizeof(buffer) ? output_length : sizeof(buffer);
+		ret = Server__read_all(server, buffer, chunk, 0);
+		if(ret == 0) {
+			fwrite(buffer, 1, chunk, stdout);
+			output_length = output_length - chunk;
+		}
+	}
+	close(server);
+	if(ret != 0) {
+		printf("[ERROR] Connection to the compile server was lost.\n");
+		*status = -1;
+		return 0;
+	}
+	*status = result;
+	return 0;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// Compile server
+//   "--server [socket [memory limit]]" keeps one compiler process alive and
+//   compiles the requests sent to a Unix socket, so source files and
+//   translated functions stay warm in memory (see Cache__keep_in_memory).
+//   "--client <socket> <arguments>" forwards its arguments and working
+//   directory and prints what the compile printed.
+//
+//   Request:  u32 length, "<cwd>\0<argv[0]>\0<argv[1]>\0..."
+//   Response: i32 exit status, u64 length, <output>
+//
+//   Up to SERVER_WORKERS clients are served at once, each worker thread has its
+//   own working directory and descriptor table (unshare), so the compiles do not
+//   see each other's chdir and stdout. A client that does not send its whole
+//   request or read its response within SERVER_TIMEOUT is dropped. The
+//   socket path is only replaced if it is a socket no server listens on.
+
+#define SERVER_SOCKET      "./build/ChaosLangCompiler/server.sock"
+#define SERVER_MAX_REQUEST (1 << 20)
+#define SERVER_TIMEOUT     5000       // Milliseconds
+#define SERVER_WORKERS     8
+
+typedef int (*SERVER_HANDLER)(int argc, char* argv[]);
+
+int Server__run(const char* path, SERVER_HANDLER handler);
+int Server__request(const char* path, int argc, char* argv[], int* status);
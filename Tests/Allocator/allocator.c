@@ -0,0 +1,178 @@
+// Allocator check: a libc host linked with chaosrt.o. Its threads have no
+// slot of the runtime (TASKS_SHARED, see Runtime/Tasks/tasks.h).
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "../../Runtime/Memory/memory.h"
+#include "../../Runtime/Tasks/tasks.h"
+#include "../../Runtime/Coroutines/coroutines.h"
+#include "../../Runtime/IO/io.h"
+
+#define THREADS 8
+#define LIVE 64
+
+static int failures;
+
+static void check(int condition, const char* what) {
+	if(!condition) {
+		printf("[ERROR] %s\n", what);
+		__atomic_add_fetch(&failures, 1, __ATOMIC_RELAXED);
+	}
+}
+
+static uint64_t next(uint64_t* random) {
+	*random ^= *random << 13;
+	*random ^= *random >> 7;
+	*random ^= *random << 17;
+	return *random;
+}
+
+static void* churn(void* argument) {
+	// Blocks of all classes and large ones, each filled with the thread and checked before it is freed
+	int thread = (int)(long)argument;
+	uint64_t random = 0x9e3779b97f4a7c15ull * (thread + 1);
+	char* blocks[LIVE] = {0};
+	uint64_t sizes[LIVE] = {0};
+	for(int i = 0;i < 20000;i++) {
+		int slot = (int)(next(&random) % LIVE);
+		if(blocks[slot] != NULL) {
+			for(uint64_t j = 0;j < sizes[slot];j++) {
+				if(blocks[slot][j] != (char)(thread + j)) {
+					check(0, "block changed while it was in use");
+					break;
+				}
+			}
+			__chaos_free(blocks[slot]);
+		}
+		sizes[slot] = next(&random) % 16 == 0 ? 9000 + next(&random) % 30000 : next(&random) % 3000;
+		blocks[slot] = __chaos_alloc(sizes[slot]);
+		check(blocks[slot] != NULL && ((uint64_t)blocks[slot] & 15) == 0, "allocation is not 16 byte aligned");
+		for(uint64_t j = 0;j < sizes[slot];j++) {
+			blocks[slot][j] = (char)(thread + j);
+		}
+	}
+	for(int i = 0;i < LIVE;i++) {
+		__chaos_free(blocks[i]);
+	}
+	return NULL;
+}
+
+static int task(void) {
+	void* block = __chaos_alloc(100);
+	__chaos_free(block);
+	return 3;
+}
+
+static void* tasks(void* argument) {
+	(void)argument;
+	TASK* handles[100];
+	int sum = 0;
+	for(int i = 0;i < 100;i++) {
+		handles[i] = __chaos_spawn(task);
+	}
+	for(int i = 0;i < 100;i++) {
+		sum = sum + __chaos_join(handles[i]);
+	}
+	check(sum == 300, "tasks of a host thread");
+	return NULL;
+}
+
+static int pipes[THREADS][2];
+static __thread int own;                   // Index of the thread, coroutines run on it
+
+static int reader(void) {
+	int value = 0;
+	// Nothing was written yet, the coroutine parks
+	long ret = __chaos_read(pipes[own][0], &value, sizeof(value));
+	return ret == sizeof(value) ? value : -1;
+}
+
+static int writer(void) {
+	int value = own * 10;
+	return (int)__chaos_write(pipes[own][1], &value, sizeof(value));
+}
+
+static void* coroutines(void* argument) {
+	own = (int)(long)argument;
+	for(int i = 0;i < 200;i++) {
+		COROUTINE* read = __chaos_go(reader);
+		COROUTINE* written = __chaos_go(writer);
+		check(__chaos_await(read) == own * 10, "coroutine read the wrong value");
+		check(__chaos_await(written) == sizeof(int), "coroutine could not write");
+	}
+	return NULL;
+}
+
+static void* printer(void* argument) {
+	int thread = (int)(long)argument;
+	for(int i = 0;i < 1000;i++) {
+		__chaos_print_int(thread * 1000 + i);
+	}
+	return NULL;
+}
+
+static void run(void* (*function)(void*)) {
+	pthread_t threads[THREADS];
+	for(long i = 0;i < THREADS;i++) {
+		pthread_create(&threads[i], NULL, function, (void*)i);
+	}
+	for(int i = 0;i < THREADS;i++) {
+		pthread_join(threads[i], NULL);
+	}
+}
+
+int main(int argc, char* argv[]) {
+	if(argc > 1 && strcmp(argv[1], "print") == 0) {
+		// Only runtime output, the host flushes it
+		run(printer);
+		__chaos_flush();
+		return 0;
+	}
+	MEMORY_STATS stats;
+	__chaos_memory_stats(&stats);
+	uint64_t allocations = stats.allocations;
+
+	// Size classes and a large block
+	void* small = __chaos_alloc(24);
+	void* large = __chaos_alloc(100000);
+	__chaos_memory_stats(&stats);
+	check(stats.small_used == 32 && stats.large_used >= 100000, "used bytes of small and large blocks");
+	check(stats.allocations == allocations + 2, "allocation count");
+	__chaos_free(small);
+	__chaos_free(large);
+	__chaos_free(NULL);
+	__chaos_memory_stats(&stats);
+	check(stats.small_used == 0 && stats.large_used == 0, "used bytes after free");
+
+	// Arenas: reset hands out the same memory again
+	MEMORY_ARENA* arena = __chaos_arena_create();
+	char* first = __chaos_arena_alloc(arena, 100);
+	for(int i = 0;i < 2000;i++) {
+		char* block = __chaos_arena_alloc(arena, 100);
+		memset(block, i, 100);
+	}
+	__chaos_memory_stats(&stats);
+	check(stats.arena_used == 2001 * 112, "arena bytes");
+	__chaos_arena_reset(arena);
+	check(__chaos_arena_alloc(arena, 100) == first, "arena reset");
+	__chaos_memory_stats(&stats);
+	check(stats.arena_used == 112 && stats.arena_resets == 1, "arena bytes after reset");
+	__chaos_arena_destroy(arena);
+	__chaos_memory_stats(&stats);
+	check(stats.arena_used == 0, "arena bytes after destroy");
+
+	// Threads of the host, before and after tasks started
+	run(churn);
+	run(tasks);
+	run(churn);
+	for(int i = 0;i < THREADS;i++) {
+		check(pipe(pipes[i]) == 0, "pipe");
+	}
+	run(coroutines);
+	__chaos_memory_stats(&stats);
+	check(stats.small_used == 0 && stats.large_used == 0 && stats.allocations == stats.frees, "everything was freed");
+	printf("%s\n", failures == 0 ? "allocator ok" : "allocator failed");
+	return failures != 0;
+}
@@ -0,0 +1,43 @@
+// Host of work.soft: libc threads call the exported work, which spawns a task
+// and prints, and flush the output of the library before the host exits.
+#include <stdio.h>
+#include <dlfcn.h>
+#include <pthread.h>
+
+#define THREADS 8
+
+static int (*work)(int);
+
+static void* call(void* argument) {
+	int failures = 0;
+	for(int i = 0;i < 50;i++) {
+		failures += work((int)(long)argument) != 7 + (int)(long)argument;
+	}
+	return (void*)(long)failures;
+}
+
+int main(int argc, char* argv[]) {
+	void* library = dlopen(argc > 1 ? argv[1] : "./libwork.so", RTLD_NOW);
+	if(library == NULL) {
+		printf("[ERROR] %s\n", dlerror());
+		return 1;
+	}
+	work = (int (*)(int))dlsym(library, "work");
+	void (*flush)(void) = (void (*)(void))dlsym(library, "__chaos_flush");
+	if(work == NULL || flush == NULL) {
+		printf("[ERROR] work or __chaos_flush is missing.\n");
+		return 1;
+	}
+	pthread_t threads[THREADS];
+	for(long i = 0;i < THREADS;i++) {
+		pthread_create(&threads[i], NULL, call, (void*)(i * 100));
+	}
+	long failures = 0;
+	for(int i = 0;i < THREADS;i++) {
+		void* ret;
+		pthread_join(threads[i], &ret);
+		failures += (long)ret;
+	}
+	flush();
+	return failures != 0;
+}
@@ -0,0 +1,72 @@
+// Host of the calling convention check: loads the library given as
+// argument, calls its functions with arguments on the stack and with the
+// callee-saved registers set, and is called back
+#include <stdio.h>
+#include <dlfcn.h>
+
+int (*leaf)(int);
+long preserved(void);
+
+int host_mix(int a, int b, int c, int d, int e, int f, int g, int h) {
+	return a * 1000 + b * 100 + c * 10 + d - e - f - g - h;
+}
+
+// Sets rbx, rbp and r12-r15 to known values, calls leaf(5) and returns 0
+// if they are still the same and the result is 15
+__asm__(
+	".text\n"
+	".globl preserved\n"
+	"preserved:\n"
+	"\tpushq %rbx\n"
+	"\tpushq %rbp\n"
+	"\tpushq %r12\n"
+	"\tpushq %r13\n"
+	"\tpushq %r14\n"
+	"\tpushq %r15\n"
+	"\tsubq $8, %rsp\n"
+	"\tmovq $0x1111, %rbx\n"
+	"\tmovq $0x2222, %rbp\n"
+	"\tmovq $0x3333, %r12\n"
+	"\tmovq $0x4444, %r13\n"
+	"\tmovq $0x5555, %r14\n"
+	"\tmovq $0x6666, %r15\n"
+	"\tmovl $5, %edi\n"
+	"\tcall *leaf(%rip)\n"
+	"\txorq $15, %rax\n"
+	"\txorq $0x1111, %rbx\n"
+	"\torq %rbx, %rax\n"
+	"\txorq $0x2222, %rbp\n"
+	"\torq %rbp, %rax\n"
+	"\txorq $0x3333, %r12\n"
+	"\torq %r12, %rax\n"
+	"\txorq $0x4444, %r13\n"
+	"\torq %r13, %rax\n"
+	"\txorq $0x5555, %r14\n"
+	"\torq %r14, %rax\n"
+	"\txorq $0x6666, %r15\n"
+	"\torq %r15, %rax\n"
+	"\taddq $8, %rsp\n"
+	"\tpopq %r15\n"
+	"\tpopq %r14\n"
+	"\tpopq %r13\n"
+	"\tpopq %r12\n"
+	"\tpopq %rbp\n"
+	"\tpopq %rbx\n"
+	"\tret\n"
+);
+
+int main(int argc, char* argv[]) {
+	void* library = dlopen(argc > 1 ? argv[1] : "./libcalls.so", RTLD_NOW);
+	if(library == NULL) {
+		printf("%s\n", dlerror());
+		return 1;
+	}
+	int (*eight)(int, int, int, int, int, int, int, int) = (int (*)(int, int, int, int, int, int, int, int))dlsym(library, "eight");
+	int (*from_soft)(int) = (int (*)(int))dlsym(library, "from_soft");
+	int (*through_host)(int) = (int (*)(int))dlsym(library, "through_host");
+	leaf = (int (*)(int))dlsym(library, "leaf");
+	printf("%d %d %d\n", eight(1, 2, 3, 4, 5, 6, 7, 8), eight(-1, 0, 0, 0, 0, 0, 0, 1000), leaf(-7));
+	printf("%d %d\n", from_soft(1), through_host(9));
+	printf("%s\n", preserved() == 0 ? "preserved" : "clobbered");
+	return 0;
+}
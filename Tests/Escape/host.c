@@ -0,0 +1,35 @@
+// Host of lib.soft: keep holds on to the arrays, they are still there after
+// the functions returned and belong to the heap of the runtime
+#include <stdio.h>
+#include <dlfcn.h>
+
+static int* kept[2];
+static int count;
+
+int keep(int* array) {
+	kept[count++] = array;
+	return array[1];
+}
+
+int main(int argc, char* argv[]) {
+	void* library = dlopen(argc > 1 ? argv[1] : "./liblib.so", RTLD_NOW);
+	if(library == NULL) {
+		printf("[ERROR] %s\n", dlerror());
+		return 1;
+	}
+	int (*stash)(int) = (int (*)(int))dlsym(library, "stash");
+	int (*through)(int) = (int (*)(int))dlsym(library, "through");
+	void (*release)(void*) = (void (*)(void*))dlsym(library, "__chaos_free");
+	if(stash == NULL || through == NULL || release == NULL) {
+		printf("[ERROR] stash, through or __chaos_free is missing.\n");
+		return 1;
+	}
+	int first = stash(5);
+	int second = through(42);
+	printf("%d %d\n", first, second);
+	printf("%d %d %d\n", kept[0][0], kept[0][1], kept[0][2]);
+	printf("%d %d %d\n", kept[1][0], kept[1][1], kept[1][39]);
+	release(kept[0]);
+	release(kept[1]);
+	return 0;
+}
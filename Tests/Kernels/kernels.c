@@ -0,0 +1,138 @@
+// Kernel check: every variant of Runtime/Kernels/kernels.c against byte
+// loops, for all short sizes and alignments, the ERMS sizes and strings
+// that end right before an unmapped page.
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "../../Runtime/Kernels/kernels.c"
+
+#define GUARD 0xEE
+
+// Only __chaos_cpu_level needs the rest of the runtime
+long __chaos_out(int fd, const void* data, uint64_t size) {
+	return write(fd, data, size);
+}
+
+void __chaos_exit(int status) {
+	_exit(status);
+}
+
+typedef struct _KERNELS_VARIANT_ {
+	const char* name;
+	KERNELS_MEMCPY copy;
+	KERNELS_MEMSET set;
+	KERNELS_MEMCMP compare;
+	KERNELS_MEMCHR find;
+	KERNELS_STRLEN length;
+} KERNELS_VARIANT;
+
+static int failures;
+
+static void check(int condition, const char* variant, const char* kernel, uint64_t size, int offset) {
+	if(!condition && failures++ < 10) {
+		printf("[ERROR] %s %s, size %llu, offset %d\n", variant, kernel, (unsigned long long)size, offset);
+	}
+}
+
+static unsigned char* find(unsigned char* block, int value, uint64_t size) {
+	for(uint64_t i = 0;i < size;i++) {
+		if(block[i] == (unsigned char)value) {
+			return block + i;
+		}
+	}
+	return NULL;
+}
+
+static void test(const KERNELS_VARIANT* variant, unsigned char* source, unsigned char* destination, uint64_t size, int offset) {
+	unsigned char* to = destination + 64 + offset;
+	unsigned char* from = source + 64 + (offset * 5) % 64;
+	for(uint64_t i = 0;i < size;i++) {
+		from[i] = (unsigned char)(size + i * 7 + (i >> 8));
+	}
+	for(uint64_t i = 0;i < size + 128;i++) {
+		destination[i] = GUARD;
+	}
+	check(variant->copy(to, from, size) == to, variant->name, "memcpy result", size, offset);
+	bool same = to[-1] == GUARD && to[size] == GUARD;
+	for(uint64_t i = 0;i < size && same;i++) {
+		same = to[i] == from[i];
+	}
+	check(same, variant->name, "memcpy", size, offset);
+
+	check(variant->compare(to, from, size) == 0, variant->name, "memcmp equal", size, offset);
+	if(size > 0) {
+		uint64_t at = (size * 3) / 4;
+		// Bytes compare unsigned
+		to[at] = (unsigned char)(from[at] ^ 0x80);
+		int order = to[at] > from[at] ? 1 : -1;
+		check(variant->compare(to, from, size) * order > 0 && variant->compare(from, to, size) * order < 0, variant->name, "memcmp order", size, offset);
+		check(variant->find(to, to[at], size) == find(to, to[at], size), variant->name, "memchr", size, offset);
+	}
+	check(variant->find(to, 0x100 | 0x5A, size) == find(to, 0x5A, size), variant->name, "memchr of an int", size, offset);
+	check(variant->find(to, GUARD, size) == find(to, GUARD, size), variant->name, "memchr after the end", size, offset);
+
+	check(variant->set(to, 0x1C3, size) == to, variant->name, "memset result", size, offset);
+	same = to[-1] == GUARD && to[size] == GUARD;
+	for(uint64_t i = 0;i < size && same;i++) {
+		same = to[i] == 0xC3;
+	}
+	check(same, variant->name, "memset", size, offset);
+}
+
+static void strings(const KERNELS_VARIANT* variant, unsigned char* page) {
+	// Strings that end on the last byte before an unmapped page
+	unsigned char* end = page + 4096;
+	for(uint64_t length = 0;length < 300;length++) {
+		unsigned char* string = end - length - 1;
+		for(uint64_t i = 0;i < length;i++) {
+			string[i] = (unsigned char)('a' + i % 26);
+		}
+		string[length] = '\0';
+		check(variant->length((const char*)string) == length, variant->name, "strlen at a page end", length, 0);
+		check(variant->find(string, 0, length + 1) == string + length, variant->name, "memchr at a page end", length, 0);
+	}
+	for(int offset = 0;offset < 64;offset++) {
+		unsigned char* string = page + offset;
+		for(uint64_t i = 0;i < 1000;i++) {
+			string[i] = 'x';
+		}
+		string[999 - offset] = '\0';
+		check(variant->length((const char*)string) == 999 - (uint64_t)offset, variant->name, "strlen", 999 - offset, offset);
+	}
+}
+
+int main() {
+	KERNELS_VARIANT variants[2] = {
+		{ "sse2", Kernels__memcpy_sse2, Kernels__memset_sse2, Kernels__memcmp_sse2, Kernels__memchr_sse2, Kernels__strlen_sse2 },
+		{ "avx2", Kernels__memcpy_avx2, Kernels__memset_avx2, Kernels__memcmp_avx2, Kernels__memchr_avx2, Kernels__strlen_avx2 }
+	};
+	int count = (__chaos_cpu_features() & KERNELS_FEATURE_AVX2) ? 2 : 1;
+	uint64_t large[] = { KERNELS_ERMS_MIN - 1, KERNELS_ERMS_MIN, KERNELS_ERMS_MIN + 33, 65536 + 17 };
+	unsigned char* source = mmap(NULL, 1 << 20, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	unsigned char* destination = mmap(NULL, 1 << 20, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	unsigned char* page = mmap(NULL, 8192, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if(source == MAP_FAILED || destination == MAP_FAILED || page == MAP_FAILED || mprotect(page + 4096, 4096, PROT_NONE) != 0) {
+		printf("[ERROR] Could not map the buffers.\n");
+		return 1;
+	}
+	for(int i = 0;i < count;i++) {
+		for(uint64_t size = 0;size <= 300;size++) {
+			for(int offset = 0;offset < 64;offset++) {
+				test(&variants[i], source, destination, size, offset);
+			}
+		}
+		for(int j = 0;j < 4;j++) {
+			for(int offset = 0;offset < 64;offset = offset + 7) {
+				test(&variants[i], source, destination, large[j], offset);
+			}
+		}
+		strings(&variants[i], page);
+	}
+	// The dispatched kernels are the ones of the CPU
+	unsigned char text[] = "dispatch";
+	check(__chaos_strlen((const char*)text) == 8 && __chaos_memchr(text, 't', 8) == text + 5, "dispatched", "kernels", 8, 0);
+	check(__chaos_cpu_level(KERNELS_LEVEL_X86_64) >= KERNELS_LEVEL_X86_64, "dispatched", "cpu level", 0, 0);
+	printf("%s\n", failures == 0 ? "kernels ok" : "kernels failed");
+	return failures != 0;
+}
@@ -0,0 +1,21 @@
+// __chaos_cpu_level of _start: the level of the CPU, or an error for a higher one
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "../../Runtime/Kernels/kernels.c"
+
+long __chaos_out(int fd, const void* data, uint64_t size) {
+	return write(fd, data, size);
+}
+
+void __chaos_exit(int status) {
+	_exit(status);
+}
+
+int main(int argc, char* argv[]) {
+	long required = argc > 1 ? atol(argv[1]) : KERNELS_LEVEL_X86_64;
+	long level = __chaos_cpu_level(required);
+	printf("%s\n", level >= required && level <= KERNELS_LEVEL_V4 ? "level ok" : "level failed");
+	return 0;
+}
@@ -0,0 +1,132 @@
+// Output runtime check: a libc host linked with chaosrt.o writes into pipes
+// and looks at what reached them (FIONREAD) after every step.
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+
+#include "../../Runtime/IO/io.h"
+
+static int failures;
+
+static void check(int condition, const char* what) {
+	if(!condition) {
+		printf("[ERROR] %s\n", what);
+		failures++;
+	}
+}
+
+static int pending(int fd) {
+	int bytes = -1;
+	ioctl(fd, FIONREAD, &bytes);
+	return bytes;
+}
+
+static int drain(int fd, char* text, int size) {
+	int length = 0, ret;
+	while(length < size && pending(fd) > 0 && (ret = (int)read(fd, text + length, size - length)) > 0) {
+		length += ret;
+	}
+	text[length] = '\0';
+	return length;
+}
+
+static void pipes(int descriptors[2]) {
+	if(pipe(descriptors) != 0) {
+		printf("[ERROR] pipe\n");
+		_exit(1);
+	}
+	// Room for more than one buffer
+	fcntl(descriptors[1], F_SETPIPE_SZ, 1 << 20);
+}
+
+int main() {
+	static char text[1 << 20];
+	int a[2], b[2];
+	pipes(a);
+	pipes(b);
+
+	// Pipes are fully buffered: nothing is written before the flush, then in order
+	check(__chaos_out(a[1], "one ", 4) == 4 && __chaos_out(b[1], "x", 1) == 1 && __chaos_out(a[1], "two\n", 4) == 4, "out");
+	check(pending(a[0]) == 0 && pending(b[0]) == 0, "pipe written before the flush");
+	check(__chaos_flush() == 0, "flush");
+	check(drain(a[0], text, sizeof(text) - 1) == 8 && strcmp(text, "one two\n") == 0, "order of one descriptor");
+	check(drain(b[0], text, sizeof(text) - 1) == 1 && strcmp(text, "x") == 0, "second descriptor");
+
+	// IO_RUNS descriptor changes fill the run table, the next change writes it
+	for(int i = 0;i < IO_RUNS;i++) {
+		__chaos_out(i % 2 == 0 ? a[1] : b[1], "r", 1);
+	}
+	check(pending(a[0]) == 0, "runs written too early");
+	__chaos_out(a[1], "r", 1);
+	check(pending(a[0]) == IO_RUNS / 2 && pending(b[0]) == IO_RUNS / 2, "full run table");
+	__chaos_flush();
+	check(drain(a[0], text, sizeof(text) - 1) == IO_RUNS / 2 + 1, "run after the full table");
+	drain(b[0], text, sizeof(text) - 1);
+
+	// A full buffer goes out together with the data that did not fit
+	memset(text, 'f', IO_BUFFER_SIZE);
+	__chaos_out(a[1], text, IO_BUFFER_SIZE - 10);
+	check(pending(a[0]) == 0, "buffer written before it is full");
+	__chaos_out(a[1], text, 20);
+	check(pending(a[0]) == IO_BUFFER_SIZE + 10, "full buffer");
+	drain(a[0], text, sizeof(text) - 1);
+	__chaos_out(a[1], "small", 5);
+	__chaos_out(a[1], text, IO_BUFFER_SIZE + 100);
+	check(pending(a[0]) == IO_BUFFER_SIZE + 105, "write larger than the buffer");
+	drain(a[0], text, sizeof(text) - 1);
+	check(strncmp(text, "smallfff", 8) == 0, "order of a large write");
+
+	// Line buffered: a line end writes, unbuffered: every call writes
+	__chaos_io_mode(b[1], IO_MODE_LINE);
+	__chaos_out(b[1], "line", 4);
+	check(pending(b[0]) == 0, "line written before its end");
+	__chaos_out(b[1], " end\nrest", 9);
+	check(pending(b[0]) == 13, "line mode");
+	__chaos_io_mode(a[1], IO_MODE_NONE);
+	__chaos_out(a[1], "now", 3);
+	check(pending(a[0]) == 3, "unbuffered mode");
+	__chaos_flush();
+	drain(a[0], text, sizeof(text) - 1);
+	drain(b[0], text, sizeof(text) - 1);
+
+	// Errors of the write are negative errno values
+	int closed = dup(a[1]);
+	close(closed);
+	__chaos_io_mode(closed, IO_MODE_NONE);
+	check(__chaos_out(closed, "x", 1) == -EBADF, "error of an unbuffered write");
+	__chaos_io_mode(closed, IO_MODE_FULL);
+	__chaos_out(closed, "x", 1);
+	check(__chaos_flush() == -EBADF, "error of the flush");
+
+	// print of the extremes on stdout (a pipe)
+	int out = dup(1);
+	dup2(a[1], 1);
+	__chaos_io_mode(1, IO_MODE_FULL);
+	__chaos_print_int(INT_MIN);
+	__chaos_print_int(INT_MAX);
+	__chaos_print_int(0);
+	__chaos_print_int(-7);
+	__chaos_flush();
+	dup2(out, 1);
+	drain(a[0], text, sizeof(text) - 1);
+	check(strcmp(text, "-2147483648\n2147483647\n0\n-7\n") == 0, "print");
+
+	// Mapped files
+	const void* data;
+	long size = __chaos_map_file(__FILE__, &data);
+	FILE* file = fopen(__FILE__, "r");
+	long length = file != NULL ? (long)fread(text, 1, sizeof(text), file) : -1;
+	if(file != NULL) {
+		fclose(file);
+	}
+	check(size > 0 && size == length && memcmp(data, text, size) == 0, "mapped file");
+	__chaos_unmap_file(data, size);
+	check(__chaos_map_file("missing.file", &data) == -ENOENT && data == NULL, "missing file");
+	printf("%s\n", failures == 0 ? "io ok" : "io failed");
+	return failures != 0;
+}
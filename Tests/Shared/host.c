@@ -0,0 +1,20 @@
+// Host of the shared object check: loads the library given as argument
+#include <stdio.h>
+#include <dlfcn.h>
+int host_add(int a, int b) {
+	return a + b;
+}
+int main(int argc, char* argv[]) {
+	void* library = dlopen(argv[1], RTLD_NOW);
+	if(library == NULL) {
+		printf("%s\n", dlerror());
+		return 1;
+	}
+	int (*triple_plus)(int) = (int (*)(int))dlsym(library, "triple_plus");
+	int (*through_host)(int) = (int (*)(int))dlsym(library, "through_host");
+	int* base = (int*)dlsym(library, "__GLOBALVAR_base");
+	printf("%d %d\n", triple_plus(7), through_host(37));
+	*base = 1;
+	printf("%d %s\n", triple_plus(7), dlsym(library, "helper") == NULL ? "hidden" : "visible");
+	return 0;
+}
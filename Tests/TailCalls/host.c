@@ -0,0 +1,53 @@
+// Host of the tail call check: runs the endless recursions of the library
+// given as argument on a 64 KiB stack, host_step ends them after enough
+// steps with longjmp
+#include <stdio.h>
+#include <setjmp.h>
+#include <dlfcn.h>
+#include <pthread.h>
+
+#define STEPS 10000000
+
+static jmp_buf done;
+static int (*recursion)(int);
+
+int host_step(int n) {
+	if(n == STEPS) {
+		longjmp(done, 1);
+	}
+	return n + 1;
+}
+
+int host_twice(int a) {
+	return a * 2;
+}
+
+static void* run(void* argument) {
+	(void)argument;
+	if(setjmp(done) == 0) {
+		recursion(0);
+	}
+	return NULL;
+}
+
+int main(int argc, char* argv[]) {
+	void* library = dlopen(argc > 1 ? argv[1] : "./libtail.so", RTLD_NOW);
+	if(library == NULL) {
+		printf("%s\n", dlerror());
+		return 1;
+	}
+	const char* names[] = { "loop", "ping" };
+	for(int i = 0;i < 2;i++) {
+		recursion = (int (*)(int))dlsym(library, names[i]);
+		pthread_attr_t attributes;
+		pthread_attr_init(&attributes);
+		pthread_attr_setstacksize(&attributes, 64 << 10);
+		pthread_t thread;
+		pthread_create(&thread, &attributes, run, NULL);
+		pthread_join(thread, NULL);
+		printf("%s: %d steps\n", names[i], STEPS);
+	}
+	int (*to_host)(int) = (int (*)(int))dlsym(library, "to_host");
+	printf("%d\n", to_host(21));
+	return 0;
+}
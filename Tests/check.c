@@ -0,0 +1,221 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <limits.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+// Regression checks (make check)
+//   Every directory Tests/<name> with a case.check file is one case. Its
+//   commands run with sh in an empty directory <work>/<name>, in order,
+//   until the first one fails:
+//     # comment
+//     $ <command>      has to exit with 0
+//     ! <command>      has to exit with something else
+//     > <line>         the output (stdout and stderr) of the command before
+//                      is exactly these lines
+//     ~ <text>         the output of the command before contains the text
+//   The commands find the tools in the environment:
+//     SOFT     the token compiler      CCC     the build engine (main.c)
+//     RUNTIME  chaosrt.o               CASE    the directory of the case
+//     LIMITS   the usual limits of the compiler ("1000 1000 100 100000 1")
+//     CC       a C compiler for reference programs and hosts
+//     check <compiler> <builder> <runtime> <tests directory> <work directory> [<case>...]
+
+#define CHECK_MAX_OUTPUT (256 << 10)
+#define CHECK_MAX_CASES 256
+#define CHECK_LIMITS "1000 1000 100 100000 1"
+
+typedef struct _CHECK_COMMAND_ {
+	char* command;
+	bool fails;                        // "!"
+	int line;
+	char* expected;                    // "> " lines, NULL = any output
+	size_t expected_length;
+	char** contains;                   // "~ " texts
+	int contains_count;
+} CHECK_COMMAND;
+
+static int Check__run(CHECK_COMMAND* command, const char* name, char* output, size_t size) {
+	// Runs one command and compares its status and output
+	char* line = malloc(strlen(command->command) + 16);
+	sprintf(line, "(%s) 2>&1", command->command);
+	FILE* pipe = popen(line, "r");
+	free(line);
+	if(pipe == NULL) {
+		printf("[ERROR] %s:%d: could not run the command.\n", name, command->line);
+		return -1;
+	}
+	size_t length = 0, read;
+	while((read = fread(output + length, 1, size - 1 - length, pipe)) > 0) {
+		length += read;
+	}
+	output[length] = '\0';
+	int status = pclose(pipe);
+	bool success = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+	if(success == command->fails) {
+		printf("[ERROR] %s:%d: \"%s\" %s.\n%s", name, command->line, command->command, command->fails ? "did not fail" : "failed", output);
+		return -1;
+	}
+	if(command->expected != NULL && (length != command->expected_length || memcmp(output, command->expected, length) != 0)) {
+		printf("[ERROR] %s:%d: output of \"%s\" differs.\n--- expected\n%s--- got\n%s", name, command->line, command->command, command->expected, output);
+		return -1;
+	}
+	for(int i = 0;i < command->contains_count;i++) {
+		if(strstr(output, command->contains[i]) == NULL) {
+			printf("[ERROR] %s:%d: output of \"%s\" does not contain \"%s\".\n%s", name, command->line, command->command, command->contains[i], output);
+			return -1;
+		}
+	}
+	return 0;
+}
+
+static void Check__free(CHECK_COMMAND* command) {
+	free(command->command);
+	free(command->expected);
+	for(int i = 0;i < command->contains_count;i++) {
+		free(command->contains[i]);
+	}
+	free(command->contains);
+	memset(command, 0, sizeof(*command));
+}
+
+static int Check__case(const char* tests, const char* work, const char* name) {
+	char path[PATH_MAX], directory[PATH_MAX], real[PATH_MAX];
+	snprintf(path, sizeof(path), "%s/%s", tests, name);
+	if(realpath(path, real) == NULL) {
+		printf("[ERROR] Could not find the case \"%s\".\n", path);
+		return -1;
+	}
+	setenv("CASE", real, 1);
+	snprintf(path, sizeof(path), "%s/%s/case.check", tests, name);
+	FILE* file = fopen(path, "r");
+	if(file == NULL) {
+		printf("[ERROR] Could not open \"%s\".\n", path);
+		return -1;
+	}
+	snprintf(directory, sizeof(directory), "%s/%s", work, name);
+	char* command_line = malloc(strlen(directory) * 2 + 32);
+	sprintf(command_line, "rm -rf '%s' && mkdir -p '%s'", directory, directory);
+	int created = system(command_line);
+	free(command_line);
+	if(created != 0 || chdir(directory) != 0) {
+		printf("[ERROR] Could not create \"%s\".\n", directory);
+		fclose(file);
+		return -1;
+	}
+
+	static char output[CHECK_MAX_OUTPUT];
+	CHECK_COMMAND command = {0};
+	char line[8192];
+	int number = 0, ret = 0;
+	while(ret == 0) {
+		bool end = fgets(line, sizeof(line), file) == NULL;
+		number++;
+		size_t length = end ? 0 : strlen(line);
+		if(length > 0 && line[length - 1] == '\n') {
+			line[--length] = '\0';
+		}
+		char kind = length >= 2 && line[1] == ' ' ? line[0] : length == 1 ? line[0] : '\0';
+		const char* text = length >= 2 ? line + 2 : "";
+		if(end || kind == '$' || kind == '!') {
+			// The command before is complete
+			if(command.command != NULL) {
+				ret = Check__run(&command, name, output, sizeof(output));
+				Check__free(&command);
+			}
+			if(end) {
+				break;
+			}
+			command.command = strdup(text);
+			command.fails = kind == '!';
+			command.line = number;
+		}
+		else if((kind == '>' || kind == '~') && command.command == NULL) {
+			printf("[ERROR] %s:%d: output without a command.\n", name, number);
+			ret = -1;
+		}
+		else if(kind == '>') {
+			command.expected = realloc(command.expected, command.expected_length + strlen(text) + 2);
+			memcpy(command.expected + command.expected_length, text, strlen(text));
+			command.expected_length += strlen(text);
+			command.expected[command.expected_length++] = '\n';
+			command.expected[command.expected_length] = '\0';
+		}
+		else if(kind == '~') {
+			command.contains = realloc(command.contains, (command.contains_count + 1) * sizeof(char*));
+			command.contains[command.contains_count++] = strdup(text);
+		}
+		else if(kind != '#' && length > 0) {
+			printf("[ERROR] %s:%d: unknown line \"%s\".\n", name, number, line);
+			ret = -1;
+		}
+	}
+	Check__free(&command);
+	fclose(file);
+	if(ret == 0) {
+		printf("[CHECK] %s\n", name);
+	}
+	return ret;
+}
+
+static int Check__compare_names(const void* a, const void* b) {
+	return strcmp(*(char* const*)a, *(char* const*)b);
+}
+
+int main(int argc, char* argv[]) {
+	if(argc < 6) {
+		printf("[ERROR] Not enough arguments.\n<compiler> <builder> <runtime> <tests directory> <work directory> [<case>...]\n");
+		return 1;
+	}
+	// Absolute paths, the cases run in their own directories
+	char compiler[PATH_MAX], builder[PATH_MAX], runtime[PATH_MAX], tests[PATH_MAX], work[PATH_MAX];
+	mkdir(argv[5], 0755);
+	if(realpath(argv[1], compiler) == NULL || realpath(argv[2], builder) == NULL || realpath(argv[3], runtime) == NULL ||
+	   realpath(argv[4], tests) == NULL || realpath(argv[5], work) == NULL) {
+		printf("[ERROR] Compiler, builder, runtime, tests and work directory have to exist.\n");
+		return 1;
+	}
+	setenv("SOFT", compiler, 1);
+	setenv("CCC", builder, 1);
+	setenv("RUNTIME", runtime, 1);
+	setenv("LIMITS", CHECK_LIMITS, 1);
+	setenv("CC", getenv("CC") != NULL ? getenv("CC") : "cc", 1);
+
+	// All cases in name order, or the ones given
+	char* names[CHECK_MAX_CASES];
+	int count = 0;
+	if(argc > 6) {
+		for(int i = 6;i < argc && count < CHECK_MAX_CASES;i++) {
+			names[count++] = strdup(argv[i]);
+		}
+	}
+	else {
+		DIR* cases = opendir(tests);
+		if(cases == NULL) {
+			printf("[ERROR] Could not open \"%s\".\n", tests);
+			return 1;
+		}
+		struct dirent* entry;
+		while((entry = readdir(cases)) != NULL && count < CHECK_MAX_CASES) {
+			char path[PATH_MAX];
+			snprintf(path, sizeof(path), "%s/%s/case.check", tests, entry->d_name);
+			if(entry->d_name[0] != '.' && access(path, R_OK) == 0) {
+				names[count++] = strdup(entry->d_name);
+			}
+		}
+		closedir(cases);
+		qsort(names, count, sizeof(names[0]), Check__compare_names);
+	}
+
+	int failed = 0;
+	for(int i = 0;i < count;i++) {
+		failed += Check__case(tests, work, names[i]) != 0;
+		free(names[i]);
+	}
+	printf("[INFO] %d of %d checks passed.\n", count - failed, count);
+	return failed != 0;
+}
@@ -0,0 +1,112 @@
+#include <string.h>
+#include <time.h>
+#include <malloc.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+
+#include "time_report.h"
+
+#define C compiler
+
+static double TimeReport__clock(clockid_t clock) {
+	struct timespec now;
+	clock_gettime(clock, &now);
+	return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+static int64_t TimeReport__heap(void) {
+	// Bytes in use: small blocks of all arenas and mmapped blocks
+	struct mallinfo2 info = mallinfo2();
+	return (int64_t)(info.uordblks + info.hblkhd);
+}
+
+static long TimeReport__peak_rss(void) {
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return usage.ru_maxrss;
+}
+
+void TimeReport__begin(COMPILER* compiler) {
+	TIME_REPORT* report = &C->time_report;
+	if(report->mode == TIME_REPORT_OFF) {
+		return;
+	}
+	report->wall = TimeReport__clock(CLOCK_MONOTONIC);
+	report->cpu = TimeReport__clock(CLOCK_PROCESS_CPUTIME_ID);
+	report->heap = TimeReport__heap();
+}
+
+void TimeReport__end(COMPILER* compiler, const char* phase) {
+	TIME_REPORT* report = &C->time_report;
+	if(report->mode == TIME_REPORT_OFF) {
+		return;
+	}
+	double wall = TimeReport__clock(CLOCK_MONOTONIC) - report->wall;
+	double cpu = TimeReport__clock(CLOCK_PROCESS_CPUTIME_ID) - report->cpu;
+	int64_t heap = TimeReport__heap() - report->heap;
+
+	TIME_PHASE* entry = NULL;
+	for(int i = 0;i < report->phase_count && entry == NULL;i++) {
+		if(strcmp(report->phases[i].name, phase) == 0) {
+			entry = &report->phases[i];
+		}
+	}
+	if(entry == NULL) {
+		if(report->phase_count == TIME_REPORT_MAX_PHASES) {
+			return;
+		}
+		entry = &report->phases[report->phase_count++];
+		memset(entry, 0, sizeof(TIME_PHASE));
+		entry->name = phase;
+	}
+	entry->wall = entry->wall + wall;
+	entry->cpu = entry->cpu + cpu;
+	entry->heap = entry->heap + heap;
+	entry->peak_rss = TimeReport__peak_rss();
+}
+
+void TimeReport__print(COMPILER* compiler) {
+	TIME_REPORT* report = &C->time_report;
+	if(report->mode == TIME_REPORT_OFF) {
+		return;
+	}
+	TIME_PHASE total = { "total", 0, 0, 0, TimeReport__peak_rss() };
+	for(int i = 0;i < report->phase_count;i++) {
+		total.wall = total.wall + report->phases[i].wall;
+		total.cpu = total.cpu + report->phases[i].cpu;
+		total.heap = total.heap + report->phases[i].heap;
+	}
+	struct stat output;
+	long long output_bytes = C->bflagsArgs[0] && stat(C->output_file, &output) == 0 ? (long long)output.st_size : 0;
+	unsigned long long text = C->image.sections[OUTPUT_SECTION_TEXT].buffer.size;
+	unsigned long long rodata = C->image.sections[OUTPUT_SECTION_RODATA].buffer.size;
+	unsigned long long data = C->image.sections[OUTPUT_SECTION_DATA].buffer.size;
+	unsigned long long bss = C->image.sections[OUTPUT_SECTION_BSS].buffer.size;
+
+	if(report->mode == TIME_REPORT_JSON) {
+		printf("{\"file\":\"%s\",\"phases\":[", C->fName);
+		for(int i = 0;i <= report->phase_count;i++) {
+			TIME_PHASE* phase = i < report->phase_count ? &report->phases[i] : &total;
+			if(i == report->phase_count) {
+				printf("],\"total\":");
+			}
+			else if(i > 0) {
+				printf(",");
+			}
+			printf("{\"name\":\"%s\",\"wall_ms\":%.3f,\"cpu_ms\":%.3f,\"heap_bytes\":%lld,\"peak_rss_kb\":%ld}",
+				phase->name, phase->wall * 1e3, phase->cpu * 1e3, (long long)phase->heap, phase->peak_rss);
+		}
+		printf(",\"counts\":{\"tokens\":%d,\"ir_entries\":%d,\"functions\":%d,\"text_bytes\":%llu,\"rodata_bytes\":%llu,\"data_bytes\":%llu,\"bss_bytes\":%llu,\"output_bytes\":%lld}}\n",
+			C->current_token_index, C->pcc_entries, C->current_function, text, rodata, data, bss, output_bytes);
+		return;
+	}
+
+	printf("[INFO] Time report for \"%s\":\n", C->fName);
+	printf("  %-12s %10s %10s %12s %14s\n", "phase", "wall ms", "cpu ms", "heap bytes", "peak RSS KiB");
+	for(int i = 0;i <= report->phase_count;i++) {
+		TIME_PHASE* phase = i < report->phase_count ? &report->phases[i] : &total;
+		printf("  %-12s %10.3f %10.3f %+12lld %14ld\n", phase->name, phase->wall * 1e3, phase->cpu * 1e3, (long long)phase->heap, phase->peak_rss);
+	}
+	printf("  %d tokens, %d pre-compiled code entries, %d functions\n", C->current_token_index, C->pcc_entries, C->current_function);
+	printf("  .text %llu, .rodata %llu, .data %llu, .bss %llu bytes, output %lld bytes\n", text, rodata, data, bss, output_bytes);
+}
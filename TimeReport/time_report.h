@@ -0,0 +1,27 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "./../structures.h"
+
+// Compiler phase report (-ftime-report, -ftime-report=json)
+//   Every phase of compile() is measured between TimeReport__begin and
+//   TimeReport__end: wall time, CPU time of all threads (translation runs
+//   on -j threads), the change of the bytes malloc has in use and the peak
+//   RSS of the process at its end. Phases that run more than once are
+//   summed. TimeReport__print adds the totals and the sizes of the
+//   results (tokens, pre-compiled code entries, section and output bytes)
+//   and prints a table or one line of JSON on stdout.
+//   Nothing is measured without the option.
+
+enum TIME_REPORT_MODE {
+	TIME_REPORT_OFF,
+	TIME_REPORT_TABLE,
+	TIME_REPORT_JSON,
+};
+
+void TimeReport__begin(COMPILER* compiler);
+void TimeReport__end(COMPILER* compiler, const char* phase);
+void TimeReport__print(COMPILER* compiler);
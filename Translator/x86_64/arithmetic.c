@@ -0,0 +1,426 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "translator.h"
+
+// Instruction selection of calculations
+//   The value is in rax, the result goes to rax. Only rcx, rdx and r8 are
+//   used besides it (caller-saved, see translator.c).
+//   Multiplies by constants become shifts and lea: 2^k, 3/5/9 * 2^k,
+//   products of two of 3, 5 and 9, 2^k + 1 and 2^k - 1, negated ones by a
+//   final neg. Other factors use imul.
+//   Divides and modulos by constants never use div/idiv: 2^k is a shift
+//   (signed ones round towards zero with the bias (n >> 63) >>> (64 - k)),
+//   others multiply by a magic number and keep the high half (Granlund and
+//   Montgomery, "Division by invariant integers using multiplication";
+//   Hacker's Delight 10). Unsigned divisors without an N bit magic number
+//   use the add indicator form q = (t + ((n - t) >> 1)) >> (l - 1). The
+//   modulo is n - q * d with the multiply above.
+//   CHAR to UINT are widened to 64 bit and use 32 bit magic numbers, whose
+//   product fits into one 64 bit imul. LONG to ULONGLONG use mul/imul with
+//   the high half in rdx (LONG is 8 byte on x86_64).
+//   Like in C, operands are promoted to at least int and converted to their
+//   common type (Translator__common), the calculation is done in it and the
+//   result converted to the type of the variable. Bits above the width of a
+//   type are undefined until a conversion extends it (Translator__convert).
+
+// Magic number and shift of a divisor
+typedef struct _ARITHMETIC_MAGIC_ {
+	uint64_t multiplier;
+	int shift;
+	bool add;                          // Unsigned: needs the add indicator form
+} ARITHMETIC_MAGIC;
+
+int Translator__width(int type, bool* is_signed) {
+	// Bits of an integer type
+	switch(type) {
+		case CODE_OBJECT_TYPE_BOOL:
+		case CODE_OBJECT_TYPE_UCHAR:     *is_signed = false; return 8;
+		case CODE_OBJECT_TYPE_CHAR:      *is_signed = true;  return 8;
+		case CODE_OBJECT_TYPE_SHORT:     *is_signed = true;  return 16;
+		case CODE_OBJECT_TYPE_USHORT:    *is_signed = false; return 16;
+		case CODE_OBJECT_TYPE_INT:       *is_signed = true;  return 32;
+		case CODE_OBJECT_TYPE_UINT:      *is_signed = false; return 32;
+		case CODE_OBJECT_TYPE_LONG:
+		case CODE_OBJECT_TYPE_LONGLONG:  *is_signed = true;  return 64;
+		case CODE_OBJECT_TYPE_ULONG:
+		case CODE_OBJECT_TYPE_ULONGLONG: *is_signed = false; return 64;
+	}
+	printf("[ERROR] Calculations need an integer type, not type %d.\n", type);
+	return -1;
+}
+
+static int64_t Translator__truncate(int64_t value, int bits, bool is_signed) {
+	// Constant as a value of the type
+	if(bits == 64) {
+		return value;
+	}
+	uint64_t mask = (1ull << bits) - 1;
+	uint64_t low = (uint64_t)value & mask;
+	if(is_signed && (low >> (bits - 1)) != 0) {
+		return (int64_t)(low | ~mask);
+	}
+	return (int64_t)low;
+}
+
+int64_t Translator__value(int type, int64_t value) {
+	// Constant converted to an integer type (C: modulo 2^N for every type)
+	bool is_signed;
+	int bits = Translator__width(type, &is_signed);
+	return bits < 0 ? value : Translator__truncate(value, bits, is_signed);
+}
+
+static int Translator__rank(int type) {
+	// Integer conversion rank of a promoted type (int, long, long long)
+	return type == CODE_OBJECT_TYPE_INT || type == CODE_OBJECT_TYPE_UINT ? 1 : type == CODE_OBJECT_TYPE_LONG || type == CODE_OBJECT_TYPE_ULONG ? 2 : 3;
+}
+
+static int Translator__promote(int type) {
+	// Types narrower than int are calculated as int
+	bool is_signed;
+	return Translator__width(type, &is_signed) < 32 ? CODE_OBJECT_TYPE_INT : type;
+}
+
+int Translator__common(int a, int b) {
+	// Usual arithmetic conversions of C: the type both operands are converted to
+	a = Translator__promote(a);
+	b = Translator__promote(b);
+	bool a_signed, b_signed;
+	int a_bits = Translator__width(a, &a_signed), b_bits = Translator__width(b, &b_signed);
+	if(a == b) {
+		return a;
+	}
+	if(a_signed == b_signed) {
+		return Translator__rank(a) >= Translator__rank(b) ? a : b;
+	}
+	int unsigned_type = a_signed ? b : a, signed_type = a_signed ? a : b;
+	if(Translator__rank(unsigned_type) >= Translator__rank(signed_type)) {
+		return unsigned_type;
+	}
+	if((a_signed ? a_bits : b_bits) > (a_signed ? b_bits : a_bits)) {
+		// The signed type holds every value of the unsigned one
+		return signed_type;
+	}
+	// Unsigned type of the signed one's rank
+	return signed_type == CODE_OBJECT_TYPE_LONG ? CODE_OBJECT_TYPE_ULONG : CODE_OBJECT_TYPE_ULONGLONG;
+}
+
+int Translator__convert(CODE_BUFFER* buffer, int reg, int from, int to) {
+	// reg holds a value of type from, extends it if to is wider (narrower types use the low bytes)
+	bool from_signed, to_signed;
+	int from_bits = Translator__width(from, &from_signed), to_bits = Translator__width(to, &to_signed);
+	if(from_bits < 0 || to_bits < 0) {
+		return -1;
+	}
+	return to_bits > from_bits ? Assembler__extend_reg(buffer, reg, from_bits / 8, from_signed) : 0;
+}
+
+static int Translator__log2(uint64_t value) {
+	int bits = 0;
+	while(value > 1) {
+		value = value >> 1;
+		bits++;
+	}
+	return bits;
+}
+
+static int Translator__lea_factor(CODE_BUFFER* buffer, int reg, uint64_t factor) {
+	// reg = reg * 3, 5 or 9
+	return Assembler__lea_reg_index(buffer, reg, reg, reg, (int)factor - 1);
+}
+
+static int Translator__scale(CODE_BUFFER* buffer, int reg, int scratch, int64_t constant) {
+	// reg = reg * constant (low 64 bit, the same for signed and unsigned)
+	uint64_t factor = constant < 0 ? 0 - (uint64_t)constant : (uint64_t)constant;
+	if(factor == 0) {
+		return Assembler__xor_reg32(buffer, reg);
+	}
+	int shift = __builtin_ctzll(factor);
+	uint64_t odd = factor >> shift;
+	int ret;
+	if(odd == 1) {
+		ret = shift > 0 ? Assembler__shift_reg_imm8(buffer, SHIFT_SHL, reg, shift) : 0;
+	}
+	else if(odd == 3 || odd == 5 || odd == 9) {
+		ret = Translator__lea_factor(buffer, reg, odd);
+		if(ret == 0 && shift > 0) {
+			ret = Assembler__shift_reg_imm8(buffer, SHIFT_SHL, reg, shift);
+		}
+	}
+	else if(shift == 0 && (odd == 15 || odd == 25 || odd == 27 || odd == 45 || odd == 81)) {
+		// Two lea
+		uint64_t first = odd % 9 == 0 ? 9 : odd % 5 == 0 ? 5 : 3;
+		ret = Translator__lea_factor(buffer, reg, first);
+		if(ret == 0) {
+			ret = Translator__lea_factor(buffer, reg, odd / first);
+		}
+	}
+	else if(shift == 0 && ((odd - 1) & (odd - 2)) == 0) {
+		// 2^k + 1
+		ret = Assembler__mov_reg_reg(buffer, scratch, reg) != 0 || Assembler__shift_reg_imm8(buffer, SHIFT_SHL, reg, Translator__log2(odd - 1)) != 0 ||
+			Assembler__alu_reg_reg(buffer, ALU_ADD, reg, scratch) != 0 ? -1 : 0;
+	}
+	else if(shift == 0 && ((odd + 1) & odd) == 0) {
+		// 2^k - 1
+		ret = Assembler__mov_reg_reg(buffer, scratch, reg) != 0 || Assembler__shift_reg_imm8(buffer, SHIFT_SHL, reg, Translator__log2(odd + 1)) != 0 ||
+			Assembler__alu_reg_reg(buffer, ALU_SUB, reg, scratch) != 0 ? -1 : 0;
+	}
+	else if(constant >= INT32_MIN && constant <= INT32_MAX) {
+		return Assembler__imul_reg_imm32(buffer, reg, reg, (int32_t)constant);
+	}
+	else {
+		if(Assembler__mov_reg_imm64(buffer, scratch, (uint64_t)constant) != 0) {
+			return -1;
+		}
+		return Assembler__imul_reg_reg(buffer, reg, scratch);
+	}
+	if(ret != 0) {
+		return -1;
+	}
+	return constant < 0 ? Assembler__neg_reg(buffer, reg) : 0;
+}
+
+static ARITHMETIC_MAGIC Translator__magic_unsigned(uint64_t divisor, int bits) {
+	// Smallest shift s with m = ceil(2^(N + s) / d) < 2^N and m * d - 2^(N + s) <= 2^s,
+	// then q = (n * m) >> (N + s) for all n < 2^N. Else the add indicator form
+	ARITHMETIC_MAGIC magic = { 0, 0, false };
+	int l = Translator__log2(divisor - 1) + 1;       // ceil(log2(d)), d is not a power of two
+	for(int s = 0;s < l;s++) {
+		unsigned __int128 power = (unsigned __int128)1 << (bits + s);
+		unsigned __int128 m = (power + divisor - 1) / divisor;
+		if(m < ((unsigned __int128)1 << bits) && m * divisor - power <= ((unsigned __int128)1 << s)) {
+			magic.multiplier = (uint64_t)m;
+			magic.shift = s;
+			return magic;
+		}
+	}
+	// m = floor(2^N * (2^l - d) / d) + 1
+	magic.multiplier = (uint64_t)((((unsigned __int128)1 << bits) * (((unsigned __int128)1 << l) - divisor)) / divisor + 1);
+	magic.shift = l - 1;
+	magic.add = true;
+	return magic;
+}
+
+static ARITHMETIC_MAGIC Translator__magic_signed(int64_t divisor, int bits) {
+	// Hacker's Delight 10-1 for N bits: |d| >= 2 and not a power of two
+	ARITHMETIC_MAGIC magic = { 0, 0, false };
+	uint64_t mask = bits == 64 ? ~0ull : (1ull << bits) - 1;
+	uint64_t two = 1ull << (bits - 1);
+	uint64_t ad = divisor < 0 ? 0 - (uint64_t)divisor : (uint64_t)divisor;
+	uint64_t t = two + ((uint64_t)divisor >> 63);
+	uint64_t anc = t - 1 - t % ad;                   // |nc|
+	int p = bits - 1;
+	uint64_t q1 = two / anc, r1 = two - q1 * anc;
+	uint64_t q2 = two / ad, r2 = two - q2 * ad;
+	uint64_t delta;
+	do {
+		p++;
+		q1 = (2 * q1) & mask;
+		r1 = (2 * r1) & mask;
+		if(r1 >= anc) {
+			q1 = (q1 + 1) & mask;
+			r1 = r1 - anc;
+		}
+		q2 = (2 * q2) & mask;
+		r2 = (2 * r2) & mask;
+		if(r2 >= ad) {
+			q2 = (q2 + 1) & mask;
+			r2 = r2 - ad;
+		}
+		delta = ad - r2;
+	} while(q1 < delta || (q1 == delta && r1 == 0));
+	uint64_t m = (q2 + 1) & mask;
+	if(divisor < 0) {
+		m = (0 - m) & mask;
+	}
+	// Sign extended multiplier
+	magic.multiplier = (uint64_t)Translator__truncate((int64_t)m, bits, true);
+	magic.shift = p - bits;
+	return magic;
+}
+
+static int Translator__quotient_unsigned(CODE_BUFFER* buffer, uint64_t divisor, int bits, bool saved) {
+	// rax = n / d, 64 bit keeps n in r8 if needed (saved: already there)
+	if((divisor & (divisor - 1)) == 0) {
+		int shift = Translator__log2(divisor);
+		return shift > 0 ? Assembler__shift_reg_imm8(buffer, SHIFT_SHR, REGISTER_RAX, shift) : 0;
+	}
+	ARITHMETIC_MAGIC magic = Translator__magic_unsigned(divisor, bits == 64 ? 64 : 32);
+	int high, n;
+	if(bits == 64) {
+		// rdx = high half of n * m
+		if(magic.add && !saved && Assembler__mov_reg_reg(buffer, REGISTER_R8, REGISTER_RAX) != 0) {
+			return -1;
+		}
+		if(Assembler__mov_reg_imm64(buffer, REGISTER_RCX, magic.multiplier) != 0 || Assembler__mul_reg(buffer, REGISTER_RCX, false) != 0) {
+			return -1;
+		}
+		high = REGISTER_RDX;
+		n = REGISTER_R8;
+		if(!magic.add) {
+			if(Assembler__mov_reg_reg(buffer, REGISTER_RAX, REGISTER_RDX) != 0) {
+				return -1;
+			}
+			return magic.shift > 0 ? Assembler__shift_reg_imm8(buffer, SHIFT_SHR, REGISTER_RAX, magic.shift) : 0;
+		}
+	}
+	else {
+		// n * m fits into 64 bit
+		if(Assembler__mov_reg_imm32(buffer, REGISTER_RCX, (uint32_t)magic.multiplier) != 0) {
+			return -1;
+		}
+		if(!magic.add) {
+			if(Assembler__imul_reg_reg(buffer, REGISTER_RAX, REGISTER_RCX) != 0) {
+				return -1;
+			}
+			return Assembler__shift_reg_imm8(buffer, SHIFT_SHR, REGISTER_RAX, 32 + magic.shift);
+		}
+		if(Assembler__imul_reg_reg(buffer, REGISTER_RCX, REGISTER_RAX) != 0 || Assembler__shift_reg_imm8(buffer, SHIFT_SHR, REGISTER_RCX, 32) != 0) {
+			return -1;
+		}
+		high = REGISTER_RCX;
+		n = REGISTER_RAX;
+	}
+	// q = (t + ((n - t) >> 1)) >> (l - 1)
+	if((n != REGISTER_RAX && Assembler__mov_reg_reg(buffer, REGISTER_RAX, n) != 0) || Assembler__alu_reg_reg(buffer, ALU_SUB, REGISTER_RAX, high) != 0 ||
+	   Assembler__shift_reg_imm8(buffer, SHIFT_SHR, REGISTER_RAX, 1) != 0 || Assembler__alu_reg_reg(buffer, ALU_ADD, REGISTER_RAX, high) != 0) {
+		return -1;
+	}
+	return magic.shift > 0 ? Assembler__shift_reg_imm8(buffer, SHIFT_SHR, REGISTER_RAX, magic.shift) : 0;
+}
+
+static int Translator__quotient_signed(CODE_BUFFER* buffer, int64_t divisor, int bits, bool saved) {
+	// rax = n / d rounded towards zero, n sign extended to 64 bit (kept in r8 like above)
+	if(divisor == 1) {
+		return 0;
+	}
+	if(divisor == -1) {
+		return Assembler__neg_reg(buffer, REGISTER_RAX);
+	}
+	uint64_t magnitude = divisor < 0 ? 0 - (uint64_t)divisor : (uint64_t)divisor;
+	if((magnitude & (magnitude - 1)) == 0) {
+		// (n + ((n >> 63) >>> (64 - k))) >> k
+		int shift = Translator__log2(magnitude);
+		if(Assembler__mov_reg_reg(buffer, REGISTER_RCX, REGISTER_RAX) != 0 || Assembler__shift_reg_imm8(buffer, SHIFT_SAR, REGISTER_RCX, 63) != 0 ||
+		   Assembler__shift_reg_imm8(buffer, SHIFT_SHR, REGISTER_RCX, 64 - shift) != 0 || Assembler__alu_reg_reg(buffer, ALU_ADD, REGISTER_RAX, REGISTER_RCX) != 0 ||
+		   Assembler__shift_reg_imm8(buffer, SHIFT_SAR, REGISTER_RAX, shift) != 0) {
+			return -1;
+		}
+		return divisor < 0 ? Assembler__neg_reg(buffer, REGISTER_RAX) : 0;
+	}
+	ARITHMETIC_MAGIC magic = Translator__magic_signed(divisor, bits == 64 ? 64 : 32);
+	int64_t multiplier = (int64_t)magic.multiplier;
+	// t = high half of n * m (+ n if d > 0 and m < 0, - n if d < 0 and m > 0)
+	int operation = divisor > 0 && multiplier < 0 ? ALU_ADD : divisor < 0 && multiplier > 0 ? ALU_SUB : 0;
+	int high, n;
+	if(bits == 64) {
+		if(operation != 0 && !saved && Assembler__mov_reg_reg(buffer, REGISTER_R8, REGISTER_RAX) != 0) {
+			return -1;
+		}
+		if(Assembler__mov_reg_imm64(buffer, REGISTER_RCX, (uint64_t)multiplier) != 0 || Assembler__mul_reg(buffer, REGISTER_RCX, true) != 0) {
+			return -1;
+		}
+		high = REGISTER_RDX;
+		n = REGISTER_R8;
+		if(magic.shift > 0 && operation == 0 && Assembler__shift_reg_imm8(buffer, SHIFT_SAR, high, magic.shift) != 0) {
+			return -1;
+		}
+	}
+	else {
+		// The 64 bit product is exact, both shifts in one without the correction
+		high = REGISTER_RCX;
+		n = REGISTER_RAX;
+		if(Assembler__imul_reg_imm32(buffer, REGISTER_RCX, REGISTER_RAX, (int32_t)multiplier) != 0 ||
+		   Assembler__shift_reg_imm8(buffer, SHIFT_SAR, REGISTER_RCX, operation == 0 ? 32 + magic.shift : 32) != 0) {
+			return -1;
+		}
+	}
+	if(operation != 0) {
+		if(Assembler__alu_reg_reg(buffer, operation, high, n) != 0) {
+			return -1;
+		}
+		if(magic.shift > 0 && Assembler__shift_reg_imm8(buffer, SHIFT_SAR, high, magic.shift) != 0) {
+			return -1;
+		}
+	}
+	// Negative quotients are one too small: q = t + (t >>> 63)
+	if(Assembler__mov_reg_reg(buffer, REGISTER_RAX, high) != 0 || Assembler__shift_reg_imm8(buffer, SHIFT_SHR, REGISTER_RAX, 63) != 0) {
+		return -1;
+	}
+	return Assembler__alu_reg_reg(buffer, ALU_ADD, REGISTER_RAX, high);
+}
+
+int Translator__multiply(CODE_BUFFER* buffer, int type, int64_t constant) {
+	bool is_signed;
+	int bits = Translator__width(type, &is_signed);
+	if(bits < 0) {
+		return -1;
+	}
+	return Translator__scale(buffer, REGISTER_RAX, REGISTER_RCX, Translator__truncate(constant, bits, is_signed));
+}
+
+int Translator__divide(CODE_BUFFER* buffer, int type, int64_t constant, bool modulo) {
+	bool is_signed;
+	int bits = Translator__width(type, &is_signed);
+	if(bits < 0) {
+		return -1;
+	}
+	int64_t divisor = Translator__truncate(constant, bits, is_signed);
+	if(divisor == 0) {
+		printf("[ERROR] Division by zero.\n");
+		return -1;
+	}
+	if(modulo && !is_signed && ((uint64_t)divisor & ((uint64_t)divisor - 1)) == 0) {
+		// n & (d - 1)
+		if(divisor == 1) {
+			return Assembler__xor_reg32(buffer, REGISTER_RAX);
+		}
+		if(bits < 64 && Assembler__extend_reg(buffer, REGISTER_RAX, bits / 8, false) != 0) {
+			return -1;
+		}
+		if((uint64_t)divisor - 1 <= INT32_MAX) {
+			return Assembler__alu_reg_imm32(buffer, ALU_AND, REGISTER_RAX, (int32_t)(divisor - 1));
+		}
+		if(Assembler__mov_reg_imm64(buffer, REGISTER_RCX, (uint64_t)divisor - 1) != 0) {
+			return -1;
+		}
+		return Assembler__alu_reg_reg(buffer, ALU_AND, REGISTER_RAX, REGISTER_RCX);
+	}
+	if(bits < 64 && Assembler__extend_reg(buffer, REGISTER_RAX, bits / 8, is_signed) != 0) {
+		return -1;
+	}
+	if(modulo && Assembler__mov_reg_reg(buffer, REGISTER_R8, REGISTER_RAX) != 0) {
+		return -1;
+	}
+	if(is_signed ? Translator__quotient_signed(buffer, divisor, bits, modulo) != 0 : Translator__quotient_unsigned(buffer, (uint64_t)divisor, bits, modulo) != 0) {
+		return -1;
+	}
+	if(!modulo) {
+		return 0;
+	}
+	// n - q * d
+	if(Translator__scale(buffer, REGISTER_RAX, REGISTER_RCX, divisor) != 0 || Assembler__alu_reg_reg(buffer, ALU_SUB, REGISTER_R8, REGISTER_RAX) != 0) {
+		return -1;
+	}
+	return Assembler__mov_reg_reg(buffer, REGISTER_RAX, REGISTER_R8);
+}
+
+int Translator__divide_reg(CODE_BUFFER* buffer, int type, bool modulo) {
+	// rax / rcx with div/idiv (division by zero traps like in C)
+	bool is_signed;
+	int bits = Translator__width(type, &is_signed);
+	if(bits < 0) {
+		return -1;
+	}
+	int size = bits == 64 ? 8 : 4;
+	if(bits < 32 && (Assembler__extend_reg(buffer, REGISTER_RAX, bits / 8, is_signed) != 0 || Assembler__extend_reg(buffer, REGISTER_RCX, bits / 8, is_signed) != 0)) {
+		return -1;
+	}
+	if(is_signed ? Assembler__cdq(buffer, size) != 0 : Assembler__xor_reg32(buffer, REGISTER_RDX) != 0) {
+		return -1;
+	}
+	if(Assembler__div_reg(buffer, REGISTER_RCX, size, is_signed) != 0) {
+		return -1;
+	}
+	return modulo ? Assembler__mov_reg_reg(buffer, REGISTER_RAX, REGISTER_RDX) : 0;
+}
@@ -0,0 +1,1596 @@
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <pthread.h>
+
+#include "translator.h"
+#include "./../../Cache/cache.h"
+#include "./../../Optimizer/LTO/lto.h"
+#include "./../../Optimizer/PGO/pgo.h"
+#include "./../../Runtime/Tasks/tasks.h"
+#include "./../../Runtime/Coroutines/coroutines.h"
+#include "./../../Runtime/Kernels/kernels.h"
+#include "./../../Runtime/IO/io.h"
+#include "./../../Runtime/Memory/memory.h"
+#include "./../../Runtime/Profile/profile.h"
+
+#define C compiler
+
+// Translation into machine code
+//   Globals and the entry code are generated on the calling thread. Every
+//   function is an independent job that only reads the pre-compiled code and
+//   writes into its own CODE_BUFFER, so functions are translated by a pool of
+//   "threads" workers. The buffers are spliced into the image in source order,
+//   which keeps the output byte-identical for every thread count. With a
+//   profile (-fprofile-use) they are spliced in its order instead.
+//   Calls follow the System V ABI, so C code can call ChaosLang functions
+//   and the other way around: the first six arguments in rdi, rsi, rdx, rcx,
+//   r8 and r9, the rest on the stack, the result in rax. Arguments in
+//   registers are stored into frame slots on entry. Only caller-saved
+//   registers are used, rbx, rbp and r12-r15 keep their values. Functions
+//   that call nothing and whose locals fit into the red zone have no frame,
+//   their locals are addressed through rsp.
+//   Calls in tail position ("return f(...);" and "int r = f(...); return r;")
+//   with all arguments in registers are jumps: self recursion loops back to
+//   the body, other calls delete the frame and jump to the function, so
+//   recursion runs in constant stack space. "musttail return f(...);" fails
+//   to compile if the call can not be a jump.
+//   Locals and returns can also be one calculation of a variable and a
+//   variable or number ("a * 3", "n % d"), see arithmetic.c.
+//   Arrays live where Optimizer/Escape/escape.h puts them: elements in the
+//   frame, the address of a heap block in a slot (array arguments too), or
+//   nowhere, reads then load the initializer of the element.
+//   -finstrument adds inline rdtsc counters (see Runtime/Profile/profile.h):
+//   the timestamp of the entry and of the current call are kept in the two
+//   slots at the top of the frame, tail jumps end the cycles of the function
+//   before the arguments are loaded, so they only count the edge.
+//   -g tags the code with debug rows (see CODE_DEBUG): the source position
+//   of every statement and the frame state after every instruction that
+//   changes it, the writer of executables turns them into .debug_line and
+//   .eh_frame (see Linker/ELF64/debug.c).
+//   -march=<level> allows the instructions of a psABI level (see
+//   Runtime/Kernels/kernels.h) in all code, _start exits on older CPUs.
+//   Functions declared with "target_clones" are translated once per level
+//   from -march to x86-64-v4. A clone that comes out the same as the one of
+//   the level below is dropped. If more than one is left they are named
+//   after their level ("f.x86-64-v3"), "f" becomes a stub that jumps
+//   through "f.slot" and _start fills the slot from the table "f.clones"
+//   with the level of __chaos_cpu_level. Only executables have clones.
+
+typedef struct _TRANSLATOR_LOCAL_ {
+	char* identifier;
+	int32_t offset;                    // Offset to the base register
+	int size;
+	int type;                          // Integer type of the value (CODE_OBJECT_TYPE_CHAR to _ULONGLONG)
+	int task;                          // Handles: PCC_TASK_SPAWN or PCC_TASK_GO
+	PCC__POINTER* array;               // Local arrays (type CODE_OBJECT_TYPE_ARRAY), NULL for array arguments
+	int storage;                       // Arrays: see PCC_STORAGE enum, arguments are PCC_STORAGE_HEAP (the slot holds the address)
+} TRANSLATOR_LOCAL;
+
+typedef struct _TRANSLATOR_STATE_ {
+	COMPILER* compiler;
+	CODE_BUFFER* buffer;
+	PCC_CODE_BLOCK* block;
+	TRANSLATOR_LOCAL* locals;
+	int local_count;
+	int32_t frame_size;
+	int base;                          // rbp, rsp without a frame
+	uint64_t* end_jumps;               // Jumps to the function end (patched at the end)
+	int end_jump_count;
+	FUNCTION* function;
+	uint64_t body;                     // Code after the prologue, target of self tail calls
+	int level;                         // -march level of this body (see KERNELS_LEVEL_*)
+} TRANSLATOR_STATE;
+
+// -march names in KERNELS_LEVEL_* order, also the suffix of the clones
+static const char* const translator_levels[KERNELS_LEVEL_V4 + 1] = { NULL, "x86-64", "x86-64-v2", "x86-64-v3", "x86-64-v4" };
+
+typedef struct _TRANSLATOR_JOBS_ {
+	COMPILER* compiler;
+	int* entries;                      // Pre-compiled code index of every function
+	int* levels;                       // -march level of every job (target_clones: one job per level)
+	CODE_BUFFER* buffers;              // Output of every function (same order as entries)
+	int* results;
+	bool* dropped;                     // Clones that equal the clone of the level below
+	int count;
+	int next;                          // Next free job (atomic)
+} TRANSLATOR_JOBS;
+
+static int Translator__bytes(int type) {
+	// Size of a variable of an integer type
+	bool is_signed;
+	int bits = Translator__width(type, &is_signed);
+	return bits > 8 ? bits / 8 : 1;
+}
+
+static PCC__INT* Translator__find_global(COMPILER* compiler, const char* identifier) {
+	for(int i = 0;i < C->pcc_entries;i++) {
+		if(C->pre_compiled_code[i].type == CODE_OBJECT_TYPE_INT && C->pre_compiled_code[i].CODE_OBJECT_DATA._int->global &&
+		   strcmp(C->pre_compiled_code[i].CODE_OBJECT_DATA._int->identifier, identifier) == 0) {
+			return C->pre_compiled_code[i].CODE_OBJECT_DATA._int;
+		}
+	}
+	return NULL;
+}
+
+static TRANSLATOR_LOCAL* Translator__find_local(TRANSLATOR_STATE* state, const char* identifier) {
+	for(int i = state->local_count - 1;i >= 0;i--) {
+		if(strcmp(state->locals[i].identifier, identifier) == 0) {
+			return &state->locals[i];
+		}
+	}
+	return NULL;
+}
+
+// Loads a variable into a register (locals first, then globals)
+static int Translator__load(TRANSLATOR_STATE* state, int reg, const char* identifier) {
+	TRANSLATOR_LOCAL* local = Translator__find_local(state, identifier);
+	if(local != NULL && local->type == CODE_OBJECT_TYPE_ARRAY) {
+		printf("[ERROR] \"%s\" is an array, only its elements and calls take it, in function \"%s\".\n", identifier, state->block->identifier);
+		return -1;
+	}
+	if(local != NULL) {
+		return Assembler__mov_reg_mem(state->buffer, reg, Assembler__memory(state->base, local->offset), local->size);
+	}
+	PCC__INT* global = Translator__find_global(state->compiler, identifier);
+	if(global != NULL && global->count_start != 0) {
+		printf("[ERROR] \"%s\" is a table, it can not be returned by function \"%s\".\n", identifier, state->block->identifier);
+		return -1;
+	}
+	if(global != NULL && Lto__constant(state->compiler, global)) {
+		if(Translator__bytes(global->type) == 8 && (global->value < 0 || global->value > UINT32_MAX)) {
+			return Assembler__mov_reg_imm64(state->buffer, reg, (uint64_t)global->value);
+		}
+		return Assembler__mov_reg_imm32(state->buffer, reg, (uint32_t)global->value);
+	}
+	if(global != NULL) {
+		// Value follows the meta data byte
+		return Assembler__mov_reg_mem(state->buffer, reg, Assembler__symbol(global->asm_identifier, 1), Translator__bytes(global->type));
+	}
+	printf("[ERROR] Unknown identifier \"%s\" in function \"%s\".\n", identifier, state->block->identifier);
+	return -1;
+}
+
+static int Translator__type_of(TRANSLATOR_STATE* state, const char* identifier) {
+	// Integer type of a variable
+	TRANSLATOR_LOCAL* local = Translator__find_local(state, identifier);
+	if(local != NULL) {
+		return local->type;
+	}
+	PCC__INT* global = Translator__find_global(state->compiler, identifier);
+	return global != NULL ? global->type : CODE_OBJECT_TYPE_INT;
+}
+
+static int Translator__load_as(TRANSLATOR_STATE* state, int reg, const char* identifier, int type) {
+	// Loads a variable converted to type: loads zero extend, signed values
+	// are sign extended when type is wider
+	int from = Translator__type_of(state, identifier);
+	bool from_signed, to_signed;
+	if(Translator__load(state, reg, identifier) != 0) {
+		return -1;
+	}
+	if(Translator__width(from, &from_signed) < Translator__width(type, &to_signed) && from_signed) {
+		return Translator__convert(state->buffer, reg, from, type);
+	}
+	return 0;
+}
+
+static int Translator__call(COMPILER* compiler, CODE_BUFFER* buffer, const char* symbol);
+static int Translator__jump(COMPILER* compiler, CODE_BUFFER* buffer, const char* symbol);
+static int Translator__address(COMPILER* compiler, CODE_BUFFER* buffer, int reg, const char* symbol);
+
+static int Translator__size(PCC__INT* local) {
+	// Spawn and coroutine handles are pointers
+	return local->task == PCC_TASK_SPAWN || local->task == PCC_TASK_GO ? 8 : Translator__bytes(local->type);
+}
+
+static int32_t Translator__slot(int32_t used, int size) {
+	// Bytes used by the locals after adding one of size bytes (aligned to its size)
+	return (used + size + size - 1) & ~(size - 1);
+}
+
+static int32_t Translator__array_slot(int32_t used, PCC__POINTER* array) {
+	// Bytes used by the locals after adding an array: its elements (8 byte aligned), the address of a heap block or nothing
+	if(array->storage == PCC_STORAGE_FRAME) {
+		return (int32_t)((used + array->count * 4 + 7) & ~7);
+	}
+	return array->storage == PCC_STORAGE_HEAP ? Translator__slot(used, 8) : used;
+}
+
+int Translator__march(const char* name) {
+	// KERNELS_LEVEL_* of a -march name, -1 if unknown
+	for(int level = KERNELS_LEVEL_X86_64;level <= KERNELS_LEVEL_V4;level++) {
+		if(strcmp(translator_levels[level], name) == 0) {
+			return level;
+		}
+	}
+	return -1;
+}
+
+static FUNCTION* Translator__function_of(COMPILER* compiler, const char* name) {
+	for(int i = 0;i < C->current_function;i++) {
+		if(strcmp(C->functions[i].name, name) == 0) {
+			return &C->functions[i];
+		}
+	}
+	return NULL;
+}
+
+static int Translator__task(TRANSLATOR_STATE* state, TRANSLATOR_LOCAL* local, PCC__INT* integer, int32_t record) {
+	// handle = __chaos_spawn/__chaos_go(function), result = __chaos_join/__chaos_await(handle),
+	// records in the frame (see Optimizer/Escape/escape.h) use __chaos_spawn_at/__chaos_join_at
+	static const char* const symbols[] = { NULL, TASKS_SPAWN_SYMBOL, TASKS_JOIN_SYMBOL, COROUTINES_GO_SYMBOL, COROUTINES_AWAIT_SYMBOL };
+	COMPILER* compiler = state->compiler;
+	const char* symbol = symbols[integer->task];
+	if(integer->storage == PCC_STORAGE_FRAME) {
+		symbol = integer->task == PCC_TASK_SPAWN ? TASKS_SPAWN_AT_SYMBOL : TASKS_JOIN_AT_SYMBOL;
+	}
+	if(integer->task == PCC_TASK_SPAWN || integer->task == PCC_TASK_GO) {
+		FUNCTION* function = Translator__function_of(C, integer->task_operand);
+		if(function == NULL) {
+			printf("[ERROR] Function \"%s\" is not defined, in function \"%s\".\n", integer->task_operand, state->block->identifier);
+			return -1;
+		}
+		if(function->arg_count != 0) {
+			printf("[ERROR] Function \"%s\" takes arguments, it can not be started by %s, in function \"%s\".\n", integer->task_operand,
+				integer->task == PCC_TASK_SPAWN ? "spawn" : "go", state->block->identifier);
+			return -1;
+		}
+		local->task = integer->task;
+		if(integer->storage == PCC_STORAGE_NONE) {
+			// The join calls the function
+			return 0;
+		}
+		int reg = REGISTER_RDI;
+		if(integer->storage == PCC_STORAGE_FRAME) {
+			if(Assembler__lea_reg_mem(state->buffer, REGISTER_RDI, Assembler__memory(state->base, record)) != 0) {
+				return -1;
+			}
+			reg = REGISTER_RSI;
+		}
+		if(Translator__address(C, state->buffer, reg, integer->task_operand) != 0 || Translator__call(C, state->buffer, symbol) != 0) {
+			return -1;
+		}
+		return Assembler__mov_mem_reg(state->buffer, Assembler__memory(state->base, local->offset), REGISTER_RAX, 8);
+	}
+	int handle_task = integer->task == PCC_TASK_JOIN ? PCC_TASK_SPAWN : PCC_TASK_GO;
+	TRANSLATOR_LOCAL* handle = Translator__find_local(state, integer->task_operand);
+	if(handle == NULL || handle->task != handle_task) {
+		printf("[ERROR] \"%s\" is not a %s handle, in function \"%s\".\n", integer->task_operand, handle_task == PCC_TASK_SPAWN ? "spawn" : "go", state->block->identifier);
+		return -1;
+	}
+	if(Translator__load(state, REGISTER_RDI, integer->task_operand) != 0 || Translator__call(C, state->buffer, symbol) != 0) {
+		return -1;
+	}
+	return Assembler__mov_mem_reg(state->buffer, Assembler__memory(state->base, local->offset), REGISTER_RAX, 4);
+}
+
+static int Translator__array_address(TRANSLATOR_STATE* state, int reg, TRANSLATOR_LOCAL* local) {
+	// reg = address of element 0 (arrays in the frame or in a slot)
+	if(local->storage == PCC_STORAGE_FRAME) {
+		return Assembler__lea_reg_mem(state->buffer, reg, Assembler__memory(state->base, local->offset));
+	}
+	return Assembler__mov_reg_mem(state->buffer, reg, Assembler__memory(state->base, local->offset), 8);
+}
+
+static int Translator__initializer(TRANSLATOR_STATE* state, int reg, PCC__POINTER* array, long long k) {
+	// reg = initial value of element k
+	if(k < array->element_count && array->elements[k] != NULL) {
+		return Translator__load_as(state, reg, array->elements[k], CODE_OBJECT_TYPE_INT);
+	}
+	return Assembler__mov_reg_imm32(state->buffer, reg, k < array->element_count ? (uint32_t)array->POINTER_VALUE.array_values[k] : 0);
+}
+
+static int Translator__array(TRANSLATOR_STATE* state, TRANSLATOR_LOCAL* local) {
+	// Elements of an array in the frame or on the heap: zeros, then the initializers
+	COMPILER* compiler = state->compiler;
+	CODE_BUFFER* buffer = state->buffer;
+	PCC__POINTER* array = local->array;
+	int base = state->base;
+	int32_t offset = local->offset;
+	if(array->storage == PCC_STORAGE_NONE) {
+		return 0;
+	}
+	if(array->storage == PCC_STORAGE_HEAP) {
+		if(Assembler__mov_reg_imm32(buffer, REGISTER_RDI, (uint32_t)(array->count * 4)) != 0 || Translator__call(C, buffer, MEMORY_NEW_SYMBOL) != 0 ||
+		   Assembler__mov_mem_reg(buffer, Assembler__memory(state->base, local->offset), REGISTER_RAX, 8) != 0 ||
+		   Assembler__mov_reg_reg(buffer, REGISTER_RDX, REGISTER_RAX) != 0) {
+			return -1;
+		}
+		base = REGISTER_RDX;
+		offset = 0;
+	}
+	int64_t zeros = array->count - array->element_count;
+	if(zeros > TRANSLATOR_INLINE_MOVES) {
+		if(Assembler__lea_reg_mem(buffer, REGISTER_RDI, Assembler__memory(base, offset + array->element_count * 4)) != 0 ||
+		   Assembler__mov_reg_imm32(buffer, REGISTER_RCX, (uint32_t)(zeros * 4)) != 0 || Assembler__xor_reg32(buffer, REGISTER_RAX) != 0 ||
+		   Assembler__rep_stosb(buffer) != 0) {
+			return -1;
+		}
+		zeros = 0;
+	}
+	for(int64_t k = array->count - zeros;k < array->count;k++) {
+		if(Assembler__mov_mem_imm(buffer, Assembler__memory(base, offset + (int32_t)k * 4), 0, 4) != 0) {
+			return -1;
+		}
+	}
+	for(int k = 0;k < array->element_count;k++) {
+		MEMORY_OPERAND element = Assembler__memory(base, offset + k * 4);
+		if(array->elements[k] == NULL) {
+			if(Assembler__mov_mem_imm(buffer, element, (int32_t)array->POINTER_VALUE.array_values[k], 4) != 0) {
+				return -1;
+			}
+		}
+		else if(Translator__initializer(state, REGISTER_RCX, array, k) != 0 || Assembler__mov_mem_reg(buffer, element, REGISTER_RCX, 4) != 0) {
+			return -1;
+		}
+	}
+	return 0;
+}
+
+static int Translator__element(TRANSLATOR_STATE* state, PCC__INT* integer) {
+	// rax = "a[i]" (int)
+	CODE_BUFFER* buffer = state->buffer;
+	TRANSLATOR_LOCAL* local = Translator__find_local(state, integer->element);
+	if(local == NULL || local->type != CODE_OBJECT_TYPE_ARRAY) {
+		printf("[ERROR] \"%s\" is not an array, in function \"%s\".\n", integer->element, state->block->identifier);
+		return -1;
+	}
+	long long count = local->array != NULL ? local->array->count : INT32_MAX / 4;
+	if(integer->index == NULL && (integer->index_value < 0 || integer->index_value >= count)) {
+		printf("[ERROR] Index %lld is outside of array \"%s\", in function \"%s\".\n", integer->index_value, integer->element, state->block->identifier);
+		return -1;
+	}
+	if(local->storage == PCC_STORAGE_NONE) {
+		return Translator__initializer(state, REGISTER_RAX, local->array, integer->index_value);
+	}
+	if(integer->index == NULL && local->storage == PCC_STORAGE_FRAME) {
+		return Assembler__mov_reg_mem(buffer, REGISTER_RAX, Assembler__memory(state->base, local->offset + (int32_t)integer->index_value * 4), 4);
+	}
+	if(Translator__array_address(state, REGISTER_RAX, local) != 0) {
+		return -1;
+	}
+	if(integer->index == NULL) {
+		return Assembler__mov_reg_mem(buffer, REGISTER_RAX, Assembler__memory(REGISTER_RAX, (int32_t)integer->index_value * 4), 4);
+	}
+	// Indices are not checked, like in C
+	if(Translator__load_as(state, REGISTER_RCX, integer->index, CODE_OBJECT_TYPE_LONGLONG) != 0 ||
+	   Assembler__lea_reg_index(buffer, REGISTER_RAX, REGISTER_RAX, REGISTER_RCX, 4) != 0) {
+		return -1;
+	}
+	return Assembler__mov_reg_mem(buffer, REGISTER_RAX, Assembler__memory(REGISTER_RAX, 0), 4);
+}
+
+static int Translator__argument(TRANSLATOR_STATE* state, int reg, const char* argument) {
+	// Arguments are int, arrays are passed as their address
+	TRANSLATOR_LOCAL* local = Translator__find_local(state, argument);
+	if(local != NULL && local->type == CODE_OBJECT_TYPE_ARRAY) {
+		return Translator__array_address(state, reg, local);
+	}
+	if(isalpha((unsigned char)argument[0]) || argument[0] == '_') {
+		return Translator__load_as(state, reg, argument, CODE_OBJECT_TYPE_INT);
+	}
+	return Assembler__mov_reg_imm32(state->buffer, reg, (uint32_t)strtol(argument, NULL, 0));
+}
+
+static int Translator__operand_type(TRANSLATOR_STATE* state, PCC__INT* integer, int k) {
+	if(integer->operands[k] != NULL) {
+		return Translator__type_of(state, integer->operands[k]);
+	}
+	// Numbers are int or long like in C
+	long long value = integer->operand_values[k];
+	return value >= INT32_MIN && value <= INT32_MAX ? CODE_OBJECT_TYPE_INT : CODE_OBJECT_TYPE_LONG;
+}
+
+static int Translator__operand(TRANSLATOR_STATE* state, int reg, PCC__INT* integer, int k, int type) {
+	if(integer->operands[k] != NULL) {
+		return Translator__load_as(state, reg, integer->operands[k], type);
+	}
+	return Assembler__mov_reg_imm64(state->buffer, reg, (uint64_t)integer->operand_values[k]);
+}
+
+static int Translator__arithmetic(TRANSLATOR_STATE* state, PCC__INT* integer, int type) {
+	// rax = "a <operation> b" in type (see Translator__common)
+	CODE_BUFFER* buffer = state->buffer;
+	int operation = integer->operation;
+	if(Translator__operand(state, REGISTER_RAX, integer, 0, type) != 0) {
+		return -1;
+	}
+	if(integer->operands[1] == NULL) {
+		int64_t constant = integer->operand_values[1];
+		switch(operation) {
+			case '+':
+			case '-': {
+				if(constant >= INT32_MIN && constant <= INT32_MAX) {
+					return Assembler__alu_reg_imm32(buffer, operation == '+' ? ALU_ADD : ALU_SUB, REGISTER_RAX, (int32_t)constant);
+				}
+			} break;
+			case '*': {
+				return Translator__multiply(buffer, type, constant);
+			}
+			default: {
+				if(constant == 0) {
+					printf("[ERROR] Division by zero in function \"%s\".\n", state->block->identifier);
+					return -1;
+				}
+				return Translator__divide(buffer, type, constant, operation == '%');
+			}
+		}
+	}
+	if(Translator__operand(state, REGISTER_RCX, integer, 1, type) != 0) {
+		return -1;
+	}
+	switch(operation) {
+		case '+': return Assembler__alu_reg_reg(buffer, ALU_ADD, REGISTER_RAX, REGISTER_RCX);
+		case '-': return Assembler__alu_reg_reg(buffer, ALU_SUB, REGISTER_RAX, REGISTER_RCX);
+		case '*': return Assembler__imul_reg_reg(buffer, REGISTER_RAX, REGISTER_RCX);
+	}
+	return Translator__divide_reg(buffer, type, operation == '%');
+}
+
+static int Translator__calculation(TRANSLATOR_STATE* state, PCC__INT* integer, int result) {
+	// rax = "a <operation> b" converted to the type result, constants on the right are lowered by arithmetic.c
+	int type = Translator__common(Translator__operand_type(state, integer, 0), Translator__operand_type(state, integer, 1));
+	if(Translator__arithmetic(state, integer, type) != 0) {
+		return -1;
+	}
+	return Translator__convert(state->buffer, REGISTER_RAX, type, result);
+}
+
+static bool Translator__frame_array(COMPILER* compiler, PCC_CODE_BLOCK* block, int i, const char* name) {
+	// The variable name of statement i is an array in the frame
+	for(int j = i - 1;j >= block->start_index;j--) {
+		CODE_OBJECT* object = &C->pre_compiled_code[j];
+		if(object->type == CODE_OBJECT_TYPE_ARRAY && strcmp(object->CODE_OBJECT_DATA._pointer->identifier, name) == 0) {
+			return object->CODE_OBJECT_DATA._pointer->storage == PCC_STORAGE_FRAME;
+		}
+		if(object->type == CODE_OBJECT_TYPE_INT && object->CODE_OBJECT_DATA._int->identifier != NULL && strcmp(object->CODE_OBJECT_DATA._int->identifier, name) == 0) {
+			return false;
+		}
+	}
+	return false;
+}
+
+static bool Translator__tail_call(COMPILER* compiler, PCC_CODE_BLOCK* block, int i) {
+	// Call whose result is returned right away and whose arguments are all in registers
+	CODE_OBJECT* object = &C->pre_compiled_code[i];
+	if(object->type != CODE_OBJECT_TYPE_INT && object->type != CODE_OBJECT_TYPE_RETURN) {
+		return false;
+	}
+	PCC__INT* integer = object->CODE_OBJECT_DATA._int;
+	if(integer->call == NULL || integer->call_arg_count > TRANSLATOR_REGISTER_ARGS) {
+		return false;
+	}
+	for(int j = 0;j < integer->call_arg_count;j++) {
+		// The jump deletes the frame
+		if(Translator__frame_array(C, block, i, integer->call_args[j])) {
+			return false;
+		}
+	}
+	if(object->type == CODE_OBJECT_TYPE_RETURN) {
+		return true;
+	}
+	// "int r = f(...); return r;" (other types convert the result)
+	if(integer->type != CODE_OBJECT_TYPE_INT) {
+		return false;
+	}
+	CODE_OBJECT* next = i + 1 < block->end_index ? &C->pre_compiled_code[i + 1] : NULL;
+	return next != NULL && next->type == CODE_OBJECT_TYPE_RETURN && next->CODE_OBJECT_DATA._int->call == NULL &&
+		next->CODE_OBJECT_DATA._int->identifier != NULL && strcmp(next->CODE_OBJECT_DATA._int->identifier, integer->identifier) == 0;
+}
+
+static int Translator__line(TRANSLATOR_STATE* state, int token) {
+	// Code from here on comes from a token (-g)
+	COMPILER* compiler = state->compiler;
+	if(!C->debug) {
+		return 0;
+	}
+	return CodeBuffer__debug(state->buffer, CODE_DEBUG_LINE, C->tokens[token].line, C->tokens[token].column);
+}
+
+static int Translator__frame(COMPILER* compiler, CODE_BUFFER* buffer, int frame) {
+	// Frame state from here on (-g)
+	if(!C->debug) {
+		return 0;
+	}
+	return CodeBuffer__debug(buffer, CODE_DEBUG_FRAME, frame, 0);
+}
+
+static int Translator__leave(TRANSLATOR_STATE* state) {
+	// Deletes the stack frame (functions without one have nothing to do)
+	if(state->base == REGISTER_RBP && (Assembler__mov_reg_reg(state->buffer, REGISTER_RSP, REGISTER_RBP) != 0 || Assembler__pop(state->buffer, REGISTER_RBP) != 0)) {
+		return -1;
+	}
+	return state->base == REGISTER_RBP ? Translator__frame(state->compiler, state->buffer, CODE_FRAME_ENTRY) : 0;
+}
+
+static int Translator__resume(TRANSLATOR_STATE* state) {
+	// Code after a ret or tail jump still runs inside the frame
+	return state->base == REGISTER_RBP ? Translator__frame(state->compiler, state->buffer, CODE_FRAME_BASE) : 0;
+}
+
+static int Translator__timestamp(CODE_BUFFER* buffer) {
+	// rax = time stamp counter, rdx is overwritten
+	if(Assembler__rdtsc(buffer) != 0 || Assembler__shl_reg_imm8(buffer, REGISTER_RDX, 32) != 0) {
+		return -1;
+	}
+	return Assembler__alu_reg_reg(buffer, ALU_OR, REGISTER_RAX, REGISTER_RDX);
+}
+
+static int Translator__count(TRANSLATOR_STATE* state, int counter, int32_t start, bool calls) {
+	// Adds the cycles since the timestamp at start (and a call) to a counter, keeps rax
+	COMPILER* compiler = state->compiler;
+	CODE_BUFFER* buffer = state->buffer;
+	MEMORY_OPERAND cycles = Assembler__symbol(PROFILE_COUNTERS_SYMBOL, counter * (int32_t)sizeof(PROFILE_COUNTER) + 8);
+	MEMORY_OPERAND count = Assembler__symbol(PROFILE_COUNTERS_SYMBOL, counter * (int32_t)sizeof(PROFILE_COUNTER));
+	if(Assembler__mov_reg_reg(buffer, REGISTER_RCX, REGISTER_RAX) != 0 || Translator__timestamp(buffer) != 0 ||
+	   Assembler__mov_reg_mem(buffer, REGISTER_RDX, Assembler__memory(state->base, start), 8) != 0 ||
+	   Assembler__alu_reg_reg(buffer, ALU_SUB, REGISTER_RAX, REGISTER_RDX) != 0 ||
+	   Assembler__alu_mem_reg(buffer, ALU_ADD, cycles, REGISTER_RAX, C->instrument.atomic) != 0) {
+		return -1;
+	}
+	if(calls && Assembler__alu_mem_imm32(buffer, ALU_ADD, count, 1, C->instrument.atomic) != 0) {
+		return -1;
+	}
+	return Assembler__mov_reg_reg(buffer, REGISTER_RAX, REGISTER_RCX);
+}
+
+static int Translator__profile_enter(TRANSLATOR_STATE* state) {
+	// Counts the call and keeps the timestamp of the entry (arguments are stored)
+	COMPILER* compiler = state->compiler;
+	if(C->instrument.path == NULL) {
+		return 0;
+	}
+	MEMORY_OPERAND count = Assembler__symbol(PROFILE_COUNTERS_SYMBOL, state->block->function_index * (int32_t)sizeof(PROFILE_COUNTER));
+	if(Translator__timestamp(state->buffer) != 0 || Assembler__mov_mem_reg(state->buffer, Assembler__memory(state->base, TRANSLATOR_PROFILE_ENTRY), REGISTER_RAX, 8) != 0) {
+		return -1;
+	}
+	return Assembler__alu_mem_imm32(state->buffer, ALU_ADD, count, 1, C->instrument.atomic);
+}
+
+static int Translator__profile_leave(TRANSLATOR_STATE* state) {
+	COMPILER* compiler = state->compiler;
+	if(C->instrument.path == NULL) {
+		return 0;
+	}
+	return Translator__count(state, state->block->function_index, TRANSLATOR_PROFILE_ENTRY, false);
+}
+
+static int Translator__invoke(TRANSLATOR_STATE* state, int site, PCC__INT* integer, bool tail) {
+	// f(arguments) with the result in rax, stack arguments go into the outgoing area at rsp
+	// Tail calls jump instead: to the body for self recursion, otherwise to f after deleting the frame
+	static const int registers[TRANSLATOR_REGISTER_ARGS] = { REGISTER_RDI, REGISTER_RSI, REGISTER_RDX, REGISTER_RCX, REGISTER_R8, REGISTER_R9 };
+	COMPILER* compiler = state->compiler;
+	FUNCTION* function = Translator__function_of(C, integer->call);
+	if(function != NULL && function->arg_count != integer->call_arg_count) {
+		printf("[ERROR] Function \"%s\" takes %d arguments, not %d, in function \"%s\".\n", integer->call, function->arg_count, integer->call_arg_count, state->block->identifier);
+		return -1;
+	}
+	for(int j = 0;function != NULL && j < integer->call_arg_count;j++) {
+		TRANSLATOR_LOCAL* local = Translator__find_local(state, integer->call_args[j]);
+		bool array = local != NULL && local->type == CODE_OBJECT_TYPE_ARRAY;
+		if(array != (function->args[j].type == CODE_OBJECT_TYPE_ARRAY)) {
+			printf("[ERROR] Argument %d of function \"%s\" %s an array, in function \"%s\".\n", j + 1, integer->call, array ? "can not be" : "has to be", state->block->identifier);
+			return -1;
+		}
+	}
+	int edge = C->instrument.path != NULL ? C->current_function + C->instrument.sites[site] : -1;
+	if(edge >= 0 && tail) {
+		MEMORY_OPERAND count = Assembler__symbol(PROFILE_COUNTERS_SYMBOL, edge * (int32_t)sizeof(PROFILE_COUNTER));
+		if(Translator__profile_leave(state) != 0 || Assembler__alu_mem_imm32(state->buffer, ALU_ADD, count, 1, C->instrument.atomic) != 0) {
+			return -1;
+		}
+	}
+	else if(edge >= 0 && (Translator__timestamp(state->buffer) != 0 ||
+	        Assembler__mov_mem_reg(state->buffer, Assembler__memory(state->base, TRANSLATOR_PROFILE_CALL), REGISTER_RAX, 8) != 0)) {
+		return -1;
+	}
+	for(int j = TRANSLATOR_REGISTER_ARGS;j < integer->call_arg_count;j++) {
+		if(Translator__argument(state, REGISTER_RAX, integer->call_args[j]) != 0 ||
+		   Assembler__mov_mem_reg(state->buffer, Assembler__memory(REGISTER_RSP, (j - TRANSLATOR_REGISTER_ARGS) * 8), REGISTER_RAX, 8) != 0) {
+			return -1;
+		}
+	}
+	for(int j = 0;j < integer->call_arg_count && j < TRANSLATOR_REGISTER_ARGS;j++) {
+		if(Translator__argument(state, registers[j], integer->call_args[j]) != 0) {
+			return -1;
+		}
+	}
+	if(function == NULL && Assembler__xor_reg32(state->buffer, REGISTER_RAX) != 0) {
+		// C function, al = vector registers used by a variadic call
+		return -1;
+	}
+	if(!tail) {
+		if(Translator__call(C, state->buffer, integer->call) != 0) {
+			return -1;
+		}
+		return edge >= 0 ? Translator__count(state, edge, TRANSLATOR_PROFILE_CALL, true) : 0;
+	}
+	if(function == state->function) {
+		uint64_t field;
+		if(Assembler__jmp_local(state->buffer, &field) != 0) {
+			return -1;
+		}
+		return CodeBuffer__patch_rel32(state->buffer, field, state->body);
+	}
+	if(Translator__leave(state) != 0 || Translator__jump(C, state->buffer, integer->call) != 0) {
+		return -1;
+	}
+	return Translator__resume(state);
+}
+
+static int Translator__epilogue(TRANSLATOR_STATE* state) {
+	if(Translator__profile_leave(state) != 0 || Translator__leave(state) != 0 || Assembler__ret(state->buffer) != 0) {
+		return -1;
+	}
+	return Translator__resume(state);
+}
+
+int Translator__function(COMPILER* compiler, int entry, int level, CODE_BUFFER* buffer) {
+	PCC_CODE_BLOCK* block = C->pre_compiled_code[entry].CODE_OBJECT_DATA._code_block;
+	FUNCTION* function = &C->functions[block->function_index];
+	TRANSLATOR_STATE state = { compiler, buffer, block, NULL, 0, 0, REGISTER_RBP, NULL, 0, function, 0, level };
+	int ret = -1;
+	int count = block->end_index - block->start_index + function->arg_count;
+
+	state.locals = malloc((count > 0 ? count : 1) * sizeof(TRANSLATOR_LOCAL));
+	state.end_jumps = malloc((count > 0 ? count : 1) * sizeof(uint64_t));
+	if(state.locals == NULL || state.end_jumps == NULL) {
+		printf("[ERROR] Could not allocate translator state.\n");
+		goto CLEANUP;
+	}
+
+	// Stack frame: one slot per argument in a register and per local
+	// variable, below them the stack arguments of the calls. Tail calls
+	// leave before they jump, so they do not need a frame. Instrumented
+	// functions keep their timestamps above the arguments
+	bool leaf = true;
+	int outgoing = 0;
+	int32_t profile = C->instrument.path != NULL ? TRANSLATOR_PROFILE_SLOTS : 0;
+	state.frame_size = profile;
+	for(int j = 0;j < function->arg_count && j < TRANSLATOR_REGISTER_ARGS;j++) {
+		state.frame_size = Translator__slot(state.frame_size, function->args[j].type == CODE_OBJECT_TYPE_ARRAY ? 8 : 4);
+	}
+	for(int i = block->start_index;i < block->end_index;i++) {
+		CODE_OBJECT* object = &C->pre_compiled_code[i];
+		if(object->type == CODE_OBJECT_TYPE_ARRAY) {
+			state.frame_size = Translator__array_slot(state.frame_size, object->CODE_OBJECT_DATA._pointer);
+			leaf = leaf && object->CODE_OBJECT_DATA._pointer->storage != PCC_STORAGE_HEAP;
+		}
+		if(object->type == CODE_OBJECT_TYPE_INT) {
+			PCC__INT* integer = object->CODE_OBJECT_DATA._int;
+			state.frame_size = Translator__slot(state.frame_size, Translator__size(integer));
+			if(integer->task == PCC_TASK_SPAWN && integer->storage == PCC_STORAGE_FRAME) {
+				state.frame_size = Translator__slot(state.frame_size, TRANSLATOR_TASK_SLOT);
+			}
+			leaf = leaf && (integer->task == PCC_TASK_NONE || integer->storage == PCC_STORAGE_NONE);
+		}
+		if((object->type == CODE_OBJECT_TYPE_INT || object->type == CODE_OBJECT_TYPE_RETURN) && object->CODE_OBJECT_DATA._int->call != NULL) {
+			PCC__INT* integer = object->CODE_OBJECT_DATA._int;
+			leaf = leaf && Translator__tail_call(C, block, i);
+			if(integer->call_arg_count - TRANSLATOR_REGISTER_ARGS > outgoing) {
+				outgoing = integer->call_arg_count - TRANSLATOR_REGISTER_ARGS;
+			}
+		}
+		leaf = leaf && object->type != CODE_OBJECT_TYPE_PRINT;
+	}
+	if(leaf && state.frame_size <= TRANSLATOR_RED_ZONE) {
+		state.base = REGISTER_RSP;
+	}
+	state.frame_size = (state.frame_size + outgoing * 8 + 15) & ~15;
+
+	int label = CodeBuffer__label(buffer, block->asm_identifier, true);
+	if(label < 0) {
+		goto CLEANUP;
+	}
+	buffer->labels[label].exported = block->exported;
+	if(Translator__frame(C, buffer, CODE_FRAME_ENTRY) != 0 || Translator__line(&state, C->pre_compiled_code[entry].token) != 0) {
+		goto CLEANUP;
+	}
+	if(state.base == REGISTER_RBP) {
+		if(Assembler__push(buffer, REGISTER_RBP) != 0 || Translator__frame(C, buffer, CODE_FRAME_PUSHED) != 0 ||
+		   Assembler__mov_reg_reg(buffer, REGISTER_RBP, REGISTER_RSP) != 0 || Translator__frame(C, buffer, CODE_FRAME_BASE) != 0) {
+			goto CLEANUP;
+		}
+		if(state.frame_size > 0 && Assembler__alu_reg_imm32(buffer, ALU_SUB, REGISTER_RSP, state.frame_size) != 0) {
+			goto CLEANUP;
+		}
+	}
+
+	// Arguments are locals, the ones on the stack stay above the return address
+	state.body = buffer->size;
+	static const int registers[TRANSLATOR_REGISTER_ARGS] = { REGISTER_RDI, REGISTER_RSI, REGISTER_RDX, REGISTER_RCX, REGISTER_R8, REGISTER_R9 };
+	int32_t next_offset = -profile;
+	for(int j = 0;j < function->arg_count;j++) {
+		TRANSLATOR_LOCAL* local = &state.locals[state.local_count++];
+		local->identifier = function->args[j].name;
+		local->size = function->args[j].type == CODE_OBJECT_TYPE_ARRAY ? 8 : 4;
+		local->type = function->args[j].type;
+		local->task = PCC_TASK_NONE;
+		local->array = NULL;
+		local->storage = PCC_STORAGE_HEAP;
+		if(j >= TRANSLATOR_REGISTER_ARGS) {
+			local->offset = (state.base == REGISTER_RBP ? 16 : 8) + (j - TRANSLATOR_REGISTER_ARGS) * 8;
+			continue;
+		}
+		next_offset = -Translator__slot(-next_offset, local->size);
+		local->offset = next_offset;
+		if(Assembler__mov_mem_reg(buffer, Assembler__memory(state.base, local->offset), registers[j], local->size) != 0) {
+			goto CLEANUP;
+		}
+	}
+	if(Translator__profile_enter(&state) != 0) {
+		goto CLEANUP;
+	}
+
+	bool returned = false, jumped = false;
+	for(int i = block->start_index;i < block->end_index;i++) {
+		CODE_OBJECT* object = &C->pre_compiled_code[i];
+		returned = false;
+		jumped = false;
+		if(Translator__line(&state, object->token) != 0) {
+			goto CLEANUP;
+		}
+		switch(object->type) {
+			case CODE_OBJECT_TYPE_INT: {
+				// Local integer variable
+				PCC__INT* integer = object->CODE_OBJECT_DATA._int;
+				int size = Translator__size(integer);
+				next_offset = -Translator__slot(-next_offset, size);
+				TRANSLATOR_LOCAL* local = &state.locals[state.local_count];
+				local->identifier = integer->identifier;
+				local->offset = next_offset;
+				local->size = size;
+				local->type = integer->type;
+				local->task = PCC_TASK_NONE;
+				local->array = NULL;
+				int32_t record = 0;
+				if(integer->task == PCC_TASK_SPAWN && integer->storage == PCC_STORAGE_FRAME) {
+					next_offset = -Translator__slot(-next_offset, TRANSLATOR_TASK_SLOT);
+					record = next_offset;
+				}
+				if(integer->task != PCC_TASK_NONE) {
+					// Declared after the call, "int h = join h;" refers to an earlier handle
+					if(Translator__task(&state, local, integer, record) != 0) {
+						goto CLEANUP;
+					}
+				}
+				else if(integer->call != NULL) {
+					bool tail = Translator__tail_call(C, block, i);
+					if(Translator__invoke(&state, i, integer, tail) != 0) {
+						goto CLEANUP;
+					}
+					if(tail) {
+						// The return that follows is part of the jump
+						i++;
+						returned = true;
+						jumped = true;
+					}
+					else if(Translator__convert(buffer, REGISTER_RAX, CODE_OBJECT_TYPE_INT, integer->type) != 0 ||
+					        Assembler__mov_mem_reg(buffer, Assembler__memory(state.base, local->offset), REGISTER_RAX, size) != 0) {
+						// Functions return int
+						goto CLEANUP;
+					}
+				}
+				else if(integer->operation != 0) {
+					if(Translator__calculation(&state, integer, integer->type) != 0 ||
+					   Assembler__mov_mem_reg(buffer, Assembler__memory(state.base, local->offset), REGISTER_RAX, size) != 0) {
+						goto CLEANUP;
+					}
+				}
+				else if(integer->element != NULL) {
+					if(Translator__element(&state, integer) != 0 || Translator__convert(buffer, REGISTER_RAX, CODE_OBJECT_TYPE_INT, integer->type) != 0 ||
+					   Assembler__mov_mem_reg(buffer, Assembler__memory(state.base, local->offset), REGISTER_RAX, size) != 0) {
+						goto CLEANUP;
+					}
+				}
+				else if(integer->value != (int32_t)integer->value && size == 8) {
+					// No 64 bit immediate stores
+					if(Assembler__mov_reg_imm64(buffer, REGISTER_RAX, (uint64_t)integer->value) != 0 ||
+					   Assembler__mov_mem_reg(buffer, Assembler__memory(state.base, local->offset), REGISTER_RAX, 8) != 0) {
+						goto CLEANUP;
+					}
+				}
+				else if(Assembler__mov_mem_imm(buffer, Assembler__memory(state.base, local->offset), (int32_t)integer->value, size) != 0) {
+					goto CLEANUP;
+				}
+				state.local_count++;
+			} break;
+			case CODE_OBJECT_TYPE_ARRAY: {
+				// Local array, declared after its initializers
+				PCC__POINTER* array = object->CODE_OBJECT_DATA._pointer;
+				next_offset = -Translator__array_slot(-next_offset, array);
+				TRANSLATOR_LOCAL* local = &state.locals[state.local_count];
+				local->identifier = array->identifier;
+				local->offset = next_offset;
+				local->size = 8;
+				local->type = CODE_OBJECT_TYPE_ARRAY;
+				local->task = PCC_TASK_NONE;
+				local->array = array;
+				local->storage = array->storage;
+				if(Translator__array(&state, local) != 0) {
+					goto CLEANUP;
+				}
+				state.local_count++;
+			} break;
+			case CODE_OBJECT_TYPE_RETURN: {
+				PCC__INT* value = object->CODE_OBJECT_DATA._int;
+				bool tail = Translator__tail_call(C, block, i);
+				for(int j = 0;value->musttail && !tail && value->call != NULL && j < value->call_arg_count;j++) {
+					if(Translator__frame_array(C, block, i, value->call_args[j])) {
+						printf("[ERROR] musttail return in function \"%s\" can not become a jump, it passes the array \"%s\" of its frame.\n", block->identifier, value->call_args[j]);
+						goto CLEANUP;
+					}
+				}
+				if(value->musttail && !tail) {
+					printf("[ERROR] musttail return in function \"%s\" can not become a jump (it needs a call with at most %d arguments).\n", block->identifier, TRANSLATOR_REGISTER_ARGS);
+					goto CLEANUP;
+				}
+				if(value->call != NULL) {
+					if(Translator__invoke(&state, i, value, tail) != 0) {
+						goto CLEANUP;
+					}
+					if(tail) {
+						returned = true;
+						jumped = true;
+						break;
+					}
+				}
+				else if(value->operation != 0) {
+					if(Translator__calculation(&state, value, block->return_type) != 0) {
+						goto CLEANUP;
+					}
+				}
+				else if(value->element != NULL) {
+					if(Translator__element(&state, value) != 0) {
+						goto CLEANUP;
+					}
+				}
+				else if(value->identifier != NULL) {
+					if(Translator__load_as(&state, REGISTER_RAX, value->identifier, block->return_type) != 0) {
+						goto CLEANUP;
+					}
+				}
+				else if(value->value == 0) {
+					if(Assembler__xor_reg32(buffer, REGISTER_RAX) != 0) {
+						goto CLEANUP;
+					}
+				}
+				else if(Assembler__mov_reg_imm32(buffer, REGISTER_RAX, (uint32_t)value->value) != 0) {
+					goto CLEANUP;
+				}
+
+				if(C->bflagsArgs[2]) {
+					// Long return: delete stack frame and use 'ret'
+					if(Translator__epilogue(&state) != 0) {
+						goto CLEANUP;
+					}
+				}
+				else if(i + 1 < block->end_index) {
+					// Jump to end
+					if(Assembler__jmp_local(buffer, &state.end_jumps[state.end_jump_count++]) != 0) {
+						goto CLEANUP;
+					}
+				}
+				returned = true;
+			} break;
+			case CODE_OBJECT_TYPE_PRINT: {
+				PCC__INT* value = object->CODE_OBJECT_DATA._int;
+				if(value->identifier != NULL) {
+					// Printed as int
+					if(Translator__load_as(&state, REGISTER_RDI, value->identifier, CODE_OBJECT_TYPE_INT) != 0) {
+						goto CLEANUP;
+					}
+				}
+				else if(Assembler__mov_reg_imm32(buffer, REGISTER_RDI, (uint32_t)value->value) != 0) {
+					goto CLEANUP;
+				}
+				if(Translator__call(C, buffer, IO_PRINT_SYMBOL) != 0) {
+					goto CLEANUP;
+				}
+			} break;
+			default: {
+				printf("[ERROR] Unsupported code object (%d) in function \"%s\".\n", object->type, block->identifier);
+				goto CLEANUP;
+			} break;
+		}
+	}
+
+	// Function end ("}")
+	if(Translator__line(&state, function->token_end) != 0) {
+		goto CLEANUP;
+	}
+	if(!returned) {
+		// Falling off the end returns 0
+		if(Assembler__xor_reg32(buffer, REGISTER_RAX) != 0) {
+			goto CLEANUP;
+		}
+	}
+	for(int i = 0;i < state.end_jump_count;i++) {
+		if(CodeBuffer__patch_rel32(buffer, state.end_jumps[i], buffer->size) != 0) {
+			goto CLEANUP;
+		}
+	}
+	if(!(returned && (C->bflagsArgs[2] || jumped) && state.end_jump_count == 0)) {
+		if(Translator__epilogue(&state) != 0) {
+			goto CLEANUP;
+		}
+	}
+	buffer->labels[label].size = buffer->size - buffer->labels[label].offset;
+	while(buffer->debug_count > 0 && buffer->debug[buffer->debug_count - 1].offset == buffer->size) {
+		// Rows after the last instruction would belong to the next function
+		buffer->debug_count--;
+	}
+	ret = 0;
+
+	CLEANUP:
+	free(state.locals);
+	free(state.end_jumps);
+	return ret;
+}
+
+static bool Translator__defines(COMPILER* compiler, const char* symbol) {
+	for(int i = 0;i < C->current_function;i++) {
+		if(strcmp(C->functions[i].name, symbol) == 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static int Translator__call(COMPILER* compiler, CODE_BUFFER* buffer, const char* symbol) {
+	// Position independent code calls functions of other files through the PLT
+	if(C->pic && !Translator__defines(C, symbol)) {
+		return Assembler__call_plt(buffer, symbol);
+	}
+	return Assembler__call_symbol(buffer, symbol);
+}
+
+static int Translator__jump(COMPILER* compiler, CODE_BUFFER* buffer, const char* symbol) {
+	// Tail calls, like Translator__call
+	if(C->pic && !Translator__defines(C, symbol)) {
+		return Assembler__jmp_plt(buffer, symbol);
+	}
+	return Assembler__jmp_symbol(buffer, symbol);
+}
+
+static int Translator__address(COMPILER* compiler, CODE_BUFFER* buffer, int reg, const char* symbol) {
+	// Address of a symbol of this file
+	if(C->pic) {
+		return Assembler__lea_reg_mem(buffer, reg, Assembler__symbol(symbol, 0));
+	}
+	return Assembler__mov_reg_symbol(buffer, reg, symbol);
+}
+
+static int Translator__copy(COMPILER* compiler, CODE_BUFFER* buffer, const char* destination, const char* source, uint64_t size) {
+	// Copy of known size between two symbols (in _start, after the CPU check)
+	int level = C->target.level;
+	int widest = level >= KERNELS_LEVEL_V4 ? 64 : level >= KERNELS_LEVEL_V3 ? 32 : level >= KERNELS_LEVEL_V2 ? 16 : 8;
+	if(size <= (uint64_t)widest * TRANSLATOR_INLINE_MOVES) {
+		// Widest moves through rax or xmm0/ymm0/zmm0, the last one overlaps the one before
+		int width = widest;
+		while(width > 1 && (uint64_t)width > size) {
+			width = width / 2;
+		}
+		for(uint64_t offset = 0;offset < size;offset = offset + width) {
+			if(offset + width > size) {
+				offset = size - width;
+			}
+			MEMORY_OPERAND from = Assembler__symbol(source, (int32_t)offset);
+			MEMORY_OPERAND to = Assembler__symbol(destination, (int32_t)offset);
+			if(width >= 16 && (Assembler__movdqu_reg_mem(buffer, 0, from, width) != 0 || Assembler__movdqu_mem_reg(buffer, to, 0, width) != 0)) {
+				return -1;
+			}
+			if(width < 16 && (Assembler__mov_reg_mem(buffer, REGISTER_RAX, from, width) != 0 || Assembler__mov_mem_reg(buffer, to, REGISTER_RAX, width) != 0)) {
+				return -1;
+			}
+		}
+		return width >= 32 ? Assembler__vzeroupper(buffer) : 0;
+	}
+	if(Translator__address(C, buffer, REGISTER_RDI, destination) != 0 || Translator__address(C, buffer, REGISTER_RSI, source) != 0) {
+		return -1;
+	}
+	if(C->tasks) {
+		// The runtime is linked (see LinkRuntime)
+		if(Assembler__mov_reg_imm32(buffer, REGISTER_RDX, (uint32_t)size) != 0) {
+			return -1;
+		}
+		return Translator__call(C, buffer, KERNELS_MEMCPY_SYMBOL);
+	}
+	if(Assembler__mov_reg_imm32(buffer, REGISTER_RCX, (uint32_t)size) != 0) {
+		return -1;
+	}
+	return Assembler__rep_movsb(buffer);
+}
+
+static int Translator__meta(int type) {
+	bool is_signed;
+	Translator__width(type, &is_signed);
+	return TRANSLATOR_META(type, is_signed);
+}
+
+static int Translator__global(CODE_BUFFER* buffer, PCC__INT* global) {
+	// Meta data byte and the value in the size of its type (little endian)
+	uint64_t value = (uint64_t)global->value;
+	if(CodeBuffer__byte(buffer, (uint8_t)Translator__meta(global->type)) != 0) {
+		return -1;
+	}
+	return CodeBuffer__emit(buffer, &value, Translator__bytes(global->type));
+}
+
+static PCC__INT* Translator__initialized(COMPILER* compiler, int entry) {
+	// Global set by _start (tables are in .rodata)
+	CODE_OBJECT* object = &C->pre_compiled_code[entry];
+	if(object->type != CODE_OBJECT_TYPE_INT || !object->CODE_OBJECT_DATA._int->global || object->CODE_OBJECT_DATA._int->count_start != 0 ||
+	   (C->live != NULL && !C->live[entry])) {
+		return NULL;
+	}
+	return object->CODE_OBJECT_DATA._int;
+}
+
+static int Translator__symbol_index(COMPILER* compiler, const char* name) {
+	// Profile symbol of a callee, external functions are added after the functions
+	INSTRUMENT* instrument = &C->instrument;
+	for(int i = 0;i < instrument->symbol_count;i++) {
+		if(strcmp(instrument->symbols[i], name) == 0) {
+			return i;
+		}
+	}
+	char** symbols = realloc(instrument->symbols, (instrument->symbol_count + 1) * sizeof(char*));
+	if(symbols == NULL) {
+		return -1;
+	}
+	instrument->symbols = symbols;
+	instrument->symbols[instrument->symbol_count] = (char*)name;
+	return instrument->symbol_count++;
+}
+
+int Translator__instrument(COMPILER* compiler) {
+	// Edges of all call sites (before the functions are translated in parallel),
+	// their description in .rodata and the counters in .bss
+	INSTRUMENT* instrument = &C->instrument;
+	instrument->symbols = malloc((C->current_function > 0 ? C->current_function : 1) * sizeof(char*));
+	instrument->sites = malloc((C->pcc_entries > 0 ? C->pcc_entries : 1) * sizeof(int));
+	instrument->edges = malloc((C->pcc_entries > 0 ? C->pcc_entries : 1) * 2 * sizeof(uint32_t));
+	if(instrument->symbols == NULL || instrument->sites == NULL || instrument->edges == NULL) {
+		printf("[ERROR] Could not allocate the profile tables.\n");
+		return -1;
+	}
+	for(int i = 0;i < C->current_function;i++) {
+		instrument->symbols[i] = C->functions[i].name;
+	}
+	instrument->symbol_count = C->current_function;
+	int caller = -1;
+	for(int i = 0;i < C->pcc_entries;i++) {
+		CODE_OBJECT* object = &C->pre_compiled_code[i];
+		instrument->sites[i] = -1;
+		if(object->type == CODE_OBJECT_TYPE_FUNCTION) {
+			caller = object->CODE_OBJECT_DATA._code_block->function_index;
+		}
+		instrument->atomic = instrument->atomic || (object->type == CODE_OBJECT_TYPE_INT && object->CODE_OBJECT_DATA._int->task == PCC_TASK_SPAWN);
+		if(caller < 0 || (object->type != CODE_OBJECT_TYPE_INT && object->type != CODE_OBJECT_TYPE_RETURN) || object->CODE_OBJECT_DATA._int->call == NULL) {
+			continue;
+		}
+		int callee = Translator__symbol_index(C, object->CODE_OBJECT_DATA._int->call);
+		if(callee < 0) {
+			printf("[ERROR] Could not allocate the profile tables.\n");
+			return -1;
+		}
+		int edge = 0;
+		while(edge < instrument->edge_count && (instrument->edges[edge * 2] != (uint32_t)caller || instrument->edges[edge * 2 + 1] != (uint32_t)callee)) {
+			edge++;
+		}
+		if(edge == instrument->edge_count) {
+			instrument->edges[edge * 2] = (uint32_t)caller;
+			instrument->edges[edge * 2 + 1] = (uint32_t)callee;
+			instrument->edge_count++;
+		}
+		instrument->sites[i] = edge;
+	}
+
+	CODE_BUFFER* rodata = &C->image.sections[OUTPUT_SECTION_RODATA].buffer;
+	CODE_BUFFER* bss = &C->image.sections[OUTPUT_SECTION_BSS].buffer;
+	PROFILE_HEADER header = { PROFILE_MAGIC, PROFILE_VERSION, (uint32_t)C->current_function, (uint32_t)instrument->symbol_count, (uint32_t)instrument->edge_count, 0, 0 };
+	for(int i = 0;i < instrument->symbol_count;i++) {
+		header.names_size = header.names_size + strlen(instrument->symbols[i]) + 1;
+	}
+	uint32_t padding = ((header.names_size + 7) & ~7u) - header.names_size;
+	header.names_size = header.names_size + padding;
+	CodeBuffer__label(rodata, PROFILE_PATH_SYMBOL, false);
+	CodeBuffer__emit(rodata, instrument->path, strlen(instrument->path) + 1);
+	CodeBuffer__align(rodata, 8, 0);
+	CodeBuffer__label(rodata, PROFILE_META_SYMBOL, false);
+	CodeBuffer__emit(rodata, &header, sizeof(header));
+	CodeBuffer__emit(rodata, instrument->edges, instrument->edge_count * sizeof(PROFILE_EDGE));
+	for(int i = 0;i < instrument->symbol_count;i++) {
+		CodeBuffer__emit(rodata, instrument->symbols[i], strlen(instrument->symbols[i]) + 1);
+	}
+	CodeBuffer__zero(rodata, padding);
+	CodeBuffer__align(bss, 8, 0);
+	CodeBuffer__label(bss, PROFILE_COUNTERS_SYMBOL, false);
+	return CodeBuffer__zero(bss, (uint64_t)(C->current_function + instrument->edge_count) * sizeof(PROFILE_COUNTER));
+}
+
+void Translator__free_instrument(COMPILER* compiler) {
+	// The symbols belong to the functions and the pre-compiled code
+	free(C->instrument.symbols);
+	free(C->instrument.edges);
+	free(C->instrument.sites);
+	C->instrument.symbols = NULL;
+	C->instrument.edges = NULL;
+	C->instrument.sites = NULL;
+}
+
+static char* Translator__clone_name(const char* function, const char* suffix) {
+	// "<function>.<suffix>": the clones, their table and the slot of the stub
+	char* name = malloc(strlen(function) + strlen(suffix) + 2);
+	if(name == NULL) {
+		printf("[ERROR] Could not allocate the clones of \"%s\".\n", function);
+		return NULL;
+	}
+	sprintf(name, "%s.%s", function, suffix);
+	return name;
+}
+
+static int Translator__exit(COMPILER* compiler, CODE_BUFFER* buffer) {
+	// Exit with the result of main, exit_group also ends task workers
+	Assembler__mov_reg_reg(buffer, REGISTER_RDI, REGISTER_RAX);
+	if(C->tasks) {
+		// Buffered output is written first
+		return Translator__call(C, buffer, IO_EXIT_SYMBOL);
+	}
+	Assembler__mov_reg_imm32(buffer, REGISTER_RAX, 231);
+	return Assembler__syscall(buffer);
+}
+
+int Translator__entry(COMPILER* compiler, CODE_BUFFER* buffer) {
+	int label = CodeBuffer__label(buffer, "_start", true);
+	if(label < 0 || Translator__frame(C, buffer, CODE_FRAME_OUTERMOST) != 0) {
+		return -1;
+	}
+	if(C->format == OUTPUT_FORMAT_ELF64_OBJECT) {
+		// Globals are in .data, the kernel zeroes .bss
+		Translator__call(C, buffer, "main");
+		int ret = Translator__exit(C, buffer);
+		buffer->labels[label].size = buffer->size;
+		return ret;
+	}
+
+	// Zero out bss
+	Translator__address(C, buffer, REGISTER_RDI, "bss_start");
+	Translator__address(C, buffer, REGISTER_RCX, "bss_end");
+	Assembler__alu_reg_reg(buffer, ALU_SUB, REGISTER_RCX, REGISTER_RDI);
+	Assembler__xor_reg32(buffer, REGISTER_RAX);
+	Assembler__rep_stosb(buffer);
+
+	// CPU check (before any code of the -march level), then the clones of
+	// the target_clones functions: rax = level * 8 - 8 indexes their tables
+	if(C->target.level > KERNELS_LEVEL_X86_64 || C->target.dispatch_count > 0) {
+		Assembler__mov_reg_imm32(buffer, REGISTER_RDI, (uint32_t)C->target.level);
+		Translator__call(C, buffer, KERNELS_CPU_LEVEL_SYMBOL);
+	}
+	if(C->target.dispatch_count > 0) {
+		Assembler__shl_reg_imm8(buffer, REGISTER_RAX, 3);
+		Assembler__alu_reg_imm32(buffer, ALU_SUB, REGISTER_RAX, 8);
+	}
+	for(int i = 0;i < C->target.dispatch_count;i++) {
+		PCC_CODE_BLOCK* block = C->pre_compiled_code[C->functions[C->target.dispatched[i]].id].CODE_OBJECT_DATA._code_block;
+		char* table = Translator__clone_name(block->asm_identifier, "clones");
+		char* slot = Translator__clone_name(block->asm_identifier, "slot");
+		int ret = table != NULL && slot != NULL ? 0 : -1;
+		if(ret == 0 && (Translator__address(C, buffer, REGISTER_RCX, table) != 0 || Assembler__alu_reg_reg(buffer, ALU_ADD, REGISTER_RCX, REGISTER_RAX) != 0 ||
+		   Assembler__mov_reg_mem(buffer, REGISTER_RCX, Assembler__memory(REGISTER_RCX, 0), 8) != 0 ||
+		   Assembler__mov_mem_reg(buffer, Assembler__symbol(slot, 0), REGISTER_RCX, 8) != 0)) {
+			ret = -1;
+		}
+		free(table);
+		free(slot);
+		if(ret != 0) {
+			return -1;
+		}
+	}
+
+	// Set global variables: few with immediate stores, more with one copy of
+	// their initial image in .rodata (they follow bss_start)
+	uint64_t bytes = 0;
+	for(int i = 0;i < C->pcc_entries;i++) {
+		PCC__INT* global = Translator__initialized(C, i);
+		bytes = bytes + (global != NULL ? 1 + Translator__bytes(global->type) : 0);
+	}
+	CODE_BUFFER* rodata = &C->image.sections[OUTPUT_SECTION_RODATA].buffer;
+	bool copy = bytes > TRANSLATOR_IMMEDIATE_GLOBALS;
+	if(copy) {
+		CodeBuffer__align(rodata, 8, 0);
+		CodeBuffer__label(rodata, "globals_init", false);
+	}
+	for(int i = 0;i < C->pcc_entries;i++) {
+		PCC__INT* global = Translator__initialized(C, i);
+		if(global == NULL) {
+			continue;
+		}
+		int size = Translator__bytes(global->type);
+		if(copy) {
+			Translator__global(rodata, global);
+			continue;
+		}
+		Assembler__mov_mem_imm(buffer, Assembler__symbol(global->asm_identifier, 0), Translator__meta(global->type), 1);
+		if(global->value == 0) {
+			// Zero set not needed (bss)
+			continue;
+		}
+		if(global->value != (int32_t)global->value && size == 8) {
+			Assembler__mov_reg_imm64(buffer, REGISTER_RAX, (uint64_t)global->value);
+			Assembler__mov_mem_reg(buffer, Assembler__symbol(global->asm_identifier, 1), REGISTER_RAX, 8);
+		}
+		else {
+			Assembler__mov_mem_imm(buffer, Assembler__symbol(global->asm_identifier, 1), (int32_t)global->value, size);
+		}
+	}
+	if(copy && Translator__copy(C, buffer, "bss_start", "globals_init", bytes) != 0) {
+		return -1;
+	}
+
+	// Execute code
+	Translator__call(C, buffer, "main");
+	if(C->instrument.path != NULL) {
+		// Profile of the run, the exit status stays on the (aligned) stack
+		Assembler__push(buffer, REGISTER_RAX);
+		Assembler__push(buffer, REGISTER_RAX);
+		Translator__address(C, buffer, REGISTER_RDI, PROFILE_PATH_SYMBOL);
+		Translator__address(C, buffer, REGISTER_RSI, PROFILE_META_SYMBOL);
+		Translator__address(C, buffer, REGISTER_RDX, PROFILE_COUNTERS_SYMBOL);
+		Translator__call(C, buffer, PROFILE_WRITE_SYMBOL);
+		Assembler__pop(buffer, REGISTER_RAX);
+		Assembler__pop(buffer, REGISTER_RAX);
+	}
+	int ret = Translator__exit(C, buffer);
+	buffer->labels[label].size = buffer->size;
+	return ret;
+}
+
+static void* Translator__worker(void* argument) {
+	TRANSLATOR_JOBS* jobs = argument;
+	while(true) {
+		int job = __atomic_fetch_add(&jobs->next, 1, __ATOMIC_RELAXED);
+		if(job >= jobs->count) {
+			break;
+		}
+		COMPILER* compiler = jobs->compiler;
+		int function = C->pre_compiled_code[jobs->entries[job]].CODE_OBJECT_DATA._code_block->function_index;
+		bool cached = jobs->levels[job] == C->target.level; // Clones above the -march level are not cached
+		if(cached && Cache__load(C, function, &jobs->buffers[job]) == 0) {
+			jobs->results[job] = 0;
+			continue;
+		}
+		jobs->results[job] = Translator__function(C, jobs->entries[job], jobs->levels[job], &jobs->buffers[job]);
+		if(cached && jobs->results[job] == 0) {
+			Cache__store(C, function, &jobs->buffers[job]);
+		}
+	}
+	return NULL;
+}
+
+// qsort comparators read these, per thread for the compile server
+static __thread COMPILER* sort_compiler;
+static __thread TRANSLATOR_JOBS* sort_jobs;
+
+static int Translator__compare_rank(const void* a, const void* b) {
+	COMPILER* compiler = sort_compiler;
+	int x = C->pgo.rank[C->pre_compiled_code[sort_jobs->entries[*(const int*)a]].CODE_OBJECT_DATA._code_block->function_index];
+	int y = C->pgo.rank[C->pre_compiled_code[sort_jobs->entries[*(const int*)b]].CODE_OBJECT_DATA._code_block->function_index];
+	return x != y ? x - y : *(const int*)a - *(const int*)b; // Clones stay in level order
+}
+
+static bool Translator__same(CODE_BUFFER* a, CODE_BUFFER* b) {
+	// Same code, relocations and debug rows (the labels are the ones of the function)
+	if(a->size != b->size || a->relocation_count != b->relocation_count || a->debug_count != b->debug_count || memcmp(a->data, b->data, a->size) != 0) {
+		return false;
+	}
+	for(int i = 0;i < a->relocation_count;i++) {
+		CODE_RELOCATION* x = &a->relocations[i];
+		CODE_RELOCATION* y = &b->relocations[i];
+		if(x->offset != y->offset || x->type != y->type || x->addend != y->addend || strcmp(x->symbol, y->symbol) != 0) {
+			return false;
+		}
+	}
+	for(int i = 0;i < a->debug_count;i++) {
+		CODE_DEBUG* x = &a->debug[i];
+		CODE_DEBUG* y = &b->debug[i];
+		if(x->offset != y->offset || x->kind != y->kind || x->value != y->value || x->column != y->column) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static int Translator__clones(COMPILER* compiler, TRANSLATOR_JOBS* jobs, int first) {
+	// Drops the clones that equal the one of the level below, the rest get a
+	// stub (appended to the first clone), a table and a slot for _start
+	PCC_CODE_BLOCK* block = C->pre_compiled_code[jobs->entries[first]].CODE_OBJECT_DATA._code_block;
+	int kept[KERNELS_LEVEL_V4 + 1];
+	int distinct = 1;
+	kept[C->target.level] = first;
+	for(int level = C->target.level + 1;level <= KERNELS_LEVEL_V4;level++) {
+		int job = first + level - C->target.level;
+		jobs->dropped[job] = Translator__same(&jobs->buffers[kept[level - 1]], &jobs->buffers[job]);
+		kept[level] = jobs->dropped[job] ? kept[level - 1] : job;
+		distinct = distinct + !jobs->dropped[job];
+	}
+	if(distinct == 1) {
+		// Nothing depends on the level, one function for every CPU
+		return 0;
+	}
+
+	int ret = -1;
+	char* names[KERNELS_LEVEL_V4 + 1] = { NULL };
+	char* table = Translator__clone_name(block->asm_identifier, "clones");
+	char* slot = Translator__clone_name(block->asm_identifier, "slot");
+	if(table == NULL || slot == NULL) {
+		goto CLEANUP;
+	}
+	for(int level = C->target.level;level <= KERNELS_LEVEL_V4;level++) {
+		CODE_BUFFER* buffer = &jobs->buffers[kept[level]];
+		names[level] = Translator__clone_name(block->asm_identifier, translator_levels[level]);
+		if(names[level] == NULL) {
+			goto CLEANUP;
+		}
+		int label = CodeBuffer__find_label(buffer, block->asm_identifier);
+		if(kept[level] == first + level - C->target.level && label >= 0) {
+			free(buffer->labels[label].name);
+			buffer->labels[label].name = strdup(names[level]);
+			buffer->labels[label].global = false;
+			buffer->labels[label].exported = false;
+		}
+	}
+
+	// Clone of every CPU level (levels below -march do not get past _start)
+	CODE_BUFFER* rodata = &C->image.sections[OUTPUT_SECTION_RODATA].buffer;
+	CODE_BUFFER* bss = &C->image.sections[OUTPUT_SECTION_BSS].buffer;
+	if(CodeBuffer__align(rodata, 8, 0) != 0 || CodeBuffer__label(rodata, table, false) < 0) {
+		goto CLEANUP;
+	}
+	for(int level = KERNELS_LEVEL_X86_64;level <= KERNELS_LEVEL_V4;level++) {
+		if(CodeBuffer__relocation(rodata, names[level < C->target.level ? C->target.level : level], RELOCATION_ABS64, 0) != 0) {
+			goto CLEANUP;
+		}
+	}
+	if(CodeBuffer__align(bss, 8, 0) != 0 || CodeBuffer__label(bss, slot, false) < 0 || CodeBuffer__zero(bss, 8) != 0) {
+		goto CLEANUP;
+	}
+
+	// The stub has the name, calls and spawn go through it
+	CODE_BUFFER* buffer = &jobs->buffers[first];
+	int label = CodeBuffer__label(buffer, block->asm_identifier, true);
+	if(label < 0 || Translator__frame(C, buffer, CODE_FRAME_ENTRY) != 0 || Assembler__jmp_mem(buffer, Assembler__symbol(slot, 0)) != 0) {
+		goto CLEANUP;
+	}
+	buffer->labels[label].exported = block->exported;
+	buffer->labels[label].size = buffer->size - buffer->labels[label].offset;
+	C->target.dispatched[C->target.dispatch_count++] = block->function_index;
+	ret = 0;
+
+	CLEANUP:
+	for(int level = 0;level <= KERNELS_LEVEL_V4;level++) {
+		free(names[level]);
+	}
+	free(table);
+	free(slot);
+	return ret;
+}
+
+int Translator__x86_64(COMPILER* compiler) {
+	if(Linker__init_image(&C->image) != 0) {
+		return -1;
+	}
+	CODE_BUFFER* bss = &C->image.sections[OUTPUT_SECTION_BSS].buffer;
+	CODE_BUFFER* data = &C->image.sections[OUTPUT_SECTION_DATA].buffer;
+	bool shared = C->format == OUTPUT_FORMAT_ELF64_SHARED;
+	bool object = C->format == OUTPUT_FORMAT_ELF64_OBJECT || shared;
+
+	// Global variables (meta data byte + value)
+	//   Executables keep them in .bss and set them in _start. Objects and
+	//   shared objects are linked with other files, so their globals are
+	//   initialized in .data.
+	if(C->whole_program && Lto__analyze(C) != 0) {
+		return -1;
+	}
+	if(!object) {
+		CodeBuffer__label(bss, "bss_start", false);
+	}
+	for(int i = 0;i < C->pcc_entries;i++) {
+		if(C->live != NULL && !C->live[i]) {
+			// Whole program: unreachable
+			continue;
+		}
+		if(C->pre_compiled_code[i].type == CODE_OBJECT_TYPE_INT && C->pre_compiled_code[i].CODE_OBJECT_DATA._int->global) {
+			PCC__INT* global = C->pre_compiled_code[i].CODE_OBJECT_DATA._int;
+			if(global->count_start != 0) {
+				// Computed at compile time (see Optimizer/Constexpr/constexpr.h)
+				CODE_BUFFER* rodata = &C->image.sections[OUTPUT_SECTION_RODATA].buffer;
+				CodeBuffer__align(rodata, 4, 0);
+				int label = CodeBuffer__label(rodata, global->asm_identifier, true);
+				if(label >= 0) {
+					rodata->labels[label].size = global->count * sizeof(int32_t);
+					rodata->labels[label].exported = global->exported;
+				}
+				if(CodeBuffer__emit(rodata, global->table, global->count * sizeof(int32_t)) != 0) {
+					return -1;
+				}
+			}
+			else if(object) {
+				int label = CodeBuffer__label(data, global->asm_identifier, true);
+				if(label >= 0) {
+					data->labels[label].size = 1 + Translator__bytes(global->type);
+					data->labels[label].exported = global->exported;
+				}
+				Translator__global(data, global);
+			}
+			else {
+				CodeBuffer__label(bss, global->asm_identifier, true);
+				CodeBuffer__zero(bss, 1 + Translator__bytes(global->type));
+			}
+		}
+	}
+	if(C->instrument.path != NULL && Translator__instrument(C) != 0) {
+		return -1;
+	}
+
+	// Script sections, hosts load the bytecode at __SCRIPT with Script__load
+	if(C->script != NULL) {
+		CODE_BUFFER* rodata = &C->image.sections[OUTPUT_SECTION_RODATA].buffer;
+		CodeBuffer__align(rodata, 8, 0);
+		int label = CodeBuffer__label(rodata, "__SCRIPT", true);
+		if(label >= 0) {
+			rodata->labels[label].size = C->script_size;
+			rodata->labels[label].exported = true;
+		}
+		if(CodeBuffer__emit(rodata, C->script, C->script_size) != 0) {
+			return -1;
+		}
+	}
+
+	// Functions, target_clones functions once per level in executables
+	TRANSLATOR_JOBS jobs = { C, NULL, NULL, NULL, NULL, NULL, 0, 0 };
+	int clones = object ? 0 : KERNELS_LEVEL_V4 - C->target.level;
+	for(int i = 0;i < C->pcc_entries;i++) {
+		if(C->pre_compiled_code[i].type == CODE_OBJECT_TYPE_FUNCTION && (C->live == NULL || C->live[i])) {
+			jobs.count = jobs.count + 1 + (C->pre_compiled_code[i].CODE_OBJECT_DATA._code_block->clones ? clones : 0);
+		}
+	}
+	int ret = 0;
+	jobs.entries = malloc((jobs.count + 1) * sizeof(int));
+	jobs.levels = malloc((jobs.count + 1) * sizeof(int));
+	jobs.buffers = calloc(jobs.count + 1, sizeof(CODE_BUFFER));
+	jobs.results = calloc(jobs.count + 1, sizeof(int));
+	jobs.dropped = calloc(jobs.count + 1, sizeof(bool));
+	C->target.dispatched = malloc((C->current_function + 1) * sizeof(int));
+	if(jobs.entries == NULL || jobs.levels == NULL || jobs.buffers == NULL || jobs.results == NULL || jobs.dropped == NULL || C->target.dispatched == NULL) {
+		printf("[ERROR] Could not allocate translation jobs.\n");
+		ret = -1;
+		goto CLEANUP;
+	}
+	for(int i = 0, j = 0;i < C->pcc_entries;i++) {
+		if(C->pre_compiled_code[i].type != CODE_OBJECT_TYPE_FUNCTION || (C->live != NULL && !C->live[i])) {
+			continue;
+		}
+		int last = C->target.level + (C->pre_compiled_code[i].CODE_OBJECT_DATA._code_block->clones ? clones : 0);
+		for(int level = C->target.level;level <= last;level++) {
+			jobs.entries[j] = i;
+			jobs.levels[j] = level;
+			if(CodeBuffer__init(&jobs.buffers[j], 256) != 0) {
+				ret = -1;
+				goto CLEANUP;
+			}
+			j++;
+		}
+	}
+
+	int threads = C->threads;
+	if(threads > jobs.count) {
+		threads = jobs.count;
+	}
+	if(threads <= 1) {
+		Translator__worker(&jobs);
+	}
+	else {
+		pthread_t* workers = malloc(threads * sizeof(pthread_t));
+		if(workers == NULL) {
+			printf("[ERROR] Could not allocate translation threads.\n");
+			ret = -1;
+			goto CLEANUP;
+		}
+		int started = 0;
+		for(;started < threads;started++) {
+			if(pthread_create(&workers[started], NULL, Translator__worker, &jobs) != 0) {
+				break;
+			}
+		}
+		if(started == 0) {
+			// No thread could be started, translate on this thread
+			Translator__worker(&jobs);
+		}
+		for(int i = 0;i < started;i++) {
+			pthread_join(workers[i], NULL);
+		}
+		free(workers);
+	}
+	for(int i = 0;i < jobs.count && ret == 0;i++) {
+		ret = jobs.results[i];
+		if(ret == 0 && jobs.levels[i] == C->target.level && i + 1 < jobs.count && jobs.entries[i + 1] == jobs.entries[i]) {
+			ret = Translator__clones(C, &jobs, i);
+		}
+	}
+	if(ret != 0) {
+		goto CLEANUP;
+	}
+
+	// Entry code (objects only carry it if they define main, shared objects never)
+	bool has_main = Translator__defines(C, "main");
+	if(!object || (has_main && !shared)) {
+		CODE_BUFFER entry;
+		if(CodeBuffer__init(&entry, 256) != 0) {
+			ret = -1;
+			goto CLEANUP;
+		}
+		ret = Translator__entry(C, &entry);
+		if(ret == 0) {
+			ret = Linker__splice(&C->image, OUTPUT_SECTION_TEXT, &entry);
+		}
+		CodeBuffer__free(&entry);
+		if(ret != 0) {
+			goto CLEANUP;
+		}
+	}
+
+	// Concatenate in source order, or in the order of the profile (see Optimizer/PGO/pgo.h)
+	int* order = malloc((jobs.count + 1) * sizeof(int));
+	if(order == NULL) {
+		printf("[ERROR] Could not allocate translation jobs.\n");
+		ret = -1;
+		goto CLEANUP;
+	}
+	for(int i = 0;i < jobs.count;i++) {
+		order[i] = i;
+	}
+	if(C->pgo.rank != NULL) {
+		sort_compiler = C;
+		sort_jobs = &jobs;
+		qsort(order, jobs.count, sizeof(int), Translator__compare_rank);
+	}
+	for(int i = 0;i < jobs.count && ret == 0;i++) {
+		int job = order[i];
+		int function = C->pre_compiled_code[jobs.entries[job]].CODE_OBJECT_DATA._code_block->function_index;
+		int heat = C->pgo.heat != NULL ? C->pgo.heat[function] : PGO_UNKNOWN;
+		if(jobs.dropped[job]) {
+			continue;
+		}
+		if(heat == PGO_COLD) {
+			ret = Linker__splice_buffer(&C->image.cold, &jobs.buffers[job]);
+			continue;
+		}
+		if(heat == PGO_HOT) {
+			ret = CodeBuffer__align(&C->image.sections[OUTPUT_SECTION_TEXT].buffer, PGO_HOT_ALIGNMENT, 0xCC);
+		}
+		if(ret == 0) {
+			ret = Linker__splice(&C->image, OUTPUT_SECTION_TEXT, &jobs.buffers[job]);
+		}
+	}
+	free(order);
+	if(ret == 0 && !object) {
+		CodeBuffer__label(bss, "bss_end", false);
+	}
+
+	CLEANUP:
+	for(int i = 0;jobs.buffers != NULL && i < jobs.count;i++) {
+		CodeBuffer__free(&jobs.buffers[i]);
+	}
+	free(jobs.entries);
+	free(jobs.levels);
+	free(jobs.buffers);
+	free(jobs.results);
+	free(jobs.dropped);
+	free(C->target.dispatched);
+	C->target.dispatched = NULL;
+	C->target.dispatch_count = 0;
+	return ret;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdbool.h>
+
+#include "./../../structures.h"
+#include "./../../Assembler/x86_64/assembler.h"
+
+// Meta data byte in front of every global variable (2 bit unused, 1 bit signed, 5 bit type + 1),
+// 0x26 (00100110b) for int
+#define TRANSLATOR_META(type, is_signed) (((is_signed) ? 0x20 : 0x00) | ((type) + 1))
+
+// Copies of known size up to this many moves of the widest register are inlined (128 bytes for x86-64),
+// longer ones call __chaos_memcpy (see Runtime/Kernels/kernels.h)
+#define TRANSLATOR_INLINE_MOVES 16
+// Up to this many bytes of globals are set with immediate stores in _start, more are copied
+#define TRANSLATOR_IMMEDIATE_GLOBALS 64
+// Arguments passed in registers (rdi, rsi, rdx, rcx, r8, r9)
+#define TRANSLATOR_REGISTER_ARGS 6
+// Bytes below rsp a function without calls may use without a frame (System V)
+#define TRANSLATOR_RED_ZONE 128
+// Frame slots of instrumented functions (-finstrument): entry and call timestamps
+#define TRANSLATOR_PROFILE_SLOTS 16
+#define TRANSLATOR_PROFILE_ENTRY -8
+#define TRANSLATOR_PROFILE_CALL -16
+// Frame bytes of a task record that does not escape (TASK, see Optimizer/Escape/escape.h), a power of 2
+#define TRANSLATOR_TASK_SLOT 32
+// Elements of an array ("int a[N]", 4 bytes each), frame offsets stay 32 bit
+#define TRANSLATOR_ARRAY_MAX (1 << 20)
+
+int Translator__x86_64(COMPILER* compiler);
+int Translator__entry(COMPILER* compiler, CODE_BUFFER* buffer);
+int Translator__function(COMPILER* compiler, int entry, int level, CODE_BUFFER* buffer);
+int Translator__march(const char* name);
+int Translator__instrument(COMPILER* compiler);
+void Translator__free_instrument(COMPILER* compiler);
+
+// Calculations (arithmetic.c): rax = rax <operation> constant or rcx, uses rcx, rdx and r8
+int Translator__width(int type, bool* is_signed);
+int64_t Translator__value(int type, int64_t value);
+int Translator__common(int a, int b);
+int Translator__convert(CODE_BUFFER* buffer, int reg, int from, int to);
+int Translator__multiply(CODE_BUFFER* buffer, int type, int64_t constant);
+int Translator__divide(CODE_BUFFER* buffer, int type, int64_t constant, bool modulo);
+int Translator__divide_reg(CODE_BUFFER* buffer, int type, bool modulo);
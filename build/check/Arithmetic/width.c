@@ -0,0 +1,268 @@
+#include <stdio.h>
+// Calculations in one integer type (Translator/x86_64/arithmetic.c): case.check
+// replaces unsigned long long, A and B and compares the output with the same source built as C
+int main() {
+	unsigned long long a = 12345678901234567890;
+	unsigned long long b = 0 - 2;
+	int i = 0 - 7;
+	unsigned int u = 3000000000;
+	long l = 0 - 5000000000;
+	unsigned long long w = 0 - 3;
+	unsigned long long r1 = a + b;
+	unsigned long long r2 = a - b;
+	unsigned long long r3 = a * b;
+	unsigned long long r4 = a / b;
+	unsigned long long r5 = a % b;
+	unsigned long long r6 = b / a;
+	unsigned long long r7 = b % a;
+	unsigned long long r8 = a * 0;
+	unsigned long long r9 = a * 1;
+	unsigned long long r10 = a * -1;
+	unsigned long long r11 = a * 2;
+	unsigned long long r12 = a * 3;
+	unsigned long long r13 = a * 5;
+	unsigned long long r14 = a * 9;
+	unsigned long long r15 = a * 12;
+	unsigned long long r16 = a * 15;
+	unsigned long long r17 = a * 45;
+	unsigned long long r18 = a * 81;
+	unsigned long long r19 = a * 17;
+	unsigned long long r20 = a * 31;
+	unsigned long long r21 = a * -7;
+	unsigned long long r22 = a * 1000;
+	unsigned long long r23 = a * 1000000007;
+	unsigned long long r24 = a * 10000000000;
+	unsigned long long r25 = a / 1;
+	unsigned long long r26 = a / -1;
+	unsigned long long r27 = a / 2;
+	unsigned long long r28 = a / 8;
+	unsigned long long r29 = a / -4;
+	unsigned long long r30 = a / 3;
+	unsigned long long r31 = a / 7;
+	unsigned long long r32 = a / -7;
+	unsigned long long r33 = a / 10;
+	unsigned long long r34 = a / 641;
+	unsigned long long r35 = a / -1000;
+	unsigned long long r36 = a / 1000000007;
+	unsigned long long r37 = a / 10000000000;
+	unsigned long long r38 = a / 4294967296;
+	unsigned long long r39 = a % 1;
+	unsigned long long r40 = a % 2;
+	unsigned long long r41 = a % 8;
+	unsigned long long r42 = a % -4;
+	unsigned long long r43 = a % 3;
+	unsigned long long r44 = a % 7;
+	unsigned long long r45 = a % 10;
+	unsigned long long r46 = a % 641;
+	unsigned long long r47 = a % -1000;
+	unsigned long long r48 = a % 1000000007;
+	unsigned long long r49 = a % 10000000000;
+	unsigned long long r50 = a + i;
+	unsigned long long r51 = a * i;
+	unsigned long long r52 = a / i;
+	unsigned long long r53 = a % i;
+	unsigned long long r54 = a + u;
+	unsigned long long r55 = a / u;
+	unsigned long long r56 = a % u;
+	unsigned long long r57 = a - l;
+	unsigned long long r58 = a / l;
+	unsigned long long r59 = a * w;
+	unsigned long long r60 = a / w;
+	unsigned long long r61 = a % w;
+	unsigned long long r62 = i / a;
+	unsigned long long r63 = u / a;
+	unsigned long long r64 = l % a;
+	long long h1 = r1 / 4294967296;
+	printf("%d\n", (int)r1);
+	printf("%d\n", (int)h1);
+	long long h2 = r2 / 4294967296;
+	printf("%d\n", (int)r2);
+	printf("%d\n", (int)h2);
+	long long h3 = r3 / 4294967296;
+	printf("%d\n", (int)r3);
+	printf("%d\n", (int)h3);
+	long long h4 = r4 / 4294967296;
+	printf("%d\n", (int)r4);
+	printf("%d\n", (int)h4);
+	long long h5 = r5 / 4294967296;
+	printf("%d\n", (int)r5);
+	printf("%d\n", (int)h5);
+	long long h6 = r6 / 4294967296;
+	printf("%d\n", (int)r6);
+	printf("%d\n", (int)h6);
+	long long h7 = r7 / 4294967296;
+	printf("%d\n", (int)r7);
+	printf("%d\n", (int)h7);
+	long long h8 = r8 / 4294967296;
+	printf("%d\n", (int)r8);
+	printf("%d\n", (int)h8);
+	long long h9 = r9 / 4294967296;
+	printf("%d\n", (int)r9);
+	printf("%d\n", (int)h9);
+	long long h10 = r10 / 4294967296;
+	printf("%d\n", (int)r10);
+	printf("%d\n", (int)h10);
+	long long h11 = r11 / 4294967296;
+	printf("%d\n", (int)r11);
+	printf("%d\n", (int)h11);
+	long long h12 = r12 / 4294967296;
+	printf("%d\n", (int)r12);
+	printf("%d\n", (int)h12);
+	long long h13 = r13 / 4294967296;
+	printf("%d\n", (int)r13);
+	printf("%d\n", (int)h13);
+	long long h14 = r14 / 4294967296;
+	printf("%d\n", (int)r14);
+	printf("%d\n", (int)h14);
+	long long h15 = r15 / 4294967296;
+	printf("%d\n", (int)r15);
+	printf("%d\n", (int)h15);
+	long long h16 = r16 / 4294967296;
+	printf("%d\n", (int)r16);
+	printf("%d\n", (int)h16);
+	long long h17 = r17 / 4294967296;
+	printf("%d\n", (int)r17);
+	printf("%d\n", (int)h17);
+	long long h18 = r18 / 4294967296;
+	printf("%d\n", (int)r18);
+	printf("%d\n", (int)h18);
+	long long h19 = r19 / 4294967296;
+	printf("%d\n", (int)r19);
+	printf("%d\n", (int)h19);
+	long long h20 = r20 / 4294967296;
+	printf("%d\n", (int)r20);
+	printf("%d\n", (int)h20);
+	long long h21 = r21 / 4294967296;
+	printf("%d\n", (int)r21);
+	printf("%d\n", (int)h21);
+	long long h22 = r22 / 4294967296;
+	printf("%d\n", (int)r22);
+	printf("%d\n", (int)h22);
+	long long h23 = r23 / 4294967296;
+	printf("%d\n", (int)r23);
+	printf("%d\n", (int)h23);
+	long long h24 = r24 / 4294967296;
+	printf("%d\n", (int)r24);
+	printf("%d\n", (int)h24);
+	long long h25 = r25 / 4294967296;
+	printf("%d\n", (int)r25);
+	printf("%d\n", (int)h25);
+	long long h26 = r26 / 4294967296;
+	printf("%d\n", (int)r26);
+	printf("%d\n", (int)h26);
+	long long h27 = r27 / 4294967296;
+	printf("%d\n", (int)r27);
+	printf("%d\n", (int)h27);
+	long long h28 = r28 / 4294967296;
+	printf("%d\n", (int)r28);
+	printf("%d\n", (int)h28);
+	long long h29 = r29 / 4294967296;
+	printf("%d\n", (int)r29);
+	printf("%d\n", (int)h29);
+	long long h30 = r30 / 4294967296;
+	printf("%d\n", (int)r30);
+	printf("%d\n", (int)h30);
+	long long h31 = r31 / 4294967296;
+	printf("%d\n", (int)r31);
+	printf("%d\n", (int)h31);
+	long long h32 = r32 / 4294967296;
+	printf("%d\n", (int)r32);
+	printf("%d\n", (int)h32);
+	long long h33 = r33 / 4294967296;
+	printf("%d\n", (int)r33);
+	printf("%d\n", (int)h33);
+	long long h34 = r34 / 4294967296;
+	printf("%d\n", (int)r34);
+	printf("%d\n", (int)h34);
+	long long h35 = r35 / 4294967296;
+	printf("%d\n", (int)r35);
+	printf("%d\n", (int)h35);
+	long long h36 = r36 / 4294967296;
+	printf("%d\n", (int)r36);
+	printf("%d\n", (int)h36);
+	long long h37 = r37 / 4294967296;
+	printf("%d\n", (int)r37);
+	printf("%d\n", (int)h37);
+	long long h38 = r38 / 4294967296;
+	printf("%d\n", (int)r38);
+	printf("%d\n", (int)h38);
+	long long h39 = r39 / 4294967296;
+	printf("%d\n", (int)r39);
+	printf("%d\n", (int)h39);
+	long long h40 = r40 / 4294967296;
+	printf("%d\n", (int)r40);
+	printf("%d\n", (int)h40);
+	long long h41 = r41 / 4294967296;
+	printf("%d\n", (int)r41);
+	printf("%d\n", (int)h41);
+	long long h42 = r42 / 4294967296;
+	printf("%d\n", (int)r42);
+	printf("%d\n", (int)h42);
+	long long h43 = r43 / 4294967296;
+	printf("%d\n", (int)r43);
+	printf("%d\n", (int)h43);
+	long long h44 = r44 / 4294967296;
+	printf("%d\n", (int)r44);
+	printf("%d\n", (int)h44);
+	long long h45 = r45 / 4294967296;
+	printf("%d\n", (int)r45);
+	printf("%d\n", (int)h45);
+	long long h46 = r46 / 4294967296;
+	printf("%d\n", (int)r46);
+	printf("%d\n", (int)h46);
+	long long h47 = r47 / 4294967296;
+	printf("%d\n", (int)r47);
+	printf("%d\n", (int)h47);
+	long long h48 = r48 / 4294967296;
+	printf("%d\n", (int)r48);
+	printf("%d\n", (int)h48);
+	long long h49 = r49 / 4294967296;
+	printf("%d\n", (int)r49);
+	printf("%d\n", (int)h49);
+	long long h50 = r50 / 4294967296;
+	printf("%d\n", (int)r50);
+	printf("%d\n", (int)h50);
+	long long h51 = r51 / 4294967296;
+	printf("%d\n", (int)r51);
+	printf("%d\n", (int)h51);
+	long long h52 = r52 / 4294967296;
+	printf("%d\n", (int)r52);
+	printf("%d\n", (int)h52);
+	long long h53 = r53 / 4294967296;
+	printf("%d\n", (int)r53);
+	printf("%d\n", (int)h53);
+	long long h54 = r54 / 4294967296;
+	printf("%d\n", (int)r54);
+	printf("%d\n", (int)h54);
+	long long h55 = r55 / 4294967296;
+	printf("%d\n", (int)r55);
+	printf("%d\n", (int)h55);
+	long long h56 = r56 / 4294967296;
+	printf("%d\n", (int)r56);
+	printf("%d\n", (int)h56);
+	long long h57 = r57 / 4294967296;
+	printf("%d\n", (int)r57);
+	printf("%d\n", (int)h57);
+	long long h58 = r58 / 4294967296;
+	printf("%d\n", (int)r58);
+	printf("%d\n", (int)h58);
+	long long h59 = r59 / 4294967296;
+	printf("%d\n", (int)r59);
+	printf("%d\n", (int)h59);
+	long long h60 = r60 / 4294967296;
+	printf("%d\n", (int)r60);
+	printf("%d\n", (int)h60);
+	long long h61 = r61 / 4294967296;
+	printf("%d\n", (int)r61);
+	printf("%d\n", (int)h61);
+	long long h62 = r62 / 4294967296;
+	printf("%d\n", (int)r62);
+	printf("%d\n", (int)h62);
+	long long h63 = r63 / 4294967296;
+	printf("%d\n", (int)r63);
+	printf("%d\n", (int)h63);
+	long long h64 = r64 / 4294967296;
+	printf("%d\n", (int)r64);
+	printf("%d\n", (int)h64);
+	return 0;
+}
@@ -7,6 +7,9 @@
 
 #include "t.h"
 
+#include "./Assembler/x86_64/assembler.h"
+#include "./Linker/ELF64/linker.h"
+
 typedef struct _Def_ {
     char* str;
 } Def;
@@ -90,10 +93,12 @@ uint32_t identifier_count;
 
 char** preprocessed_files;
 
+OUTPUT_IMAGE output_image;
+
 int preprocessor(File* finput, uint32_t input_File_count, PRE_INFO* PreInfo);
 int compile(File* finput, uint32_t fcount);
 int translate();
-int assemble();
+int assemble(File* foutput, uint8_t Format);
 int Argument_processing__set_format(uint8_t* Format, char* argv);
 
 int main(int argc, char* argv[]) {
@@ -285,7 +290,7 @@ int main(int argc, char* argv[]) {
 		return ret;
 	}
 
-	ret = assemble();
+	ret = assemble(&foutput, Format);
 	if(ret != 0) {
 		return ret;
 	}
@@ -492,9 +497,52 @@ int compile(File* finput, uint32_t input_File_count) {
 	return 0;
 }
 
-int translate() {}
+int translate() {
+	if(Linker__init_image(&output_image) != 0) {
+		return -1;
+	}
+
+	// Entry code (see test.target.asm): zero out bss, call main, exit with its return value
+	CODE_BUFFER entry;
+	if(CodeBuffer__init(&entry, 64) != 0) {
+		return -1;
+	}
+	CodeBuffer__label(&entry, "_start", true);
+	Assembler__mov_reg_symbol(&entry, REGISTER_RDI, "bss_start");
+	Assembler__mov_reg_symbol(&entry, REGISTER_RCX, "bss_end");
+	Assembler__alu_reg_reg(&entry, ALU_SUB, REGISTER_RCX, REGISTER_RDI);
+	Assembler__xor_reg32(&entry, REGISTER_RAX);
+	Assembler__rep_stosb(&entry);
+	Assembler__call_symbol(&entry, "main");
+	Assembler__mov_reg_reg(&entry, REGISTER_RDI, REGISTER_RAX);
+	Assembler__mov_reg_imm32(&entry, REGISTER_RAX, 60);
+	Assembler__syscall(&entry);
+	int ret = Linker__splice(&output_image, OUTPUT_SECTION_TEXT, &entry);
+	CodeBuffer__free(&entry);
+	if(ret != 0) {
+		return ret;
+	}
 
-int assemble() {}
+	// Compiled code and globals follow the entry code
+	CodeBuffer__label(&output_image.sections[OUTPUT_SECTION_BSS].buffer, "bss_start", false);
+	return 0;
+}
+
+int assemble(File* foutput, uint8_t Format) {
+	// Close the bss range used by the entry code
+	CodeBuffer__label(&output_image.sections[OUTPUT_SECTION_BSS].buffer, "bss_end", false);
+
+	// Raw binaries are loaded at 0
+	if(Format == OUTPUT_FORMAT_RAW16 || Format == OUTPUT_FORMAT_RAW32 || Format == OUTPUT_FORMAT_RAW64) {
+		output_image.base_address = 0;
+	}
+
+	// Write the whole file in one go (no external assembler or linker)
+	fflush(foutput->fptr);
+	int ret = Linker__write(&output_image, fileno(foutput->fptr), Format);
+	Linker__free_image(&output_image);
+	return ret;
+}
 
 int Argument_processing__set_format(uint8_t* Format, char* argv) {
 	if(defines_count >= 6000) {
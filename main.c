@@ -1,5 +1,7 @@
 // Includes
 #include <stdio.h>
+#include <string.h>
+#include <unistd.h>
 
 // Compilers
 #include "./Compilers/ChaosLangCompiler.h" // ChaosLang
@@ -7,56 +9,41 @@
 
 // C specific includes
 
-// Assembly specific includes
-#include "./Translator/x86_64/translator.h"
-#include "./Assembler/x86_64/assembler.h"
+// Build engine
+#include "./Build/build.h"
 
 int main(int argc, char* argv[]) {
-	bool bflags[2] = {
-		true, // Translate
-		true  // Assemble
-	};
-	int flags[1] = {
-		0 // x86_64 Assembly
-	};
+	if(argc >= 3 && strcmp(argv[1], "--build") == 0) {
+		// Build a .soft project file
+		return Build__main(argc, argv);
+	}
+	// Language from the file extension
 	int language = 0;
-	char* fileName;
-	FILE* fptr;
-	File file = { fptr, fileName, NULL };
+	const char* extension = argc >= 2 ? strrchr(argv[1], '.') : NULL;
+	if(extension != NULL && (strcmp(extension, ".soft") == 0 || strcmp(extension, ".chaos") == 0)) {
+		language = 1;
+	}
+	else if(extension != NULL && strcmp(extension, ".c") == 0) {
+		language = 2;
+	}
 	switch(language) {
 		case 0: {
-			printf("Language could not be detected.");
+			printf("Language could not be detected.\n");
+			return 1;
 		} break;
 		case 1: {
-			// ChaosLang compile route
-			file = ChaosLangCompiler(file, argv[0]);
-			if(bflags[0]) {
-				if(flags[0] == 0) {
-					Translator__x86_64();
-					if(bflags[1]) {
-						Assembler__x86_64();
-					}
-				}
-				else {
-					printf("[ERROR] Invalid assembler specified.\n");
-				}
-			}
+			// ChaosLang compile route: the token compiler owns the COMPILER that
+			// Translator__x86_64 and the native writer work on, it gets the same arguments
+			argv[0] = BUILD_COMPILER;
+			execv(BUILD_COMPILER, argv);
+			printf("[ERROR] Could not run the compiler \"%s\".\n", BUILD_COMPILER);
+			return 1;
 		} break;
 		case 2: {
-			// C compile route
-			file = CCompiler(file, argv[0]);
-			if(bflags[0]) {
-				if(flags[0] == 0) {
-					Translator__x86_64();
-					if(bflags[1]) {
-						Assembler__x86_64();
-					}
-				}
-				else {
-					printf("[ERROR] Invalid assembler specified.\n");
-				}
-			}
+			// C compile route (no C front end yet, see Compilers/CCompiler.h)
+			printf("[ERROR] There is no translator for C yet.\n");
+			return 1;
 		} break;
 	}
 	return 0;
-}
\ No newline at end of file
+}
@@ -2,6 +2,72 @@
 
 #include <stdio.h>
 #include <stdbool.h>
+#include <stdint.h>
+
+#include "./Linker/ELF64/linker.h"
+#include "./Script/VM/vm.h"
+
+// Code object types
+enum CODE_OBJECT_TYPE {
+	CODE_OBJECT_TYPE_BOOL,              // 1 Bit
+	CODE_OBJECT_TYPE_CHAR,              // 1 Byte number or character
+	CODE_OBJECT_TYPE_UCHAR,             // Unsigned 1 byte numbers only
+	CODE_OBJECT_TYPE_SHORT,             // 2 byte number
+	CODE_OBJECT_TYPE_USHORT,            // Unsigned 2 byte number
+	CODE_OBJECT_TYPE_INT,               // 4 byte number
+	CODE_OBJECT_TYPE_UINT,              // Unsigned 4 byte number
+	CODE_OBJECT_TYPE_LONG,              // 6 byte number
+	CODE_OBJECT_TYPE_ULONG,             // Unsigned 6 byte number
+	CODE_OBJECT_TYPE_LONGLONG,          // 8 byte number
+	CODE_OBJECT_TYPE_ULONGLONG,         // Unsigned 8 byte number
+	CODE_OBJECT_TYPE_FLOAT,             // 4 byte floating point number
+	CODE_OBJECT_TYPE_UFLOAT,            // Unsigned 4 byte floating point number
+	CODE_OBJECT_TYPE_DOUBLE,            // 8 byte floating point number
+	CODE_OBJECT_TYPE_UDOUBLE,           // Unsigned 8 byte floating point number
+	CODE_OBJECT_TYPE_LONGDOUBLE,        // 16 byte floating point number
+	CODE_OBJECT_TYPE_ULONGDOUBLE,       // Unsigned 16 byte floating point number
+	CODE_OBJECT_TYPE_POINTER,           // Pointer 4/8 byte depending on cpu bit mode
+	CODE_OBJECT_TYPE_POINTER_INT,       // Pointer to integer
+	CODE_OBJECT_TYPE_ARRAY,             // Array (Pointer) size = element size * number of elements
+	CODE_OBJECT_TYPE_STRUCT,            // Structure (Pointer)
+	CODE_OBJECT_TYPE_UNION,             // Union (Pointer) size = max member size
+	CODE_OBJECT_TYPE_ENUM,              // Enum (4 byte number) named integer constants
+	CODE_OBJECT_TYPE_NOT,               // Not/invertation operator
+	CODE_OBJECT_TYPE_EQUALS,            // Equals operator '=='
+	CODE_OBJECT_TYPE_NOT_EQUALS,        // Not equals operator '!='
+	CODE_OBJECT_TYPE_LESS_THAN,         // Less than operator '<'
+	CODE_OBJECT_TYPE_GREATER_THAN,      // Greater than operator '>'
+	CODE_OBJECT_TYPE_LESS_EQUAL,        // Less than or equal operator '<='
+	CODE_OBJECT_TYPE_GREATER_EQUAL,     // Greater than or equal operator '>='
+	CODE_OBJECT_TYPE_SET,               // Assignment operator '='
+	CODE_OBJECT_TYPE_RETURN,            // Return statement
+	CODE_OBJECT_TYPE_IDENTIFIER_REF,    // Reference to a identifier
+	CODE_OBJECT_TYPE_FUNCTION_REF,      // Reference to a function
+	CODE_OBJECT_TYPE_NUMBER,            // Number
+	CODE_OBJECT_TYPE_IDENTIFIER,        // Identifier
+	CODE_OBJECT_TYPE_FUNCTION,          // Function declaration (needs ARG_LIST and CODE_BLOCK)
+	CODE_OBJECT_TYPE_CALCULATION,       // Calculation
+	CODE_OBJECT_TYPE_ARG_LIST,          // Argument list 
+	CODE_OBJECT_TYPE_CODE_BLOCK,        // Code block
+	CODE_OBJECT_TYPE_PRINT,             // Print statement (Runtime/IO/io.h)
+};
+
+// Task initializers (see Runtime/Tasks/tasks.h)
+enum PCC_TASK {
+	PCC_TASK_NONE,
+	PCC_TASK_SPAWN,                     // int handle = spawn function;
+	PCC_TASK_JOIN,                      // int result = join handle;
+	PCC_TASK_GO,                        // int handle = go function; (Runtime/Coroutines/coroutines.h)
+	PCC_TASK_AWAIT,                     // int result = await handle;
+};
+
+// Where the record of a spawned task or an array lives (see Optimizer/Escape/escape.h)
+enum PCC_STORAGE {
+	PCC_STORAGE_HEAP,                   // Runtime (free list, __chaos_new), the handle or array escapes
+	PCC_STORAGE_FRAME,                  // Frame of the declaring function
+	PCC_STORAGE_NONE,                   // Task: joined right away, the join calls the function
+	                                    // Array: replaced by its elements
+};
 
 // Code file stages
 typedef struct _File_ {
@@ -18,8 +84,9 @@ typedef struct _Token_ {
 } Token;
 
 typedef struct _ARG_LIST_ {
-	int type;
+	int type;                          // CODE_OBJECT_TYPE_INT or _ARRAY ("int a[]")
 	char* name;
+	bool escapes;                      // Array: the function lets it outlive the call (see Optimizer/Escape/escape.h)
 } ARG_LIST;
 
 typedef struct _IDENTIFIER_ {
@@ -30,8 +97,11 @@ typedef struct _IDENTIFIER_ {
 typedef struct _FUNCTION_ {
 	char* name;
 	unsigned long long id;
+	int arg_count;
 	ARG_LIST* args;
 	IDENTIFIER* local_identifiers;
+	int token_start;                   // First token of the declaration
+	int token_end;                     // Closing '}' of the body
 } FUNCTION;
 
 typedef struct _DEFINE_ {
@@ -55,6 +125,26 @@ typedef struct _PCC__INT_ {
 	char* asm_identifier;              // Name that will be used in assembly
 	long long value;                   // Standard value of the integer
 	unsigned long long target_address; // Target address offset for runtime memory space, 0 = not set (gets generated before translation)
+	bool exported;                     // Declared with "export" (visible outside of a shared object)
+	int init_start;                    // Tokens of a computed initializer, 0 = literal (see Optimizer/Constexpr/constexpr.h)
+	int init_end;
+	int count_start;                   // Tokens of the element count of a table, 0 = no table
+	int count_end;
+	long long count;                   // Table: number of elements
+	int32_t* table;                    // Table: elements computed at compile time (.rodata)
+	int task;                          // Initialized by spawn, join, go or await, see PCC_TASK enum
+	char* task_operand;                // Function (spawn, go) or handle (join, await)
+	int storage;                       // Spawn and its join: see PCC_STORAGE enum
+	char* call;                        // Initialized by a call at run time ("int r = f(a, 2);"), NULL = none
+	char** call_args;                  // Identifiers or numbers
+	int call_arg_count;
+	int operation;                     // Calculation at run time ("int r = a * 3;"): '+', '-', '*', '/' or '%', 0 = none
+	char* operands[2];                 // Identifiers, NULL = number (operand_values)
+	long long operand_values[2];
+	char* element;                     // Element of an array ("int r = a[i];"), NULL = none
+	char* index;                       // Identifier of the index, NULL = number (index_value)
+	long long index_value;
+	bool musttail;                     // Return: "musttail return f(...);", the call has to become a jump
 } PCC__INT;
 
 typedef struct _PCC__UINT_ {
@@ -108,6 +198,10 @@ typedef struct _PCC__POINTER_ {
 		unsigned long long* array_values;
 	} POINTER_VALUE;
 	unsigned long long target_address; // Target address offset for runtime memory space, 0 = not set (gets generated before translation)
+	long long count;                   // Array: number of elements
+	char** elements;                   // Array: identifiers of the initializers, NULL = number (array_values), the rest is 0
+	int element_count;
+	int storage;                       // Array: see PCC_STORAGE enum
 } PCC__POINTER;
 
 typedef struct _PCC__CODE_BLOCK_ {
@@ -118,6 +212,8 @@ typedef struct _PCC__CODE_BLOCK_ {
 	char* identifier;                  // Name of the function/code block
 	char* asm_identifier;              // Name that will be used in assembly
 	unsigned long long target_address; // Target address offset for runtime memory space, 0 = not set (gets generated before translation)
+	bool exported;                     // Declared with "export" (visible outside of a shared object)
+	bool clones;                       // Declared with "target_clones" (one body per -march level, see Translator/x86_64/translator.h)
 } PCC_CODE_BLOCK;
 
 typedef struct _CODE_OBJECT_ {
@@ -126,6 +222,7 @@ typedef struct _CODE_OBJECT_ {
 	//  - variable declaration
 	//  - function declaration
 	int type; // See CODE_OBJECT_TYPE enum
+	int token; // First token of the statement (source position of -g)
 	union CODE_OBJECT_DATA_ {
 		PCC__BOOL* _bool;
 		PCC__INT* _int;
@@ -138,11 +235,93 @@ typedef struct _CODE_OBJECT_ {
 	} CODE_OBJECT_DATA;
 } CODE_OBJECT;
 
+typedef struct _CACHE_SYMBOL_ {
+	char* name;                        // Function or global variable name
+	uint64_t hash;                     // Hash of its signature/declaration
+} CACHE_SYMBOL;
+
+typedef struct _FUNCTION_CACHE_ {
+	// Per-function translation cache (see Cache/cache.h)
+	bool enabled;
+	char* directory;                   // "./build/ChaosLangCompiler/cache/<hash of file name>"
+	CACHE_SYMBOL* symbols;             // Hash table of everything a function can depend on
+	int symbol_capacity;
+	uint64_t* keys;                    // Content hash of every function (index = function index)
+	uint64_t flags;                    // Hash of the options, part of every entry name
+	int hits;
+	int misses;
+} FUNCTION_CACHE;
+
+// Compile-time function (constexpr)
+typedef struct _CONSTEXPR_FUNCTION_ {
+	char* name;
+	char** args;
+	int arg_count;
+	int token_start;                // First token of the body
+	int token_end;                  // Closing '}'
+	int state;                      // 0 = not compiled, 1 = compiling, 2 = compiled, -1 = failed
+	SCRIPT_VM vm;
+} CONSTEXPR_FUNCTION;
+
+typedef struct _CONSTEXPR_STATE_ {
+	CONSTEXPR_FUNCTION* functions;
+	int function_count;
+	uint64_t steps;                 // Loop iterations per call (-fconstexpr-steps)
+	int max_depth;                  // Nested compiles of constexpr functions (-fconstexpr-depth)
+	uint64_t memory;                // Bytes of tables (-fconstexpr-memory)
+	int depth;
+	int current;                    // Pre-compiled code entry being evaluated
+} CONSTEXPR_STATE;
+
+// Per-phase measurements (see TimeReport/time_report.h)
+#define TIME_REPORT_MAX_PHASES 16
+
+typedef struct _TIME_PHASE_ {
+	const char* name;
+	double wall;                    // Seconds
+	double cpu;                     // Seconds of all threads
+	int64_t heap;                   // Change of the bytes malloc has in use
+	long peak_rss;                  // KiB at the end of the phase
+} TIME_PHASE;
+
+typedef struct _TIME_REPORT_ {
+	uint8_t mode;                   // See TIME_REPORT_MODE enum (-ftime-report[=json])
+	TIME_PHASE phases[TIME_REPORT_MAX_PHASES];
+	int phase_count;
+	double wall, cpu;               // Start of the current phase
+	int64_t heap;
+} TIME_REPORT;
+
+// Function profile (see Runtime/Profile/profile.h)
+typedef struct _INSTRUMENT_ {
+	char* path;                     // Profile written at exit (-finstrument[=<file>]), NULL = not instrumented
+	char** symbols;                 // Functions, then the external functions they call
+	int symbol_count;
+	uint32_t* edges;                // Caller function and callee symbol of every edge
+	int edge_count;
+	int* sites;                     // Edge of every pre-compiled code entry that calls a function (-1 = none)
+	bool atomic;                    // Counters are shared by task workers (lock prefix)
+} INSTRUMENT;
+
+// Profile-guided function layout (see Optimizer/PGO/pgo.h)
+typedef struct _PGO_LAYOUT_ {
+	char* path;                     // Profile of earlier runs (-fprofile-use=<file>), NULL = source order
+	int* rank;                      // Position of every function in .text
+	uint8_t* heat;                  // See PGO_HEAT enum, per function
+} PGO_LAYOUT;
+
+// CPU level of the output and function clones (see Translator/x86_64/translator.h)
+typedef struct _TARGET_ {
+	int level;                      // -march, see KERNELS_LEVEL_* in Runtime/Kernels/kernels.h
+	int* dispatched;                // Functions whose clones differ, _start picks one for the CPU
+	int dispatch_count;
+} TARGET;
+
 typedef struct _COMPILER_ {
 	// Flags
 	int flags[3];                   // 0 = Interpretation path, 1 = Functions complexity level (0 = no functions, 1 = functions used), 2 = Current section (0 = source, 1 = script)
 	bool bflags[4];                 // 0 = In-/Outside function (true = In-, false = Outside), 1 = Optimize and translate, 2 = First error flag, 3 = End not set
-	bool bflagsArgs[3];             // 0 = Assemble Flag, 1 = List tokens (DEBBUG), 2 = Long return method (false = jump to end, true = delete stack frame and use 'ret')
+	bool bflagsArgs[3];             // 0 = Assemble Flag, 1 = List tokens (DEBBUG), 2 = Long return method (false = jump to end, true = delete stack frame and use 'ret', the default)
 
 	// Meta data
 	int column, line;               // Position
@@ -175,7 +354,7 @@ typedef struct _COMPILER_ {
 	int MAX_ASM_ID;                 // Max assembly identifiers: default 700
 
 	// Compilation data
-	FILE* temp_script_file;         // Temporary script file for script section
+	int* script_tokens;             // Token indices of all script sections (see Script/Bytecode/bytecode.h)
 	FILE* temp_assembly;            // Temporary assembly file for assembler output
 	Token* tokens;
 	FUNCTION* functions;
@@ -185,4 +364,67 @@ typedef struct _COMPILER_ {
 	char* code_buffer;
 	CODE_OBJECT* pre_compiled_code; // Pre-compiled code (Next translation and optimization)
 	char** asm_identifier_list;     // All identifiers used in assembly
-} COMPILER;
\ No newline at end of file
+
+	// Native output
+	int threads;                    // Code generation threads (Default: 1)
+	uint8_t format;                 // Output format, see OUTPUT_FORMAT enum (Default: elf_linux)
+	bool pic;                       // Position independent code (-fPIC, always set for shared objects)
+	bool debug;                     // Line table and unwind tables in executables (-g)
+	char* output_file;              // Default: "./build/ChaosLangCompiler/a.out"
+	OUTPUT_IMAGE image;             // Translated code and data
+	FUNCTION_CACHE cache;           // Translated functions of earlier compiles
+
+	// Link-time optimization (see Optimizer/LTO/lto.h)
+	uint8_t* lto_source;            // Source written into objects (-flto), NULL = none
+	uint64_t lto_source_size;
+	bool whole_program;             // The file is the whole program (--whole-program)
+	bool* live;                     // Whole program: reachable pre-compiled code entries (NULL = all)
+
+	// Script sections
+	int script_token_count;
+	uint8_t* script;                // Bytecode for Script/VM/vm.h, NULL = no script sections
+	uint64_t script_size;
+	bool run_script;                // Run it after compiling (--run-script)
+
+	// Compile-time evaluation (see Optimizer/Constexpr/constexpr.h)
+	CONSTEXPR_STATE evaluator;
+
+	// Task runtime (see Runtime/Tasks/tasks.h)
+	bool tasks;                     // Calls into the runtime (spawn, join, go, await, print, -finstrument, -march or target_clones)
+	char* runtime;                  // Object linked into executables that use it (--runtime <file>)
+
+	// Phase report
+	TIME_REPORT time_report;
+	bool verbose;                   // [INFO] statistics of the passes (-v)
+
+	// Profile instrumentation
+	INSTRUMENT instrument;
+	PGO_LAYOUT pgo;
+
+	// Instruction set
+	TARGET target;
+} COMPILER;
+
+typedef struct _COMPILER_OPTIONS_ {
+	// Command line options that are not limits
+	bool assemble;                  // Write the output file
+	int threads;                    // -j <threads>
+	uint8_t format;                 // -f <format>
+	char* output_file;              // -o <file>
+	bool cache;                     // Reuse translated functions (--no-cache disables)
+	bool pic;                       // -fPIC
+	bool lto;                       // -flto
+	bool whole_program;             // --whole-program
+	bool run_script;                // --run-script
+	uint64_t constexpr_steps;       // -fconstexpr-steps=<loop iterations per call>
+	int constexpr_depth;            // -fconstexpr-depth=<nested calls>
+	uint64_t constexpr_memory;      // -fconstexpr-memory=<bytes of tables>
+	char* runtime;                  // --runtime <file>
+	uint8_t time_report;            // -ftime-report[=json]
+	bool list_tokens;               // --list-tokens
+	char* instrument;               // -finstrument[=<file>], NULL = off
+	char* profile_use;              // -fprofile-use=<file>, NULL = off
+	bool debug;                     // -g
+	int march;                      // -march=<x86-64|x86-64-v2|x86-64-v3|x86-64-v4>
+	bool verbose;                   // -v
+} COMPILER_OPTIONS;
\ No newline at end of file
@@ -51,6 +51,14 @@ main:                                     ; int main()
     pop rbp
     ret
 
+add:                                      ; int add(int a, int b) { return b; }
+                                          ; System V: arguments in rdi, rsi, rdx, rcx, r8, r9, then on the stack
+                                          ; No calls and locals fit into the red zone: no frame
+    mov [rsp-4], edi                      ; a
+    mov [rsp-8], esi                      ; b
+    mov eax, [rsp-8]                      ; return b;
+    ret
+
 section .bss
 bss_start:
 __GLOBALVAR_var: db 0
@@ -4,48 +4,22 @@
 #include <string.h>
 #include <ctype.h>
 
-enum CODE_OBJECT_TYPE {
-	CODE_OBJECT_TYPE_BOOL,              // 1 Bit
-	CODE_OBJECT_TYPE_CHAR,              // 1 Byte number or character
-	CODE_OBJECT_TYPE_UCHAR,             // Unsigned 1 byte numbers only
-	CODE_OBJECT_TYPE_SHORT,             // 2 byte number
-	CODE_OBJECT_TYPE_USHORT,            // Unsigned 2 byte number
-	CODE_OBJECT_TYPE_INT,               // 4 byte number
-	CODE_OBJECT_TYPE_UINT,              // Unsigned 4 byte number
-	CODE_OBJECT_TYPE_LONG,              // 6 byte number
-	CODE_OBJECT_TYPE_ULONG,             // Unsigned 6 byte number
-	CODE_OBJECT_TYPE_LONGLONG,          // 8 byte number
-	CODE_OBJECT_TYPE_ULONGLONG,         // Unsigned 8 byte number
-	CODE_OBJECT_TYPE_FLOAT,             // 4 byte floating point number
-	CODE_OBJECT_TYPE_UFLOAT,            // Unsigned 4 byte floating point number
-	CODE_OBJECT_TYPE_DOUBLE,            // 8 byte floating point number
-	CODE_OBJECT_TYPE_UDOUBLE,           // Unsigned 8 byte floating point number
-	CODE_OBJECT_TYPE_LONGDOUBLE,        // 16 byte floating point number
-	CODE_OBJECT_TYPE_ULONGDOUBLE,       // Unsigned 16 byte floating point number
-	CODE_OBJECT_TYPE_POINTER,           // Pointer 4/8 byte depending on cpu bit mode
-	CODE_OBJECT_TYPE_POINTER_INT,       // Pointer to integer
-	CODE_OBJECT_TYPE_ARRAY,             // Array (Pointer) size = element size * number of elements
-	CODE_OBJECT_TYPE_STRUCT,            // Structure (Pointer)
-	CODE_OBJECT_TYPE_UNION,             // Union (Pointer) size = max member size
-	CODE_OBJECT_TYPE_ENUM,              // Enum (4 byte number) named integer constants
-	CODE_OBJECT_TYPE_NOT,               // Not/invertation operator
-	CODE_OBJECT_TYPE_EQUALS,            // Equals operator '=='
-	CODE_OBJECT_TYPE_NOT_EQUALS,        // Not equals operator '!='
-	CODE_OBJECT_TYPE_LESS_THAN,         // Less than operator '<'
-	CODE_OBJECT_TYPE_GREATER_THAN,      // Greater than operator '>'
-	CODE_OBJECT_TYPE_LESS_EQUAL,        // Less than or equal operator '<='
-	CODE_OBJECT_TYPE_GREATER_EQUAL,     // Greater than or equal operator '>='
-	CODE_OBJECT_TYPE_SET,               // Assignment operator '='
-	CODE_OBJECT_TYPE_RETURN,            // Return statement
-	CODE_OBJECT_TYPE_IDENTIFIER_REF,    // Reference to a identifier
-	CODE_OBJECT_TYPE_FUNCTION_REF,      // Reference to a function
-	CODE_OBJECT_TYPE_NUMBER,            // Number
-	CODE_OBJECT_TYPE_IDENTIFIER,        // Identifier
-	CODE_OBJECT_TYPE_FUNCTION,          // Function declaration (needs ARG_LIST and CODE_BLOCK)
-	CODE_OBJECT_TYPE_CALCULATION,       // Calculation
-	CODE_OBJECT_TYPE_ARG_LIST,          // Argument list 
-	CODE_OBJECT_TYPE_CODE_BLOCK,        // Code block
-};
+#include "./structures.h"
+#include "./PreProcessors/ChaosLang/preprocessor.h"
+#include "./Translator/x86_64/translator.h"
+#include "./Cache/cache.h"
+#include "./Server/server.h"
+#include "./Linker/Archive/archive.h"
+#include "./Optimizer/LTO/lto.h"
+#include "./Optimizer/Constexpr/constexpr.h"
+#include "./Optimizer/Escape/escape.h"
+#include "./Optimizer/PGO/pgo.h"
+#include "./Script/Bytecode/bytecode.h"
+#include "./Script/VM/vm.h"
+#include "./Runtime/Tasks/tasks.h"
+#include "./Runtime/Kernels/kernels.h"
+#include "./TimeReport/time_report.h"
+#include "./ProfileReport/profile_report.h"
 
 #define C compiler
 
@@ -101,10 +75,298 @@ int convert_str_to_ullong(char* str) {
 	return result;
 }
 
+int ParseType(COMPILER* compiler, int i, int* type) {
+	// Integer type name at token i ("char", "unsigned short", "long long int",
+	// "unsigned", ...), returns its number of tokens (0 = none)
+	int j = i;
+	bool is_unsigned = false, sign = false;
+	if(j < C->current_token_index && (strcmp(C->tokens[j].str, "unsigned") == 0 || strcmp(C->tokens[j].str, "signed") == 0)) {
+		is_unsigned = C->tokens[j].str[0] == 'u';
+		sign = true;
+		j++;
+	}
+	int base = CODE_OBJECT_TYPE_INT;
+	bool named = j < C->current_token_index;
+	if(named && strcmp(C->tokens[j].str, "char") == 0) {
+		base = CODE_OBJECT_TYPE_CHAR;
+		j++;
+	}
+	else if(named && (strcmp(C->tokens[j].str, "short") == 0 || strcmp(C->tokens[j].str, "long") == 0)) {
+		base = C->tokens[j].str[0] == 's' ? CODE_OBJECT_TYPE_SHORT : CODE_OBJECT_TYPE_LONG;
+		j++;
+		if(base == CODE_OBJECT_TYPE_LONG && j < C->current_token_index && strcmp(C->tokens[j].str, "long") == 0) {
+			base = CODE_OBJECT_TYPE_LONGLONG;
+			j++;
+		}
+		if(j < C->current_token_index && strcmp(C->tokens[j].str, "int") == 0) {
+			j++;
+		}
+	}
+	else if(named && strcmp(C->tokens[j].str, "int") == 0) {
+		j++;
+	}
+	else if(!sign) {
+		return 0;
+	}
+	// The unsigned type follows the signed one (CODE_OBJECT_TYPE order)
+	*type = is_unsigned ? base + 1 : base;
+	return j - i;
+}
+
+int ParseCall(COMPILER* compiler, int i, int end, PCC__INT* integer) {
+	// "f(a, 2)" with identifiers or numbers as arguments: a call at run time
+	// unless f is a constexpr function (decided by Constexpr__evaluate)
+	if(end < i + 3 || !(isalpha(C->tokens[i].str[0]) || C->tokens[i].str[0] == '_') ||
+	   strcmp(C->tokens[i + 1].str, "(") != 0 || strcmp(C->tokens[end - 1].str, ")") != 0 || ((end - i - 3) % 2 == 0 && end != i + 3)) {
+		return 0;
+	}
+	int count = 0;
+	for(int j = i + 2;j < end - 1;j = j + 2) {
+		if(!isalnum(C->tokens[j].str[0]) && C->tokens[j].str[0] != '_') {
+			return 0;
+		}
+		if(j + 1 < end - 1 && strcmp(C->tokens[j + 1].str, ",") != 0) {
+			return 0;
+		}
+		count++;
+	}
+	integer->call_args = malloc((count > 0 ? count : 1) * sizeof(char*));
+	if(integer->call_args == NULL) {
+		return -1;
+	}
+	for(int j = 0;j < count;j++) {
+		integer->call_args[j] = C->tokens[i + 2 + j * 2].str;
+	}
+	integer->call = C->tokens[i].str;
+	integer->call_arg_count = count;
+	return 0;
+}
+
+bool ParseLocal(COMPILER* compiler, const char* name) {
+	// Argument or earlier local of the function being parsed
+	if(!C->bflags[0]) {
+		return false;
+	}
+	FUNCTION* function = &C->functions[C->current_function];
+	for(int j = 0;j < function->arg_count;j++) {
+		if(strcmp(function->args[j].name, name) == 0) {
+			return true;
+		}
+	}
+	for(int j = C->pre_compiled_code[function->id].CODE_OBJECT_DATA._code_block->start_index;j < C->pcc_entries;j++) {
+		if(C->pre_compiled_code[j].type == CODE_OBJECT_TYPE_INT && C->pre_compiled_code[j].CODE_OBJECT_DATA._int->identifier != NULL &&
+		   strcmp(C->pre_compiled_code[j].CODE_OBJECT_DATA._int->identifier, name) == 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+bool ParseArrayLocal(COMPILER* compiler, const char* name) {
+	// Array argument or earlier local array of the function being parsed
+	if(!C->bflags[0]) {
+		return false;
+	}
+	FUNCTION* function = &C->functions[C->current_function];
+	bool array = false;
+	for(int j = 0;j < function->arg_count;j++) {
+		if(strcmp(function->args[j].name, name) == 0) {
+			array = function->args[j].type == CODE_OBJECT_TYPE_ARRAY;
+		}
+	}
+	for(int j = C->pre_compiled_code[function->id].CODE_OBJECT_DATA._code_block->start_index;j < C->pcc_entries;j++) {
+		// The last declaration counts
+		CODE_OBJECT* object = &C->pre_compiled_code[j];
+		if(object->type == CODE_OBJECT_TYPE_INT && object->CODE_OBJECT_DATA._int->identifier != NULL && strcmp(object->CODE_OBJECT_DATA._int->identifier, name) == 0) {
+			array = false;
+		}
+		else if(object->type == CODE_OBJECT_TYPE_ARRAY && strcmp(object->CODE_OBJECT_DATA._pointer->identifier, name) == 0) {
+			array = true;
+		}
+	}
+	return array;
+}
+
+bool ParseUnsigned64(COMPILER* compiler, const char* name) {
+	// Earlier global of type unsigned long (long): constant expressions are
+	// calculated in long long, so divisions of it have to run at run time
+	for(int j = 0;name != NULL && j < C->pcc_entries;j++) {
+		PCC__INT* global = C->pre_compiled_code[j].type == CODE_OBJECT_TYPE_INT ? C->pre_compiled_code[j].CODE_OBJECT_DATA._int : NULL;
+		if(global != NULL && global->global && global->identifier != NULL && strcmp(global->identifier, name) == 0) {
+			return global->type == CODE_OBJECT_TYPE_ULONG || global->type == CODE_OBJECT_TYPE_ULONGLONG;
+		}
+	}
+	return false;
+}
+
+int ParseOperand(COMPILER* compiler, int i, int end, char** identifier, long long* value) {
+	// Identifier, number or negative number, returns the index after it (0 = none)
+	bool negative = i + 1 < end && strcmp(C->tokens[i].str, "-") == 0;
+	int j = i + negative;
+	if(j >= end) {
+		return 0;
+	}
+	if(!negative && (isalpha(C->tokens[j].str[0]) || C->tokens[j].str[0] == '_')) {
+		*identifier = C->tokens[j].str;
+		return j + 1;
+	}
+	if(!isdigit(C->tokens[j].str[0])) {
+		return 0;
+	}
+	*identifier = NULL;
+	*value = (long long)strtoull(C->tokens[j].str, NULL, 10);
+	*value = negative ? -*value : *value;
+	return j + 1;
+}
+
+int ParseArray(COMPILER* compiler, int i, PCC__POINTER* array) {
+	// "[N];" or "[N] = { a, 2, -3 };" after the name of a local array,
+	// returns the index of ';' (missing initializers are 0)
+	if(i + 3 >= C->current_token_index || !isdigit(C->tokens[i + 1].str[0]) || strcmp(C->tokens[i + 2].str, "]") != 0) {
+		printf("[ERROR] Array \"%s\" needs a number of elements, at %d:%d.\n", array->identifier, C->tokens[i].line, C->tokens[i].column);
+		return -1;
+	}
+	array->count = strtoll(C->tokens[i + 1].str, NULL, 10);
+	if(array->count < 1 || array->count > TRANSLATOR_ARRAY_MAX) {
+		printf("[ERROR] Array \"%s\" needs 1 to %d elements, at %d:%d.\n", array->identifier, TRANSLATOR_ARRAY_MAX, C->tokens[i + 1].line, C->tokens[i + 1].column);
+		return -1;
+	}
+	i = i + 3;
+	if(strcmp(C->tokens[i].str, ";") == 0) {
+		return i;
+	}
+	if(strcmp(C->tokens[i].str, "=") != 0 || i + 1 >= C->current_token_index || strcmp(C->tokens[i + 1].str, "{") != 0) {
+		printf("[ERROR] Expected \"= {\" or ';' after array \"%s\", at %d:%d.\n", array->identifier, C->tokens[i].line, C->tokens[i].column);
+		return -1;
+	}
+	int end = i + 2;
+	while(end < C->current_token_index && strcmp(C->tokens[end].str, "}") != 0) {
+		end++;
+	}
+	if(end + 1 >= C->current_token_index || strcmp(C->tokens[end + 1].str, ";") != 0) {
+		printf("[ERROR] Definition incomplete. End of file.\n");
+		return -1;
+	}
+	array->elements = malloc((end - i) * sizeof(char*));
+	array->POINTER_VALUE.array_values = malloc((end - i) * sizeof(unsigned long long));
+	if(array->elements == NULL || array->POINTER_VALUE.array_values == NULL) {
+		return -1;
+	}
+	for(int j = i + 2;j < end;j++) {
+		long long value = 0;
+		int next = ParseOperand(C, j, end, &array->elements[array->element_count], &value);
+		if(next == 0 || (next < end && strcmp(C->tokens[next].str, ",") != 0) || array->element_count >= array->count) {
+			printf("[ERROR] Elements of array \"%s\" are at most %lld identifiers or numbers, at %d:%d.\n", array->identifier, array->count,
+				C->tokens[j].line, C->tokens[j].column);
+			return -1;
+		}
+		array->POINTER_VALUE.array_values[array->element_count++] = (unsigned long long)Translator__value(CODE_OBJECT_TYPE_INT, value);
+		j = next;
+	}
+	return end + 1;
+}
+
+int ParseCalculation(COMPILER* compiler, int i, int end, PCC__INT* integer) {
+	// "a * 3" with a local or argument as an operand: a calculation at run time
+	// (see Translator/x86_64/arithmetic.c), anything else is a constant expression
+	char* operands[2] = { NULL, NULL };
+	long long values[2] = { 0, 0 };
+	int j = ParseOperand(C, i, end, &operands[0], &values[0]);
+	if(j == 0 || j + 1 >= end || strlen(C->tokens[j].str) != 1 || strchr("+-*/%", C->tokens[j].str[0]) == NULL) {
+		return 0;
+	}
+	int operation = C->tokens[j].str[0];
+	if(ParseOperand(C, j + 1, end, &operands[1], &values[1]) != end) {
+		return 0;
+	}
+	if(!(operands[0] != NULL && ParseLocal(C, operands[0])) && !(operands[1] != NULL && ParseLocal(C, operands[1])) &&
+	   !((operation == '/' || operation == '%') && (ParseUnsigned64(C, operands[0]) || ParseUnsigned64(C, operands[1])))) {
+		return 0;
+	}
+	if(operands[0] == NULL && (operation == '+' || operation == '*')) {
+		// Constant on the right
+		operands[0] = operands[1];
+		operands[1] = NULL;
+		values[1] = values[0];
+	}
+	integer->operation = operation;
+	for(int k = 0;k < 2;k++) {
+		integer->operands[k] = operands[k];
+		integer->operand_values[k] = values[k];
+	}
+	// Not a constant expression
+	integer->init_start = 0;
+	integer->init_end = 0;
+	return 0;
+}
+
+int ParseInitializer(COMPILER* compiler, int i, PCC__INT* integer) {
+	// Literal or constant expression up to ';', returns the index of ';'
+	int end = i;
+	while(end < C->current_token_index && strcmp(C->tokens[end].str, ";") != 0) {
+		end++;
+	}
+	if(end >= C->current_token_index) {
+		C->bflags[1] = false;
+		printf("[ERROR] Definition incomplete. End of file.\n");
+		return -1;
+	}
+	if(end == i) {
+		C->bflags[1] = false;
+		printf("[ERROR] Expected a value, at %d:%d.\n", C->tokens[i].line, C->tokens[i].column);
+		return -1;
+	}
+	static const char* const tasks[] = { NULL, "spawn", "join", "go", "await" }; // PCC_TASK order
+	int task = PCC_TASK_NONE;
+	for(int j = PCC_TASK_SPAWN;end == i + 2 && j <= PCC_TASK_AWAIT;j++) {
+		if(strcmp(C->tokens[i].str, tasks[j]) == 0) {
+			task = j;
+		}
+	}
+	if(task != PCC_TASK_NONE) {
+		// Task or coroutine handle or result, lowered to runtime calls by the translator
+		if(integer->global || integer->type != CODE_OBJECT_TYPE_INT) {
+			C->bflags[1] = false;
+			printf("[ERROR] \"%s\" can only initialize local int variables, at %d:%d.\n", C->tokens[i].str, C->tokens[i].line, C->tokens[i].column);
+			return -1;
+		}
+		integer->task = task;
+		integer->task_operand = C->tokens[i + 1].str;
+		C->tasks = true;
+	}
+	else if(end == i + 1 && isdigit(C->tokens[i].str[0])) {
+		integer->value = Translator__value(integer->type, (long long)strtoull(C->tokens[i].str, NULL, 10));
+	}
+	else if(end == i + 4 && strcmp(C->tokens[i + 1].str, "[") == 0 && strcmp(C->tokens[i + 3].str, "]") == 0 && ParseArrayLocal(C, C->tokens[i].str)) {
+		// Element of a local array or an array argument, read at run time
+		integer->element = C->tokens[i].str;
+		if(ParseOperand(C, i + 2, i + 3, &integer->index, &integer->index_value) != i + 3) {
+			C->bflags[1] = false;
+			printf("[ERROR] The index of \"%s\" is an identifier or a number, at %d:%d.\n", integer->element, C->tokens[i + 2].line, C->tokens[i + 2].column);
+			return -1;
+		}
+	}
+	else {
+		// Evaluated by Constexpr__evaluate before translation
+		integer->init_start = i;
+		integer->init_end = end;
+		if(!integer->global && (ParseCall(C, i, end, integer) != 0 || ParseCalculation(C, i, end, integer) != 0)) {
+			return -1;
+		}
+	}
+	return end;
+}
+
 int ParseCode(COMPILER* compiler) {
 	// Split into sections ("__SEC_SCRIPT", "__SEC_SOURCE")
 	C->flags[2] = 0; // Current section: 0 = source, 1 = script
+	bool exported = false; // "export" in front of the next declaration
+	bool musttail = false; // "musttail" in front of the next return
+	bool clones = false; // "target_clones" in front of the next function
+	int type, length; // Integer type of a declaration and its number of tokens (ParseType)
 	for(int i = 0;i < C->current_token_index;i++) {
+		// Every entry is completed by the statement it starts with
+		C->pre_compiled_code[C->pcc_entries].token = i;
 		if(!(i < C->current_token_index)) {
 			return 0;
 		}
@@ -118,23 +380,22 @@ int ParseCode(COMPILER* compiler) {
 			continue;
 		}
 		else if(C->flags[2]) {
-			// Create/Reopen temporary script file
-			C->temp_script_file = fopen("./temp_script.script", "a+");
-			if(C->temp_script_file == NULL) {
-				printf("[ERROR] Could not create temporary script file.\n");
-				return -1;
+			// Script token, all sections are compiled together by Translate
+			if(C->script_tokens == NULL) {
+				C->script_tokens = malloc(C->current_token_index * sizeof(int));
+				if(C->script_tokens == NULL) {
+					printf("[ERROR] Could not allocate script tokens.\n");
+					return -1;
+				}
 			}
-			// Write token to script file
-			fprintf(C->temp_script_file, "%s ", C->tokens[i].str);
-
-			fclose(C->temp_script_file);
+			C->script_tokens[C->script_token_count++] = i;
 		}
 		// Inside or outside function
 		else if(C->bflags[0]) {
 			// Currently parsing inside a function
-			if(strcmp(C->tokens[i].str, "int") == 0) {
+			if((length = ParseType(C, i, &type)) > 0) {
 				// Local integer variable declaration
-				i++;
+				i = i + length;
 				if(!(i < C->current_token_index)) {
 					// Error
 					C->bflags[1] = false;
@@ -143,7 +404,11 @@ int ParseCode(COMPILER* compiler) {
 					return -1;
 				}
 
-				PCC__INT _int = {0};
+				C->pre_compiled_code[C->pcc_entries].CODE_OBJECT_DATA._int = calloc(1, sizeof(PCC__INT));
+				if(C->pre_compiled_code[C->pcc_entries].CODE_OBJECT_DATA._int == NULL) {
+					return -1;
+				}
+				C->pre_compiled_code[C->pcc_entries].CODE_OBJECT_DATA._int->type = type;
 				
 				if(isalpha(C->tokens[i].str[0]) || C->tokens[i].str[0] == '_') {
 					// Save the name of the variable/function in temp_code_object
@@ -158,6 +423,32 @@ int ParseCode(COMPILER* compiler) {
 					printf("[ERROR] Definition incomplete. End of file.\n");
 					return -1;
 				}
+				if(strcmp(C->tokens[i].str, "[") == 0) {
+					// Local array, where it lives is decided by Escape__analyze
+					char* identifier = C->pre_compiled_code[C->pcc_entries].CODE_OBJECT_DATA._int->identifier;
+					free(C->pre_compiled_code[C->pcc_entries].CODE_OBJECT_DATA._int);
+					if(type != CODE_OBJECT_TYPE_INT || identifier == NULL) {
+						C->bflags[1] = false;
+						printf("[ERROR] Arrays are int and need a name, at %d:%d.\n", C->tokens[i].line, C->tokens[i].column);
+						return -1;
+					}
+					PCC__POINTER* array = calloc(1, sizeof(PCC__POINTER));
+					if(array == NULL) {
+						return -1;
+					}
+					array->array = true;
+					array->type = CODE_OBJECT_TYPE_INT;
+					array->identifier = identifier;
+					C->pre_compiled_code[C->pcc_entries].type = CODE_OBJECT_TYPE_ARRAY;
+					C->pre_compiled_code[C->pcc_entries].CODE_OBJECT_DATA._pointer = array;
+					i = ParseArray(C, i, array);
+					if(i < 0) {
+						C->bflags[1] = false;
+						return -1;
+					}
+					C->pcc_entries++;
+					continue;
+				}
 				if(strcmp(C->tokens[i].str, "=") == 0) {
 					i++;
 					if(!(i < C->current_token_index)) {
@@ -198,47 +489,152 @@ int ParseCode(COMPILER* compiler) {
 						}
 					}
 					else {
-						// Set
-						// Get length of number string
-						i++;
-						if(!(i < C->current_token_index)) {
-							// Error
-							C->bflags[1] = false;
-							// Print error
-							printf("[ERROR] Definition incomplete. End of file.\n");
-							return -1;
-						}
-						int length = 0;
-						for(int j = 0;C->tokens[i].str[j] != '\0';j++) {
-							length++;
-						}
-
-						// Convert to integer number
-						C->pre_compiled_code[C->pcc_entries].CODE_OBJECT_DATA._int->value = convert_str_to_int(C->tokens[i].str);
-
-						// Check for command end
-						i++;
-						if(!(i < C->current_token_index)) {
-							// Error
-							C->bflags[1] = false;
-							// Print error
-							printf("[ERROR] Definition incomplete. End of file.\n");
+						// Set (literal or constant expression)
+						i = ParseInitializer(C, i, C->pre_compiled_code[C->pcc_entries].CODE_OBJECT_DATA._int);
+						if(i < 0) {
 							return -1;
 						}
-
-						if(strcmp(C->tokens[i].str, ";") == 0) {
-							C->pcc_entries++;
-							continue;
-						}
+						C->pcc_entries++;
+						continue;
 					}
 				}
+				else if(strcmp(C->tokens[i].str, ";") == 0) {
+					// Declaration without value
+					C->pre_compiled_code[C->pcc_entries].type = CODE_OBJECT_TYPE_INT;
+					C->pcc_entries++;
+				}
+			}
+			else if(strcmp(C->tokens[i].str, "return") == 0) {
+				// Return statement
+				i++;
+				if(!(i < C->current_token_index)) {
+					// Error
+					C->bflags[1] = false;
+					// Print error
+					printf("[ERROR] Definition incomplete. End of file.\n");
+					return -1;
+				}
+				C->pre_compiled_code[C->pcc_entries].CODE_OBJECT_DATA._int = calloc(1, sizeof(PCC__INT));
+				if(C->pre_compiled_code[C->pcc_entries].CODE_OBJECT_DATA._int == NULL) {
+					return -1;
+				}
+				C->pre_compiled_code[C->pcc_entries].type = CODE_OBJECT_TYPE_RETURN;
+				C->pre_compiled_code[C->pcc_entries].CODE_OBJECT_DATA._int->type = CODE_OBJECT_TYPE_INT; // Functions return int
+				C->pre_compiled_code[C->pcc_entries].CODE_OBJECT_DATA._int->musttail = musttail;
+				musttail = false;
+				if(i + 1 < C->current_token_index && strcmp(C->tokens[i + 1].str, ";") != 0) {
+					// Call or constant expression
+					PCC__INT* value = C->pre_compiled_code[C->pcc_entries].CODE_OBJECT_DATA._int;
+					int start = i;
+					i = ParseInitializer(C, i, value);
+					if(i < 0) {
+						return -1;
+					}
+					if(value->task != PCC_TASK_NONE) {
+						C->bflags[1] = false;
+						printf("[ERROR] \"%s\" can only initialize local variables, at %d:%d.\n", C->tokens[start].str, C->tokens[start].line, C->tokens[start].column);
+						return -1;
+					}
+					C->pcc_entries++;
+					continue;
+				}
+				if(isalpha(C->tokens[i].str[0]) || C->tokens[i].str[0] == '_') {
+					// Return the value of a variable
+					C->pre_compiled_code[C->pcc_entries].CODE_OBJECT_DATA._int->identifier = C->tokens[i].str;
+				}
+				else {
+					C->pre_compiled_code[C->pcc_entries].CODE_OBJECT_DATA._int->value = convert_str_to_int(C->tokens[i].str);
+				}
+
+				// Check for command end
+				i++;
+				if(!(i < C->current_token_index)) {
+					// Error
+					C->bflags[1] = false;
+					// Print error
+					printf("[ERROR] Definition incomplete. End of file.\n");
+					return -1;
+				}
+				if(strcmp(C->tokens[i].str, ";") == 0) {
+					C->pcc_entries++;
+					continue;
+				}
+			}
+			else if(strcmp(C->tokens[i].str, "musttail") == 0) {
+				// The call of the next return has to become a jump
+				if(!(i + 1 < C->current_token_index) || strcmp(C->tokens[i + 1].str, "return") != 0) {
+					C->bflags[1] = false;
+					printf("[ERROR] Expected \"return\" after musttail, at %d:%d.\n", C->tokens[i].line, C->tokens[i].column);
+					return -1;
+				}
+				musttail = true;
+			}
+			else if(strcmp(C->tokens[i].str, "print") == 0) {
+				// Print statement (see Runtime/IO/io.h)
+				i++;
+				if(!(i + 1 < C->current_token_index)) {
+					// Error
+					C->bflags[1] = false;
+					// Print error
+					printf("[ERROR] Definition incomplete. End of file.\n");
+					return -1;
+				}
+				C->pre_compiled_code[C->pcc_entries].CODE_OBJECT_DATA._int = calloc(1, sizeof(PCC__INT));
+				if(C->pre_compiled_code[C->pcc_entries].CODE_OBJECT_DATA._int == NULL) {
+					return -1;
+				}
+				C->pre_compiled_code[C->pcc_entries].type = CODE_OBJECT_TYPE_PRINT;
+				if(isalpha(C->tokens[i].str[0]) || C->tokens[i].str[0] == '_') {
+					C->pre_compiled_code[C->pcc_entries].CODE_OBJECT_DATA._int->identifier = C->tokens[i].str;
+				}
+				else {
+					C->pre_compiled_code[C->pcc_entries].CODE_OBJECT_DATA._int->value = convert_str_to_int(C->tokens[i].str);
+				}
+				i++;
+				if(strcmp(C->tokens[i].str, ";") != 0) {
+					C->bflags[1] = false;
+					printf("[ERROR] Expected ';' after print, at %d:%d.\n", C->tokens[i].line, C->tokens[i].column);
+					return -1;
+				}
+				C->tasks = true;
+				C->pcc_entries++;
+				continue;
+			}
+			else if(strcmp(C->tokens[i].str, "}") == 0) {
+				// Function end
+				int function_entry = C->functions[C->current_function].id;
+				C->pre_compiled_code[function_entry].CODE_OBJECT_DATA._code_block->end_index = C->pcc_entries;
+				C->bflags[0] = false; // Outside function
+				C->bflags[3] = false; // End set
+				C->functions[C->current_function].token_end = i;
+				C->current_function++;
 			}
 		}
 		else {
 			// Currently parsing outside a function
-			if(strcmp(C->tokens[i].str, "int") == 0) {
+			if(strcmp(C->tokens[i].str, "export") == 0) {
+				// Next declaration is visible outside of a shared object
+				exported = true;
+				continue;
+			}
+			if(strcmp(C->tokens[i].str, "target_clones") == 0) {
+				// Next function gets one body per -march level, _start of executables picks one (calls __chaos_cpu_level)
+				clones = true;
+				C->tasks = C->tasks || (C->format != OUTPUT_FORMAT_ELF64_OBJECT && C->format != OUTPUT_FORMAT_ELF64_SHARED);
+				continue;
+			}
+			if(strcmp(C->tokens[i].str, "constexpr") == 0) {
+				// Function that only runs while compiling
+				i = Constexpr__declare(C, i);
+				if(i < 0) {
+					C->bflags[1] = false;
+					return -1;
+				}
+				continue;
+			}
+			if((length = ParseType(C, i, &type)) > 0) {
 				// Global integer variable or function declaration
-				i++;
+				i = i + length;
 				if(!(i < C->current_token_index)) {
 					// Error
 					C->bflags[1] = false;
@@ -248,10 +644,24 @@ int ParseCode(COMPILER* compiler) {
 				}
 
 				char* temp_identifier = C->tokens[i].str;
+
+				C->pre_compiled_code[C->pcc_entries].CODE_OBJECT_DATA._int = calloc(1, sizeof(PCC__INT));
+				if(C->pre_compiled_code[C->pcc_entries].CODE_OBJECT_DATA._int == NULL) {
+					return -1;
+				}
+				C->pre_compiled_code[C->pcc_entries].CODE_OBJECT_DATA._int->global = true;
+				C->pre_compiled_code[C->pcc_entries].CODE_OBJECT_DATA._int->type = type;
+				C->pre_compiled_code[C->pcc_entries].CODE_OBJECT_DATA._int->exported = exported;
+				exported = false;
 				
 				if(isalpha(C->tokens[i].str[0]) || C->tokens[i].str[0] == '_') {
 					// Save the name of the variable/function in temp_code_object
 					C->pre_compiled_code[C->pcc_entries].CODE_OBJECT_DATA._int->identifier = temp_identifier;
+					C->pre_compiled_code[C->pcc_entries].CODE_OBJECT_DATA._int->asm_identifier = malloc(strlen(temp_identifier) + 13);
+					if(C->pre_compiled_code[C->pcc_entries].CODE_OBJECT_DATA._int->asm_identifier == NULL) {
+						return -1;
+					}
+					sprintf(C->pre_compiled_code[C->pcc_entries].CODE_OBJECT_DATA._int->asm_identifier, "__GLOBALVAR_%s", temp_identifier);
 				}
 
 				i++;
@@ -262,6 +672,30 @@ int ParseCode(COMPILER* compiler) {
 					printf("[ERROR] Definition incomplete. End of file.\n");
 					return -1;
 				}
+				if(clones && strcmp(C->tokens[i].str, "(") != 0) {
+					C->bflags[1] = false;
+					printf("[ERROR] target_clones needs a function, \"%s\" is a variable, at %d:%d.\n", temp_identifier, C->tokens[i].line, C->tokens[i].column);
+					return -1;
+				}
+				if(type != CODE_OBJECT_TYPE_INT && (strcmp(C->tokens[i].str, "[") == 0 || strcmp(C->tokens[i].str, "(") == 0)) {
+					C->bflags[1] = false;
+					printf("[ERROR] Functions and tables are int, \"%s\" is declared with another type, at %d:%d.\n", temp_identifier, C->tokens[i].line, C->tokens[i].column);
+					return -1;
+				}
+				if(strcmp(C->tokens[i].str, "[") == 0) {
+					// Table, the element count is a constant expression
+					C->pre_compiled_code[C->pcc_entries].CODE_OBJECT_DATA._int->count_start = i + 1;
+					while(i < C->current_token_index && strcmp(C->tokens[i].str, "]") != 0) {
+						i++;
+					}
+					C->pre_compiled_code[C->pcc_entries].CODE_OBJECT_DATA._int->count_end = i;
+					i++;
+					if(!(i < C->current_token_index) || strcmp(C->tokens[i].str, "=") != 0) {
+						C->bflags[1] = false;
+						printf("[ERROR] Table \"%s\" needs an initializer.\n", temp_identifier);
+						return -1;
+					}
+				}
 				if(strcmp(C->tokens[i].str, "=") == 0) {
 					i++;
 					if(!(i < C->current_token_index)) {
@@ -302,49 +736,37 @@ int ParseCode(COMPILER* compiler) {
 						}
 					}
 					else {
-						// Set
-						// Get length of number string
-						i++;
-						if(!(i < C->current_token_index)) {
-							// Error
-							C->bflags[1] = false;
-							// Print error
-							printf("[ERROR] Definition incomplete. End of file.\n");
+						// Set (literal or constant expression)
+						i = ParseInitializer(C, i, C->pre_compiled_code[C->pcc_entries].CODE_OBJECT_DATA._int);
+						if(i < 0) {
 							return -1;
 						}
-						int length = 0;
-						for(int j = 0;C->tokens[i].str[j] != '\0';j++) {
-							length++;
-						}
-
-						// Convert to integer number
-						C->pre_compiled_code[C->pcc_entries].CODE_OBJECT_DATA._int->value = convert_str_to_int(C->tokens[i].str);
-
-						// Check for command end
-						i++;
-						if(!(i < C->current_token_index)) {
-							// Error
-							C->bflags[1] = false;
-							// Print error
-							printf("[ERROR] Definition incomplete. End of file.\n");
-							return -1;
-						}
-
-						if(strcmp(C->tokens[i].str, ";") == 0) {
-							C->pcc_entries++;
-							continue;
-						}
+						C->pcc_entries++;
+						continue;
 					}
 				}
 				else if(strcmp(C->tokens[i].str, "(") == 0) {
 					// Read argument list
-					C->pre_compiled_code[C->pcc_entries].type = CODE_OBJECT_TYPE_FUNCTION;
-					C->pre_compiled_code[C->pcc_entries].CODE_OBJECT_DATA._code_block->return_type = CODE_OBJECT_TYPE_INT;
-					C->pre_compiled_code[C->pcc_entries].CODE_OBJECT_DATA._code_block->identifier = temp_identifier;
-					C->pre_compiled_code[C->pcc_entries].CODE_OBJECT_DATA._code_block->function_index = C->current_function;
-					C->functions[C->current_function].name = temp_identifier;
-					C->functions[C->current_function].id = C->pcc_entries;
-					
+					int function_entry = C->pcc_entries;
+					bool function_exported = C->pre_compiled_code[function_entry].CODE_OBJECT_DATA._int->exported;
+					free(C->pre_compiled_code[function_entry].CODE_OBJECT_DATA._int->asm_identifier);
+					free(C->pre_compiled_code[function_entry].CODE_OBJECT_DATA._int);
+					C->pre_compiled_code[function_entry].CODE_OBJECT_DATA._code_block = calloc(1, sizeof(PCC_CODE_BLOCK));
+					if(C->pre_compiled_code[function_entry].CODE_OBJECT_DATA._code_block == NULL) {
+						return -1;
+					}
+					C->pre_compiled_code[function_entry].type = CODE_OBJECT_TYPE_FUNCTION;
+					C->pre_compiled_code[function_entry].CODE_OBJECT_DATA._code_block->return_type = CODE_OBJECT_TYPE_INT;
+					C->pre_compiled_code[function_entry].CODE_OBJECT_DATA._code_block->identifier = temp_identifier;
+					C->pre_compiled_code[function_entry].CODE_OBJECT_DATA._code_block->asm_identifier = temp_identifier;
+					C->pre_compiled_code[function_entry].CODE_OBJECT_DATA._code_block->function_index = C->current_function;
+					C->pre_compiled_code[function_entry].CODE_OBJECT_DATA._code_block->exported = function_exported;
+					C->pre_compiled_code[function_entry].CODE_OBJECT_DATA._code_block->clones = clones;
+					C->functions[C->current_function].name = strdup(temp_identifier);
+					C->functions[C->current_function].id = function_entry;
+					C->functions[C->current_function].token_start = i - 1 - length - function_exported - clones; // "export", "target_clones" or return type
+					clones = false;
+
 					// Read args
 					i++;
 					if(!(i < C->current_token_index)) {
@@ -355,29 +777,25 @@ int ParseCode(COMPILER* compiler) {
 						return -1;
 					}
 					// Count args
-					int arg_count = 1;
-					for(int j = i;j < C->current_token_index;j++) {
-						if(strcmp(C->tokens[j].str, ")") == 0) {
-							break;
-						}
-						else if(strcmp(C->tokens[j].str, ",") == 0) {
-							arg_count++;
+					int arg_count = 0;
+					if(strcmp(C->tokens[i].str, ")") != 0) {
+						arg_count = 1;
+						for(int j = i;j < C->current_token_index;j++) {
+							if(strcmp(C->tokens[j].str, ")") == 0) {
+								break;
+							}
+							else if(strcmp(C->tokens[j].str, ",") == 0) {
+								arg_count++;
+							}
 						}
 					}
-					C->functions[C->current_function].args = malloc(arg_count * sizeof(ARG_LIST));
+					C->functions[C->current_function].arg_count = arg_count;
+					C->functions[C->current_function].args = malloc((arg_count > 0 ? arg_count : 1) * sizeof(ARG_LIST));
 					if(C->functions[C->current_function].args == NULL) {
 						return -1;
 					}
 					// Read args
 					for(int j = 0;j < arg_count;j++) {
-						i++;
-						if(!(i < C->current_token_index)) {
-							// Error
-							C->bflags[1] = false;
-							// Print error
-							printf("[ERROR] Definition incomplete. End of file.\n");
-							return -1;
-						}
 						// Save arg type
 						if(strcmp(C->tokens[i].str, "int") == 0) {
 							C->functions[C->current_function].args[j].type = CODE_OBJECT_TYPE_INT;
@@ -400,7 +818,14 @@ int ParseCode(COMPILER* compiler) {
 
 						// Save arg name
 						C->functions[C->current_function].args[j].name = strdup(C->tokens[i].str);
+						C->functions[C->current_function].args[j].escapes = false;
+						if(i + 2 < C->current_token_index && strcmp(C->tokens[i + 1].str, "[") == 0 && strcmp(C->tokens[i + 2].str, "]") == 0) {
+							// Array argument ("int a[]"), passed as a pointer
+							C->functions[C->current_function].args[j].type = CODE_OBJECT_TYPE_ARRAY;
+							i = i + 2;
+						}
 
+						// Skip ',' (')' ends the list)
 						i++;
 						if(!(i < C->current_token_index)) {
 							// Error
@@ -409,35 +834,29 @@ int ParseCode(COMPILER* compiler) {
 							printf("[ERROR] Definition incomplete. End of file.\n");
 							return -1;
 						}
-					}
-					// Update function end
-					C->pcc_entries++;
-					C->pre_compiled_code[C->pcc_entries].CODE_OBJECT_DATA._code_block->start_index = C->pcc_entries;
-					while (strcmp(C->tokens[i].str, "{") != 0) {
-						int curly_brace_count = 0;
-						int j = i;
-						while(strcmp(C->tokens[j].str, "}") != 0 && curly_brace_count <= 0) {
-							j++;
-							if(!(j < C->current_token_index)) {
-								// Error
-								C->bflags[1] = false;
-								// Print error
-								printf("[ERROR] Definition incomplete. End of file.\n");
-								return -1;
-							}
-							if(strcmp(C->tokens[j].str, "{") == 0) {
-								curly_brace_count++;
-							}
-							else if(strcmp(C->tokens[j].str, "}") == 0) {
-								curly_brace_count--;
-							}
+						if(strcmp(C->tokens[i].str, ",") == 0) {
+							i++;
 						}
-						C->bflags[0] = true; // Inside function
-						C->bflags[3] = true; // End not set
-						i++;
 					}
-					C->current_function++;
-					
+
+					// Function body
+					i++;
+					if(!(i < C->current_token_index)) {
+						// Error
+						C->bflags[1] = false;
+						// Print error
+						printf("[ERROR] Definition incomplete. End of file.\n");
+						return -1;
+					}
+					if(strcmp(C->tokens[i].str, "{") != 0) {
+						C->bflags[1] = false;
+						printf("[ERROR] Expected '{' after argument list of \"%s\", at %d:%d.\n", temp_identifier, C->tokens[i].line, C->tokens[i].column);
+						return -1;
+					}
+					C->pcc_entries++;
+					C->pre_compiled_code[function_entry].CODE_OBJECT_DATA._code_block->start_index = C->pcc_entries;
+					C->bflags[0] = true; // Inside function
+					C->bflags[3] = true; // End not set
 				}
 			}
 			else if(strcmp(C->tokens[i].str, "return") == 0) {
@@ -459,110 +878,298 @@ int ParseCode(COMPILER* compiler) {
 }
 
 int Translate(COMPILER* compiler) {
-	// Open temporary assembly file
-	C->temp_assembly = fopen(C->temp_assembly_file, "w+");
-	if(!C->temp_assembly) {
-		printf("[ERROR] Could not create/reopen temporary assembly file.\n");
+	// Translate the pre-compiled code into machine code (C->image)
+	// Functions are translated in parallel by C->threads threads
+	// Functions whose key did not change are taken from the cache
+	// A profile (-fprofile-use) orders the functions
+	TimeReport__begin(C);
+	int ret = Constexpr__evaluate(C);
+	TimeReport__end(C, "constexpr");
+	if(ret != 0) {
+		return -1;
+	}
+	TimeReport__begin(C);
+	ret = Escape__analyze(C);
+	TimeReport__end(C, "escape");
+	if(ret != 0) {
+		return -1;
+	}
+	TimeReport__begin(C);
+	ret = Cache__prepare(C);
+	TimeReport__end(C, "cache");
+	if(ret != 0) {
 		return -1;
 	}
-	// Write assembly header (no calling main for now, just zero out bss)
-	fputs("section .data\nsection .text\nglobal _start\n_start:\n\tmov rdi, bss_start\n\tmov rcx, bss_end\n\tsub rcx, rdi\n\txor rax, rax\n\trep stosb", C->temp_assembly);
-	// Reopen for appending
-	fclose(C->temp_assembly);
-	C->temp_assembly = fopen(C->temp_assembly_file, "a+");
-	if(!C->temp_assembly) {
-		printf("[ERROR] Could not create/reopen temporary assembly file.\n");
+	TimeReport__begin(C);
+	ret = Bytecode__compile(C);
+	TimeReport__end(C, "bytecode");
+	if(ret != 0) {
 		return -1;
 	}
-	// Read global variable definitions
-	for(int i = 0;i < C->pcc_entries;i++) {
-		switch(C->pre_compiled_code[i].type) {
-			case CODE_OBJECT_TYPE_INT: {
-				// Add global variable of type integer
-				// Check for standard value
-				fprintf(C->temp_assembly, "\tmov [%s], 00100110b\n", C->pre_compiled_code[i].CODE_OBJECT_DATA._int->asm_identifier);
-				if(C->pre_compiled_code[i].CODE_OBJECT_DATA._int->value != 0) {
-					fprintf(C->temp_assembly, "\tmov [%s], %d\n", C->pre_compiled_code[i].CODE_OBJECT_DATA._int->asm_identifier, C->pre_compiled_code[i].CODE_OBJECT_DATA._int->value);
-				}
-			} break;
-		}
-	}
-	for(int i = 0;i < C->pcc_entries;i++) {
-		switch(C->pre_compiled_code[i].type) {
-			case CODE_OBJECT_TYPE_INT: {
-				// IDK.
-			} break;
-			case CODE_OBJECT_TYPE_RETURN: {
-				//
-			} break;
-			case CODE_OBJECT_TYPE_FUNCTION: {
-				//
-			} break;
-			default: {
-				printf("[ERROR] Kinks.\n");
-			} break;
-		}
-	}
-	fclose(C->temp_assembly);
+	if(C->pgo.path != NULL) {
+		TimeReport__begin(C);
+		ret = Pgo__load(C);
+		TimeReport__end(C, "pgo");
+		if(ret != 0) {
+			return -1;
+		}
+	}
+	TimeReport__begin(C);
+	ret = Translator__x86_64(C);
+	TimeReport__end(C, "translate");
+	if(C->cache.enabled && C->verbose) {
+		printf("[INFO] Function cache: %d hits, %d misses.\n", C->cache.hits, C->cache.misses);
+	}
+	return ret;
 }
 
-int Assemble(COMPILER* compiler) {
-	// Build assembler call
-	// Calculate length
-	int length = C->assembler_length;
-	for(int i = 0;i < C->current_assembler_flag;i++) {
-		length = length + C->assembler_flags_length[i];
+int LinkRuntime(COMPILER* compiler) {
+	// spawn/join, go/await and print call into the runtime (objects get it from --link)
+	FILE* file = fopen(C->runtime, "rb");
+	if(file == NULL) {
+		printf("[ERROR] Could not open runtime \"%s\" (make runtime, --runtime <file>).\n", C->runtime);
+		return -1;
 	}
-	length = length + C->temp_assembly_file_length;
-
-	// Allocate call buffer
-	char* assembler_call = malloc(length * sizeof(char));
-	char* temp = assembler_call;
-	if(temp == NULL || assembler_call == NULL) {
-		return 1;
+	fseek(file, 0, SEEK_END);
+	long size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	uint8_t* data = malloc(size > 0 ? size : 1);
+	int ret = -1;
+	if(data != NULL && fread(data, 1, size, file) == (size_t)size) {
+		ret = Linker__load_object(&C->image, data, size, C->runtime, 1);
+	}
+	else {
+		printf("[ERROR] Could not read runtime \"%s\".\n", C->runtime);
 	}
+	free(data);
+	fclose(file);
+	return ret;
+}
 
-	// Write call
-	strncpy(temp, C->ASSEMBLER, C->assembler_length);
-	temp = temp + C->assembler_length;
-	for(int i = 0;i < C->current_assembler_flag;i++) {
-		strncpy(temp, C->assembler_flags[i], C->assembler_flags_length[i]);
-		temp = temp + C->assembler_flags_length[i];
+int Assemble(COMPILER* compiler) {
+	// Write the executable directly (no external assembler or linker)
+	C->image.soname = C->output_file;
+	C->image.source = C->debug ? C->fName : NULL;
+	if(C->format == OUTPUT_FORMAT_ELF64_OBJECT && C->lto_source != NULL) {
+		C->image.ir = C->lto_source;
+		C->image.ir_size = C->lto_source_size;
+	}
+	if(C->tasks && C->format != OUTPUT_FORMAT_ELF64_OBJECT && LinkRuntime(C) != 0) {
+		return -1;
 	}
-	strncpy(temp, C->temp_assembly_file, C->temp_assembly_file_length);
+	return Linker__write_file(&C->image, C->output_file, C->format);
+}
 
-	// Call assembler
-	system(assembler_call);
-	
-	// Clean up
-	free(assembler_call);
-	return 0;
+int RunScript(COMPILER* compiler) {
+	// Run the script sections in the virtual machine, inputs are 0
+	// and loops get the budget of compile time evaluation (-fconstexpr-steps)
+	if(C->script == NULL) {
+		printf("[ERROR] There are no script sections to run.\n");
+		return -1;
+	}
+	SCRIPT_VM vm;
+	if(Script__load(&vm, C->script, C->script_size) != 0) {
+		return -1;
+	}
+	vm.budget = C->evaluator.steps;
+	int64_t inputs[SCRIPT_MAX_REGISTERS] = {0};
+	int64_t result = 0;
+	int ret = Script__run(&vm, inputs, &result);
+	if(ret == SCRIPT_OK) {
+		printf("[INFO] Script returned %lld.\n", (long long)result);
+	}
+	else {
+		printf("[ERROR] Script stopped: %s.\n", ret == SCRIPT_ERROR_DIVISION ? "division by zero" : "loop budget exceeded");
+	}
+	Script__free(&vm);
+	return ret == SCRIPT_OK ? 0 : -1;
 }
 
 int compile(char* fileName, int maxTokens, int maxFunctions,
-	int maxIdentifiers, int maxErrors);
+	int maxIdentifiers, int maxErrors, COMPILER_OPTIONS* options);
+
+int run(int argc, char* argv[]);
 
 int main(int argc, char* argv[]) {
+	if(argc >= 2 && strcmp(argv[1], "--server") == 0) {
+		// Compile server (--server [socket [memory limit of each cache in bytes]])
+		Cache__keep_in_memory(true, argc >= 4 ? strtoull(argv[3], NULL, 10) : 0);
+		return Server__run(argc >= 3 ? argv[2] : SERVER_SOCKET, run);
+	}
+	if(argc >= 3 && strcmp(argv[1], "--client") == 0) {
+		// Forward to the compile server (--client <socket> <arguments>), compile here if none is running
+		char* socket = argv[2];
+		argv[2] = argv[0];
+		int status = 0;
+		if(Server__request(socket, argc - 2, argv + 2, &status) == 0) {
+			return status;
+		}
+		return run(argc - 2, argv + 2);
+	}
+	if(argc >= 3 && strcmp(argv[1], "--profile-report") == 0) {
+		// Report of a -finstrument profile (--profile-report <file> [--call-graph])
+		return ProfileReport__print(argv[2], argc >= 4 && strcmp(argv[3], "--call-graph") == 0) != 0;
+	}
+	if(argc >= 4 && strcmp(argv[1], "--archive") == 0) {
+		// Static library (--archive <output> <objects>)
+		return Archive__write(argv[2], argv + 3, argc - 3);
+	}
+	if(argc >= 5 && (strcmp(argv[1], "--link") == 0 || strcmp(argv[1], "--shared") == 0) && strcmp(argv[2], "-flto") == 0) {
+		// Link-time optimization (--link|--shared -flto [-v] <output> <inputs>)
+		uint8_t format = strcmp(argv[1], "--shared") == 0 ? OUTPUT_FORMAT_ELF64_SHARED : OUTPUT_FORMAT_ELF64_LINUX;
+		bool verbose = strcmp(argv[3], "-v") == 0;
+		if(verbose && argc < 6) {
+			printf("[ERROR] Not enough arguments.\n");
+			return -1;
+		}
+		return Lto__link(argv[3 + verbose], argv + 4 + verbose, argc - 4 - verbose, format, verbose, run);
+	}
+	if(argc >= 4 && strcmp(argv[1], "--link") == 0) {
+		// Executable (--link <output> <objects and static libraries>)
+		return Linker__link(argv[2], argv + 3, argc - 3, OUTPUT_FORMAT_ELF64_LINUX);
+	}
+	if(argc >= 4 && strcmp(argv[1], "--shared") == 0) {
+		// Shared object (--shared <output> <objects compiled with -fPIC and static libraries>)
+		return Linker__link(argv[2], argv + 3, argc - 3, OUTPUT_FORMAT_ELF64_SHARED);
+	}
+	return run(argc, argv);
+}
+
+int run(int argc, char* argv[]) {
 	// DEBUG: Argument chack
 	if(argc < 6) {
-		printf("[ERROR] Not enough arguments.\n<file> <max functions> <max identifiers> <max errors before terminating> <max tokens> <assemble>\n");
+		printf("[ERROR] Not enough arguments.\n<file> <max functions> <max identifiers> <max errors before terminating> <max tokens> <assemble> [-j <threads>] [-f <format>] [-o <output>] [-c] [-fPIC] [-shared] [-flto] [--whole-program] [--run-script] [-fconstexpr-steps=<n>] [-fconstexpr-depth=<n>] [-fconstexpr-memory=<bytes>] [--runtime <file>] [--no-cache] [-ftime-report[=json]] [--list-tokens] [-finstrument[=<file>]] [-fprofile-use=<file>] [-g] [-march=<level>] [-v]\n");
 		return -1;
 	}
 
-	return compile(argv[1], atoi(argv[5]), atoi(argv[2]), atoi(argv[3]), atoi(argv[4]));
+	COMPILER_OPTIONS options = { false, 1, OUTPUT_FORMAT_ELF64_LINUX, "./build/ChaosLangCompiler/a.out", true, false, false, false, false,
+		CONSTEXPR_DEFAULT_STEPS, CONSTEXPR_DEFAULT_DEPTH, CONSTEXPR_DEFAULT_MEMORY, TASKS_RUNTIME_DEFAULT, TIME_REPORT_OFF, false, NULL, NULL, false, KERNELS_LEVEL_X86_64, false };
+	int i = 6;
+	if(i < argc && argv[i][0] != '-') {
+		options.assemble = atoi(argv[i]) != 0;
+		i++;
+	}
+	for(;i < argc;i++) {
+		if(strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+			options.threads = atoi(argv[++i]);
+			if(options.threads < 1) {
+				options.threads = 1;
+			}
+		}
+		else if(strcmp(argv[i], "-f") == 0 && i + 1 < argc) {
+			int format = Linker__format(argv[++i]);
+			if(format < 0) {
+				printf("[ERROR] \"%s\" is an invalid Format.\n", argv[i]);
+				return -1;
+			}
+			options.format = (uint8_t)format;
+		}
+		else if(strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+			options.output_file = argv[++i];
+		}
+		else if(strcmp(argv[i], "-c") == 0) {
+			// Object file for --link and --archive
+			options.format = OUTPUT_FORMAT_ELF64_OBJECT;
+		}
+		else if(strcmp(argv[i], "-fPIC") == 0) {
+			options.pic = true;
+		}
+		else if(strcmp(argv[i], "-shared") == 0) {
+			// Shared object of this file only (--shared links several objects)
+			options.format = OUTPUT_FORMAT_ELF64_SHARED;
+		}
+		else if(strcmp(argv[i], "-flto") == 0) {
+			// Objects also carry the source for "--link -flto"
+			options.lto = true;
+		}
+		else if(strcmp(argv[i], "--whole-program") == 0) {
+			options.whole_program = true;
+		}
+		else if(strcmp(argv[i], "--run-script") == 0) {
+			// Run the script sections once (inputs are 0) and print the result
+			options.run_script = true;
+		}
+		else if(strncmp(argv[i], "-fconstexpr-steps=", 18) == 0) {
+			options.constexpr_steps = strtoull(argv[i] + 18, NULL, 10);
+		}
+		else if(strncmp(argv[i], "-fconstexpr-depth=", 18) == 0) {
+			options.constexpr_depth = atoi(argv[i] + 18);
+		}
+		else if(strncmp(argv[i], "-fconstexpr-memory=", 19) == 0) {
+			options.constexpr_memory = strtoull(argv[i] + 19, NULL, 10);
+		}
+		else if(strcmp(argv[i], "--runtime") == 0 && i + 1 < argc) {
+			// Runtime object for spawn/join and go/await (make runtime)
+			options.runtime = argv[++i];
+		}
+		else if(strcmp(argv[i], "--no-cache") == 0) {
+			options.cache = false;
+		}
+		else if(strcmp(argv[i], "-ftime-report") == 0) {
+			options.time_report = TIME_REPORT_TABLE;
+		}
+		else if(strcmp(argv[i], "-ftime-report=json") == 0) {
+			options.time_report = TIME_REPORT_JSON;
+		}
+		else if(strcmp(argv[i], "--list-tokens") == 0) {
+			options.list_tokens = true;
+		}
+		else if(strcmp(argv[i], "-finstrument") == 0) {
+			// Count calls and cycles of every function (Runtime/Profile/profile.h)
+			options.instrument = PROFILE_DEFAULT_FILE;
+		}
+		else if(strncmp(argv[i], "-finstrument=", 13) == 0 && argv[i][13] != '\0') {
+			options.instrument = argv[i] + 13;
+		}
+		else if(strncmp(argv[i], "-fprofile-use=", 14) == 0 && argv[i][14] != '\0') {
+			// Function layout from a -finstrument profile (Optimizer/PGO/pgo.h)
+			options.profile_use = argv[i] + 14;
+		}
+		else if(strcmp(argv[i], "-g") == 0) {
+			// Line table and unwind tables (Linker/ELF64/debug.c)
+			options.debug = true;
+		}
+		else if(strncmp(argv[i], "-march=", 7) == 0) {
+			// Instruction set (Translator/x86_64/translator.h)
+			options.march = Translator__march(argv[i] + 7);
+			if(options.march < 0) {
+				printf("[ERROR] \"%s\" is an invalid CPU level (x86-64, x86-64-v2, x86-64-v3 or x86-64-v4).\n", argv[i] + 7);
+				return -1;
+			}
+		}
+		else if(strcmp(argv[i], "-v") == 0) {
+			// Statistics of the passes
+			options.verbose = true;
+		}
+		else {
+			printf("[ERROR] Argument \"%s\" is invalid.\n", argv[i]);
+			return -1;
+		}
+	}
+
+	if(options.instrument != NULL && options.format != OUTPUT_FORMAT_ELF64_LINUX) {
+		printf("[ERROR] -finstrument needs an executable (the profile is written when main returns).\n");
+		return -1;
+	}
+
+	return compile(argv[1], atoi(argv[5]), atoi(argv[2]), atoi(argv[3]), atoi(argv[4]), &options);
 }
 
 int compile(char* fileName, int maxTokens, int maxFunctions,
-	int maxIdentifiers, int maxErrors) {
+	int maxIdentifiers, int maxErrors, COMPILER_OPTIONS* options) {
 	// Initalize compiler object
 	COMPILER compiler = {
 		/* Flags */ { 0, 0, 0 }, { false, false }, { false },
-		/* Meta data */ 1, 1, NULL, fopen(fileName, "r"), 0,
+		/* Meta data */ 1, 1, NULL, Cache__open_source(fileName), 0,
 		/* Changing data */ 1, 0, 0, 0, 0,
 		/* Assembler meta data*/ 4, NULL, 1, NULL, NULL, 14, NULL,
 		/* Limits */ 1024, 250, 450, 500,250, 700,
 		/* Compilation data */ NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL
 	};
+	if(C.fptr == NULL) {
+		printf("[ERROR] Could not open \"%s\".\n", fileName);
+		return -1;
+	}
 	C.fName = strdup(fileName);
 	C.temp_assembly_file = strdup("./build/ChaosLangCompiler/temp_asm.asm");
 	C.ASSEMBLER = strdup("nasm");
@@ -573,20 +1180,63 @@ int compile(char* fileName, int maxTokens, int maxFunctions,
 	C.tokens = malloc(C.MAX_TOKENS * sizeof(Token));
 	C.functions = malloc(C.MAX_FUNCTIONS * sizeof(FUNCTION));
 	C.identifiers = malloc(C.MAX_IDENTIFIERS * sizeof(IDENTIFIER));
-	C.code_buffer = malloc(257 * sizeof(char));
+	C.code_buffer = calloc(257, sizeof(char));
 	C.code_buffer[256] = '\0';
-	C.pre_compiled_code = malloc(2500 * sizeof(CODE_OBJECT));
+	C.pre_compiled_code = malloc((C.MAX_TOKENS > 2500 ? C.MAX_TOKENS : 2500) * sizeof(CODE_OBJECT)); // At most one entry per token
 	C.asm_identifier_list = malloc(C.MAX_ASM_ID * sizeof(char*));
 	C.defines = malloc(C.MAX_DEFINES * sizeof(DEFINE));
+	C.bflagsArgs[0] = options->assemble;
+	C.bflagsArgs[1] = options->list_tokens;
+	C.bflagsArgs[2] = true; // Returns delete the frame in place (as short as the jump to the end)
+	C.threads = options->threads;
+	C.format = options->format;
+	C.pic = options->pic || options->format == OUTPUT_FORMAT_ELF64_SHARED;
+	C.debug = options->debug;
+	C.output_file = options->output_file;
+	C.cache.enabled = options->cache && options->instrument == NULL; // Counter offsets depend on the whole file
+	C.whole_program = options->whole_program;
+	C.run_script = options->run_script;
+	C.evaluator.steps = options->constexpr_steps;
+	C.evaluator.max_depth = options->constexpr_depth;
+	C.evaluator.memory = options->constexpr_memory;
+	C.runtime = options->runtime;
+	C.time_report.mode = options->time_report;
+	C.verbose = options->verbose;
+	C.instrument.path = options->instrument;
+	C.pgo.path = options->profile_use;
+	C.target.level = options->march;
+	C.tasks = options->instrument != NULL; // The profile is written by the runtime
+	C.tasks = C.tasks || (C.target.level > KERNELS_LEVEL_X86_64 && C.format != OUTPUT_FORMAT_ELF64_OBJECT && C.format != OUTPUT_FORMAT_ELF64_SHARED); // _start checks the CPU
+	if(options->lto) {
+		FILE* source = fopen(fileName, "rb");
+		if(source != NULL) {
+			fseek(source, 0, SEEK_END);
+			long size = ftell(source);
+			fseek(source, 0, SEEK_SET);
+			C.lto_source = malloc(size > 0 ? size : 1);
+			if(C.lto_source != NULL && fread(C.lto_source, 1, size, source) == (size_t)size) {
+				C.lto_source_size = size;
+			}
+			fclose(source);
+		}
+	}
 	bool done = false;                // While flag
 	int c = '\0';                     // Character holder
+	int ret = 0;                      // Exit status, any failed phase fails the compile
 
 	// Compiling chain
 	while(!done) {
 		// Pre-processor
-		PreProcessor(&C);
+		TimeReport__begin(&C);
+		int preprocessed = PreProcessor(C.fptr, &C);
+		TimeReport__end(&C, "preprocess");
+		if(preprocessed != 0) {
+			ret = -1;
+			break;
+		}
 
 		// Process into token
+		TimeReport__begin(&C);
 		// 1.Get the first character from fptr
 		c = fgetc(C.fptr);
 		// 2.Read trough file
@@ -675,9 +1325,15 @@ int compile(char* fileName, int maxTokens, int maxFunctions,
 			else {
 				// Other characters (Argument list, calculations, access, ...)
 				switch(c) {
-					// End of command / = / + / ! / < / >
+					// End of command / = / + / - / * / % / ! / < / > / , / [ / ]
+					case (int)',':
+					case (int)'[':
+					case (int)']':
 					case (int)'=':
 					case (int)'+':
+					case (int)'-':
+					case (int)'*':
+					case (int)'%':
 					case (int)'!':
 					case (int)'<':
 					case (int)'>':
@@ -807,37 +1463,63 @@ int compile(char* fileName, int maxTokens, int maxFunctions,
 								}
 							}
 						}
+						else {
+							// Division, the character after it is read again
+							C.tokens[C.current_token_index].str = strdup("/");
+							C.tokens[C.current_token_index].length = 1;
+							C.tokens[C.current_token_index].column = C.column - 1;
+							C.tokens[C.current_token_index].line = C.line;
+							C.current_token_index++;
+							ungetc(c, C.fptr);
+						}
 						C.token_start = C.column;
 						i = -1;
 					} break;
 					default: {
 						printf("[FATAL ERROR] Unsupported character, at %d:%d.\n", C.line, C.column);
-						//return -1;
+						ret = -1;
 					} break;
 				}
 			}
 			c = fgetc(C.fptr);
 		}
 		
+		TimeReport__end(&C, "lex");
+
 		// Print tokens
-		for(int j = 0;j < C.current_token_index;j++) {
-			printf("\"");
-			printf(C.tokens[j].str);
-			printf("\", start: %d\n", C.tokens[j].column);
+		for(int j = 0;C.bflagsArgs[1] && j < C.current_token_index;j++) {
+			printf("\"%s\", start: %d\n", C.tokens[j].str, C.tokens[j].column);
 		}
 
 		// Parse code
-		ParseCode(&C);
+		TimeReport__begin(&C);
+		int parsed = ParseCode(&C);
+		TimeReport__end(&C, "parse");
 
 		// Translate
-		Translate(&C);
+		int translated = parsed == 0 && ret == 0 ? Translate(&C) : -1;
+		if(translated != 0) {
+			ret = -1;
+		}
 
-		
-		if(C.bflagsArgs[0]) {
+		if(C.run_script && translated == 0) {
+			TimeReport__begin(&C);
+			if(RunScript(&C) != 0) {
+				ret = -1;
+			}
+			TimeReport__end(&C, "script");
+		}
+
+		if(C.bflagsArgs[0] && translated == 0) {
 			// Assemble
-			Assemble(&C);
+			TimeReport__begin(&C);
+			if(Assemble(&C) != 0) {
+				ret = -1;
+			}
+			TimeReport__end(&C, "assemble");
 		}
 	}
+	TimeReport__print(&C);
 	
 	// Clean up
 	free(C.fName);
@@ -861,6 +1543,23 @@ int compile(char* fileName, int maxTokens, int maxFunctions,
 		free(C.list_of_types);
 	}
 	free(C.code_buffer);
+	for(int i = 0;i < C.current_define;i++) {
+		free(C.defines[i].name);
+		free(C.defines[i].value);
+	}
+	free(C.defines);
+	Constexpr__free(&C);
+	Translator__free_instrument(&C);
+	Pgo__free(&C);
 	free(C.pre_compiled_code);
-	return 0;
+	free(C.lto_source);
+	free(C.live);
+	free(C.script_tokens);
+	free(C.script);
+	Linker__free_image(&C.image);
+	Cache__free(&C);
+	if(C.fptr != NULL) {
+		fclose(C.fptr);
+	}
+	return ret;
 }
\ No newline at end of file